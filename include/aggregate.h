@@ -0,0 +1,119 @@
+#ifndef AGGREGATE_H
+#define AGGREGATE_H
+
+/*! \file aggregate.h
+ *  \brief Definitions for grouping the entries of a book store.
+ *
+ *  Entries are grouped by the value of one member and each group counts
+ *  its entries along with the minimum, maximum and sum of a numeric member.
+ *  Groups are gathered in a single pass into an open addressing table,
+ *  reading the columns of both members when they are up to date;
+ *  large book stores are split into partitions, grouped concurrently by the
+ *  shared pool and merged at the end.
+ */
+
+#include <stdio.h>
+#include "book.h"
+
+/*! \def AGGREGATE_PARALLEL_ROWS
+ *  \brief Default number of entries from which grouping runs in parallel.
+ */
+#define AGGREGATE_PARALLEL_ROWS 16384
+
+/*! \typedef aggregate_order_t
+ *  \brief Enumeration of the orders of groups.
+ *
+ *  Groups are sorted by decreasing count, sum, mean or maximum, by
+ *  increasing minimum or by value. Ties are broken by value.
+ */
+typedef enum
+{
+    AGGREGATE_BY_COUNT,
+    AGGREGATE_BY_SUM,
+    AGGREGATE_BY_MEAN,
+    AGGREGATE_BY_MIN,
+    AGGREGATE_BY_MAX,
+    AGGREGATE_BY_VALUE,
+    AGGREGATE_ORDERS
+} aggregate_order_t;
+
+/*! \typedef aggregate_group_t
+ *  \brief Type definition of the entries sharing a value.
+ *
+ *  The minimum, maximum and sum only cover the g_values entries whose
+ *  numeric member could be parsed.
+ */
+typedef struct
+{
+    const char *g_value;
+    unsigned long long g_len;
+    unsigned long g_count;
+    unsigned long g_values;
+    long g_min;
+    long g_max;
+    long long g_sum;
+} aggregate_group_t;
+
+/*! \typedef book_aggregate_t
+ *  \brief Type definition of the groups of a book store.
+ *
+ *  The values of the groups are copied into a_values, so the groups stay
+ *  valid after the book store is modified or destroyed.
+ */
+typedef struct
+{
+    aggregate_group_t *a_groups;
+    unsigned long a_count;
+    unsigned long a_rows;
+    entry_field_t a_field;
+    entry_field_t a_measure;
+    char *a_values;
+} book_aggregate_t;
+
+/*! \fn book_aggregate_t *book_aggregate( const book_t *book, entry_field_t field, entry_field_t measure )
+ *  \brief Groups the entries of a book store by the value of a member.
+ *  \param book The book store to be grouped.
+ *  \param field The member whose values identify the groups.
+ *  \param measure Either ENTRY_PAGES or ENTRY_PUBDATE, the numeric member
+ *  summarized by each group.
+ *  \return On success the groups are returned, in no particular order.
+ *  Otherwise NULL is returned and errno is set appropriately.
+ *  \exception EINVAL The member is unknown or the measure is not numeric.
+ *  \exception ENOMEM Not enough memory to allocate the groups.
+ */
+extern book_aggregate_t *book_aggregate( const book_t *book, entry_field_t field,
+                                         entry_field_t measure );
+
+/*! \fn void book_aggregate_sort( book_aggregate_t *aggregate, aggregate_order_t order, unsigned long limit )
+ *  \brief Sorts the groups and keeps the first of them.
+ *
+ *  When fewer groups are kept than there are, the first ones are selected
+ *  through a heap of limit groups before being sorted.
+ *  \param aggregate The groups to be sorted.
+ *  \param order The order of the groups.
+ *  \param limit The number of groups to be kept, or zero to keep all.
+ */
+extern void book_aggregate_sort( book_aggregate_t *aggregate, aggregate_order_t order,
+                                 unsigned long limit );
+
+/*! \fn void book_aggregate_print( FILE *file, const book_aggregate_t *aggregate )
+ *  \brief Prints the groups as a table.
+ *  \param file The stream where to print the table.
+ *  \param aggregate The groups to be printed.
+ */
+extern void book_aggregate_print( FILE *file, const book_aggregate_t *aggregate );
+
+/*! \fn void book_aggregate_destroy( book_aggregate_t *aggregate )
+ *  \brief Destroys groups.
+ *  \param aggregate The groups to be destroyed.
+ */
+extern void book_aggregate_destroy( book_aggregate_t *aggregate );
+
+/*! \fn void aggregate_set_parallel( unsigned long rows )
+ *  \brief Sets the number of entries from which grouping runs in parallel.
+ *  \param rows The smallest book store to be grouped in parallel, or zero
+ *  to always group on the calling thread.
+ */
+extern void aggregate_set_parallel( unsigned long rows );
+
+#endif /* AGGREGATE_H */
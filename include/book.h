@@ -33,12 +33,28 @@ typedef struct entry_node
  *  \brief Type definition of an book store.
  *
  *  This is a doubly linked list implementation that contains a head and
- *  tail.
+ *  tail. The version is incremented whenever an entry is added or removed
+ *  and lets lazily built indexes detect that they are out of date.
+ *
+ *  A sealed book store has its entries changed only through book_set_field,
+ *  which counts the edits of each member in the book store itself, or by
+ *  its owner, which increments the version itself. Its indexes thus ignore
+ *  edits of entries held elsewhere. A book store must be sealed before it
+ *  is first indexed.
+ *
+ *  A book store may hold at most one entry per ISBN, checked through a hash
+ *  set of its entry nodes kept up to date by additions and removals.
  */
 typedef struct
 {
     entry_node_t *a_head;
     entry_node_t *a_tail;
+    unsigned long a_count;
+    unsigned long a_version;
+    int a_sealed;
+    unsigned long a_generations[ ENTRY_FIELDS ];
+    struct book_index *a_index;
+    struct book_unique *a_unique;
 } book_t;
 
 /*! \fn book_t *book_create( void )
@@ -69,19 +85,29 @@ extern book_t *book_duplicate( const book_t *book );
  */
 extern entry_node_t *book_get( const book_t *book, unsigned index );
 
-/*! \fn void book_write( FILE *file, book_t *book )
+/*! \fn int book_write( FILE *file, book_t *book )
  *  \brief Writes an book store in binary format to a specified stream.
  *  \param file The stream where to write the book store.
  *  \param book The book store to be written.
+ *  \return On success zero is returned. Otherwise -1 is returned and errno
+ *  is set appropriately.
+ *  \exception EIO A lazy description could not be read.
  */
-extern void book_write( FILE *file, book_t *book );
+extern int book_write( FILE *file, book_t *book );
 
 /*! \fn void book_t *book_read( FILE *file )
  *  \brief Reads an book store in binary format from a specified stream.
+ *
+ *  Both the legacy format written by book_write and the compressed
+ *  container written by book_write_packed are accepted. A manifest of
+ *  shard files is only read by book_load.
  *  \param file The stream from where to read the entry.
  *  \return On success a new book store with read values is returned.
- *  Otherwise NULL is returned and errno is set appropriately.
+ *  Otherwise NULL is returned and errno is set appropriately. An empty
+ *  stream is read as an empty book store.
  *  \exception ENOMEM Not enough memeory to allocate the entry.
+ *  \exception EIO The stream is truncated, malformed or fails its
+ *  checksums.
  */
 extern book_t *book_read( FILE *file );
 
@@ -93,9 +119,40 @@ extern book_t *book_read( FILE *file );
  *  is returned and errno is set appropriately.
  *  \exception ENOMEM Not enough memory to allocate an entry node or
  *  duplicate an entry.
+ *  \exception EEXIST The book store holds unique ISBNs and already holds
+ *  the ISBN of the entry.
  */
 extern int book_add( book_t *book, entry_t *entry );
 
+/*! \fn int book_add_take( book_t *book, entry_t *entry )
+ *  \brief Adds an entry to the end of an book store, which takes ownership
+ *  of it instead of duplicating it.
+ *  \param book The book store for which an entry is to be added.
+ *  \param entry The entry to be added, destroyed along with the book store.
+ *  \return On success the entry is added and zero is returned. Otherwise -1
+ *  is returned, errno is set appropriately and the entry still belongs to
+ *  the caller.
+ *  \exception ENOMEM Not enough memory to allocate an entry node.
+ *  \exception EEXIST The book store holds unique ISBNs and already holds
+ *  the ISBN of the entry.
+ */
+extern int book_add_take( book_t *book, entry_t *entry );
+
+/*! \fn int book_append( book_t *book, entry_t *entry )
+ *  \brief Adds an entry to the end of an book store without duplicating it.
+ *
+ *  This is how result book stores sharing their entries with the searched
+ *  book store are built.
+ *  \param book The book store for which an entry is to be added.
+ *  \param entry The entry to be added.
+ *  \return On success the entry is added and zero is returned. Otherwise -1
+ *  is returned and errno is set appropriately.
+ *  \exception ENOMEM Not enough memory to allocate an entry node.
+ *  \exception EEXIST The book store holds unique ISBNs and already holds
+ *  the ISBN of the entry.
+ */
+extern int book_append( book_t *book, entry_t *entry );
+
 /*! \fn int book_add_all( book_t *book, book_t *some_book )
  *  \brief Duplicates and adds all entries from another book store.
  *  \param book The book store for which entries are too be added.
@@ -104,9 +161,79 @@ extern int book_add( book_t *book, entry_t *entry );
  *  -1 is returned and errno is set appropriately.
  *  \exception ENOMEM Not enough memory to allocate an entry node or
  *  duplicate an entry.
+ *  \exception EEXIST The book store holds unique ISBNs and already holds
+ *  the ISBN of an entry, which was not added nor were the entries after it.
  */
 extern int book_add_all( book_t *book, book_t *some_book );
 
+/*! \fn long book_merge( book_t *book, book_t *some_book )
+ *  \brief Duplicates and upserts all entries from another book store.
+ *
+ *  An entry whose ISBN is already held replaces the entry holding it,
+ *  which is destroyed, and is moved to the end of the book store. Other
+ *  entries are added. Each entry costs a lookup in the hash set of ISBNs.
+ *  If the book store did not hold unique ISBNs, a hash set is built for
+ *  the merge only and released afterwards, leaving the book store
+ *  unconstrained.
+ *  \param book The book store into which entries are to be merged.
+ *  \param some_book The book store containing all entries to be merged.
+ *  \return On success the number of replaced entries is returned.
+ *  Otherwise -1 is returned and errno is set appropriately.
+ *  \exception EINVAL Both book stores are the same.
+ *  \exception EEXIST The book store already held an ISBN more than once.
+ *  \exception ENOMEM Not enough memory to allocate an entry node, duplicate
+ *  an entry or grow the hash set.
+ */
+extern long book_merge( book_t *book, book_t *some_book );
+
+/*! \fn int book_set_field( book_t *book, entry_t *entry, entry_field_t field, string_t *value )
+ *  \brief Sets a member of an entry held by a book store.
+ *
+ *  When the book store holds unique ISBNs, a new ISBN is first checked
+ *  against the ISBNs of the other entries, which entry_set_field does not.
+ *  Cached query results of the book store that are unaffected by the edit
+ *  are kept.
+ *  \param book The book store holding the entry.
+ *  \param entry The entry to be modified.
+ *  \param field The member to be modified.
+ *  \param value A string containing a value for the member, which belongs
+ *  to the entry on success and still belongs to the caller on failure.
+ *  \return On success zero is returned. Otherwise -1 is returned and errno
+ *  is set appropriately.
+ *  \exception EEXIST The book store holds unique ISBNs and another entry
+ *  already holds the ISBN.
+ *  \exception ENOMEM Not enough memory to rebuild the hash set.
+ */
+extern int book_set_field( book_t *book, entry_t *entry, entry_field_t field,
+                           string_t *value );
+
+/*! \fn unsigned long book_generation( const book_t *book, entry_field_t field )
+ *  \brief Gets the modification count of a member of the entries of a
+ *  book store.
+ *  \param book The book store of interest.
+ *  \param field The member of interest.
+ *  \return The count of edits made through book_set_field if the book
+ *  store is sealed, or the count across all entries of entry_generation
+ *  otherwise.
+ */
+extern unsigned long book_generation( const book_t *book, entry_field_t field );
+
+/*! \fn int book_set_unique( book_t *book, int unique )
+ *  \brief Sets whether a book store holds at most one entry per ISBN.
+ *
+ *  Entries without an ISBN are not constrained. Once set, additions of an
+ *  ISBN already held fail, as do edits made through book_set_field. Edits
+ *  made directly with entry_set_field are not checked and rebuild the hash
+ *  set on the next addition.
+ *  \param book The book store to be constrained.
+ *  \param unique Non-zero to constrain the book store, zero to release it.
+ *  \return On success zero is returned. Otherwise -1 is returned and errno
+ *  is set appropriately.
+ *  \exception EEXIST The book store already holds an ISBN more than once.
+ *  \exception ENOMEM Not enough memory to allocate the hash set.
+ */
+extern int book_set_unique( book_t *book, int unique );
+
 /*! \fn int book_add_many book_add_many( book_t *book, int count, ... )
  *  \brief Duplicates and adds many entries into an book store at once.
  *  \param book The book store for which the entries are to be added.
@@ -119,7 +246,7 @@ extern int book_add_all( book_t *book, book_t *some_book );
 extern int book_add_many( book_t *book, int count, ... );
 
 /*! \fn book_t *book_find_by_title( const book_t *book, const char *title )
- *  \brief Finds entries in an book store by first name.
+ *  \brief Finds entries in an book store by title.
  *  \param book The book store from which entries are to be searched.
  *  \param title A null-terminated string containing the value for title.
  *  \return On success an book store containing found entries is returned.
@@ -130,7 +257,7 @@ extern int book_add_many( book_t *book, int count, ... );
 extern book_t *book_find_by_title( const book_t *book, const char *title );
 
 /*! \fn book_t *book_find_by_author( const book_t *book, const char *author )
- *  \brief Finds entries in an book store by last name.
+ *  \brief Finds entries in an book store by author.
  *  \param book The book store from which entries are to be searched.
  *  \param author A null-terminated string containing the value for author.
  *  \return On success an book store containing found entries is returned.
@@ -141,7 +268,7 @@ extern book_t *book_find_by_title( const book_t *book, const char *title );
 extern book_t *book_find_by_author( const book_t *book, const char *author );
 
 /*! \fn book_t *book_find_by_publisher( const book_t *book, const char *publisher )
- *  \brief Finds entries in an book store by pubdate name.
+ *  \brief Finds entries in an book store by publisher.
  *  \param book The book store from which entries are to be searched.
  *  \param pubdate A null-terminated string containing the value for publisher.
  *  \return On success an book store containing found entries is returned.
@@ -151,6 +278,32 @@ extern book_t *book_find_by_author( const book_t *book, const char *author );
  */
 extern book_t *book_find_by_publisher( const book_t *book, const char *publisher );
 
+/*! \fn book_t *book_find_by_pages( const book_t *book, long min, long max )
+ *  \brief Finds entries in an book store by a range of page counts.
+ *  \param book The book store from which entries are to be searched.
+ *  \param min The smallest page count to be found.
+ *  \param max The largest page count to be found.
+ *  \return On success an book store containing found entries ordered by
+ *  page count is returned. Otherwise NULL is returned and errno is set
+ *  appropriately.
+ *  \exception ENOMEM Not enough memory to allocate a new book store, entry
+ *  nodes or the index.
+ */
+extern book_t *book_find_by_pages( const book_t *book, long min, long max );
+
+/*! \fn book_t *book_find_by_pubdate( const book_t *book, long min, long max )
+ *  \brief Finds entries in an book store by a range of publication dates.
+ *  \param book The book store from which entries are to be searched.
+ *  \param min The earliest date to be found, encoded as YYYYMMDD.
+ *  \param max The latest date to be found, encoded as YYYYMMDD.
+ *  \return On success an book store containing found entries ordered by
+ *  publication date is returned. Otherwise NULL is returned and errno is
+ *  set appropriately.
+ *  \exception ENOMEM Not enough memory to allocate a new book store, entry
+ *  nodes or the index.
+ */
+extern book_t *book_find_by_pubdate( const book_t *book, long min, long max );
+
 /*! \fn entry_t *book_remove( book_t *book, entry_node_t *entry_node )
  *  \brief Removes an entry from an book store.
  *  \param book The book store for which an entry is to be removed.
@@ -0,0 +1,147 @@
+#ifndef BOOK_CACHE_H
+#define BOOK_CACHE_H
+
+/*! \file book_cache.h
+ *  \brief Definitions for a cache of query results over a book store.
+ *
+ *  The results of the most recently used queries are kept as the entries
+ *  they matched, keyed by the whole query. Entries appended to or removed
+ *  from the book store are checked against each query and added to or
+ *  removed from its result, and so are entries edited through
+ *  book_set_field. A result is only stale once a member the query reads
+ *  was set otherwise, as counted by book_generation, the same way indexes
+ *  go out of date. Stale results are dropped when next looked up, and the
+ *  least recently used result makes room for a new one once the cache is
+ *  full.
+ *
+ *  A cache may be used by many threads.
+ */
+
+#include <pthread.h>
+#include "query.h"
+
+/*! \def BOOK_CACHE_ENTRIES
+ *  \brief Maximum number of results kept by a cache.
+ */
+#define BOOK_CACHE_ENTRIES  32
+
+/*! \def BOOK_CACHE_ROWS
+ *  \brief Maximum number of entries of a result to be kept.
+ */
+#define BOOK_CACHE_ROWS     4096
+
+/*! \typedef book_cached_t
+ *  \brief Type definition of a result kept by a cache.
+ *
+ *  The key is the query encoded as bytes. Fields is a bit mask of the
+ *  members the query reads, whose modification counts are recorded along
+ *  the version of the book store. Used orders results by their last use.
+ */
+typedef struct
+{
+    char *k_key;
+    unsigned long long k_size;
+    unsigned long k_hash;
+    unsigned k_fields;
+    unsigned long k_version;
+    unsigned long k_generations[ ENTRY_FIELDS ];
+    entry_t **k_entries;
+    unsigned long k_count;
+    unsigned long k_used;
+} book_cached_t;
+
+/*! \typedef book_cache_t
+ *  \brief Type definition of a cache of query results.
+ */
+typedef struct book_cache
+{
+    pthread_mutex_t c_lock;
+    book_cached_t c_slots[ BOOK_CACHE_ENTRIES ];
+    unsigned long c_tick;
+    unsigned long c_hits;
+    unsigned long c_misses;
+} book_cache_t;
+
+/*! \fn book_cache_t *book_cache_create( void )
+ *  \brief Creates an empty cache.
+ *  \return On success the cache is returned. Otherwise NULL is returned
+ *  and errno is set appropriately.
+ *  \exception ENOMEM Not enough memory to allocate the cache.
+ */
+extern book_cache_t *book_cache_create( void );
+
+/*! \fn book_t *book_cache_find( book_cache_t *cache, const book_t *book, const query_t *query )
+ *  \brief Looks up the result of a query.
+ *  \param cache The cache to be searched.
+ *  \param book The book store the query is run against.
+ *  \param query The query to be looked up.
+ *  \return On success a new book store holding the entries of the result
+ *  in their original order is returned. Otherwise NULL is returned and
+ *  errno is set appropriately.
+ *  \exception ENOENT The cache holds no up to date result of the query.
+ *  \exception ENOMEM Not enough memory to allocate the book store.
+ */
+extern book_t *book_cache_find( book_cache_t *cache, const book_t *book,
+                                const query_t *query );
+
+/*! \fn int book_cache_store( book_cache_t *cache, const book_t *book, const query_t *query, const book_t *result )
+ *  \brief Keeps the result of a query.
+ *
+ *  Results of more than BOOK_CACHE_ROWS entries are not kept.
+ *  \param cache The cache where to keep the result.
+ *  \param book The book store the query was run against, unchanged since.
+ *  \param query The query run.
+ *  \param result The entries found by the query.
+ *  \return On success zero is returned. Otherwise -1 is returned and errno
+ *  is set appropriately.
+ *  \exception ENOMEM Not enough memory to keep the result.
+ */
+extern int book_cache_store( book_cache_t *cache, const book_t *book,
+                             const query_t *query, const book_t *result );
+
+/*! \fn void book_cache_appended( book_cache_t *cache, const book_t *book, entry_t *entry )
+ *  \brief Adds an entry just appended to a book store to the results it
+ *  matches that were up to date before.
+ *
+ *  A result that would grow past BOOK_CACHE_ROWS entries is dropped.
+ *  \param cache The cache of the book store.
+ *  \param book The book store the entry was appended to.
+ *  \param entry The entry appended.
+ */
+extern void book_cache_appended( book_cache_t *cache, const book_t *book, entry_t *entry );
+
+/*! \fn void book_cache_removed( book_cache_t *cache, const book_t *book, entry_t *entry )
+ *  \brief Removes an entry just removed from a book store from the results
+ *  that were up to date before.
+ *  \param cache The cache of the book store.
+ *  \param book The book store the entry was removed from.
+ *  \param entry The entry removed.
+ */
+extern void book_cache_removed( book_cache_t *cache, const book_t *book, entry_t *entry );
+
+/*! \fn void book_cache_edited( book_cache_t *cache, const book_t *book, entry_t *entry, entry_field_t field, unsigned long generation )
+ *  \brief Keeps the results that were up to date before an edit of an
+ *  entry and that still hold the entry exactly if it matches their query.
+ *  \param cache The cache of the book store.
+ *  \param book The book store holding the entry.
+ *  \param entry The entry edited.
+ *  \param field The member set.
+ *  \param generation The modification count of the member before the
+ *  edit, as given by book_generation.
+ */
+extern void book_cache_edited( book_cache_t *cache, const book_t *book, entry_t *entry,
+                               entry_field_t field, unsigned long generation );
+
+/*! \fn void book_cache_clear( book_cache_t *cache )
+ *  \brief Drops every result kept by a cache.
+ *  \param cache The cache to be cleared.
+ */
+extern void book_cache_clear( book_cache_t *cache );
+
+/*! \fn void book_cache_destroy( book_cache_t *cache )
+ *  \brief Destroys a cache and the results it keeps.
+ *  \param cache The cache to be destroyed.
+ */
+extern void book_cache_destroy( book_cache_t *cache );
+
+#endif /* BOOK_CACHE_H */
@@ -0,0 +1,344 @@
+#ifndef BOOK_FILE_H
+#define BOOK_FILE_H
+
+/*! \file book_file.h
+ *  \brief Definitions for the compressed container of a book store.
+ *
+ *  The container starts with a header and a block index, followed by the
+ *  blocks themselves. Each block holds consecutive entries in the binary
+ *  format of entry_write, compressed on its own so that blocks are packed
+ *  and unpacked concurrently by the shared worker pool. A block that does
+ *  not shrink is stored as is. All numbers use the byte order of the
+ *  machine, like the legacy format, which is told apart by the magic.
+ *
+ *  Since version 2, a CRC32C checksum of the header and the block index
+ *  follows the index, and every block carries the checksum of its stored
+ *  bytes. Checksums are verified on load unless disabled for trusted
+ *  files.
+ *
+ *  Since version 3, the blocks may be followed by the lookup indexes of
+ *  the book store, flagged in the header. A directory, its sections and
+ *  their checksum come first, then the arrays of each section, aligned to
+ *  eight bytes from the start of the file so that they are used in place
+ *  from a mapping of the file. The directory tells the checksum of the
+ *  block index the indexes were built from, and indexes that do not match
+ *  the blocks, the rows or the word size of the reader are left to be
+ *  rebuilt. A mapped file must be replaced, as book_save does, and never
+ *  truncated while loaded. Containers without indexes are still written
+ *  as version 2.
+ *
+ *  A book store may also be split into shard files named after the main
+ *  file with the number of the shard appended, such as book.dat.3, while
+ *  the main file holds a manifest telling their count and format. Each
+ *  shard file is a book store of its own in either format, so shards are
+ *  loaded and saved concurrently, one per worker.
+ */
+
+#include "book.h"
+
+/*! \def BOOK_MAGIC
+ *  \brief Characters opening a compressed container.
+ */
+#define BOOK_MAGIC          "BKST"
+
+/*! \def BOOK_DECODE_ROWS
+ *  \brief Number of entries of the legacy format decoded by each worker.
+ */
+#define BOOK_DECODE_ROWS    16384
+
+/*! \def BOOK_SHARDS_MAGIC
+ *  \brief Characters opening a manifest of shard files.
+ */
+#define BOOK_SHARDS_MAGIC   "BKSH"
+
+/*! \def BOOK_SHARDS_VERSION
+ *  \brief Version of the manifest of shard files written.
+ */
+#define BOOK_SHARDS_VERSION 1
+
+/*! \def BOOK_SHARDS_MAX
+ *  \brief Maximum number of shard files of a book store.
+ */
+#define BOOK_SHARDS_MAX     4096
+
+/*! \def BOOK_FILE_VERSION
+ *  \brief Latest version of the compressed container.
+ */
+#define BOOK_FILE_VERSION   3
+
+/*! \def BOOK_FLAG_INDEXES
+ *  \brief Flag of a container whose blocks are followed by indexes.
+ */
+#define BOOK_FLAG_INDEXES   0x1
+
+/*! \def BOOK_INDEXES_MAGIC
+ *  \brief Characters opening the directory of persisted indexes.
+ */
+#define BOOK_INDEXES_MAGIC  "BKIX"
+
+/*! \def BOOK_BLOCK_SIZE
+ *  \brief Number of uncompressed bytes from which a block is closed.
+ */
+#define BOOK_BLOCK_SIZE     ( 256 * 1024 )
+
+/*! \typedef book_format_t
+ *  \brief Enumeration of the formats of a book store file.
+ */
+typedef enum
+{
+    BOOK_FORMAT_LEGACY,
+    BOOK_FORMAT_PACKED,
+    BOOK_FORMAT_SHARDED
+} book_format_t;
+
+/*! \typedef book_codec_t
+ *  \brief Enumeration of the codecs of a block.
+ */
+typedef enum
+{
+    BOOK_CODEC_NONE,
+    BOOK_CODEC_LZ
+} book_codec_t;
+
+/*! \typedef book_header_t
+ *  \brief Type definition of the header of a compressed container.
+ */
+typedef struct
+{
+    char f_magic[ 4 ];
+    unsigned f_version;
+    unsigned f_blocks;
+    unsigned f_flags;
+    unsigned long long f_count;
+} book_header_t;
+
+/*! \typedef book_block_t
+ *  \brief Type definition of an entry of the block index.
+ *
+ *  The offset is relative to the end of the block index. Version 1 of the
+ *  container lacks the last two members.
+ */
+typedef struct
+{
+    unsigned long long b_offset;
+    unsigned b_size;
+    unsigned b_packed;
+    unsigned b_count;
+    unsigned b_codec;
+    unsigned b_crc;
+    unsigned b_reserved;
+} book_block_t;
+
+/*! \typedef book_indexes_t
+ *  \brief Type definition of the directory of persisted indexes.
+ *
+ *  The blocks member is the CRC32C of the block index, and the padding is
+ *  the number of zero bytes between the checksum of the sections and their
+ *  arrays, whose size is given last.
+ */
+typedef struct
+{
+    char x_magic[ 4 ];
+    unsigned x_sections;
+    unsigned x_word;
+    unsigned x_blocks;
+    unsigned x_padding;
+    unsigned x_reserved;
+    unsigned long long x_rows;
+    unsigned long long x_size;
+} book_indexes_t;
+
+/*! \typedef book_section_t
+ *  \brief Type definition of a section of persisted indexes.
+ *
+ *  The kind is one of INDEX_HASH, INDEX_ORDER and INDEX_RANGE. The offset
+ *  is relative to the first array. A hash index holds its slots, starts and
+ *  postings, its count being the number of groups, while sorted
+ *  permutations and range indexes hold count rows or keys.
+ */
+typedef struct
+{
+    unsigned s_kind;
+    unsigned s_field;
+    unsigned long long s_offset;
+    unsigned long long s_size;
+    unsigned long long s_count;
+    unsigned long long s_mask;
+    unsigned s_crc;
+    unsigned s_reserved;
+} book_section_t;
+
+/*! \typedef book_manifest_t
+ *  \brief Type definition of the manifest of shard files.
+ *
+ *  The checksum is the CRC32C of the members before it.
+ */
+typedef struct
+{
+    char m_magic[ 4 ];
+    unsigned m_version;
+    unsigned m_shards;
+    unsigned m_packed;
+    unsigned m_crc;
+} book_manifest_t;
+
+/*! \fn book_format_t book_file_format( FILE *file )
+ *  \brief Tells the format of a book store file.
+ *
+ *  The position of the stream is left unchanged.
+ *  \param file The stream to be inspected.
+ *  \return The format of the stream.
+ */
+extern book_format_t book_file_format( FILE *file );
+
+/*! \fn void book_set_verify( int verify )
+ *  \brief Sets whether checksums are verified when reading containers.
+ *  \param verify Zero to trust files without checking them, non-zero to
+ *  verify them, which is the default.
+ */
+extern void book_set_verify( int verify );
+
+/*! \fn void book_set_lazy( int lazy )
+ *  \brief Sets whether long descriptions are left on disk when reading.
+ *
+ *  When set, descriptions of at least ENTRY_LAZY_MIN characters read from
+ *  the legacy format keep only their length and are read from the file on
+ *  first use, which keeps it open while they may be. Such files are read
+ *  entry by entry, seeking past the long descriptions instead of reading
+ *  them. Compressed containers are always read whole.
+ *  \param lazy Non-zero to leave long descriptions on disk, zero to read
+ *  them with the rest of the entry, which is the default.
+ */
+extern void book_set_lazy( int lazy );
+
+/*! \fn int book_get_lazy( void )
+ *  \brief Tells whether long descriptions are left on disk when reading.
+ *  \return Non-zero if they are, zero otherwise.
+ */
+extern int book_get_lazy( void );
+
+/*! \fn void book_set_indexes( int indexes )
+ *  \brief Sets whether compressed containers are written with indexes.
+ *
+ *  When set, every index of the book store is brought up to date before it
+ *  is written, and a book store read from the container adopts them
+ *  instead of building them again.
+ *  \param indexes Non-zero to write indexes, zero to write the entries
+ *  alone, which is the default.
+ */
+extern void book_set_indexes( int indexes );
+
+/*! \fn int book_write_packed( FILE *file, book_t *book )
+ *  \brief Writes an book store as a compressed container.
+ *  \param file The stream where to write the book store.
+ *  \param book The book store to be written.
+ *  \return On success zero is returned. Otherwise -1 is returned and errno
+ *  is set appropriately.
+ *  \exception ENOMEM Not enough memory to pack the blocks.
+ *  \exception EIO The stream could not be written.
+ */
+extern int book_write_packed( FILE *file, book_t *book );
+
+/*! \fn book_t *book_read_packed( FILE *file )
+ *  \brief Reads an book store from a compressed container.
+ *
+ *  Indexes following the blocks are mapped, or read if they cannot be,
+ *  and adopted by the book store. Indexes failing their checks are
+ *  skipped without failing the read.
+ *  \param file The stream from where to read the book store.
+ *  \return On success the book store read is returned. Otherwise NULL is
+ *  returned and errno is set appropriately.
+ *  \exception ENOMEM Not enough memory to unpack the blocks.
+ *  \exception EIO The stream is truncated, malformed or fails its
+ *  checksums.
+ */
+extern book_t *book_read_packed( FILE *file );
+
+/*! \fn book_t *book_read_parallel( FILE *file, unsigned count )
+ *  \brief Reads the entries of the legacy format concurrently.
+ *
+ *  The rest of the stream is read at once and a pass over the lengths of
+ *  the members finds where each run of BOOK_DECODE_ROWS entries starts.
+ *  The runs are then decoded by the shared worker pool and joined in their
+ *  original order. The stream is left after the last entry. Every
+ *  description is read, whether or not book_set_lazy was set.
+ *  \param file The stream from where to read the entries, just after
+ *  their count.
+ *  \param count The number of entries to be read.
+ *  \return On success the book store read is returned. Otherwise NULL is
+ *  returned and errno is set appropriately.
+ *  \exception ESPIPE The stream cannot seek, so it must be read in order.
+ *  \exception ENOMEM Not enough memory to read the entries.
+ *  \exception EIO The stream is truncated or malformed.
+ */
+extern book_t *book_read_parallel( FILE *file, unsigned count );
+
+/*! \fn book_t *book_load( const char *filename, int *packed )
+ *  \brief Loads an book store from a file in any format.
+ *
+ *  The shard files of a manifest are loaded concurrently and joined in
+ *  the order of their numbers.
+ *  \param filename The name of the file to be read.
+ *  \param packed Where to store whether the file, or the shard files of a
+ *  manifest, were compressed containers, or NULL.
+ *  \return On success the book store read is returned, or an empty one if
+ *  the file does not exist. Otherwise NULL is returned and errno is set
+ *  appropriately.
+ *  \exception ENOMEM Not enough memory to read the book store.
+ *  \exception EIO The file is truncated, malformed or fails its checksums.
+ */
+extern book_t *book_load( const char *filename, int *packed );
+
+/*! \fn int book_save( const char *filename, book_t *book, int packed )
+ *  \brief Saves an book store to a file.
+ *
+ *  The book store is written to the file name followed by ".tmp", which
+ *  then replaces the file, so a reader of the old file, such as a lazy
+ *  description, keeps reading it.
+ *  \param filename The name of the file to be written.
+ *  \param book The book store to be written.
+ *  \param packed Non-zero to write a compressed container, zero to write
+ *  the legacy format.
+ *  \return On success zero is returned. Otherwise -1 is returned and errno
+ *  is set appropriately.
+ *  \exception ENOMEM Not enough memory to pack the blocks.
+ *  \exception EIO The file could not be written.
+ */
+extern int book_save( const char *filename, book_t *book, int packed );
+
+/*! \fn book_t **book_load_shards( const char *filename, unsigned *count, int *packed )
+ *  \brief Loads the shard files of a book store concurrently.
+ *
+ *  A file that is not a manifest is loaded as the only shard.
+ *  \param filename The name of the manifest to be read.
+ *  \param count Where to store the number of shards.
+ *  \param packed Where to store whether the shards were compressed
+ *  containers, or NULL.
+ *  \return On success an array of count book stores is returned, to be
+ *  freed once they are destroyed. A missing file gives one empty book
+ *  store. Otherwise NULL is returned and errno is set appropriately.
+ *  \exception ENOMEM Not enough memory to read the book stores.
+ *  \exception EIO The manifest or a shard file is missing, truncated,
+ *  malformed or fails its checksums.
+ */
+extern book_t **book_load_shards( const char *filename, unsigned *count, int *packed );
+
+/*! \fn int book_save_shards( const char *filename, book_t **shards, unsigned count, int packed )
+ *  \brief Saves book stores as the shard files of a manifest.
+ *
+ *  The shard files are written concurrently and the manifest last. Shard
+ *  files left over from a manifest with more shards are removed.
+ *  \param filename The name of the manifest to be written.
+ *  \param shards The book stores to be written, one per shard.
+ *  \param count The number of shards, at most BOOK_SHARDS_MAX.
+ *  \param packed Non-zero to write the shards as compressed containers.
+ *  \return On success zero is returned. Otherwise -1 is returned and errno
+ *  is set appropriately.
+ *  \exception EINVAL There are too many shards.
+ *  \exception ENOMEM Not enough memory to pack the blocks.
+ *  \exception EIO A file could not be written.
+ */
+extern int book_save_shards( const char *filename, book_t **shards, unsigned count,
+                             int packed );
+
+#endif /* BOOK_FILE_H */
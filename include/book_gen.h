@@ -0,0 +1,118 @@
+#ifndef BOOK_GEN_H
+#define BOOK_GEN_H
+
+/*! \file book_gen.h
+ *  \brief Definitions for generating synthetic book stores.
+ *
+ *  A generator makes entries with realistic values: authors and publishers
+ *  drawn from Zipfian distributions over a fixed number of names, titles
+ *  and descriptions made of words, description and page counts following
+ *  log-normal distributions, and valid ISBN-13 numbers unique per row.
+ *
+ *  Every entry depends only on the seed and its row, so a book store of a
+ *  given size is the same however it is generated, and rows can be made
+ *  concurrently.
+ */
+
+#include <stdio.h>
+#include "book.h"
+
+/*! \def BOOK_GEN_ROWS
+ *  \brief Number of entries encoded by each worker when writing a file.
+ */
+#define BOOK_GEN_ROWS       8192
+
+/*! \def BOOK_GEN_LENGTH
+ *  \brief Maximum length of a generated member.
+ */
+#define BOOK_GEN_LENGTH     8192
+
+/*! \typedef book_gen_config_t
+ *  \brief Type definition of the settings of a generator.
+ *
+ *  Skew is the exponent of the Zipfian distributions, zero making names
+ *  equally likely. Description is the median length of descriptions.
+ */
+typedef struct
+{
+    unsigned long long g_seed;
+    unsigned long g_authors;
+    unsigned long g_publishers;
+    double g_skew;
+    unsigned long g_description;
+} book_gen_config_t;
+
+/*! \typedef book_gen_t
+ *  \brief Type definition of a generator.
+ *
+ *  The cumulative distributions of the ranks of authors and publishers are
+ *  computed once and shared by all rows.
+ */
+typedef struct
+{
+    book_gen_config_t g_config;
+    double *g_authors;
+    double *g_publishers;
+} book_gen_t;
+
+/*! \fn void book_gen_defaults( book_gen_config_t *config )
+ *  \brief Fills the settings of a generator with default values.
+ *  \param config The settings to be filled.
+ */
+extern void book_gen_defaults( book_gen_config_t *config );
+
+/*! \fn book_gen_t *book_gen_create( const book_gen_config_t *config )
+ *  \brief Creates a generator.
+ *  \param config The settings of the generator.
+ *  \return On success the generator is returned. Otherwise NULL is
+ *  returned and errno is set appropriately.
+ *  \exception EINVAL There are no authors or no publishers, or the skew is
+ *  negative.
+ *  \exception ENOMEM Not enough memory to allocate the generator.
+ */
+extern book_gen_t *book_gen_create( const book_gen_config_t *config );
+
+/*! \fn entry_t *book_gen_entry( const book_gen_t *gen, unsigned long long row )
+ *  \brief Generates the entry of a row.
+ *  \param gen The generator.
+ *  \param row The row of the entry.
+ *  \return On success the entry is returned. Otherwise NULL is returned and
+ *  errno is set appropriately.
+ *  \exception ENOMEM Not enough memory to allocate the entry.
+ */
+extern entry_t *book_gen_entry( const book_gen_t *gen, unsigned long long row );
+
+/*! \fn book_t *book_gen_book( const book_gen_t *gen, unsigned long count )
+ *  \brief Generates a book store of the first rows.
+ *  \param gen The generator.
+ *  \param count The number of entries.
+ *  \return On success the book store is returned. Otherwise NULL is
+ *  returned and errno is set appropriately.
+ *  \exception ENOMEM Not enough memory to allocate the book store.
+ */
+extern book_t *book_gen_book( const book_gen_t *gen, unsigned long count );
+
+/*! \fn int book_gen_write( FILE *file, const book_gen_t *gen, unsigned count )
+ *  \brief Writes a generated book store in the legacy format.
+ *
+ *  Entries are encoded straight to bytes, runs of BOOK_GEN_ROWS of them
+ *  concurrently by the shared worker pool, and written in order, so that
+ *  files larger than memory can be made. The file is the same as written
+ *  by book_write for book_gen_book.
+ *  \param file The stream where to write the book store.
+ *  \param gen The generator.
+ *  \param count The number of entries.
+ *  \return On success zero is returned. Otherwise -1 is returned and errno
+ *  is set appropriately.
+ *  \exception ENOMEM Not enough memory to encode the entries.
+ *  \exception EIO The stream could not be written.
+ */
+extern int book_gen_write( FILE *file, const book_gen_t *gen, unsigned count );
+
+/*! \fn void book_gen_destroy( book_gen_t *gen )
+ *  \brief Destroys a generator.
+ *  \param gen The generator to be destroyed.
+ */
+extern void book_gen_destroy( book_gen_t *gen );
+
+#endif /* BOOK_GEN_H */
@@ -0,0 +1,437 @@
+#ifndef BOOK_INDEX_H
+#define BOOK_INDEX_H
+
+/*! \file book_index.h
+ *  \brief Definitions for lookup indexes over a book store.
+ *
+ *  Indexes address entries by row, the zero-based position of an entry in
+ *  the book store at the time the index was built. They are built lazily
+ *  on first use and rebuilt when the book store or the indexed member of
+ *  any entry has changed since.
+ *
+ *  Bloom filters over some members answer that a value is absent without
+ *  building the other indexes. Unlike them, a filter is kept up to date
+ *  when entries are appended to or removed from the book store, since it
+ *  only ever needs to hold every value present. It is rebuilt once the
+ *  members of half of its entries have been removed, or when any indexed
+ *  member of an entry has changed.
+ *
+ *  Indexes may also be adopted from arrays persisted along with the book
+ *  store, which then live in a region of memory, possibly a mapping of the
+ *  file, released with the indexes. Arrays of the region are never freed
+ *  on their own, and rebuilding an index leaves them unused.
+ */
+
+#include "book.h"
+#include "book_cache.h"
+#include "column.h"
+
+/*! \def INDEX_HASH
+ *  \brief Kind of index answering equality lookups.
+ */
+#define INDEX_HASH      0x1
+
+/*! \def INDEX_ORDER
+ *  \brief Kind of index answering prefix lookups.
+ */
+#define INDEX_ORDER     0x2
+
+/*! \def INDEX_RANGE
+ *  \brief Kind of index answering range lookups over numeric members.
+ */
+#define INDEX_RANGE     0x4
+
+/*! \def INDEX_BLOOM
+ *  \brief Kind of index telling that a member holds no entry with a value.
+ */
+#define INDEX_BLOOM     0x8
+
+/*! \def BLOOM_WORDS
+ *  \brief Number of words of a block of a Bloom filter, a cache line.
+ */
+#define BLOOM_WORDS     8
+
+/*! \def BLOOM_BITS
+ *  \brief Number of bits of a Bloom filter per value, for about one false
+ *  positive in a hundred.
+ */
+#define BLOOM_BITS      10
+
+/*! \def BLOOM_PROBES
+ *  \brief Number of bits set in a block for each value.
+ */
+#define BLOOM_PROBES    7
+
+/*! \typedef range_key_t
+ *  \brief Type definition for a key of a range index.
+ */
+typedef struct
+{
+    long r_key;
+    unsigned long r_row;
+} range_key_t;
+
+/*! \typedef range_index_t
+ *  \brief Type definition of a sorted index over a numeric member.
+ *
+ *  Keys are sorted by value and then by row. Entries whose member could
+ *  not be parsed are left out.
+ */
+typedef struct
+{
+    range_key_t *r_keys;
+    unsigned long r_count;
+    unsigned long r_version;
+    unsigned long r_generation;
+} range_index_t;
+
+/*! \typedef hash_index_t
+ *  \brief Type definition of a hash index over a member.
+ *
+ *  Rows sharing a value are grouped into a posting list in ascending row
+ *  order. Each slot of the open addressing table holds a group number plus
+ *  one, or zero when empty.
+ */
+typedef struct
+{
+    unsigned long *h_slots;
+    unsigned long h_mask;
+    unsigned long *h_starts;
+    unsigned long *h_postings;
+    unsigned long h_groups;
+    unsigned long h_version;
+    unsigned long h_generation;
+} hash_index_t;
+
+/*! \typedef order_index_t
+ *  \brief Type definition of a sorted permutation of rows by a member.
+ */
+typedef struct
+{
+    unsigned long *o_rows;
+    unsigned long o_count;
+    unsigned long o_version;
+    unsigned long o_generation;
+} order_index_t;
+
+/*! \typedef bloom_filter_t
+ *  \brief Type definition of a blocked Bloom filter over a member.
+ *
+ *  A value sets BLOOM_PROBES bits of a single block of BLOOM_WORDS words,
+ *  so that a lookup reads one cache line. The number of blocks is a power
+ *  of two and the filter holds up to BLOOM_BITS bits per value.
+ */
+typedef struct
+{
+    unsigned long long *b_words;
+    unsigned long b_mask;
+    unsigned long b_values;
+    unsigned long b_removed;
+    unsigned long b_version;
+    unsigned long b_generation;
+} bloom_filter_t;
+
+/*! \typedef book_index_t
+ *  \brief Type definition of the indexes attached to a book store.
+ *
+ *  The cache keeps the results of recent queries run against the book
+ *  store, and the columns serve full scans of a single member.
+ */
+typedef struct book_index
+{
+    entry_t **i_rows;
+    unsigned long i_count;
+    unsigned long i_version;
+    int i_valid;
+    range_index_t i_pages;
+    range_index_t i_pubdate;
+    hash_index_t i_hash[ ENTRY_FIELDS ];
+    order_index_t i_order[ ENTRY_FIELDS ];
+    bloom_filter_t i_bloom[ ENTRY_FIELDS ];
+    book_cache_t *i_cache;
+    column_t i_columns[ ENTRY_FIELDS ];
+    void *i_region;
+    unsigned long long i_region_size;
+    int i_mapped;
+} book_index_t;
+
+/*! \fn book_index_t *book_index_create( void )
+ *  \brief Creates an empty set of indexes.
+ *  \return On success the indexes are returned. Otherwise NULL is returned
+ *  and errno is set appropriately.
+ *  \exception ENOMEM Not enough memory to allocate the indexes.
+ */
+extern book_index_t *book_index_create( void );
+
+/*! \fn book_index_t *book_index_get( const book_t *book )
+ *  \brief Gets the indexes of a book store with an up to date row table.
+ *  \param book The book store to be indexed.
+ *  \return On success the indexes are returned. Otherwise NULL is returned
+ *  and errno is set appropriately.
+ *  \exception ENOMEM Not enough memory to allocate the indexes.
+ */
+extern book_index_t *book_index_get( const book_t *book );
+
+/*! \fn int book_index_kinds( entry_field_t field )
+ *  \brief Gets the kinds of index available for a member.
+ *  \param field The member of interest.
+ *  \return A combination of INDEX_HASH, INDEX_ORDER, INDEX_RANGE and
+ *  INDEX_BLOOM.
+ */
+extern int book_index_kinds( entry_field_t field );
+
+/*! \fn const range_index_t *book_index_range( const book_t *book, entry_field_t field )
+ *  \brief Gets an up to date range index of a book store.
+ *  \param book The book store to be indexed.
+ *  \param field Either ENTRY_PAGES or ENTRY_PUBDATE.
+ *  \return On success the range index is returned. Otherwise NULL is
+ *  returned and errno is set appropriately.
+ *  \exception EINVAL The member has no numeric form.
+ *  \exception ENOMEM Not enough memory to build the index.
+ */
+extern const range_index_t *book_index_range( const book_t *book, entry_field_t field );
+
+/*! \fn const hash_index_t *book_index_hash( const book_t *book, entry_field_t field )
+ *  \brief Gets an up to date hash index of a book store.
+ *  \param book The book store to be indexed.
+ *  \param field The member to be indexed.
+ *  \return On success the hash index is returned. Otherwise NULL is
+ *  returned and errno is set appropriately.
+ *  \exception EINVAL The member has no hash index.
+ *  \exception ENOMEM Not enough memory to build the index.
+ */
+extern const hash_index_t *book_index_hash( const book_t *book, entry_field_t field );
+
+/*! \fn const order_index_t *book_index_order( const book_t *book, entry_field_t field )
+ *  \brief Gets an up to date sorted permutation of a book store.
+ *  \param book The book store to be indexed.
+ *  \param field The member to be indexed.
+ *  \return On success the sorted permutation is returned. Otherwise NULL
+ *  is returned and errno is set appropriately.
+ *  \exception EINVAL The member has no sorted permutation.
+ *  \exception ENOMEM Not enough memory to build the index.
+ */
+extern const order_index_t *book_index_order( const book_t *book, entry_field_t field );
+
+/*! \fn const bloom_filter_t *book_index_bloom( const book_t *book, entry_field_t field )
+ *  \brief Gets an up to date Bloom filter of a book store.
+ *
+ *  Unlike the other indexes, a missing or stale filter is built from the
+ *  entries of the book store without bringing the row table up to date.
+ *  \param book The book store to be indexed.
+ *  \param field The member to be indexed.
+ *  \return On success the Bloom filter is returned. Otherwise NULL is
+ *  returned and errno is set appropriately.
+ *  \exception EINVAL The member has no Bloom filter.
+ *  \exception ENOMEM Not enough memory to build the filter.
+ */
+extern const bloom_filter_t *book_index_bloom( const book_t *book, entry_field_t field );
+
+/*! \fn const column_t *book_index_column( const book_t *book, entry_field_t field )
+ *  \brief Gets an up to date column of a book store, once it pays off.
+ *
+ *  A column is only built when asked for again before the book store or
+ *  the member changed, so that a scan following each modification keeps
+ *  reading the entries instead of copying them every time. The columns of
+ *  a sealed book store are never built here, since lookups may then run
+ *  concurrently, but by the next book_index_warm.
+ *  \param book The book store to be copied.
+ *  \param field The member to be copied.
+ *  \return The column if it is up to date, or NULL if the member is to be
+ *  read from the entries instead.
+ */
+extern const column_t *book_index_column( const book_t *book, entry_field_t field );
+
+/*! \fn int book_index_pending( const book_t *book )
+ *  \brief Tells whether a column was asked for that book_index_warm would
+ *  build.
+ *  \param book The book store of interest.
+ *  \return Non-zero if some column is to be built, zero otherwise.
+ */
+extern int book_index_pending( const book_t *book );
+
+/*! \fn int book_index_absent( const book_t *book, entry_field_t field, const char *value )
+ *  \brief Tells whether no entry of a book store holds a value.
+ *  \param book The book store to be searched.
+ *  \param field The member of interest.
+ *  \param value A null-terminated string containing the value.
+ *  \return Non-zero if no entry holds the value. Zero if some entry may
+ *  hold it, or if the member has no Bloom filter or it could not be built.
+ */
+extern int book_index_absent( const book_t *book, entry_field_t field, const char *value );
+
+/*! \fn void book_index_appended( book_t *book, entry_t *entry )
+ *  \brief Adds the members of an entry just appended to the Bloom filters
+ *  and cached query results of a book store that were up to date before.
+ *  \param book The book store the entry was appended to.
+ *  \param entry The entry appended.
+ */
+extern void book_index_appended( book_t *book, entry_t *entry );
+
+/*! \fn void book_index_removed( book_t *book, entry_t *entry )
+ *  \brief Keeps the Bloom filters of a book store up to date after an
+ *  entry was removed, until half of their values are gone, and removes the
+ *  entry from the cached query results.
+ *  \param book The book store the entry was removed from.
+ *  \param entry The entry removed.
+ */
+extern void book_index_removed( book_t *book, entry_t *entry );
+
+/*! \fn void book_index_edited( book_t *book, entry_t *entry, entry_field_t field, unsigned long generation )
+ *  \brief Keeps the cached query results of a book store that an edit of
+ *  an entry does not affect.
+ *  \param book The book store holding the entry.
+ *  \param entry The entry edited.
+ *  \param field The member set.
+ *  \param generation The modification count of the member before the
+ *  edit, as given by book_generation.
+ */
+extern void book_index_edited( book_t *book, entry_t *entry, entry_field_t field,
+                               unsigned long generation );
+
+/*! \fn int book_index_warm( const book_t *book )
+ *  \brief Brings every index of an book store up to date.
+ *
+ *  Columns are only built when asked for since the last modification.
+ *  Once warm, and for as long as the book store is not modified, lookups
+ *  only read the indexes and may run concurrently.
+ *  \param book The book store whose indexes are to be built.
+ *  \return On success zero is returned. Otherwise -1 is returned and errno
+ *  is set appropriately.
+ *  \exception ENOMEM Not enough memory to allocate the indexes.
+ */
+extern int book_index_warm( const book_t *book );
+
+/*! \fn int book_index_attach( const book_t *book, void *region, unsigned long long size, int mapped )
+ *  \brief Hands a region holding persisted indexes to the indexes of a book
+ *  store, which release it when destroyed.
+ *
+ *  A book store takes a single region, before adopting any array from it.
+ *  \param book The book store whose indexes take the region.
+ *  \param region The start of the region.
+ *  \param size The number of bytes of the region.
+ *  \param mapped Non-zero if the region is to be released with munmap,
+ *  zero if with free.
+ *  \return On success zero is returned. Otherwise -1 is returned and errno
+ *  is set appropriately, and the region is left to the caller.
+ *  \exception EBUSY The indexes already have a region.
+ *  \exception ENOMEM Not enough memory to allocate the indexes.
+ */
+extern int book_index_attach( const book_t *book, void *region,
+                              unsigned long long size, int mapped );
+
+/*! \fn int book_index_adopt_hash( const book_t *book, entry_field_t field, unsigned long *slots, unsigned long mask, unsigned long *starts, unsigned long groups, unsigned long *postings )
+ *  \brief Adopts a persisted hash index as up to date.
+ *
+ *  The arrays are checked to stay within the rows of the book store, not
+ *  against the entries themselves.
+ *  \param book The book store the hash index was built from.
+ *  \param field The member covered by the hash index.
+ *  \param slots The open addressing table of mask plus one slots.
+ *  \param mask The number of slots minus one, a power of two minus one.
+ *  \param starts The groups plus one positions where posting lists start.
+ *  \param groups The number of distinct values.
+ *  \param postings The posting lists, one row per entry.
+ *  \return On success zero is returned. Otherwise -1 is returned and errno
+ *  is set appropriately.
+ *  \exception EINVAL The member has no hash index or the arrays do not fit
+ *  the book store.
+ *  \exception ENOMEM Not enough memory to allocate the indexes.
+ */
+extern int book_index_adopt_hash( const book_t *book, entry_field_t field,
+                                  unsigned long *slots, unsigned long mask,
+                                  unsigned long *starts, unsigned long groups,
+                                  unsigned long *postings );
+
+/*! \fn int book_index_adopt_order( const book_t *book, entry_field_t field, unsigned long *rows, unsigned long count )
+ *  \brief Adopts a persisted sorted permutation as up to date.
+ *  \param book The book store the sorted permutation was built from.
+ *  \param field The member covered by the sorted permutation.
+ *  \param rows The rows in the order of their members.
+ *  \param count The number of rows, which is that of the book store.
+ *  \return On success zero is returned. Otherwise -1 is returned and errno
+ *  is set appropriately.
+ *  \exception EINVAL The member has no sorted permutation or the rows do
+ *  not fit the book store.
+ *  \exception ENOMEM Not enough memory to allocate the indexes.
+ */
+extern int book_index_adopt_order( const book_t *book, entry_field_t field,
+                                   unsigned long *rows, unsigned long count );
+
+/*! \fn int book_index_adopt_range( const book_t *book, entry_field_t field, range_key_t *keys, unsigned long count )
+ *  \brief Adopts a persisted range index as up to date.
+ *  \param book The book store the range index was built from.
+ *  \param field Either ENTRY_PAGES or ENTRY_PUBDATE.
+ *  \param keys The keys sorted by value and then by row.
+ *  \param count The number of keys.
+ *  \return On success zero is returned. Otherwise -1 is returned and errno
+ *  is set appropriately.
+ *  \exception EINVAL The member has no numeric form or the keys do not
+ *  fit the book store.
+ *  \exception ENOMEM Not enough memory to allocate the indexes.
+ */
+extern int book_index_adopt_range( const book_t *book, entry_field_t field,
+                                   range_key_t *keys, unsigned long count );
+
+/*! \fn int book_index_adopt_bloom( const book_t *book, entry_field_t field, unsigned long long *words, unsigned long mask, unsigned long values )
+ *  \brief Adopts a persisted Bloom filter as up to date.
+ *  \param book The book store the Bloom filter was built from.
+ *  \param field The member covered by the Bloom filter.
+ *  \param words The blocks of the filter, BLOOM_WORDS words each.
+ *  \param mask The number of blocks minus one, a power of two minus one.
+ *  \param values The number of values added to the filter.
+ *  \return On success zero is returned. Otherwise -1 is returned and errno
+ *  is set appropriately.
+ *  \exception EINVAL The member has no Bloom filter or the filter is too
+ *  small for the book store.
+ *  \exception ENOMEM Not enough memory to allocate the indexes.
+ */
+extern int book_index_adopt_bloom( const book_t *book, entry_field_t field,
+                                   unsigned long long *words, unsigned long mask,
+                                   unsigned long values );
+
+/*! \fn unsigned long range_index_lower( const range_index_t *range, long key )
+ *  \brief Finds the first key not less than a value.
+ *  \param range The range index to be searched.
+ *  \param key The value to be searched for.
+ *  \return The position of the first key not less than the value, or the
+ *  number of keys if there is none.
+ */
+extern unsigned long range_index_lower( const range_index_t *range, long key );
+
+/*! \fn unsigned long hash_index_find( const book_index_t *index, const hash_index_t *hash, entry_field_t field, const char *value, const unsigned long **rows )
+ *  \brief Looks up the rows holding a value.
+ *  \param index The indexes the hash index belongs to.
+ *  \param hash The hash index to be searched.
+ *  \param field The member covered by the hash index.
+ *  \param value A null-terminated string containing the value.
+ *  \param rows Where to store the posting list of matching rows.
+ *  \return The number of matching rows.
+ */
+extern unsigned long hash_index_find( const book_index_t *index,
+                                      const hash_index_t *hash,
+                                      entry_field_t field, const char *value,
+                                      const unsigned long **rows );
+
+/*! \fn unsigned long order_index_prefix( const book_index_t *index, const order_index_t *order, entry_field_t field, const char *prefix, unsigned long *first )
+ *  \brief Looks up the rows whose member starts with a prefix.
+ *  \param index The indexes the sorted permutation belongs to.
+ *  \param order The sorted permutation to be searched.
+ *  \param field The member covered by the sorted permutation.
+ *  \param prefix A null-terminated string containing the prefix.
+ *  \param first Where to store the position of the first matching row.
+ *  \return The number of matching rows.
+ */
+extern unsigned long order_index_prefix( const book_index_t *index,
+                                         const order_index_t *order,
+                                         entry_field_t field,
+                                         const char *prefix,
+                                         unsigned long *first );
+
+/*! \fn void book_index_destroy( book_index_t *index )
+ *  \brief Destroys a set of indexes.
+ *  \param index The indexes to be destroyed.
+ */
+extern void book_index_destroy( book_index_t *index );
+
+#endif /* BOOK_INDEX_H */
@@ -0,0 +1,305 @@
+#ifndef BOOK_SYNC_H
+#define BOOK_SYNC_H
+
+/*! \file book_sync.h
+ *  \brief Definitions for a book store shared between threads.
+ *
+ *  The entries are spread over shards by a hash of their ISBN. Each shard
+ *  is a sealed book store behind its own reader-writer lock, so lookups of
+ *  a shard run concurrently and a write only holds back the readers of
+ *  the shard it touches. Indexes invalidated by a write are rebuilt by the
+ *  next reader of the shard under the writer lock.
+ *
+ *  Entries never leave the shared book store: lookups return duplicates
+ *  owned by the caller and edits are made by ISBN. Queries scan the shards
+ *  concurrently on the shared worker pool and counts visit them one after
+ *  the other, so both may see a write to one shard but not an earlier
+ *  write to another.
+ *
+ *  Entries are never changed once added: an edit replaces an entry with an
+ *  edited copy. This lets long reads pin a view, a consistent and
+ *  immutable version of all shards, without holding any lock while they
+ *  run. Each shard publishes the array of its entries when a view is
+ *  pinned after a write, so pinning only copies the shards written since
+ *  the last view. Entries replaced or removed are retired along with the
+ *  latest version of their shard and destroyed once that version and all
+ *  older ones are released. Snapshots and saves read from a view, so they
+ *  do not hold back writers.
+ *
+ *  A shared book store may be saved as one shard file per shard, see
+ *  book_file.h. Loading such files puts each into its shard directly,
+ *  with its indexes built, by one worker per shard.
+ */
+
+#include <pthread.h>
+#include "book.h"
+#include "query.h"
+#include "book_file.h"
+
+/*! \def BOOK_SYNC_SHARDS
+ *  \brief Number of shards used when none is given.
+ */
+#define BOOK_SYNC_SHARDS    16
+
+/*! \typedef book_version_t
+ *  \brief Type definition of a published version of a shard.
+ *
+ *  The count of references includes one held by the shard while the
+ *  version is its latest. The retired entries are those removed from the
+ *  shard while the version was its latest.
+ */
+typedef struct book_version
+{
+    entry_t **v_rows;
+    unsigned long v_count;
+    unsigned long v_refs;
+    entry_t **v_retired;
+    unsigned long v_retired_count;
+    unsigned long v_retired_cap;
+    struct book_version *v_next;
+} book_version_t;
+
+/*! \typedef book_shard_t
+ *  \brief Type definition of a shard of a shared book store.
+ *
+ *  The versions are chained from the oldest still referenced to the
+ *  latest and guarded by the mutex.
+ */
+typedef struct
+{
+    pthread_rwlock_t d_lock;
+    pthread_mutex_t d_mutex;
+    book_t *d_book;
+    unsigned long long d_bytes;
+    int d_dirty;
+    int d_stale;
+    book_version_t *d_oldest;
+    book_version_t *d_latest;
+} book_shard_t;
+
+/*! \typedef book_sync_t
+ *  \brief Type definition of a book store shared between threads.
+ */
+typedef struct
+{
+    book_shard_t *y_shards;
+    unsigned y_count;
+} book_sync_t;
+
+/*! \typedef book_view_t
+ *  \brief Type definition of a pinned view of a shared book store.
+ */
+typedef struct
+{
+    book_sync_t *w_sync;
+    book_version_t **w_versions;
+    unsigned long w_count;
+} book_view_t;
+
+/*! \fn book_sync_t *book_sync_create( unsigned shards )
+ *  \brief Creates an empty shared book store.
+ *  \param shards The number of shards, or zero for BOOK_SYNC_SHARDS.
+ *  \return On success the shared book store is returned. Otherwise NULL is
+ *  returned and errno is set appropriately.
+ *  \exception ENOMEM Not enough memory to allocate the shared book store.
+ */
+extern book_sync_t *book_sync_create( unsigned shards );
+
+/*! \fn int book_sync_adopt( book_sync_t *sync, book_t *book )
+ *  \brief Moves all entries of a book store into a shared book store.
+ *
+ *  The book store is left empty but is not destroyed. On failure the
+ *  entries not yet moved remain in the book store.
+ *  \param sync The shared book store receiving the entries.
+ *  \param book The book store whose entries are to be moved.
+ *  \return On success zero is returned. Otherwise -1 is returned and errno
+ *  is set appropriately.
+ *  \exception ENOMEM Not enough memory to allocate an entry node.
+ */
+extern int book_sync_adopt( book_sync_t *sync, book_t *book );
+
+/*! \fn int book_sync_add( book_sync_t *sync, entry_t *entry )
+ *  \brief Duplicates and adds an entry to a shared book store.
+ *  \param sync The shared book store for which an entry is to be added.
+ *  \param entry The entry to be duplicated and added.
+ *  \return On success zero is returned. Otherwise -1 is returned and errno
+ *  is set appropriately.
+ *  \exception ENOMEM Not enough memory to duplicate the entry.
+ */
+extern int book_sync_add( book_sync_t *sync, entry_t *entry );
+
+/*! \fn int book_sync_add_take( book_sync_t *sync, entry_t *entry )
+ *  \brief Adds an entry to a shared book store, which takes ownership of it
+ *  instead of duplicating it.
+ *  \param sync The shared book store for which an entry is to be added.
+ *  \param entry The entry to be added.
+ *  \return On success zero is returned. Otherwise -1 is returned, errno is
+ *  set appropriately and the entry still belongs to the caller.
+ *  \exception ENOMEM Not enough memory to allocate an entry node.
+ */
+extern int book_sync_add_take( book_sync_t *sync, entry_t *entry );
+
+/*! \fn book_t *book_sync_query( book_sync_t *sync, const query_t *query )
+ *  \brief Finds the entries of a shared book store matching a query.
+ *
+ *  A query requiring an ISBN only visits the shard of that ISBN.
+ *  \param sync The shared book store to be searched.
+ *  \param query The query to be matched.
+ *  \return On success a book store holding duplicates of the matching
+ *  entries is returned, to be destroyed along with its entries. Otherwise
+ *  NULL is returned and errno is set appropriately.
+ *  \exception ENOMEM Not enough memory to duplicate the entries.
+ */
+extern book_t *book_sync_query( book_sync_t *sync, const query_t *query );
+
+/*! \fn book_view_t *book_sync_pin( book_sync_t *sync )
+ *  \brief Pins a consistent view of a shared book store.
+ *
+ *  Writers are held back only while the shards written since the last
+ *  view are published. The view does not change afterwards and its
+ *  entries stay valid until it is released.
+ *  \param sync The shared book store to be viewed.
+ *  \return On success the view is returned. Otherwise NULL is returned and
+ *  errno is set appropriately.
+ *  \exception ENOMEM Not enough memory to publish the shards.
+ */
+extern book_view_t *book_sync_pin( book_sync_t *sync );
+
+/*! \fn entry_t *book_view_get( const book_view_t *view, unsigned long row )
+ *  \brief Gets an entry of a view.
+ *  \param view The view to be read.
+ *  \param row The zero-based position of the entry, less than the count of
+ *  the view.
+ *  \return The entry, which must not be changed.
+ */
+extern entry_t *book_view_get( const book_view_t *view, unsigned long row );
+
+/*! \fn book_t *book_view_book( const book_view_t *view )
+ *  \brief Builds a book store sharing the entries of a view.
+ *
+ *  The book store lets the functions of book.h and query.h read the view.
+ *  It must be destroyed without its entries before the view is released.
+ *  \param view The view to be read.
+ *  \return On success the book store is returned. Otherwise NULL is
+ *  returned and errno is set appropriately.
+ *  \exception ENOMEM Not enough memory to allocate the book store.
+ */
+extern book_t *book_view_book( const book_view_t *view );
+
+/*! \fn void book_view_release( book_view_t *view )
+ *  \brief Releases a view, letting entries retired since be destroyed.
+ *  \param view The view to be released.
+ */
+extern void book_view_release( book_view_t *view );
+
+/*! \fn long book_sync_update( book_sync_t *sync, const char *isbn, entry_field_t field, const char *value )
+ *  \brief Sets a member of the entries of a shared book store with an
+ *  ISBN.
+ *
+ *  Each entry is replaced by an edited copy, which moves to the shard of
+ *  its new ISBN when that is the member set.
+ *  \param sync The shared book store to be edited.
+ *  \param isbn The ISBN of the entries to be edited.
+ *  \param field The member to be set.
+ *  \param value The new value of the member.
+ *  \return On success the number of entries edited is returned. Otherwise
+ *  -1 is returned and errno is set appropriately.
+ *  \exception ENOMEM Not enough memory to copy the entries.
+ */
+extern long book_sync_update( book_sync_t *sync, const char *isbn,
+                              entry_field_t field, const char *value );
+
+/*! \fn long book_sync_remove( book_sync_t *sync, const char *isbn )
+ *  \brief Removes and retires the entries of a shared book store with an
+ *  ISBN.
+ *  \param sync The shared book store from which entries are removed.
+ *  \param isbn The ISBN of the entries to be removed.
+ *  \return On success the number of entries removed is returned. Otherwise
+ *  -1 is returned and errno is set appropriately.
+ *  \exception ENOMEM Not enough memory to look the entries up.
+ */
+extern long book_sync_remove( book_sync_t *sync, const char *isbn );
+
+/*! \fn unsigned long book_sync_count( book_sync_t *sync )
+ *  \brief Counts the entries of a shared book store.
+ *  \param sync The shared book store to be counted.
+ *  \return The number of entries.
+ */
+extern unsigned long book_sync_count( book_sync_t *sync );
+
+/*! \fn unsigned long long book_sync_bytes( book_sync_t *sync )
+ *  \brief Estimates the memory held by the entries of a shared book store.
+ *
+ *  The estimate is kept up to date by every write, so it is cheap to get.
+ *  Retired entries still held by views are not counted.
+ *  \param sync The shared book store to be measured.
+ *  \return The number of bytes.
+ */
+extern unsigned long long book_sync_bytes( book_sync_t *sync );
+
+/*! \fn book_t *book_sync_snapshot( book_sync_t *sync )
+ *  \brief Duplicates all entries of a shared book store at one point in
+ *  time.
+ *  \param sync The shared book store to be duplicated.
+ *  \return On success a book store holding duplicates of all entries is
+ *  returned. Otherwise NULL is returned and errno is set appropriately.
+ *  \exception ENOMEM Not enough memory to duplicate the entries.
+ */
+extern book_t *book_sync_snapshot( book_sync_t *sync );
+
+/*! \fn int book_sync_save( book_sync_t *sync, const char *filename, int packed )
+ *  \brief Saves a shared book store to a file.
+ *
+ *  The file is written from a view.
+ *  \param sync The shared book store to be saved.
+ *  \param filename The name of the file to be written.
+ *  \param packed Non-zero to write a compressed container.
+ *  \return On success zero is returned. Otherwise -1 is returned and errno
+ *  is set appropriately.
+ *  \exception ENOMEM Not enough memory to write the file.
+ *  \exception EIO The file could not be written.
+ */
+extern int book_sync_save( book_sync_t *sync, const char *filename, int packed );
+
+/*! \fn book_sync_t *book_sync_load( const char *filename, int *packed, int *sharded )
+ *  \brief Loads a shared book store from a file in any format.
+ *
+ *  The shards of a manifest are loaded concurrently into as many shards.
+ *  Any other file gets BOOK_SYNC_SHARDS shards.
+ *  \param filename The name of the file to be read.
+ *  \param packed Where to store whether the file, or its shard files,
+ *  were compressed containers.
+ *  \param sharded Where to store whether the file was a manifest.
+ *  \return On success the shared book store is returned, empty if the
+ *  file does not exist. Otherwise NULL is returned and errno is set
+ *  appropriately.
+ *  \exception ENOMEM Not enough memory to load the book store.
+ *  \exception EIO A file is missing, truncated, malformed or fails its
+ *  checksums.
+ */
+extern book_sync_t *book_sync_load( const char *filename, int *packed, int *sharded );
+
+/*! \fn int book_sync_save_shards( book_sync_t *sync, const char *filename, int packed )
+ *  \brief Saves a shared book store as one shard file per shard.
+ *
+ *  The files are written concurrently from a view.
+ *  \param sync The shared book store to be saved.
+ *  \param filename The name of the manifest to be written.
+ *  \param packed Non-zero to write compressed containers.
+ *  \return On success zero is returned. Otherwise -1 is returned and errno
+ *  is set appropriately.
+ *  \exception ENOMEM Not enough memory to write the files.
+ *  \exception EIO A file could not be written.
+ */
+extern int book_sync_save_shards( book_sync_t *sync, const char *filename, int packed );
+
+/*! \fn void book_sync_destroy( book_sync_t *sync )
+ *  \brief Destroys a shared book store along with its entries.
+ *
+ *  No other thread may use the shared book store anymore and all views
+ *  must have been released.
+ *  \param sync The shared book store to be destroyed.
+ */
+extern void book_sync_destroy( book_sync_t *sync );
+
+#endif /* BOOK_SYNC_H */
@@ -0,0 +1,141 @@
+#ifndef CATALOG_H
+#define CATALOG_H
+
+/*! \file catalog.h
+ *  \brief Definitions for a cache of the book stores of many users.
+ *
+ *  A catalog keeps the book stores of several files loaded at once as
+ *  shared book stores, each loaded once however many sessions use it.
+ *  Sessions acquire the book store of a file and release it when done.
+ *  Book stores no session holds stay loaded while the memory of all of
+ *  them fits the budget. Past the budget, the least recently used of them
+ *  are evicted, after being saved if a session changed them. Eviction is
+ *  checked whenever a book store is loaded and on request.
+ *
+ *  A catalog may be used by many threads. A session acquiring a book store
+ *  that is being loaded or evicted waits for that to finish, while others
+ *  proceed.
+ */
+
+#include <pthread.h>
+#include "book_sync.h"
+
+/*! \def CATALOG_BUDGET
+ *  \brief Memory budget in bytes used when none is given.
+ */
+#define CATALOG_BUDGET  ( 1024ULL * 1024 * 1024 )
+
+/*! \typedef catalog_entry_t
+ *  \brief Type definition of a book store held by a catalog.
+ *
+ *  A busy book store is being loaded or evicted. Book stores are chained
+ *  in their hash slot and in order of use, most recent first.
+ */
+typedef struct catalog_entry
+{
+    char *e_filename;
+    book_sync_t *e_store;
+    int e_packed;
+    int e_sharded;
+    int e_busy;
+    int e_dirty;
+    unsigned long e_refs;
+    unsigned long long e_bytes;
+    struct catalog_entry *e_chain;
+    struct catalog_entry *e_prev;
+    struct catalog_entry *e_next;
+} catalog_entry_t;
+
+/*! \typedef catalog_t
+ *  \brief Type definition of a catalog.
+ */
+typedef struct
+{
+    pthread_mutex_t a_lock;
+    pthread_cond_t a_ready;
+    catalog_entry_t **a_slots;
+    unsigned long a_mask;
+    unsigned long a_count;
+    catalog_entry_t *a_head;
+    catalog_entry_t *a_tail;
+    unsigned long long a_bytes;
+    unsigned long long a_budget;
+    int a_compress;
+    int a_sharded;
+} catalog_t;
+
+/*! \fn catalog_t *catalog_create( unsigned long long budget, int compress, int sharded )
+ *  \brief Creates an empty catalog.
+ *  \param budget The memory budget in bytes, or zero for CATALOG_BUDGET.
+ *  \param compress Non-zero to save every book store as compressed
+ *  containers, zero to keep the format each was loaded from.
+ *  \param sharded Non-zero to save every book store as shard files, zero
+ *  to keep the layout each was loaded from.
+ *  \return On success the catalog is returned. Otherwise NULL is returned
+ *  and errno is set appropriately.
+ *  \exception ENOMEM Not enough memory to allocate the catalog.
+ */
+extern catalog_t *catalog_create( unsigned long long budget, int compress, int sharded );
+
+/*! \fn catalog_entry_t *catalog_acquire( catalog_t *catalog, const char *filename )
+ *  \brief Acquires the book store of a file, loading it if needed.
+ *  \param catalog The catalog holding the book store.
+ *  \param filename The name of the file of the book store.
+ *  \return On success the book store is returned, to be released once
+ *  done. Otherwise NULL is returned and errno is set appropriately.
+ *  \exception ENOMEM Not enough memory to load the book store.
+ *  \exception EIO The file is truncated, malformed or fails its checksums.
+ */
+extern catalog_entry_t *catalog_acquire( catalog_t *catalog, const char *filename );
+
+/*! \fn void catalog_release( catalog_t *catalog, catalog_entry_t *entry, int modified )
+ *  \brief Releases a book store acquired from a catalog.
+ *
+ *  Releasing never evicts, so it does not wait for a book store to be
+ *  saved.
+ *  \param catalog The catalog holding the book store.
+ *  \param entry The book store to be released.
+ *  \param modified Non-zero if the session changed the book store.
+ */
+extern void catalog_release( catalog_t *catalog, catalog_entry_t *entry, int modified );
+
+/*! \fn int catalog_trim( catalog_t *catalog )
+ *  \brief Evicts book stores no session holds until the budget is met.
+ *  \param catalog The catalog to be trimmed.
+ *  \return On success zero is returned. Otherwise -1 is returned, errno is
+ *  set appropriately and the book stores that could not be saved are kept.
+ *  \exception ENOMEM Not enough memory to save a book store.
+ *  \exception EIO A book store could not be saved.
+ */
+extern int catalog_trim( catalog_t *catalog );
+
+/*! \fn int catalog_save( catalog_t *catalog, catalog_entry_t *entry )
+ *  \brief Saves an acquired book store to its file.
+ *  \param catalog The catalog holding the book store.
+ *  \param entry The book store to be saved.
+ *  \return On success zero is returned. Otherwise -1 is returned and errno
+ *  is set appropriately.
+ *  \exception ENOMEM Not enough memory to save the book store.
+ *  \exception EIO The file could not be written.
+ */
+extern int catalog_save( catalog_t *catalog, catalog_entry_t *entry );
+
+/*! \fn int catalog_flush( catalog_t *catalog )
+ *  \brief Saves all changed book stores of a catalog.
+ *
+ *  No other thread may use the catalog meanwhile.
+ *  \param catalog The catalog to be saved.
+ *  \return On success zero is returned. Otherwise -1 is returned and errno
+ *  is set appropriately after trying to save all book stores.
+ *  \exception ENOMEM Not enough memory to save a book store.
+ *  \exception EIO A file could not be written.
+ */
+extern int catalog_flush( catalog_t *catalog );
+
+/*! \fn void catalog_destroy( catalog_t *catalog )
+ *  \brief Destroys a catalog and its book stores without saving them.
+ *  \param catalog The catalog to be destroyed.
+ */
+extern void catalog_destroy( catalog_t *catalog );
+
+#endif /* CATALOG_H */
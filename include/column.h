@@ -0,0 +1,101 @@
+#ifndef COLUMN_H
+#define COLUMN_H
+
+/*! \file column.h
+ *  \brief Definitions for columnar copies of the members of entries.
+ *
+ *  A column keeps one member of a table of entries in one contiguous arena
+ *  of null-terminated values and addresses them by row through an offsets
+ *  array. Numeric members are also kept as a dense array. Scanning or
+ *  aggregating a single member thus streams through one dense array
+ *  instead of chasing a pointer per entry. A column is a snapshot: it has
+ *  to be rebuilt once the entries it was made from change.
+ */
+
+#include "book.h"
+#include "query.h"
+
+/*! \typedef column_t
+ *  \brief Type definition of the values of one member of a table of entries.
+ *
+ *  The value of row r starts at c_offsets[ r ] within the arena and is
+ *  followed by a null character ending right before c_offsets[ r + 1 ].
+ *  The numbers are only kept for ENTRY_PAGES and ENTRY_PUBDATE. The
+ *  remaining members are left to the owner of the column, to tell which
+ *  state of the entries it was built from and which state last asked for it.
+ */
+typedef struct
+{
+    char *c_data;
+    unsigned long long *c_offsets;
+    unsigned long long c_size;
+    long *c_numbers;
+    unsigned long c_rows;
+    unsigned long c_version;
+    unsigned long c_generation;
+    unsigned long c_wanted;
+    unsigned long c_failed;
+} column_t;
+
+/*! \fn int column_build( column_t *column, entry_t **rows, unsigned long count, entry_field_t field )
+ *  \brief Copies a member of a table of entries into a column.
+ *
+ *  Descriptions still to be read from a file are never read: the copy then
+ *  fails and the column is left as it was.
+ *  \param column The column to be filled, whose previous values are
+ *  released on success.
+ *  \param rows The entries, in row order.
+ *  \param count The number of entries.
+ *  \param field The member to be copied.
+ *  \return On success zero is returned. Otherwise -1 is returned and errno
+ *  is set appropriately.
+ *  \exception EAGAIN Some description has yet to be read.
+ *  \exception ENOMEM Not enough memory to allocate the column.
+ */
+extern int column_build( column_t *column, entry_t **rows, unsigned long count,
+                         entry_field_t field );
+
+/*! \fn const char *column_value( const column_t *column, unsigned long row, unsigned long long *len )
+ *  \brief Gets the value of a row.
+ *  \param column The column of interest.
+ *  \param row The row of interest.
+ *  \param len Where to store the length of the value, or NULL.
+ *  \return A null-terminated string containing the value.
+ */
+extern const char *column_value( const column_t *column, unsigned long row,
+                                 unsigned long long *len );
+
+/*! \fn unsigned long column_match( const column_t *column, const query_t *query, unsigned long first, unsigned long last, unsigned long *rows )
+ *  \brief Finds the rows of a range matching a predicate on the member of
+ *  a column.
+ *  \param column The column to be scanned.
+ *  \param query An equality, prefix, substring or range predicate, the
+ *  latter only on a numeric member.
+ *  \param first The first row to be scanned.
+ *  \param last The row after the last one to be scanned.
+ *  \param rows Where to store the matching rows in ascending order, room
+ *  for last minus first rows.
+ *  \return The number of matching rows.
+ */
+extern unsigned long column_match( const column_t *column, const query_t *query,
+                                   unsigned long first, unsigned long last,
+                                   unsigned long *rows );
+
+/*! \fn int column_sum( const column_t *column, long long *sum, unsigned long *count )
+ *  \brief Sums a numeric member over all rows.
+ *  \param column The column to be scanned.
+ *  \param sum Where to store the sum of the parsed values.
+ *  \param count Where to store the number of parsed values.
+ *  \return On success zero is returned. Otherwise -1 is returned and errno
+ *  is set appropriately.
+ *  \exception EINVAL The member has no numeric form.
+ */
+extern int column_sum( const column_t *column, long long *sum, unsigned long *count );
+
+/*! \fn void column_destroy( column_t *column )
+ *  \brief Releases the values of a column, leaving it empty.
+ *  \param column The column to be emptied.
+ */
+extern void column_destroy( column_t *column );
+
+#endif /* COLUMN_H */
@@ -0,0 +1,31 @@
+#ifndef CRC32C_H
+#define CRC32C_H
+
+/*! \file crc32c.h
+ *  \brief Definitions for CRC32C (Castagnoli) checksums.
+ *
+ *  The checksum is computed with the crc32 instruction of SSE4.2 when the
+ *  running processor supports it and with a table driven implementation
+ *  processing eight bytes at a time otherwise.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+/*! \fn unsigned crc32c( unsigned crc, const void *data, unsigned long long len )
+ *  \brief Extends a CRC32C checksum over a sequence of bytes.
+ *  \param crc The checksum of the preceding bytes, or zero to start anew.
+ *  \param data The bytes to be added to the checksum.
+ *  \param len The number of bytes.
+ *  \return The checksum of the preceding bytes followed by data.
+ */
+extern unsigned crc32c( unsigned crc, const void *data, unsigned long long len );
+
+/*! \fn const char *crc32c_kernel( void )
+ *  \brief Gets the name of the implementation selected for the running
+ *  processor.
+ *  \return Either "sse4.2" or "table".
+ */
+extern const char *crc32c_kernel( void );
+
+#endif /* CRC32C_H */
@@ -0,0 +1,127 @@
+#ifndef CREDENTIALS_H
+#define CREDENTIALS_H
+
+/*! \file credentials.h
+ *  \brief Definitions for the credentials of the users of book stores.
+ *
+ *  The credentials file holds one user per line as USERNAME:SECRET:FILE,
+ *  where FILE is the book store of the user. Lines starting with # are
+ *  comments. The secret is either a password in clear text, accepted for
+ *  compatibility, or a salted hash made by credentials_hash of the form
+ *  $pbkdf2-sha256$ITERATIONS$SALT$HASH with the salt and hash in
+ *  hexadecimal.
+ *
+ *  The file is loaded once into a hash table keyed by username and loaded
+ *  again when its modification time, size or inode changes, so checking a
+ *  password does not read the file. The credentials are not meant to be
+ *  shared between threads.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/types.h>
+
+/*! \def CREDENTIALS_SCHEME
+ *  \brief Prefix of a hashed secret.
+ */
+#define CREDENTIALS_SCHEME      "$pbkdf2-sha256$"
+
+/*! \def CREDENTIALS_ITERATIONS
+ *  \brief Number of iterations of the hashes made.
+ */
+#define CREDENTIALS_ITERATIONS  100000
+
+/*! \def CREDENTIALS_SALT
+ *  \brief Number of bytes of the salts made.
+ */
+#define CREDENTIALS_SALT        16
+
+/*! \def CREDENTIALS_SECRET_MAX
+ *  \brief Size of a buffer large enough for a hashed secret.
+ */
+#define CREDENTIALS_SECRET_MAX  128
+
+/*! \typedef credential_t
+ *  \brief Type definition of the credential of a user.
+ */
+typedef struct credential
+{
+    char *c_username;
+    char *c_secret;
+    char *c_filename;
+    struct credential *c_next;
+} credential_t;
+
+/*! \typedef credentials_t
+ *  \brief Type definition of the credentials loaded from a file.
+ */
+typedef struct
+{
+    char *r_path;
+    credential_t **r_slots;
+    unsigned long r_mask;
+    unsigned long r_count;
+    time_t r_mtime;
+    time_t r_ctime;
+    off_t r_size;
+    ino_t r_inode;
+} credentials_t;
+
+/*! \fn credentials_t *credentials_open( const char *path )
+ *  \brief Loads the credentials of a file.
+ *  \param path The name of the credentials file.
+ *  \return On success the credentials are returned. Otherwise NULL is
+ *  returned and errno is set appropriately.
+ *  \exception ENOMEM Not enough memory to load the credentials.
+ *  \exception ENOENT The file does not exist.
+ */
+extern credentials_t *credentials_open( const char *path );
+
+/*! \fn int credentials_refresh( credentials_t *credentials )
+ *  \brief Loads the credentials again if their file has changed.
+ *
+ *  On failure the credentials loaded before are kept.
+ *  \param credentials The credentials to be refreshed.
+ *  \return On success zero is returned. Otherwise -1 is returned and errno
+ *  is set appropriately.
+ *  \exception ENOMEM Not enough memory to load the credentials.
+ *  \exception ENOENT The file does not exist anymore.
+ */
+extern int credentials_refresh( credentials_t *credentials );
+
+/*! \fn const char *credentials_check( credentials_t *credentials, const char *username, const char *password )
+ *  \brief Checks the password of a user.
+ *
+ *  The credentials are refreshed first. A user listed more than once is
+ *  checked against its first line.
+ *  \param credentials The credentials to be searched.
+ *  \param username The name of the user.
+ *  \param password The password to be checked.
+ *  \return The name of the book store file of the user if the password is
+ *  right, valid until the credentials are refreshed. Otherwise NULL.
+ */
+extern const char *credentials_check( credentials_t *credentials,
+                                      const char *username,
+                                      const char *password );
+
+/*! \fn int credentials_hash( const char *password, char *secret, size_t size )
+ *  \brief Makes the salted hash of a password to be stored as a secret.
+ *  \param password The password to be hashed.
+ *  \param secret Where to store the null-terminated secret.
+ *  \param size The size of secret, at least CREDENTIALS_SECRET_MAX.
+ *  \return On success zero is returned. Otherwise -1 is returned and errno
+ *  is set appropriately.
+ *  \exception EINVAL The buffer is too small.
+ *  \exception EIO No random salt could be read.
+ */
+extern int credentials_hash( const char *password, char *secret, size_t size );
+
+/*! \fn void credentials_destroy( credentials_t *credentials )
+ *  \brief Destroys credentials.
+ *  \param credentials The credentials to be destroyed.
+ */
+extern void credentials_destroy( credentials_t *credentials );
+
+#endif /* CREDENTIALS_H */
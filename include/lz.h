@@ -0,0 +1,53 @@
+#ifndef LZ_H
+#define LZ_H
+
+/*! \file lz.h
+ *  \brief Definitions for a fast LZ77 block codec.
+ *
+ *  The codec follows the design of LZ4: a block is a sequence of literal
+ *  runs each followed by a back reference of at least four bytes into the
+ *  preceding 64 KiB, found through a single-probe hash table. It trades
+ *  compression ratio for speed, decompressing at memory bandwidth.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+/*! \def LZ_WINDOW
+ *  \brief Largest distance of a back reference.
+ */
+#define LZ_WINDOW   65535
+
+/*! \fn unsigned long long lz_bound( unsigned long long len )
+ *  \brief Gets the largest compressed size of a block.
+ *  \param len The size of the block.
+ *  \return The number of bytes that any compressed block of that size fits.
+ */
+extern unsigned long long lz_bound( unsigned long long len );
+
+/*! \fn unsigned long long lz_compress( const char *src, unsigned long long len, char *dst, unsigned long long cap )
+ *  \brief Compresses a block.
+ *  \param src The block to be compressed.
+ *  \param len The size of the block.
+ *  \param dst Where to store the compressed block.
+ *  \param cap The number of bytes available at dst.
+ *  \return The size of the compressed block, or zero if it does not fit.
+ */
+extern unsigned long long lz_compress( const char *src, unsigned long long len,
+                                       char *dst, unsigned long long cap );
+
+/*! \fn int lz_decompress( const char *src, unsigned long long len, char *dst, unsigned long long size )
+ *  \brief Decompresses a block.
+ *
+ *  Every length and back reference is checked against the bounds of the
+ *  buffers, so corrupted input is reported rather than followed.
+ *  \param src The compressed block.
+ *  \param len The size of the compressed block.
+ *  \param dst Where to store the decompressed block.
+ *  \param size The size of the decompressed block.
+ *  \return Zero on success, -1 if the compressed block is malformed.
+ */
+extern int lz_decompress( const char *src, unsigned long long len,
+                          char *dst, unsigned long long size );
+
+#endif /* LZ_H */
@@ -0,0 +1,56 @@
+#ifndef MATCH_H
+#define MATCH_H
+
+/*! \file match.h
+ *  \brief Definitions for matching kernels over field data.
+ *
+ *  Equality, prefix and substring matching are implemented once with
+ *  portable C and, on x86 processors, once more with SSE2 and AVX2 vector
+ *  instructions. The fastest kernel supported by the running processor is
+ *  selected on first use.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+/*! \fn int match_equal( const char *a, unsigned long long alen, const char *b, unsigned long long blen )
+ *  \brief Tests two sequences of characters for equality.
+ *  \param a The first sequence.
+ *  \param alen The length of the first sequence.
+ *  \param b The second sequence.
+ *  \param blen The length of the second sequence.
+ *  \return Non-zero if the sequences are equal, zero otherwise.
+ */
+extern int match_equal( const char *a, unsigned long long alen,
+                        const char *b, unsigned long long blen );
+
+/*! \fn int match_prefix( const char *s, unsigned long long slen, const char *prefix, unsigned long long plen )
+ *  \brief Tests whether a sequence of characters starts with a prefix.
+ *  \param s The sequence to be tested.
+ *  \param slen The length of the sequence.
+ *  \param prefix The prefix.
+ *  \param plen The length of the prefix.
+ *  \return Non-zero if the sequence starts with the prefix, zero otherwise.
+ */
+extern int match_prefix( const char *s, unsigned long long slen,
+                         const char *prefix, unsigned long long plen );
+
+/*! \fn const char *match_find( const char *haystack, unsigned long long hlen, const char *needle, unsigned long long nlen )
+ *  \brief Finds the first occurrence of a substring.
+ *  \param haystack The sequence to be searched.
+ *  \param hlen The length of the sequence to be searched.
+ *  \param needle The substring to be found.
+ *  \param nlen The length of the substring.
+ *  \return A pointer to the first occurrence within the haystack or NULL
+ *  if there is none.
+ */
+extern const char *match_find( const char *haystack, unsigned long long hlen,
+                               const char *needle, unsigned long long nlen );
+
+/*! \fn const char *match_kernel( void )
+ *  \brief Gets the name of the kernel selected for the running processor.
+ *  \return Either "avx2", "sse2" or "scalar".
+ */
+extern const char *match_kernel( void );
+
+#endif /* MATCH_H */
@@ -15,8 +15,41 @@
 #include <errno.h>
 #include "node_string.h"
 
+/*! \def ENTRY_NONE
+ *  \brief Value of a numeric member that could not be parsed.
+ */
+#define ENTRY_NONE  ( -1L )
+
+/*! \def ENTRY_LAZY_MIN
+ *  \brief Length from which a decoded description may be left on disk.
+ */
+#define ENTRY_LAZY_MIN  64
+
+/*! \typedef entry_field_t
+ *  \brief Enumeration of the members of an entry.
+ */
+typedef enum
+{
+    ENTRY_TITLE,
+    ENTRY_AUTHOR,
+    ENTRY_PAGES,
+    ENTRY_EDITION,
+    ENTRY_LANGUAGE,
+    ENTRY_PUBLISHER,
+    ENTRY_PUBDATE,
+    ENTRY_ISBN,
+    ENTRY_DESCRIPTION,
+    ENTRY_FIELDS
+} entry_field_t;
+
 /*! \typedef entry_t
  *  \brief Type definition for book store entries.
+ *
+ *  Members pages and pubdate are also kept in numeric form, parsed once
+ *  when they are set, so that range queries need not parse strings.
+ *
+ *  A lazy description has its length but no characters until it is first
+ *  got, when they are read from the source at the offset and kept.
  */
 typedef struct
 {
@@ -29,6 +62,10 @@ typedef struct
     string_t    *e_pubdate;
     string_t    *e_isbn; 
     string_t    *e_description; 
+    long        e_pages_num;
+    long        e_pubdate_num;
+    string_source_t *e_source;
+    unsigned long long e_offset;
 } entry_t;
 
 /*! \fn entry_t *entry_create( void )
@@ -64,12 +101,17 @@ extern void entry_print( FILE *file, entry_t *entry );
  */
 extern entry_t *entry_scan( FILE *file );
 
-/*! \fn void entry_write( FILE *file, entry_t *entry )
+/*! \fn int entry_write( FILE *file, entry_t *entry )
  *  \brief Writes an entry in binary format to a specifed stream.
+ *
+ *  A lazy description is read for the write but not kept.
  *  \param file The stream where to write the entry.
  *  \param entry The entry to be written.
+ *  \return On success zero is returned. Otherwise -1 is returned and errno
+ *  is set appropriately.
+ *  \exception EIO A lazy description could not be read.
  */
-extern void entry_write( FILE *file, entry_t *entry );
+extern int entry_write( FILE *file, entry_t *entry );
 
 /*! \fn entry_t *entry_read( FILE *file )
  *  \brief Reads an entry in binary format from a specified stream.
@@ -77,9 +119,70 @@ extern void entry_write( FILE *file, entry_t *entry );
  *  \return On success a new entry with read values is returned. Otherwise
  *  NULL is returned and errno is set appropriately.
  *  \exception ENOMEM Not enough memory to allocate the entry.
+ *  \exception EIO The stream ends before the entry does.
  */
 extern entry_t *entry_read( FILE *file );
 
+/*! \fn entry_t *entry_read_lazy( FILE *file, string_source_t *source )
+ *  \brief Reads an entry leaving a long description in its file.
+ *
+ *  A description of at least ENTRY_LAZY_MIN characters is made lazy and
+ *  the stream is moved past it without reading it.
+ *  \param file The stream from where to read the entry, which must be
+ *  seekable if a source is given.
+ *  \param source The open file the stream reads, or NULL to read every
+ *  member.
+ *  \return On success a new entry with read values is returned. Otherwise
+ *  NULL is returned and errno is set appropriately.
+ *  \exception ENOMEM Not enough memory to allocate the entry.
+ *  \exception EIO The stream ends before the entry does.
+ */
+extern entry_t *entry_read_lazy( FILE *file, string_source_t *source );
+
+/*! \fn unsigned long long entry_encode( char *data, entry_t *entry )
+ *  \brief Encodes an entry in the binary format of entry_write.
+ *
+ *  A lazy description is read straight into the buffer but not kept.
+ *  \param data The buffer where to encode the entry, or NULL to only
+ *  compute its size.
+ *  \param entry The entry to be encoded.
+ *  \return The number of bytes of the encoded entry, or zero if a lazy
+ *  description could not be read.
+ */
+extern unsigned long long entry_encode( char *data, entry_t *entry );
+
+/*! \fn entry_t *entry_decode( const char *data, unsigned long long size, unsigned long long *used )
+ *  \brief Decodes an entry in the binary format of entry_write.
+ *  \param data The buffer from where to decode the entry.
+ *  \param size The number of bytes available in the buffer.
+ *  \param used Where to store the number of bytes decoded.
+ *  \return On success a new entry with the decoded values is returned.
+ *  Otherwise NULL is returned and errno is set appropriately.
+ *  \exception EIO The buffer ends before the entry does.
+ *  \exception ENOMEM Not enough memory to allocate the entry.
+ */
+extern entry_t *entry_decode( const char *data, unsigned long long size,
+                              unsigned long long *used );
+
+/*! \fn entry_t *entry_decode_lazy( const char *data, unsigned long long size, unsigned long long *used, string_source_t *source, unsigned long long offset )
+ *  \brief Decodes an entry leaving a long description in its file.
+ *
+ *  A description of at least ENTRY_LAZY_MIN characters is made lazy.
+ *  \param data The buffer from where to decode the entry.
+ *  \param size The number of bytes available in the buffer.
+ *  \param used Where to store the number of bytes decoded.
+ *  \param source The open file the buffer was read from, or NULL to
+ *  decode every member.
+ *  \param offset The position of the buffer in the file.
+ *  \return On success a new entry with the decoded values is returned.
+ *  Otherwise NULL is returned and errno is set appropriately.
+ *  \exception EIO The buffer ends before the entry does.
+ *  \exception ENOMEM Not enough memory to allocate the entry.
+ */
+extern entry_t *entry_decode_lazy( const char *data, unsigned long long size,
+                                   unsigned long long *used, string_source_t *source,
+                                   unsigned long long offset );
+
 /*! \fn void entry_set_title( entry_t *entry, string_t *title )
  *  \brief Sets member title of entry structure.
  *  \param entry The entry to be modified.
@@ -143,6 +246,14 @@ extern void entry_set_isbn( entry_t *entry, string_t *isbn );
  */
 extern void entry_set_description( entry_t *entry, string_t *description );
 
+/*! \fn void entry_set_field( entry_t *entry, entry_field_t field, string_t *value )
+ *  \brief Sets a member of entry structure by its field.
+ *  \param entry The entry to be modified.
+ *  \param field The member to be modified.
+ *  \param value A string containing a value for the member.
+ */
+extern void entry_set_field( entry_t *entry, entry_field_t field, string_t *value );
+
 /*! \fn string_t *entry_get_title( entry_t *entry )
  *  \brief Gets member title of entry structure.
  *  \param entry The entry to be accessed.
@@ -201,11 +312,93 @@ extern string_t *entry_get_isbn( entry_t *entry );
 
 /*! \fn string_t *entry_get_description( entry_t *entry )
  *  \brief Gets member description of entry structure.
+ *
+ *  A lazy description is read and kept on first call. Concurrent calls
+ *  may read it twice but keep one copy.
  *  \param entry The entry to be accessed.
- *  \return A string containing the value for description.
+ *  \return A string containing the value for description, empty if a lazy
+ *  one could not be read.
  */
 extern string_t *entry_get_description( entry_t *entry );
 
+/*! \fn int entry_lazy( const entry_t *entry )
+ *  \brief Tells whether the description of an entry is still to be read.
+ *  \param entry The entry to be accessed.
+ *  \return Non-zero if the description has yet to be read, zero otherwise.
+ */
+extern int entry_lazy( const entry_t *entry );
+
+/*! \fn string_t *entry_get_field( entry_t *entry, entry_field_t field )
+ *  \brief Gets a member of entry structure by its field.
+ *  \param entry The entry to be accessed.
+ *  \param field The member to be accessed.
+ *  \return A string containing the value for the member.
+ */
+extern string_t *entry_get_field( entry_t *entry, entry_field_t field );
+
+/*! \fn const char *entry_field_name( entry_field_t field )
+ *  \brief Gets the name of a member of entry structure.
+ *  \param field The member of interest.
+ *  \return A null-terminated string such as "title" or "pubdate".
+ */
+extern const char *entry_field_name( entry_field_t field );
+
+/*! \fn long entry_get_pages_num( entry_t *entry )
+ *  \brief Gets member pages of entry structure as a number.
+ *  \param entry The entry to be accessed.
+ *  \return The number of pages or ENTRY_NONE if it could not be parsed.
+ */
+extern long entry_get_pages_num( entry_t *entry );
+
+/*! \fn long entry_get_pubdate_num( entry_t *entry )
+ *  \brief Gets member pubdate of entry structure as a number.
+ *  \param entry The entry to be accessed.
+ *  \return The publication date encoded as YYYYMMDD or ENTRY_NONE if it
+ *  could not be parsed.
+ */
+extern long entry_get_pubdate_num( entry_t *entry );
+
+/*! \fn long entry_parse_pages( const char *s )
+ *  \brief Parses a page count.
+ *  \param s A null-terminated string such as "350" or "xii, 350 pages".
+ *  \return The first decimal number found in the string or ENTRY_NONE.
+ */
+extern long entry_parse_pages( const char *s );
+
+/*! \fn long entry_parse_pubdate( const char *s )
+ *  \brief Parses a publication date.
+ *
+ *  Accepted forms are a year optionally followed by month and day
+ *  ("2015", "2015-03", "2015/03/21"), month and day followed by a year
+ *  ("03/21/2015") and dates with English month names ("March 2015",
+ *  "21 Mar 2015"). A missing month or day is encoded as zero, so a whole
+ *  year Y is covered by the range Y0000 to Y1231.
+ *  \param s A null-terminated string containing a date.
+ *  \return The date encoded as YYYYMMDD or ENTRY_NONE.
+ */
+extern long entry_parse_pubdate( const char *s );
+
+/*! \fn unsigned long entry_generation( entry_field_t field )
+ *  \brief Gets the modification count of a member across all entries.
+ *
+ *  The count is incremented whenever a member that was already set is
+ *  replaced, which lets indexes detect edits of entries they cover. The
+ *  count is updated atomically, so entries may be edited concurrently.
+ *  \param field The member of interest.
+ *  \return The modification count of the member.
+ */
+extern unsigned long entry_generation( entry_field_t field );
+
+/*! \fn unsigned long long entry_bytes( entry_t *entry )
+ *  \brief Estimates the memory held by an entry.
+ *
+ *  Lazy descriptions are not counted, even once read, so the estimate of
+ *  an entry does not change while it is only read.
+ *  \param entry The entry to be measured.
+ *  \return The number of bytes.
+ */
+extern unsigned long long entry_bytes( entry_t *entry );
+
 /*! \fn void entry_destroy( entry_t *entry )
  *  \brief Destroys an entry.
  *  \param entry The entry to be destroyed.
@@ -26,6 +26,17 @@ typedef struct
     unsigned long long s_len;
 } string_t;
 
+/*! \typedef string_source_t
+ *  \brief Type definition of an open file strings are fetched from.
+ *
+ *  The file is closed once the last reference is released.
+ */
+typedef struct
+{
+    int u_fd;
+    unsigned long u_refs;
+} string_source_t;
+
 /*! \fn string_t *string_create( const char *s )
  *  \brief Creates a string.
  *  \param s The string used for initializing the string.
@@ -35,6 +46,16 @@ typedef struct
  */
 extern string_t *string_create( const char *s );
 
+/*! \fn string_t *string_create_n( const char *s, unsigned long long len )
+ *  \brief Creates a string from the first characters of a buffer.
+ *  \param s The characters used for initializing the string.
+ *  \param len The number of characters to copy.
+ *  \return On success a new string is returned. Otherwise NULL is returned
+ *  and errno is set appropriately.
+ *  \exception ENOMEM  Not enough memory to allocate the string.
+ */
+extern string_t *string_create_n( const char *s, unsigned long long len );
+
 /*! \fn string_t *string_duplicate( const string_t *str )
  *  \brief Duplicates an existing string.
  *  \param str The string to be duplicated.
@@ -73,12 +94,92 @@ extern void string_write( FILE *file, string_t *str );
  *  \return On success a new string object is returned with the input read.
  *  Otherwise NULL is returned and errno is set appropriately.
  *  \exception ENOMEM Not enough memory to allocate the string.
+ *  \exception EIO The stream ends before the string does.
  */
 extern string_t *string_read( FILE *file );
 
+/*! \fn unsigned long long string_encode( char *data, const string_t *str )
+ *  \brief Encodes a string in the binary format of string_write.
+ *  \param data The buffer where to encode the string, or NULL to only
+ *  compute its size.
+ *  \param str The string to be encoded.
+ *  \return The number of bytes of the encoded string.
+ */
+extern unsigned long long string_encode( char *data, const string_t *str );
+
+/*! \fn string_t *string_decode( const char *data, unsigned long long size, unsigned long long *used )
+ *  \brief Decodes a string in the binary format of string_write.
+ *  \param data The buffer from where to decode the string.
+ *  \param size The number of bytes available in the buffer.
+ *  \param used Where to store the number of bytes decoded.
+ *  \return On success a new string object is returned with the decoded
+ *  value. Otherwise NULL is returned and errno is set appropriately.
+ *  \exception EIO The buffer ends before the string does.
+ *  \exception ENOMEM Not enough memory to allocate the string.
+ */
+extern string_t *string_decode( const char *data, unsigned long long size,
+                                unsigned long long *used );
+
+/*! \fn unsigned long string_hash( const char *s, unsigned long long len )
+ *  \brief Computes the FNV-1a hash of a sequence of characters.
+ *  \param s The characters to be hashed.
+ *  \param len The number of characters.
+ *  \return The hash value.
+ */
+extern unsigned long string_hash( const char *s, unsigned long long len );
+
+/*! \fn string_source_t *string_source_open( int fd )
+ *  \brief Opens a source of strings on a duplicate of a file descriptor.
+ *  \param fd The file descriptor of the file to be read.
+ *  \return On success the source is returned with one reference. Otherwise
+ *  NULL is returned and errno is set appropriately.
+ *  \exception ENOMEM Not enough memory to allocate the source.
+ *  \exception EMFILE Too many open files.
+ */
+extern string_source_t *string_source_open( int fd );
+
+/*! \fn void string_source_retain( string_source_t *source )
+ *  \brief Adds a reference to a source of strings.
+ *  \param source The source to be referenced.
+ */
+extern void string_source_retain( string_source_t *source );
+
+/*! \fn int string_source_fill( string_source_t *source, unsigned long long offset, unsigned long long len, char *s )
+ *  \brief Reads characters from a source of strings into a buffer.
+ *  \param source The source to be read.
+ *  \param offset The position of the characters in the file.
+ *  \param len The number of characters.
+ *  \param s The buffer where to store the characters, not terminated.
+ *  \return On success zero is returned. Otherwise -1 is returned and errno
+ *  is set appropriately.
+ *  \exception EIO The file ends before the characters do.
+ */
+extern int string_source_fill( string_source_t *source, unsigned long long offset,
+                               unsigned long long len, char *s );
+
+/*! \fn char *string_source_read( string_source_t *source, unsigned long long offset, unsigned long long len )
+ *  \brief Reads characters from a source of strings.
+ *  \param source The source to be read.
+ *  \param offset The position of the characters in the file.
+ *  \param len The number of characters.
+ *  \return On success the null-terminated characters are returned, to be
+ *  freed by the caller. Otherwise NULL is returned and errno is set
+ *  appropriately.
+ *  \exception ENOMEM Not enough memory to allocate the characters.
+ *  \exception EIO The file ends before the characters do.
+ */
+extern char *string_source_read( string_source_t *source, unsigned long long offset,
+                                 unsigned long long len );
+
+/*! \fn void string_source_release( string_source_t *source )
+ *  \brief Releases a reference to a source of strings.
+ *  \param source The source to be released, or NULL.
+ */
+extern void string_source_release( string_source_t *source );
+
 /*! \fn void string_destroy( string_t *str )
  *  \brief Destroys a string.
- *  \param str The string object to be destroyed.
+ *  \param str The string object to be destroyed, or NULL.
  */
 extern void string_destroy( string_t *str );
 
@@ -0,0 +1,98 @@
+#ifndef POOL_H
+#define POOL_H
+
+/*! \file pool.h
+ *  \brief Definitions for a pool of worker threads.
+ *
+ *  The pool runs jobs submitted to a queue on a fixed set of threads. It
+ *  also runs batches of numbered parts, in which the submitting thread
+ *  takes part itself, so that a batch never waits for busy workers and a
+ *  worker may safely submit a batch of its own.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+
+/*! \typedef pool_job_t
+ *  \brief Type definition of a queued job.
+ */
+typedef struct pool_job
+{
+    void ( *j_task )( void *arg );
+    void *j_arg;
+    struct pool_job *j_next;
+} pool_job_t;
+
+/*! \typedef pool_t
+ *  \brief Type definition of a pool of worker threads.
+ */
+typedef struct
+{
+    pthread_mutex_t p_lock;
+    pthread_cond_t p_work;
+    pthread_cond_t p_done;
+    pthread_t *p_threads;
+    unsigned p_count;
+    pool_job_t *p_head;
+    pool_job_t *p_tail;
+    int p_stop;
+} pool_t;
+
+/*! \fn pool_t *pool_create( unsigned threads )
+ *  \brief Creates a pool of worker threads.
+ *  \param threads The number of threads, or zero for one per online CPU.
+ *  \return On success the pool is returned. Otherwise NULL is returned and
+ *  errno is set appropriately.
+ *  \exception ENOMEM Not enough memory to allocate the pool.
+ *  \exception EAGAIN Not enough resources to create the threads.
+ */
+extern pool_t *pool_create( unsigned threads );
+
+/*! \fn pool_t *pool_shared( void )
+ *  \brief Gets the pool shared by the whole process.
+ *
+ *  The pool has one thread per online CPU and is created on first use.
+ *  \return On success the pool is returned. Otherwise NULL is returned and
+ *  errno is set appropriately.
+ */
+extern pool_t *pool_shared( void );
+
+/*! \fn unsigned pool_cpus( void )
+ *  \brief Gets the number of online CPUs.
+ *  \return The number of online CPUs, at least one.
+ */
+extern unsigned pool_cpus( void );
+
+/*! \fn int pool_submit( pool_t *pool, void ( *task )( void *arg ), void *arg )
+ *  \brief Queues a job to be run by a worker thread.
+ *  \param pool The pool to run the job.
+ *  \param task The function to be called.
+ *  \param arg The argument to be passed to the function.
+ *  \return On success zero is returned. Otherwise -1 is returned and errno
+ *  is set appropriately.
+ *  \exception ENOMEM Not enough memory to queue the job.
+ */
+extern int pool_submit( pool_t *pool, void ( *task )( void *arg ), void *arg );
+
+/*! \fn void pool_run( pool_t *pool, unsigned count, void ( *task )( void *arg, unsigned part ), void *arg )
+ *  \brief Runs a batch of numbered parts and waits for all of them.
+ *
+ *  Parts are run concurrently by the calling thread and idle workers.
+ *  When the pool is NULL, all parts are run by the calling thread.
+ *  \param pool The pool to help with the batch, or NULL.
+ *  \param count The number of parts.
+ *  \param task The function to be called once for each part.
+ *  \param arg The argument to be passed to the function.
+ */
+extern void pool_run( pool_t *pool, unsigned count,
+                      void ( *task )( void *arg, unsigned part ), void *arg );
+
+/*! \fn void pool_destroy( pool_t *pool )
+ *  \brief Destroys a pool once the jobs in its queue have run.
+ *  \param pool The pool to be destroyed.
+ */
+extern void pool_destroy( pool_t *pool );
+
+#endif /* POOL_H */
@@ -0,0 +1,205 @@
+#ifndef QUERY_H
+#define QUERY_H
+
+/*! \file query.h
+ *  \brief Definitions for compound queries over a book store.
+ *
+ *  A query is a tree of predicates on the members of an entry combined by
+ *  conjunctions and disjunctions. Before running a query a planner picks
+ *  the most selective index able to narrow down the candidate entries,
+ *  and the whole query is then evaluated against the candidates only.
+ *  When no index applies to a large book store, the scan is split into
+ *  partitions evaluated concurrently by the shared worker pool. Results
+ *  of repeated queries are served from a cache until the book store or a
+ *  member they read changes.
+ */
+
+#include "book.h"
+
+/*! \def QUERY_PARALLEL_ROWS
+ *  \brief Default number of entries from which full scans run in parallel.
+ */
+#define QUERY_PARALLEL_ROWS 16384
+
+/*! \def QUERY_PLAN_LENGTH
+ *  \brief Maximum length of the description of a query plan.
+ */
+#define QUERY_PLAN_LENGTH   256
+
+/*! \typedef query_op_t
+ *  \brief Enumeration of the operations of a query.
+ */
+typedef enum
+{
+    QUERY_EQUAL,
+    QUERY_PREFIX,
+    QUERY_RANGE,
+    QUERY_CONTAINS,
+    QUERY_AND,
+    QUERY_OR
+} query_op_t;
+
+/*! \typedef query_t
+ *  \brief Type definition of a query.
+ *
+ *  Predicates use the members field, value, len, min and max.
+ *  Conjunctions and disjunctions own the queries they combine.
+ */
+typedef struct query
+{
+    query_op_t q_op;
+    entry_field_t q_field;
+    char *q_value;
+    unsigned long long q_len;
+    long q_min;
+    long q_max;
+    struct query **q_args;
+    unsigned q_count;
+} query_t;
+
+/*! \typedef query_plan_t
+ *  \brief Type definition of the report of a query run.
+ */
+typedef struct
+{
+    char p_access[ QUERY_PLAN_LENGTH ];
+    unsigned long p_estimated;
+    unsigned long p_examined;
+    unsigned long p_matched;
+} query_plan_t;
+
+/*! \fn query_t *query_equal( entry_field_t field, const char *value )
+ *  \brief Creates a predicate matching a member equal to a value.
+ *  \param field The member to be compared.
+ *  \param value A null-terminated string containing the value.
+ *  \return On success the query is returned. Otherwise NULL is returned
+ *  and errno is set appropriately.
+ *  \exception ENOMEM Not enough memory to allocate the query.
+ */
+extern query_t *query_equal( entry_field_t field, const char *value );
+
+/*! \fn query_t *query_prefix( entry_field_t field, const char *prefix )
+ *  \brief Creates a predicate matching a member starting with a prefix.
+ *  \param field The member to be compared.
+ *  \param prefix A null-terminated string containing the prefix.
+ *  \return On success the query is returned. Otherwise NULL is returned
+ *  and errno is set appropriately.
+ *  \exception ENOMEM Not enough memory to allocate the query.
+ */
+extern query_t *query_prefix( entry_field_t field, const char *prefix );
+
+/*! \fn query_t *query_contains( entry_field_t field, const char *needle )
+ *  \brief Creates a predicate matching a member containing a substring.
+ *
+ *  No index answers this predicate; it is evaluated by vectorized
+ *  substring search during scans.
+ *  \param field The member to be searched.
+ *  \param needle A null-terminated string containing the substring.
+ *  \return On success the query is returned. Otherwise NULL is returned
+ *  and errno is set appropriately.
+ *  \exception ENOMEM Not enough memory to allocate the query.
+ */
+extern query_t *query_contains( entry_field_t field, const char *needle );
+
+/*! \fn query_t *query_range( entry_field_t field, long min, long max )
+ *  \brief Creates a predicate matching a numeric member within a range.
+ *  \param field Either ENTRY_PAGES or ENTRY_PUBDATE.
+ *  \param min The smallest value to be matched.
+ *  \param max The largest value to be matched.
+ *  \return On success the query is returned. Otherwise NULL is returned
+ *  and errno is set appropriately.
+ *  \exception EINVAL The member has no numeric form.
+ *  \exception ENOMEM Not enough memory to allocate the query.
+ */
+extern query_t *query_range( entry_field_t field, long min, long max );
+
+/*! \fn query_t *query_combine( query_op_t op, query_t **args, unsigned count )
+ *  \brief Combines queries into a conjunction or a disjunction.
+ *
+ *  The queries and the array holding them are owned by the result. Should
+ *  any of them be NULL or the allocation fail, all of them are destroyed.
+ *  \param op Either QUERY_AND or QUERY_OR.
+ *  \param args A dynamically allocated array of the queries to be
+ *  combined.
+ *  \param count The number of queries.
+ *  \return On success the query is returned. Otherwise NULL is returned
+ *  and errno is set appropriately.
+ *  \exception EINVAL An invalid operation or a NULL query was provided.
+ *  \exception ENOMEM Not enough memory to allocate the query.
+ */
+extern query_t *query_combine( query_op_t op, query_t **args, unsigned count );
+
+/*! \fn query_t *query_and( int count, ... )
+ *  \brief Combines queries into a conjunction.
+ *  \param count The number of queries to follow.
+ *  \return On success the query is returned. Otherwise NULL is returned
+ *  and errno is set appropriately.
+ *  \exception EINVAL A NULL query was provided.
+ *  \exception ENOMEM Not enough memory to allocate the query.
+ */
+extern query_t *query_and( int count, ... );
+
+/*! \fn query_t *query_or( int count, ... )
+ *  \brief Combines queries into a disjunction.
+ *  \param count The number of queries to follow.
+ *  \return On success the query is returned. Otherwise NULL is returned
+ *  and errno is set appropriately.
+ *  \exception EINVAL A NULL query was provided.
+ *  \exception ENOMEM Not enough memory to allocate the query.
+ */
+extern query_t *query_or( int count, ... );
+
+/*! \fn int query_match( const query_t *query, entry_t *entry )
+ *  \brief Evaluates a query against an entry.
+ *  \param query The query to be evaluated.
+ *  \param entry The entry to be tested.
+ *  \return Non-zero if the entry matches the query, zero otherwise.
+ */
+extern int query_match( const query_t *query, entry_t *entry );
+
+/*! \fn book_t *book_query( const book_t *book, const query_t *query, query_plan_t *plan )
+ *  \brief Finds the entries of an book store matching a query.
+ *  \param book The book store from which entries are to be searched.
+ *  \param query The query to be run.
+ *  \param plan Where to report the plan chosen and the number of entries
+ *  examined, or NULL.
+ *  \return On success an book store containing found entries in their
+ *  original order is returned. Otherwise NULL is returned and errno is set
+ *  appropriately.
+ *  \exception ENOMEM Not enough memory to allocate a new book store, entry
+ *  nodes or an index.
+ */
+extern book_t *book_query( const book_t *book, const query_t *query,
+                           query_plan_t *plan );
+
+/*! \fn void query_set_parallel( unsigned long rows )
+ *  \brief Sets the number of entries from which full scans run in parallel.
+ *  \param rows The smallest book store to be scanned in parallel, or zero
+ *  to always scan on the calling thread.
+ */
+extern void query_set_parallel( unsigned long rows );
+
+/*! \fn void query_set_cache( int enabled )
+ *  \brief Sets whether the results of queries are cached.
+ *
+ *  When set, which is the default, book_query answers a query from the
+ *  cache of the book store while its result is up to date, and keeps the
+ *  result of every query it runs.
+ *  \param enabled Non-zero to cache results, zero to always run queries.
+ */
+extern void query_set_cache( int enabled );
+
+/*! \fn void query_plan_print( FILE *file, const query_plan_t *plan )
+ *  \brief Prints the report of a query run to a specified stream.
+ *  \param file The stream where to print the report.
+ *  \param plan The report to be printed.
+ */
+extern void query_plan_print( FILE *file, const query_plan_t *plan );
+
+/*! \fn void query_destroy( query_t *query )
+ *  \brief Destroys a query and the queries it combines.
+ *  \param query The query to be destroyed.
+ */
+extern void query_destroy( query_t *query );
+
+#endif /* QUERY_H */
@@ -0,0 +1,138 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+/*! \file server.h
+ *  \brief Definitions for serving a book store over a Unix domain socket.
+ *
+ *  The server keeps the book stores of many users in a catalog and answers
+ *  requests from many clients at once. A connection uses the default book
+ *  store until it logs in, then the book store of its user. An epoll loop on the calling thread accepts
+ *  connections and splits their input into request lines, which are
+ *  handed to a pool of worker threads sharing the store through its
+ *  shard locks. Each connection has at most one request in flight, so its
+ *  responses come back in order.
+ *
+ *  Requests and responses are lines whose arguments are separated by tab
+ *  characters:
+ *
+ *  - find FIELD VALUE [FIELD VALUE ...] matches entries whose members all
+ *    equal the values. A value ending in * matches a prefix and a value
+ *    surrounded by * matches a substring.
+ *  - add TITLE AUTHOR PAGES EDITION LANGUAGE PUBLISHER PUBDATE ISBN
+ *    DESCRIPTION adds an entry.
+ *  - edit ISBN FIELD VALUE sets a member of the entries with an ISBN.
+ *  - delete ISBN deletes the entries with an ISBN.
+ *  - save writes the book store to its file.
+ *  - memory lists, for strings, entries, nodes and books, the objects and
+ *    bytes allocated now, the peak bytes and the number of allocations.
+ *  - login USERNAME PASSWORD switches to the book store of a user listed
+ *    in the credentials file.
+ *  - quit closes the connection.
+ *
+ *  Successful requests are answered with "OK COUNT", followed for finds
+ *  by one line per entry listing its members and for memory by one line
+ *  per type. Failures are answered with
+ *  "ERR MESSAGE".
+ */
+
+#include <signal.h>
+#include "catalog.h"
+#include "credentials.h"
+#include "pool.h"
+
+/*! \def SERVER_LINE_MAX
+ *  \brief Maximum length of a request line.
+ */
+#define SERVER_LINE_MAX     65536
+
+/*! \def SERVER_BACKLOG
+ *  \brief Number of pending connections queued by the listening socket.
+ */
+#define SERVER_BACKLOG      64
+
+/*! \typedef server_buffer_t
+ *  \brief Type definition of a growing buffer of characters.
+ */
+typedef struct
+{
+    char *b_data;
+    size_t b_len;
+    size_t b_cap;
+} server_buffer_t;
+
+/*! \typedef server_conn_t
+ *  \brief Type definition of a client connection.
+ */
+typedef struct server_conn
+{
+    int c_fd;
+    char *c_in;
+    size_t c_in_len;
+    server_buffer_t c_out;
+    size_t c_sent;
+    unsigned c_events;
+    int c_busy;
+    int c_eof;
+    int c_quit;
+    int c_closed;
+    catalog_entry_t *c_tenant;
+    int c_modified;
+    struct server_conn *c_prev;
+    struct server_conn *c_next;
+} server_conn_t;
+
+/*! \typedef server_request_t
+ *  \brief Type definition of a request handed to a worker and back.
+ */
+typedef struct server_request
+{
+    struct server *r_server;
+    server_conn_t *r_conn;
+    char *r_line;
+    server_buffer_t r_reply;
+    int r_failed;
+    int r_quit;
+    struct server_request *r_next;
+} server_request_t;
+
+/*! \typedef server_t
+ *  \brief Type definition of a server.
+ */
+typedef struct server
+{
+    int s_listen;
+    int s_epoll;
+    int s_wake[ 2 ];
+    pool_t *s_pool;
+    pthread_mutex_t s_mutex;
+    pthread_mutex_t s_save;
+    pthread_mutex_t s_auth;
+    catalog_t *s_catalog;
+    catalog_entry_t *s_default;
+    credentials_t *s_credentials;
+    server_conn_t *s_conns;
+    server_request_t *s_done;
+} server_t;
+
+/*! \fn int server_run( const char *path, catalog_t *catalog, catalog_entry_t *tenant, credentials_t *credentials, unsigned threads )
+ *  \brief Serves the book stores of a catalog until SIGINT or SIGTERM is
+ *  received.
+ *
+ *  The book stores are not saved on return; the caller is expected to
+ *  flush the catalog once no client can reach it anymore.
+ *  \param path The path of the Unix domain socket to be created.
+ *  \param catalog The catalog holding the book stores of the users.
+ *  \param tenant The book store used by connections not logged in.
+ *  \param credentials The credentials checked by logins, or NULL to
+ *  disable them.
+ *  \param threads The number of worker threads, or zero for one per CPU.
+ *  \return On success zero is returned. Otherwise -1 is returned and errno
+ *  is set appropriately.
+ *  \exception ENOMEM Not enough memory to allocate the server.
+ *  \exception EADDRINUSE The socket path already exists.
+ *  \exception ENAMETOOLONG The socket path is too long.
+ */
+extern int server_run( const char *path, catalog_t *catalog, catalog_entry_t *tenant,
+                       credentials_t *credentials, unsigned threads );
+
+#endif /* SERVER_H */
@@ -0,0 +1,68 @@
+#ifndef SHA256_H
+#define SHA256_H
+
+/*! \file sha256.h
+ *  \brief Definitions for SHA-256 digests and PBKDF2 key derivation.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+/*! \def SHA256_SIZE
+ *  \brief Number of bytes of a digest.
+ */
+#define SHA256_SIZE     32
+
+/*! \def SHA256_BLOCK
+ *  \brief Number of bytes of a block.
+ */
+#define SHA256_BLOCK    64
+
+/*! \typedef sha256_t
+ *  \brief Type definition of the state of a digest being computed.
+ */
+typedef struct
+{
+    unsigned s_state[ 8 ];
+    unsigned long long s_length;
+    unsigned char s_block[ SHA256_BLOCK ];
+    unsigned s_used;
+} sha256_t;
+
+/*! \fn void sha256_init( sha256_t *sha )
+ *  \brief Starts a digest.
+ *  \param sha The state to be initialized.
+ */
+extern void sha256_init( sha256_t *sha );
+
+/*! \fn void sha256_update( sha256_t *sha, const void *data, unsigned long long len )
+ *  \brief Adds bytes to a digest.
+ *  \param sha The state of the digest.
+ *  \param data The bytes to be added.
+ *  \param len The number of bytes.
+ */
+extern void sha256_update( sha256_t *sha, const void *data, unsigned long long len );
+
+/*! \fn void sha256_final( sha256_t *sha, unsigned char *digest )
+ *  \brief Completes a digest.
+ *  \param sha The state of the digest, which is left undefined.
+ *  \param digest Where to store the SHA256_SIZE bytes of the digest.
+ */
+extern void sha256_final( sha256_t *sha, unsigned char *digest );
+
+/*! \fn void pbkdf2_sha256( const void *password, size_t password_len, const void *salt, size_t salt_len, unsigned long iterations, unsigned char *key, size_t key_len )
+ *  \brief Derives a key from a password with PBKDF2 using HMAC-SHA-256.
+ *  \param password The password.
+ *  \param password_len The number of bytes of the password.
+ *  \param salt The salt.
+ *  \param salt_len The number of bytes of the salt.
+ *  \param iterations The number of iterations.
+ *  \param key Where to store the key.
+ *  \param key_len The number of bytes of the key.
+ */
+extern void pbkdf2_sha256( const void *password, size_t password_len,
+                           const void *salt, size_t salt_len,
+                           unsigned long iterations,
+                           unsigned char *key, size_t key_len );
+
+#endif /* SHA256_H */
@@ -0,0 +1,205 @@
+#ifndef STATS_H
+#define STATS_H
+
+/*! \file stats.h
+ *  \brief Definitions for operation counters and latency histograms.
+ *
+ *  Hot paths record the number of calls, the bytes they moved and how long
+ *  each call took, in buckets of powers of two nanoseconds. Recording is
+ *  off until enabled, which then costs a clock read at both ends of a call.
+ *  Counters may be updated by many threads at once.
+ *
+ *  Allocations of strings, entries, nodes and books are accounted by type
+ *  all the time, since counting only some of them would leave the number
+ *  of live objects meaningless.
+ *
+ *  Configuring with --disable-stats defines BOOK_NO_STATS, which turns
+ *  STATS_START, STATS_RECORD, STATS_ALLOC, STATS_GROW and STATS_FREE into
+ *  no-ops so that nothing is left in the hot paths.
+ */
+
+#include <stdio.h>
+
+/*! \def STATS_BUCKETS
+ *  \brief Number of latency buckets, the last one holding longer calls.
+ */
+#define STATS_BUCKETS   40
+
+#ifdef BOOK_NO_STATS
+#define STATS_START( start )                ( ( void )( start ) )
+#define STATS_RECORD( op, start, bytes )    ( ( void )sizeof( ( op ) + ( start ) + ( bytes ) ) )
+#define STATS_ALLOC( type, bytes )          ( ( void )sizeof( ( type ) + ( bytes ) ) )
+#define STATS_GROW( type, bytes )           ( ( void )sizeof( ( type ) + ( bytes ) ) )
+#define STATS_FREE( type, bytes )           ( ( void )sizeof( ( type ) + ( bytes ) ) )
+#else
+/*! \def STATS_START( start )
+ *  \brief Stores in start when a recorded call begins, or zero if disabled.
+ */
+#define STATS_START( start )                ( ( start ) = stats_start( ) )
+
+/*! \def STATS_RECORD( op, start, bytes )
+ *  \brief Records a call that began at start, unless recording was off.
+ */
+#define STATS_RECORD( op, start, bytes ) \
+    do { if( ( start ) != 0 ) stats_record( ( op ), ( start ), ( bytes ) ); } while( 0 )
+
+/*! \def STATS_ALLOC( type, bytes )
+ *  \brief Accounts an object of a type allocated with its bytes.
+ */
+#define STATS_ALLOC( type, bytes )          stats_alloc( ( type ), ( bytes ) )
+
+/*! \def STATS_GROW( type, bytes )
+ *  \brief Accounts bytes allocated later for an object already accounted.
+ */
+#define STATS_GROW( type, bytes )           stats_grow( ( type ), ( bytes ) )
+
+/*! \def STATS_FREE( type, bytes )
+ *  \brief Accounts an object of a type freed with all its bytes.
+ */
+#define STATS_FREE( type, bytes )           stats_free( ( type ), ( bytes ) )
+#endif
+
+/*! \typedef stats_op_t
+ *  \brief Enumeration of the recorded operations.
+ */
+typedef enum
+{
+    STATS_BOOK_READ,
+    STATS_BOOK_WRITE,
+    STATS_FIND_BY_TITLE,
+    STATS_FIND_BY_AUTHOR,
+    STATS_FIND_BY_PUBLISHER,
+    STATS_FIND_BY_PAGES,
+    STATS_FIND_BY_PUBDATE,
+    STATS_BOOK_QUERY,
+    STATS_BOOK_AGGREGATE,
+    STATS_BOOK_ADD,
+    STATS_BOOK_REMOVE,
+    STATS_STRING_READ,
+    STATS_OPS
+} stats_op_t;
+
+/*! \typedef stats_type_t
+ *  \brief Enumeration of the accounted types of objects.
+ */
+typedef enum
+{
+    STATS_STRING,
+    STATS_ENTRY,
+    STATS_NODE,
+    STATS_BOOK,
+    STATS_TYPES
+} stats_type_t;
+
+/*! \typedef stats_counter_t
+ *  \brief Type definition of the counters of an operation.
+ *
+ *  Bucket i counts calls that took from 2^i up to 2^(i+1) nanoseconds.
+ */
+typedef struct
+{
+    unsigned long long t_calls;
+    unsigned long long t_bytes;
+    unsigned long long t_nanos;
+    unsigned long long t_buckets[ STATS_BUCKETS ];
+} stats_counter_t;
+
+/*! \typedef stats_memory_t
+ *  \brief Type definition of the allocation counters of a type.
+ *
+ *  Bytes include the structure and the buffers it owns, as requested from
+ *  malloc, without the overhead of the allocator.
+ */
+typedef struct
+{
+    unsigned long long m_objects;
+    unsigned long long m_bytes;
+    unsigned long long m_peak;
+    unsigned long long m_allocs;
+} stats_memory_t;
+
+/*! \fn void stats_set_enabled( int enabled )
+ *  \brief Sets whether calls are recorded.
+ *  \param enabled Non-zero to record calls, zero to stop, which is the
+ *  default.
+ */
+extern void stats_set_enabled( int enabled );
+
+/*! \fn unsigned long long stats_start( void )
+ *  \brief Gets the time at which a recorded call begins.
+ *  \return The time in nanoseconds, or zero if recording is off.
+ */
+extern unsigned long long stats_start( void );
+
+/*! \fn void stats_record( stats_op_t op, unsigned long long start, unsigned long long bytes )
+ *  \brief Records a call.
+ *  \param op The operation called.
+ *  \param start The time returned by stats_start when the call began.
+ *  \param bytes The number of bytes read or written by the call.
+ */
+extern void stats_record( stats_op_t op, unsigned long long start,
+                          unsigned long long bytes );
+
+/*! \fn void stats_alloc( stats_type_t type, unsigned long long bytes )
+ *  \brief Accounts an allocated object.
+ *  \param type The type of the object.
+ *  \param bytes The bytes allocated for the object.
+ */
+extern void stats_alloc( stats_type_t type, unsigned long long bytes );
+
+/*! \fn void stats_grow( stats_type_t type, unsigned long long bytes )
+ *  \brief Accounts bytes allocated for an object after its creation.
+ *  \param type The type of the object.
+ *  \param bytes The bytes allocated.
+ */
+extern void stats_grow( stats_type_t type, unsigned long long bytes );
+
+/*! \fn void stats_free( stats_type_t type, unsigned long long bytes )
+ *  \brief Accounts a freed object.
+ *  \param type The type of the object.
+ *  \param bytes All the bytes accounted for the object.
+ */
+extern void stats_free( stats_type_t type, unsigned long long bytes );
+
+/*! \fn void stats_get( stats_op_t op, stats_counter_t *counter )
+ *  \brief Gets the counters of an operation.
+ *  \param op The operation of interest.
+ *  \param counter Where to store a copy of the counters.
+ */
+extern void stats_get( stats_op_t op, stats_counter_t *counter );
+
+/*! \fn const char *stats_name( stats_op_t op )
+ *  \brief Gets the name of an operation.
+ *  \param op The operation of interest.
+ *  \return A null-terminated string containing the name.
+ */
+extern const char *stats_name( stats_op_t op );
+
+/*! \fn void stats_memory( stats_type_t type, stats_memory_t *memory )
+ *  \brief Gets the allocation counters of a type.
+ *  \param type The type of interest.
+ *  \param memory Where to store a copy of the counters.
+ */
+extern void stats_memory( stats_type_t type, stats_memory_t *memory );
+
+/*! \fn const char *stats_type_name( stats_type_t type )
+ *  \brief Gets the name of a type.
+ *  \param type The type of interest.
+ *  \return A null-terminated string containing the name.
+ */
+extern const char *stats_type_name( stats_type_t type );
+
+/*! \fn void stats_print( FILE *file )
+ *  \brief Prints the counters and histograms of the operations called and
+ *  the allocation counters.
+ *  \param file The stream where to print the report.
+ */
+extern void stats_print( FILE *file );
+
+/*! \fn void stats_reset( void )
+ *  \brief Clears the counters of the operations and the total allocations,
+ *  and lowers the peaks to the bytes now live.
+ */
+extern void stats_reset( void );
+
+#endif /* STATS_H */
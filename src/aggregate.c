@@ -0,0 +1,550 @@
+#include <string.h>
+#include <aggregate.h>
+#include <book_index.h>
+#include <pool.h>
+#include <stats.h>
+
+typedef struct
+{
+    aggregate_group_t *t_groups;
+    unsigned long *t_hashes;
+    unsigned long *t_slots;
+    unsigned long t_count;
+    unsigned long t_mask;
+    int t_error;
+} aggregate_table_t;
+
+typedef struct
+{
+    entry_t **s_rows;
+    const column_t *s_values;
+    const column_t *s_numbers;
+    unsigned long s_count;
+    unsigned s_parts;
+    entry_field_t s_field;
+    entry_field_t s_measure;
+    aggregate_table_t *s_tables;
+} aggregate_scan_t;
+
+typedef int ( *aggregate_compare_t )( const aggregate_group_t *a, const aggregate_group_t *b );
+
+static unsigned long parallel_rows = AGGREGATE_PARALLEL_ROWS;
+
+static int table_grow( aggregate_table_t *table )
+{
+    aggregate_group_t *groups;
+    unsigned long *hashes, *slots, size, group, slot;
+
+    size = table->t_slots != NULL ? 2 * ( table->t_mask + 1 ) : 64;
+
+    if( ( slots = calloc( size, sizeof( unsigned long ) ) ) == NULL )
+    {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    if( ( groups = realloc( table->t_groups, size / 2 * sizeof( aggregate_group_t ) ) ) == NULL )
+    {
+        free( slots );
+        errno = ENOMEM;
+        return -1;
+    }
+
+    table->t_groups = groups;
+
+    if( ( hashes = realloc( table->t_hashes, size / 2 * sizeof( unsigned long ) ) ) == NULL )
+    {
+        free( slots );
+        errno = ENOMEM;
+        return -1;
+    }
+
+    table->t_hashes = hashes;
+
+    for( group = 0; group < table->t_count; group++ )
+    {
+        for( slot = hashes[ group ] & ( size - 1 ); slots[ slot ] != 0;
+                slot = ( slot + 1 ) & ( size - 1 ) );
+
+        slots[ slot ] = group + 1;
+    }
+
+    free( table->t_slots );
+    table->t_slots = slots;
+    table->t_mask = size - 1;
+
+    return 0;
+}
+
+static aggregate_group_t *table_group( aggregate_table_t *table, const char *value,
+                                       unsigned long long len, unsigned long hash )
+{
+    aggregate_group_t *group;
+    unsigned long slot, found;
+
+    if( 2 * ( table->t_count + 1 ) > table->t_mask + 1 && table_grow( table ) == -1 )
+    {
+        return NULL;
+    }
+
+    for( slot = hash & table->t_mask; ( found = table->t_slots[ slot ] ) != 0;
+            slot = ( slot + 1 ) & table->t_mask )
+    {
+        group = &table->t_groups[ found - 1 ];
+
+        if( table->t_hashes[ found - 1 ] == hash && group->g_len == len
+                && memcmp( group->g_value, value, len ) == 0 )
+        {
+            return group;
+        }
+    }
+
+    table->t_slots[ slot ] = table->t_count + 1;
+    table->t_hashes[ table->t_count ] = hash;
+    group = &table->t_groups[ table->t_count++ ];
+    memset( group, 0, sizeof( aggregate_group_t ) );
+    group->g_value = value;
+    group->g_len = len;
+
+    return group;
+}
+
+static void table_destroy( aggregate_table_t *table )
+{
+    free( table->t_groups );
+    free( table->t_hashes );
+    free( table->t_slots );
+}
+
+static void group_merge( aggregate_group_t *group, const aggregate_group_t *other )
+{
+    if( other->g_values > 0 && ( group->g_values == 0 || other->g_min < group->g_min ) )
+    {
+        group->g_min = other->g_min;
+    }
+
+    if( other->g_values > 0 && ( group->g_values == 0 || other->g_max > group->g_max ) )
+    {
+        group->g_max = other->g_max;
+    }
+
+    group->g_count += other->g_count;
+    group->g_values += other->g_values;
+    group->g_sum += other->g_sum;
+}
+
+static int aggregate_row( aggregate_table_t *table, const aggregate_scan_t *scan,
+                          unsigned long row )
+{
+    aggregate_group_t *group;
+    const string_t *value;
+    const char *s;
+    unsigned long long len;
+    long number;
+
+    if( scan->s_values != NULL )
+    {
+        s = column_value( scan->s_values, row, &len );
+    }
+    else
+    {
+        value = entry_get_field( scan->s_rows[ row ], scan->s_field );
+        s = value != NULL ? value->s_ptr : "";
+        len = value != NULL ? value->s_len : 0;
+    }
+
+    if( ( group = table_group( table, s, len, string_hash( s, len ) ) ) == NULL )
+    {
+        return -1;
+    }
+
+    if( scan->s_numbers != NULL )
+    {
+        number = scan->s_numbers->c_numbers[ row ];
+    }
+    else
+    {
+        number = scan->s_measure == ENTRY_PAGES ? entry_get_pages_num( scan->s_rows[ row ] )
+                                                : entry_get_pubdate_num( scan->s_rows[ row ] );
+    }
+
+    group->g_count++;
+
+    if( number == ENTRY_NONE )
+    {
+        return 0;
+    }
+
+    if( group->g_values == 0 || number < group->g_min )
+    {
+        group->g_min = number;
+    }
+
+    if( group->g_values == 0 || number > group->g_max )
+    {
+        group->g_max = number;
+    }
+
+    group->g_sum += number;
+    group->g_values++;
+
+    return 0;
+}
+
+static int table_merge( aggregate_table_t *table, const aggregate_table_t *other )
+{
+    aggregate_group_t *group;
+    unsigned long i;
+
+    for( i = 0; i < other->t_count; i++ )
+    {
+        if( ( group = table_group( table, other->t_groups[ i ].g_value,
+                                   other->t_groups[ i ].g_len, other->t_hashes[ i ] ) ) == NULL )
+        {
+            return -1;
+        }
+
+        group_merge( group, &other->t_groups[ i ] );
+    }
+
+    return 0;
+}
+
+static void aggregate_part( void *arg, unsigned part )
+{
+    aggregate_scan_t *scan = arg;
+    aggregate_table_t *table;
+    unsigned long first, last, row;
+
+    first = scan->s_count * part / scan->s_parts;
+    last = scan->s_count * ( part + 1 ) / scan->s_parts;
+    table = &scan->s_tables[ part ];
+
+    for( row = first; row < last; row++ )
+    {
+        if( aggregate_row( table, scan, row ) == -1 )
+        {
+            table->t_error = 1;
+            break;
+        }
+    }
+}
+
+static int aggregate_parallel( aggregate_scan_t *scan, aggregate_table_t *table,
+                               pool_t *pool )
+{
+    unsigned part;
+    int error;
+
+    scan->s_parts = 4 * ( pool->p_count + 1 );
+
+    if( ( scan->s_tables = calloc( scan->s_parts, sizeof( aggregate_table_t ) ) ) == NULL )
+    {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    pool_run( pool, scan->s_parts, aggregate_part, scan );
+
+    for( part = 0, error = 0; part < scan->s_parts; part++ )
+    {
+        error = error || scan->s_tables[ part ].t_error
+             || table_merge( table, &scan->s_tables[ part ] ) == -1;
+        table_destroy( &scan->s_tables[ part ] );
+    }
+
+    free( scan->s_tables );
+
+    if( error )
+    {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    return 0;
+}
+
+static book_aggregate_t *aggregate_finish( aggregate_table_t *table, const book_t *book,
+                                           entry_field_t field, entry_field_t measure )
+{
+    book_aggregate_t *retval;
+    unsigned long long size;
+    unsigned long i;
+    char *it;
+
+    for( i = 0, size = 0; i < table->t_count; i++ )
+    {
+        size += table->t_groups[ i ].g_len + 1;
+    }
+
+    if( ( retval = malloc( sizeof( book_aggregate_t ) ) ) == NULL
+            || ( retval->a_values = malloc( size + 1 ) ) == NULL )
+    {
+        free( retval );
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    for( i = 0, it = retval->a_values; i < table->t_count; i++ )
+    {
+        memcpy( it, table->t_groups[ i ].g_value, table->t_groups[ i ].g_len );
+        it[ table->t_groups[ i ].g_len ] = '\0';
+        table->t_groups[ i ].g_value = it;
+        it += table->t_groups[ i ].g_len + 1;
+    }
+
+    retval->a_groups = table->t_groups;
+    retval->a_count = table->t_count;
+    retval->a_rows = book->a_count;
+    retval->a_field = field;
+    retval->a_measure = measure;
+    table->t_groups = NULL;
+
+    return retval;
+}
+
+book_aggregate_t *book_aggregate( const book_t *book, entry_field_t field,
+                                  entry_field_t measure )
+{
+    book_index_t *index;
+    aggregate_scan_t scan;
+    aggregate_table_t table;
+    book_aggregate_t *retval;
+    unsigned long long start;
+    unsigned long row;
+    pool_t *pool;
+    int status;
+
+    if( ( unsigned )field >= ENTRY_FIELDS
+            || ( measure != ENTRY_PAGES && measure != ENTRY_PUBDATE ) )
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    if( ( index = book_index_get( book ) ) == NULL )
+    {
+        return NULL;
+    }
+
+    STATS_START( start );
+    memset( &scan, 0, sizeof( aggregate_scan_t ) );
+    scan.s_rows = index->i_rows;
+    scan.s_count = index->i_count;
+    scan.s_field = field;
+    scan.s_measure = measure;
+    scan.s_values = book_index_column( book, field );
+    scan.s_numbers = book_index_column( book, measure );
+    memset( &table, 0, sizeof( aggregate_table_t ) );
+    status = 0;
+
+    if( parallel_rows > 0 && book->a_count >= parallel_rows
+            && ( pool = pool_shared( ) ) != NULL )
+    {
+        status = aggregate_parallel( &scan, &table, pool );
+    }
+    else
+    {
+        for( row = 0; row < scan.s_count && status == 0; row++ )
+        {
+            status = aggregate_row( &table, &scan, row );
+        }
+    }
+
+    retval = status == 0 ? aggregate_finish( &table, book, field, measure ) : NULL;
+    table_destroy( &table );
+    STATS_RECORD( STATS_BOOK_AGGREGATE, start, 0 );
+
+    return retval;
+}
+
+static int compare_value( const aggregate_group_t *a, const aggregate_group_t *b )
+{
+    return strcmp( a->g_value, b->g_value );
+}
+
+static int compare_count( const aggregate_group_t *a, const aggregate_group_t *b )
+{
+    return a->g_count != b->g_count ? ( a->g_count < b->g_count ? 1 : -1 )
+                                    : compare_value( a, b );
+}
+
+static int compare_sum( const aggregate_group_t *a, const aggregate_group_t *b )
+{
+    return a->g_sum != b->g_sum ? ( a->g_sum < b->g_sum ? 1 : -1 )
+                                : compare_value( a, b );
+}
+
+static int compare_mean( const aggregate_group_t *a, const aggregate_group_t *b )
+{
+    double x, y;
+
+    x = a->g_values > 0 ? ( double )a->g_sum / a->g_values : 0;
+    y = b->g_values > 0 ? ( double )b->g_sum / b->g_values : 0;
+
+    return x != y ? ( x < y ? 1 : -1 ) : compare_value( a, b );
+}
+
+static int compare_min( const aggregate_group_t *a, const aggregate_group_t *b )
+{
+    if( ( a->g_values == 0 ) != ( b->g_values == 0 ) )
+    {
+        return a->g_values == 0 ? 1 : -1;
+    }
+
+    return a->g_min != b->g_min ? ( a->g_min > b->g_min ? 1 : -1 )
+                                : compare_value( a, b );
+}
+
+static int compare_max( const aggregate_group_t *a, const aggregate_group_t *b )
+{
+    if( ( a->g_values == 0 ) != ( b->g_values == 0 ) )
+    {
+        return a->g_values == 0 ? 1 : -1;
+    }
+
+    return a->g_max != b->g_max ? ( a->g_max < b->g_max ? 1 : -1 )
+                                : compare_value( a, b );
+}
+
+static const aggregate_compare_t comparators[ AGGREGATE_ORDERS ] =
+{
+    compare_count, compare_sum, compare_mean, compare_min, compare_max, compare_value
+};
+
+static int sort_count( const void *a, const void *b )
+{
+    return compare_count( a, b );
+}
+
+static int sort_sum( const void *a, const void *b )
+{
+    return compare_sum( a, b );
+}
+
+static int sort_mean( const void *a, const void *b )
+{
+    return compare_mean( a, b );
+}
+
+static int sort_min( const void *a, const void *b )
+{
+    return compare_min( a, b );
+}
+
+static int sort_max( const void *a, const void *b )
+{
+    return compare_max( a, b );
+}
+
+static int sort_value( const void *a, const void *b )
+{
+    return compare_value( a, b );
+}
+
+static int ( * const sorters[ AGGREGATE_ORDERS ] )( const void *a, const void *b ) =
+{
+    sort_count, sort_sum, sort_mean, sort_min, sort_max, sort_value
+};
+
+static void heap_sift( aggregate_group_t *heap, unsigned long count, unsigned long i,
+                       aggregate_compare_t compare )
+{
+    aggregate_group_t swap;
+    unsigned long child;
+
+    while( ( child = 2 * i + 1 ) < count )
+    {
+        if( child + 1 < count && compare( &heap[ child + 1 ], &heap[ child ] ) > 0 )
+        {
+            child++;
+        }
+
+        if( compare( &heap[ child ], &heap[ i ] ) <= 0 )
+        {
+            break;
+        }
+
+        swap = heap[ i ];
+        heap[ i ] = heap[ child ];
+        heap[ child ] = swap;
+        i = child;
+    }
+}
+
+void book_aggregate_sort( book_aggregate_t *aggregate, aggregate_order_t order,
+                          unsigned long limit )
+{
+    aggregate_compare_t compare;
+    aggregate_group_t *groups;
+    unsigned long i;
+
+    if( ( unsigned )order >= AGGREGATE_ORDERS )
+    {
+        return;
+    }
+
+    compare = comparators[ order ];
+    groups = aggregate->a_groups;
+
+    if( limit > 0 && limit < aggregate->a_count )
+    {
+        for( i = limit / 2; i-- > 0; )
+        {
+            heap_sift( groups, limit, i, compare );
+        }
+
+        for( i = limit; i < aggregate->a_count; i++ )
+        {
+            if( compare( &groups[ i ], &groups[ 0 ] ) < 0 )
+            {
+                groups[ 0 ] = groups[ i ];
+                heap_sift( groups, limit, 0, compare );
+            }
+        }
+
+        aggregate->a_count = limit;
+    }
+
+    qsort( groups, aggregate->a_count, sizeof( aggregate_group_t ), sorters[ order ] );
+}
+
+void book_aggregate_print( FILE *file, const book_aggregate_t *aggregate )
+{
+    const aggregate_group_t *group;
+    unsigned long i;
+
+    fprintf( file, "%-40s %10s %12s %12s %16s %14s\n",
+             entry_field_name( aggregate->a_field ), "Count", "Min", "Max", "Sum", "Mean" );
+
+    for( i = 0; i < aggregate->a_count; i++ )
+    {
+        group = &aggregate->a_groups[ i ];
+        fprintf( file, "%-40s %10lu ", group->g_len > 0 ? group->g_value : "(none)",
+                 group->g_count );
+
+        if( group->g_values == 0 )
+        {
+            fprintf( file, "%12s %12s %16s %14s\n", "-", "-", "-", "-" );
+            continue;
+        }
+
+        fprintf( file, "%12ld %12ld %16lld %14.2f\n", group->g_min, group->g_max,
+                 group->g_sum, ( double )group->g_sum / group->g_values );
+    }
+
+    fprintf( file, "%lu groups, %lu entries, measure %s\n", aggregate->a_count,
+             aggregate->a_rows, entry_field_name( aggregate->a_measure ) );
+}
+
+void book_aggregate_destroy( book_aggregate_t *aggregate )
+{
+    free( aggregate->a_groups );
+    free( aggregate->a_values );
+    free( aggregate );
+}
+
+void aggregate_set_parallel( unsigned long rows )
+{
+    parallel_rows = rows;
+}
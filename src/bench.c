@@ -0,0 +1,419 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+#include <book.h>
+#include <book_file.h>
+#include <query.h>
+#include <aggregate.h>
+#include <column.h>
+#include <book_gen.h>
+
+#define BENCH_SIZES     8
+#define BENCH_CALLS     1000
+#define BENCH_COPIES    5
+
+static unsigned long long state = 1;
+static int first = 1;
+
+static unsigned long bench_random( unsigned long range )
+{
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+
+    return range > 0 ? ( unsigned long )( state % range ) : 0;
+}
+
+static double bench_now( void )
+{
+    struct timespec now;
+
+    clock_gettime( CLOCK_MONOTONIC, &now );
+
+    return ( double )now.tv_sec + ( double )now.tv_nsec / 1e9;
+}
+
+static long bench_peak_rss( void )
+{
+    struct rusage usage;
+
+    if( getrusage( RUSAGE_SELF, &usage ) == -1 )
+    {
+        return 0;
+    }
+
+    return usage.ru_maxrss;
+}
+
+static int bench_compare( const void *a, const void *b )
+{
+    double x = *( const double* )a, y = *( const double* )b;
+
+    return x < y ? -1 : x > y;
+}
+
+static double bench_percentile( const double *sorted, unsigned long count, double p )
+{
+    unsigned long rank;
+
+    rank = ( unsigned long )( p * count + 0.999999 );
+
+    return sorted[ rank > 0 ? rank - 1 : 0 ];
+}
+
+static void bench_report( FILE *out, const char *operation, unsigned long rows,
+                          double *latencies, unsigned long calls, double bytes )
+{
+    double total;
+    unsigned long i;
+
+    for( i = 0, total = 0; i < calls; i++ )
+    {
+        total += latencies[ i ];
+    }
+
+    qsort( latencies, calls, sizeof( double ), bench_compare );
+
+    fprintf( out, "%s\n    { \"operation\": \"%s\", \"rows\": %lu, \"calls\": %lu, "
+                  "\"seconds\": %.6f, \"ops_per_sec\": %.1f, \"mb_per_sec\": %.1f, "
+                  "\"p50_us\": %.2f, \"p90_us\": %.2f, \"p99_us\": %.2f, \"max_us\": %.2f, "
+                  "\"peak_rss_kib\": %ld }",
+             first ? "" : ",", operation, rows, calls, total,
+             total > 0 ? calls / total : 0.0,
+             total > 0 ? bytes / total / ( 1024 * 1024 ) : 0.0,
+             bench_percentile( latencies, calls, 0.50 ) * 1e6,
+             bench_percentile( latencies, calls, 0.90 ) * 1e6,
+             bench_percentile( latencies, calls, 0.99 ) * 1e6,
+             latencies[ calls - 1 ] * 1e6, bench_peak_rss( ) );
+
+    first = 0;
+}
+
+static book_t *bench_find( const book_t *book, entry_t **rows, unsigned long count,
+                           int operation )
+{
+    entry_t *entry;
+    long low;
+
+    entry = rows[ bench_random( count ) ];
+
+    switch( operation )
+    {
+        case 0:
+            return book_find_by_title( book, entry_get_title( entry )->s_ptr );
+        case 1:
+            return book_find_by_author( book, entry_get_author( entry )->s_ptr );
+        case 2:
+            return book_find_by_publisher( book, entry_get_publisher( entry )->s_ptr );
+        case 3:
+            low = entry_get_pages_num( entry );
+            return book_find_by_pages( book, low, low + 10 );
+        default:
+            low = entry_get_pubdate_num( entry ) / 10000;
+            return book_find_by_pubdate( book, low * 10000, low * 10000 + 1231 );
+    }
+}
+
+static int bench_run( FILE *out, const book_gen_t *gen, unsigned long rows,
+                      unsigned long calls )
+{
+    static const char *finds[ ] =
+    {
+        "book_find_by_title", "book_find_by_author", "book_find_by_publisher",
+        "book_find_by_pages", "book_find_by_pubdate"
+    };
+    book_t *book, *result;
+    column_t column;
+    book_aggregate_t *aggregate;
+    query_t *query;
+    const string_t *value;
+    entry_node_t **nodes, *it;
+    entry_t *entry, **entries;
+    double *latencies, start;
+    unsigned long row, i, step, values;
+    unsigned long long length;
+    long long sum;
+    long bytes;
+    char needle[ 5 ];
+    FILE *file;
+    int operation;
+
+    if( ( book = book_gen_book( gen, rows ) ) == NULL
+            || ( latencies = malloc( ( calls + BENCH_COPIES ) * sizeof( double ) ) ) == NULL
+            || ( nodes = malloc( ( calls + 1 ) * sizeof( entry_node_t* ) ) ) == NULL
+            || ( entries = malloc( rows * sizeof( entry_t* ) ) ) == NULL )
+    {
+        return -1;
+    }
+
+    for( it = book->a_head, row = 0; it != NULL; it = it->n_next, row++ )
+    {
+        entries[ row ] = it->n_entry;
+    }
+
+    if( ( file = tmpfile( ) ) == NULL )
+    {
+        return -1;
+    }
+
+    start = bench_now( );
+
+    if( book_write( file, book ) == -1 || fflush( file ) == EOF )
+    {
+        return -1;
+    }
+
+    latencies[ 0 ] = bench_now( ) - start;
+    bytes = ftell( file );
+    bench_report( out, "book_write", rows, latencies, 1, ( double )bytes );
+
+    rewind( file );
+    start = bench_now( );
+
+    if( ( result = book_read( file ) ) == NULL || result->a_count != rows )
+    {
+        return -1;
+    }
+
+    latencies[ 0 ] = bench_now( ) - start;
+    bench_report( out, "book_read", rows, latencies, 1, ( double )bytes );
+    book_destroy( result, 1 );
+    fclose( file );
+
+    for( operation = 0; operation < 5; operation++ )
+    {
+        for( i = 0; i < calls; i++ )
+        {
+            start = bench_now( );
+
+            if( ( result = bench_find( book, entries, rows, operation ) ) == NULL )
+            {
+                return -1;
+            }
+
+            latencies[ i ] = bench_now( ) - start;
+            book_destroy( result, 0 );
+        }
+
+        bench_report( out, finds[ operation ], rows, latencies, calls, 0 );
+    }
+
+    memset( &column, 0, sizeof( column_t ) );
+
+    for( i = 0; i < BENCH_COPIES; i++ )
+    {
+        start = bench_now( );
+
+        if( column_build( &column, entries, rows, ENTRY_TITLE ) == -1 )
+        {
+            return -1;
+        }
+
+        latencies[ i ] = bench_now( ) - start;
+    }
+
+    bench_report( out, "column_build", rows, latencies, BENCH_COPIES, 0 );
+
+    if( column_build( &column, entries, rows, ENTRY_PAGES ) == -1 )
+    {
+        return -1;
+    }
+
+    for( i = 0; i < BENCH_COPIES; i++ )
+    {
+        start = bench_now( );
+        column_sum( &column, &sum, &values );
+        latencies[ i ] = bench_now( ) - start;
+    }
+
+    bench_report( out, "column_sum", rows, latencies, BENCH_COPIES, 0 );
+    column_destroy( &column );
+
+    for( i = 0; i < BENCH_COPIES; i++ )
+    {
+        value = entry_get_title( entries[ bench_random( rows ) ] );
+        length = value->s_len < 4 ? value->s_len : 4;
+        memcpy( needle, value->s_ptr + value->s_len - length, length );
+        needle[ length ] = '\0';
+
+        if( ( query = query_contains( ENTRY_TITLE, needle ) ) == NULL )
+        {
+            return -1;
+        }
+
+        start = bench_now( );
+
+        if( ( result = book_query( book, query, NULL ) ) == NULL )
+        {
+            return -1;
+        }
+
+        latencies[ i ] = bench_now( ) - start;
+        book_destroy( result, 0 );
+        query_destroy( query );
+    }
+
+    bench_report( out, "book_query_contains", rows, latencies, BENCH_COPIES, 0 );
+
+    for( i = 0; i < BENCH_COPIES; i++ )
+    {
+        start = bench_now( );
+
+        if( ( aggregate = book_aggregate( book, ENTRY_PUBLISHER, ENTRY_PAGES ) ) == NULL )
+        {
+            return -1;
+        }
+
+        latencies[ i ] = bench_now( ) - start;
+        book_aggregate_destroy( aggregate );
+    }
+
+    bench_report( out, "book_aggregate", rows, latencies, BENCH_COPIES, 0 );
+
+    for( i = 0; i < calls; i++ )
+    {
+        if( ( entry = book_gen_entry( gen, rows + i ) ) == NULL )
+        {
+            return -1;
+        }
+
+        start = bench_now( );
+
+        if( book_add( book, entry ) == -1 )
+        {
+            return -1;
+        }
+
+        latencies[ i ] = bench_now( ) - start;
+        entry_destroy( entry );
+    }
+
+    bench_report( out, "book_add", rows, latencies, calls, 0 );
+
+    step = book->a_count / calls > 0 ? book->a_count / calls : 1;
+
+    for( it = book->a_head, row = 0, i = 0; it != NULL && i < calls; it = it->n_next, row++ )
+    {
+        if( row % step == 0 )
+        {
+            nodes[ i++ ] = it;
+        }
+    }
+
+    for( row = 0; row < i; row++ )
+    {
+        start = bench_now( );
+        entry = book_remove( book, nodes[ row ] );
+        latencies[ row ] = bench_now( ) - start;
+        entry_destroy( entry );
+    }
+
+    bench_report( out, "book_remove", rows, latencies, i, 0 );
+
+    for( i = 0; i < BENCH_COPIES; i++ )
+    {
+        start = bench_now( );
+
+        if( ( result = book_duplicate( book ) ) == NULL )
+        {
+            return -1;
+        }
+
+        latencies[ i ] = bench_now( ) - start;
+        book_destroy( result, 1 );
+    }
+
+    bench_report( out, "book_duplicate", rows, latencies, BENCH_COPIES, 0 );
+
+    book_destroy( book, 1 );
+    free( latencies );
+    free( nodes );
+    free( entries );
+
+    return 0;
+}
+
+int main( int argc, char *argv[ ] )
+{
+    book_gen_config_t config;
+    unsigned long sizes[ BENCH_SIZES ], calls;
+    book_gen_t *gen;
+    unsigned count, i;
+    int cache;
+    char *end;
+
+    sizes[ 0 ] = 10000;
+    sizes[ 1 ] = 100000;
+    sizes[ 2 ] = 1000000;
+    count = 0;
+    calls = BENCH_CALLS;
+    cache = 0;
+
+    for( i = 1; i < ( unsigned )argc; i++ )
+    {
+        if( strcmp( argv[ i ], "--rows" ) == 0 && i + 1 < ( unsigned )argc
+                && count < BENCH_SIZES
+                && ( sizes[ count ] = strtoul( argv[ i + 1 ], &end, 10 ) ) > 0 && *end == '\0' )
+        {
+            count++;
+            i++;
+        }
+        else if( strcmp( argv[ i ], "--calls" ) == 0 && i + 1 < ( unsigned )argc
+                && ( calls = strtoul( argv[ i + 1 ], &end, 10 ) ) > 0 && *end == '\0' )
+        {
+            i++;
+        }
+        else if( strcmp( argv[ i ], "--seed" ) == 0 && i + 1 < ( unsigned )argc
+                && ( state = strtoull( argv[ i + 1 ], &end, 10 ) ) > 0 && *end == '\0' )
+        {
+            i++;
+        }
+        else if( strcmp( argv[ i ], "--cache" ) == 0 )
+        {
+            cache = 1;
+        }
+        else
+        {
+            fprintf( stderr, "Usage: %s [--rows N]... [--calls N] [--seed N] [--cache]\n",
+                     argv[ 0 ] );
+            return EXIT_FAILURE;
+        }
+    }
+
+    if( count == 0 )
+    {
+        count = 3;
+    }
+
+    query_set_cache( cache );
+    book_gen_defaults( &config );
+    config.g_seed = state;
+
+    if( ( gen = book_gen_create( &config ) ) == NULL )
+    {
+        perror( "book_bench" );
+        return EXIT_FAILURE;
+    }
+
+    printf( "{\n  \"benchmark\": \"book\",\n  \"calls\": %lu,\n  \"seed\": %llu,\n"
+            "  \"cache\": %s,\n  \"results\": [", calls, state, cache ? "true" : "false" );
+
+    for( i = 0; i < count; i++ )
+    {
+        if( bench_run( stdout, gen, sizes[ i ], calls ) == -1 )
+        {
+            printf( "\n  ]\n}\n" );
+            perror( "book_bench" );
+
+            return EXIT_FAILURE;
+        }
+
+        fflush( stdout );
+    }
+
+    printf( "\n  ]\n}\n" );
+    book_gen_destroy( gen );
+
+    return EXIT_SUCCESS;
+}
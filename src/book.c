@@ -1,4 +1,302 @@
 #include <book.h>
+#include <book_index.h>
+#include <book_file.h>
+#include <query.h>
+#include <stats.h>
+
+typedef struct book_unique
+{
+    entry_node_t **u_nodes;
+    unsigned long *u_hashes;
+    unsigned long u_mask;
+    unsigned long u_count;
+    unsigned long u_generation;
+} book_unique_t;
+
+static unsigned long unique_generation( const book_t *book )
+{
+    return book_generation( book, ENTRY_ISBN );
+}
+
+static const string_t *unique_key( entry_t *entry, unsigned long *hash )
+{
+    const string_t *isbn;
+
+    if( ( isbn = entry_get_field( entry, ENTRY_ISBN ) ) == NULL || isbn->s_len == 0 )
+    {
+        return NULL;
+    }
+
+    *hash = string_hash( isbn->s_ptr, isbn->s_len );
+
+    return isbn;
+}
+
+static entry_node_t *unique_find( const book_unique_t *unique, const string_t *isbn )
+{
+    const string_t *other;
+    unsigned long hash, slot;
+
+    if( isbn == NULL || isbn->s_len == 0 )
+    {
+        return NULL;
+    }
+
+    hash = string_hash( isbn->s_ptr, isbn->s_len );
+
+    for( slot = hash & unique->u_mask; unique->u_nodes[ slot ] != NULL;
+            slot = ( slot + 1 ) & unique->u_mask )
+    {
+        other = entry_get_field( unique->u_nodes[ slot ]->n_entry, ENTRY_ISBN );
+
+        if( unique->u_hashes[ slot ] == hash && other->s_len == isbn->s_len
+                && memcmp( other->s_ptr, isbn->s_ptr, isbn->s_len ) == 0 )
+        {
+            return unique->u_nodes[ slot ];
+        }
+    }
+
+    return NULL;
+}
+
+static entry_node_t *unique_lookup( const book_unique_t *unique, entry_t *entry )
+{
+    return unique_find( unique, entry_get_field( entry, ENTRY_ISBN ) );
+}
+
+static void unique_insert( book_unique_t *unique, entry_node_t *node )
+{
+    unsigned long hash, slot;
+
+    if( unique_key( node->n_entry, &hash ) == NULL )
+    {
+        return;
+    }
+
+    for( slot = hash & unique->u_mask; unique->u_nodes[ slot ] != NULL;
+            slot = ( slot + 1 ) & unique->u_mask );
+
+    unique->u_nodes[ slot ] = node;
+    unique->u_hashes[ slot ] = hash;
+    unique->u_count++;
+}
+
+static void unique_erase( book_unique_t *unique, entry_node_t *node )
+{
+    unsigned long hash, slot, next, home;
+
+    if( unique_key( node->n_entry, &hash ) == NULL )
+    {
+        return;
+    }
+
+    for( slot = hash & unique->u_mask; unique->u_nodes[ slot ] != node;
+            slot = ( slot + 1 ) & unique->u_mask )
+    {
+        if( unique->u_nodes[ slot ] == NULL )
+        {
+            return;
+        }
+    }
+
+    unique->u_nodes[ slot ] = NULL;
+    unique->u_count--;
+
+    for( next = ( slot + 1 ) & unique->u_mask; unique->u_nodes[ next ] != NULL;
+            next = ( next + 1 ) & unique->u_mask )
+    {
+        home = unique->u_hashes[ next ] & unique->u_mask;
+
+        if( ( ( next - home ) & unique->u_mask ) >= ( ( next - slot ) & unique->u_mask ) )
+        {
+            unique->u_nodes[ slot ] = unique->u_nodes[ next ];
+            unique->u_hashes[ slot ] = unique->u_hashes[ next ];
+            unique->u_nodes[ next ] = NULL;
+            slot = next;
+        }
+    }
+}
+
+static int unique_build( book_t *book, unsigned long size, int strict )
+{
+    book_unique_t *unique;
+    entry_node_t **nodes;
+    unsigned long *hashes;
+    entry_node_t *it;
+
+    for( size = size < 16 ? 16 : size; size < 2 * book->a_count; size *= 2 );
+
+    if( ( nodes = calloc( size, sizeof( entry_node_t* ) ) ) == NULL
+            || ( hashes = malloc( size * sizeof( unsigned long ) ) ) == NULL )
+    {
+        free( nodes );
+        errno = ENOMEM;
+        return -1;
+    }
+
+    unique = book->a_unique;
+    free( unique->u_nodes );
+    free( unique->u_hashes );
+    unique->u_nodes = nodes;
+    unique->u_hashes = hashes;
+    unique->u_mask = size - 1;
+    unique->u_count = 0;
+    unique->u_generation = unique_generation( book );
+
+    for( it = book->a_head; it != NULL; it = it->n_next )
+    {
+        if( unique_lookup( unique, it->n_entry ) == NULL )
+        {
+            unique_insert( unique, it );
+        }
+        else if( strict )
+        {
+            errno = EEXIST;
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static int unique_reserve( book_t *book )
+{
+    book_unique_t *unique;
+
+    unique = book->a_unique;
+
+    if( unique->u_generation != unique_generation( book ) )
+    {
+        return unique_build( book, unique->u_mask + 1, 0 );
+    }
+
+    if( 2 * ( unique->u_count + 1 ) > unique->u_mask + 1 )
+    {
+        return unique_build( book, 2 * ( unique->u_mask + 1 ), 0 );
+    }
+
+    return 0;
+}
+
+static book_t *book_find_by( const book_t *book, entry_field_t field,
+                             const char *value, stats_op_t op )
+{
+    unsigned long long start;
+    query_t query;
+    book_t *retval;
+
+    STATS_START( start );
+    memset( &query, 0, sizeof( query_t ) );
+    query.q_op = QUERY_EQUAL;
+    query.q_field = field;
+    query.q_value = ( char* )value;
+    query.q_len = strlen( value );
+
+    retval = book_query( book, &query, NULL );
+    STATS_RECORD( op, start, 0 );
+
+    return retval;
+}
+
+static unsigned long long book_moved( FILE *file, long position )
+{
+    long now;
+
+    now = ftell( file );
+
+    return position != -1 && now > position ? ( unsigned long long )( now - position ) : 0;
+}
+
+int book_append( book_t *book, entry_t *entry )
+{
+    entry_node_t *node;
+
+    if( book->a_unique != NULL && unique_reserve( book ) == -1 )
+    {
+        return -1;
+    }
+
+    if( book->a_unique != NULL && unique_lookup( book->a_unique, entry ) != NULL )
+    {
+        errno = EEXIST;
+        return -1;
+    }
+
+    if( ( node = malloc( sizeof( entry_node_t ) ) ) == NULL )
+    {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    STATS_ALLOC( STATS_NODE, sizeof( entry_node_t ) );
+    node->n_entry = entry;
+    node->n_next = NULL;
+    node->n_prev = book->a_tail;
+
+    if( book->a_tail == NULL )
+    {
+        book->a_head = node;
+    }
+    else
+    {
+        book->a_tail->n_next = node;
+    }
+
+    book->a_tail = node;
+    book->a_count++;
+    book->a_version++;
+
+    if( book->a_unique != NULL )
+    {
+        unique_insert( book->a_unique, node );
+    }
+
+    if( book->a_index != NULL )
+    {
+        book_index_appended( book, entry );
+    }
+
+    return 0;
+}
+
+static book_t *book_find_range( const book_t *book, entry_field_t field,
+                                long min, long max, stats_op_t op )
+{
+    const range_index_t *range;
+    unsigned long long start;
+    book_t *retval;
+    unsigned long i;
+
+    STATS_START( start );
+
+    if( ( range = book_index_range( book, field ) ) == NULL )
+    {
+        return NULL;
+    }
+
+    if( ( retval = book_create( ) ) == NULL )
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    for( i = range_index_lower( range, min );
+            i < range->r_count && range->r_keys[ i ].r_key <= max; i++ )
+    {
+        if( book_append( retval,
+                    book->a_index->i_rows[ range->r_keys[ i ].r_row ] ) == -1 )
+        {
+            book_destroy( retval, 0 );
+            errno = ENOMEM;
+
+            return NULL;
+        }
+    }
+
+    STATS_RECORD( op, start, 0 );
+
+    return retval;
+}
 
 book_t *book_create( void )
 {
@@ -11,6 +309,7 @@ book_t *book_create( void )
     }
 
     memset( book, 0, sizeof( book_t ) );
+    STATS_ALLOC( STATS_BOOK, sizeof( book_t ) );
 
     return book;
 }
@@ -19,13 +318,14 @@ book_t *book_duplicate( const book_t *book )
 {
     book_t *duplicate;
 
-    if( ( duplicate = malloc( sizeof( book_t ) ) ) == NULL )
+    if( ( duplicate = book_create( ) ) == NULL )
     {
         errno = ENOMEM;
         return NULL;
     }
 
-    if( book_add_all( duplicate, ( book_t* )book ) == -1 )
+    if( ( book->a_unique != NULL && book_set_unique( duplicate, 1 ) == -1 )
+            || book_add_all( duplicate, ( book_t* )book ) == -1 )
     {
         book_destroy( duplicate, 1 );
         errno = ENOMEM;
@@ -59,11 +359,15 @@ entry_node_t *book_get( const book_t *book, unsigned index )
     return it;
 }
 
-void book_write( FILE *file, book_t *book )
+int book_write( FILE *file, book_t *book )
 {
+    unsigned long long start;
     entry_node_t *it;
     unsigned count;
+    long position;
 
+    STATS_START( start );
+    position = ftell( file );
     it = book->a_head;
     count = 0;
 
@@ -79,29 +383,87 @@ void book_write( FILE *file, book_t *book )
 
     while( it != NULL )
     {
-        entry_write( file, it->n_entry );
+        if( entry_write( file, it->n_entry ) == -1 )
+        {
+            return -1;
+        }
+
         it = it->n_next;
     }
+
+    STATS_RECORD( STATS_BOOK_WRITE, start, book_moved( file, position ) );
+
+    return 0;
 }
 
-book_t *book_read( FILE *file )
+static book_t *book_read_stream( FILE *file )
 {
+    string_source_t *source;
+    book_format_t format;
     book_t *book;
     entry_t *entry;
     unsigned count;
 
-    fread( &count, sizeof( count ), 1, file );
+    if( ( format = book_file_format( file ) ) == BOOK_FORMAT_PACKED )
+    {
+        return book_read_packed( file );
+    }
 
-    book = book_create( );
+    if( format == BOOK_FORMAT_SHARDED )
+    {
+        errno = EIO;
+        return NULL;
+    }
+
+    if( fread( &count, sizeof( count ), 1, file ) != 1 )
+    {
+        if( ferror( file ) || ftell( file ) > 0 )
+        {
+            errno = EIO;
+            return NULL;
+        }
+
+        count = 0;
+    }
+
+    source = NULL;
+
+    if( count > 0 && book_get_lazy( ) && ftell( file ) != -1 )
+    {
+        if( ( source = string_source_open( fileno( file ) ) ) == NULL )
+        {
+            return NULL;
+        }
+    }
+    else if( count > BOOK_DECODE_ROWS
+            && ( ( book = book_read_parallel( file, count ) ) != NULL || errno != ESPIPE ) )
+    {
+        return book;
+    }
+
+    if( ( book = book_create( ) ) == NULL )
+    {
+        string_source_release( source );
+        errno = ENOMEM;
+
+        return NULL;
+    }
 
     while( count > 0 )
     {
-        entry = entry_read( file );
+        if( ( entry = entry_read_lazy( file, source ) ) == NULL )
+        {
+            string_source_release( source );
+            book_destroy( book, 1 );
+
+            return NULL;
+        }
 
-        if( book_add( book, entry ) == -1 )
+        if( book_add_take( book, entry ) == -1 )
         {
+            entry_destroy( entry );
+            string_source_release( source );
             book_destroy( book, 1 );
-            errno = ENOMEM;
 
             return NULL;
         }
@@ -109,48 +471,65 @@ book_t *book_read( FILE *file )
         count--;
     }
 
+    string_source_release( source );
+
+    return book;
+}
+
+book_t *book_read( FILE *file )
+{
+    unsigned long long start;
+    book_t *book;
+    long position;
+
+    STATS_START( start );
+    position = ftell( file );
+
+    if( ( book = book_read_stream( file ) ) != NULL )
+    {
+        STATS_RECORD( STATS_BOOK_READ, start, book_moved( file, position ) );
+    }
+
     return book;
 }
 
 int book_add( book_t *book, entry_t *entry )
 {
-    entry_node_t *node;
+    unsigned long long start;
+    entry_t *duplicate;
 
-    if( ( node = malloc( sizeof( entry_node_t ) ) ) == NULL )
+    STATS_START( start );
+
+    if( ( duplicate = entry_duplicate( entry ) ) == NULL )
     {
         errno = ENOMEM;
         return -1;
     }
 
-    if( ( node->n_entry = entry_duplicate( entry ) ) == NULL )
+    if( book_append( book, duplicate ) == -1 )
     {
-        errno = ENOMEM;
-        free( node );
-    
+        entry_destroy( duplicate );
         return -1;
     }
-    
 
-    node->n_prev = node->n_next = NULL;
-    /* node->n_entry = entry; */
+    STATS_RECORD( STATS_BOOK_ADD, start, 0 );
 
-    if( book->a_head == NULL )
-    {
-        book->a_head = node;
-    }
-    else if( book->a_tail == NULL )
-    {
-        book->a_tail = node;
-        book->a_head->n_next = book->a_tail;
-        book->a_tail->n_prev = book->a_head;
-    }
-    else
+    return 0;
+}
+
+int book_add_take( book_t *book, entry_t *entry )
+{
+    unsigned long long start;
+
+    STATS_START( start );
+
+    if( book_append( book, entry ) == -1 )
     {
-        node->n_prev = book->a_tail;
-        book->a_tail->n_next = node;
-        book->a_tail = node;
+        return -1;
     }
 
+    STATS_RECORD( STATS_BOOK_ADD, start, 0 );
+
     return 0;
 }
 
@@ -164,7 +543,6 @@ int book_add_all( book_t *book, book_t *some_book )
     {
         if( book_add( book, it->n_entry ) == -1 )
         {
-            errno = ENOMEM;
             return -1;
         }
 
@@ -174,225 +552,249 @@ int book_add_all( book_t *book, book_t *some_book )
     return 0;
 }
 
-int book_add_many( book_t *book, int count, ... )
+long book_merge( book_t *book, book_t *some_book )
 {
-    va_list ap;
+    entry_node_t *it, *found;
+    entry_t *duplicate;
+    long replaced;
+    int temporary;
 
-    va_start( ap, count );
+    if( book == some_book )
+    {
+        errno = EINVAL;
+        return -1;
+    }
 
-    while( count > 0 )
+    temporary = book->a_unique == NULL;
+
+    if( temporary && book_set_unique( book, 1 ) == -1 )
     {
-        if( book_add( book, va_arg( ap, entry_t* ) ) == -1 )
+        return -1;
+    }
+
+    for( it = some_book->a_head, replaced = 0; it != NULL; it = it->n_next )
+    {
+        if( unique_reserve( book ) == -1 )
+        {
+            replaced = -1;
+            break;
+        }
+
+        if( ( duplicate = entry_duplicate( it->n_entry ) ) == NULL )
         {
-            book_destroy( book, 1 );
             errno = ENOMEM;
+            replaced = -1;
+            break;
+        }
 
-            return -1;
+        if( ( found = unique_lookup( book->a_unique, duplicate ) ) != NULL )
+        {
+            entry_destroy( book_remove( book, found ) );
+            replaced++;
         }
 
-        count--;
+        if( book_append( book, duplicate ) == -1 )
+        {
+            entry_destroy( duplicate );
+            replaced = -1;
+            break;
+        }
     }
 
-    va_end( ap );
+    if( temporary )
+    {
+        book_set_unique( book, 0 );
+    }
 
-    return 0;
+    return replaced;
 }
 
-book_t *book_find_by_title( const book_t *book, const char *title )
+int book_set_field( book_t *book, entry_t *entry, entry_field_t field, string_t *value )
 {
-    entry_node_t *it, *tmp;
-    book_t *retval;
+    entry_node_t *found, *node;
+    unsigned long generation;
 
-    if( ( retval = book_create( ) ) == NULL )
+    node = NULL;
+
+    if( field == ENTRY_ISBN && book->a_unique != NULL )
     {
-        errno = ENOMEM;
-        return NULL;
-    }
+        if( unique_reserve( book ) == -1 )
+        {
+            return -1;
+        }
 
-    it = book->a_head;
+        if( ( found = unique_find( book->a_unique, value ) ) != NULL && found->n_entry != entry )
+        {
+            errno = EEXIST;
+            return -1;
+        }
 
-    while( it != NULL )
-    {
-        if( strcmp( it->n_entry->e_title->s_ptr, title ) == 0 )
+        if( ( node = unique_lookup( book->a_unique, entry ) ) != NULL && node->n_entry == entry )
         {
-            if( ( tmp = malloc( sizeof( entry_node_t ) ) ) == NULL )
-            {
-                book_destroy( retval, 0 );
-                errno = ENOMEM;
+            unique_erase( book->a_unique, node );
+        }
+        else
+        {
+            node = NULL;
+        }
+    }
 
-                return NULL;
-            }
+    generation = book_generation( book, field );
+    entry_set_field( entry, field, value );
 
-            tmp->n_prev = tmp->n_next = NULL;
-            tmp->n_entry = it->n_entry;
+    if( book->a_sealed )
+    {
+        book->a_generations[ field ]++;
+    }
 
-            if( retval->a_head == NULL )
-            {
-                retval->a_head = tmp;
-            }
-            else if( retval->a_tail == NULL )
-            {
-                retval->a_tail = tmp;
-                retval->a_head->n_next = retval->a_tail;
-                retval->a_tail->n_prev = retval->a_head;
-            }
-            else
-            {
-                tmp->n_prev = retval->a_tail;
-                retval->a_tail->n_next = tmp;
-                retval->a_tail = tmp;
-            }
-        }
+    if( node != NULL )
+    {
+        unique_insert( book->a_unique, node );
+        book->a_unique->u_generation = unique_generation( book );
+    }
 
-        it = it->n_next;
+    if( book->a_index != NULL )
+    {
+        book_index_edited( book, entry, field, generation );
     }
 
-    return retval;
+    return 0;
 }
 
-book_t *book_find_by_author( const book_t *book, const char *author )
+unsigned long book_generation( const book_t *book, entry_field_t field )
 {
-    entry_node_t *it, *tmp;
-    book_t *retval;
+    return book->a_sealed ? book->a_generations[ field ] : entry_generation( field );
+}
 
-    if( ( retval = book_create( ) ) == NULL )
+int book_set_unique( book_t *book, int unique )
+{
+    if( book->a_unique != NULL )
     {
-        errno = ENOMEM;
-        return NULL;
+        free( book->a_unique->u_nodes );
+        free( book->a_unique->u_hashes );
+        free( book->a_unique );
+        book->a_unique = NULL;
     }
 
-    it = book->a_head;
-
-    while( it != NULL )
+    if( !unique )
     {
-        if( strcmp( it->n_entry->e_author->s_ptr, author ) == 0 )
-        {
-            if( ( tmp = malloc( sizeof( entry_node_t ) ) ) == NULL )
-            {
-                book_destroy( retval, 0 );
-                errno = ENOMEM;
-
-                return NULL;
-            }
-
-            tmp->n_prev = tmp->n_next = NULL;
-            tmp->n_entry = it->n_entry;
+        return 0;
+    }
 
-            if( retval->a_head == NULL )
-            {
-                retval->a_head = tmp;
-            }
-            else if( retval->a_tail == NULL )
-            {
-                retval->a_tail = tmp;
-                retval->a_head->n_next = retval->a_tail;
-                retval->a_tail->n_prev = retval->a_head;
-            }
-            else
-            {
-                tmp->n_prev = retval->a_tail;
-                retval->a_tail->n_next = tmp;
-                retval->a_tail = tmp;
-            }
-        }
+    if( ( book->a_unique = calloc( 1, sizeof( book_unique_t ) ) ) == NULL )
+    {
+        errno = ENOMEM;
+        return -1;
+    }
 
-        it = it->n_next;
+    if( unique_build( book, 0, 1 ) == -1 )
+    {
+        book_set_unique( book, 0 );
+        return -1;
     }
 
-    return retval;
+    return 0;
 }
 
-book_t *book_find_by_publisher( const book_t *book, const char *publisher )
+int book_add_many( book_t *book, int count, ... )
 {
-    entry_node_t *it, *tmp;
-    book_t *retval;
+    va_list ap;
 
-    if( ( retval = book_create( ) ) == NULL )
+    va_start( ap, count );
+
+    while( count > 0 )
     {
-        errno = ENOMEM;
-        return NULL;
+        if( book_add( book, va_arg( ap, entry_t* ) ) == -1 )
+        {
+            book_destroy( book, 1 );
+            errno = ENOMEM;
+
+            return -1;
+        }
+
+        count--;
     }
 
-    it = book->a_head;
+    va_end( ap );
 
-    while( it != NULL )
-    {
-        if( strcmp( it->n_entry->e_publisher->s_ptr, publisher ) == 0 )
-        {
-            if( ( tmp = malloc( sizeof( entry_node_t ) ) ) == NULL )
-            {
-                book_destroy( retval, 0 );
-                errno = ENOMEM;
+    return 0;
+}
 
-                return NULL;
-            }
+book_t *book_find_by_title( const book_t *book, const char *title )
+{
+    return book_find_by( book, ENTRY_TITLE, title, STATS_FIND_BY_TITLE );
+}
 
-            tmp->n_prev = tmp->n_next = NULL;
-            tmp->n_entry = it->n_entry;
+book_t *book_find_by_author( const book_t *book, const char *author )
+{
+    return book_find_by( book, ENTRY_AUTHOR, author, STATS_FIND_BY_AUTHOR );
+}
 
-            if( retval->a_head == NULL )
-            {
-                retval->a_head = tmp;
-            }
-            else if( retval->a_tail == NULL )
-            {
-                retval->a_tail = tmp;
-                retval->a_head->n_next = retval->a_tail;
-                retval->a_tail->n_prev = retval->a_head;
-            }
-            else
-            {
-                tmp->n_prev = retval->a_tail;
-                retval->a_tail->n_next = tmp;
-                retval->a_tail = tmp;
-            }
-        }
+book_t *book_find_by_publisher( const book_t *book, const char *publisher )
+{
+    return book_find_by( book, ENTRY_PUBLISHER, publisher, STATS_FIND_BY_PUBLISHER );
+}
 
-        it = it->n_next;
-    }
+book_t *book_find_by_pages( const book_t *book, long min, long max )
+{
+    return book_find_range( book, ENTRY_PAGES, min, max, STATS_FIND_BY_PAGES );
+}
 
-    return retval;
+book_t *book_find_by_pubdate( const book_t *book, long min, long max )
+{
+    return book_find_range( book, ENTRY_PUBDATE, min, max, STATS_FIND_BY_PUBDATE );
 }
 
 entry_t *book_remove( book_t *book, entry_node_t *entry_node )
 {
+    unsigned long long start;
     entry_t *retval;
 
-    if( book->a_head == entry_node )
-    {
-        retval = book->a_head->n_entry;
-        book->a_head = book->a_head->n_next;
+    STATS_START( start );
+    retval = entry_node->n_entry;
 
-        if( book->a_head != NULL )
-        {
-            book->a_head->n_prev = NULL;
-        }
+    if( entry_node->n_prev != NULL )
+    {
+        entry_node->n_prev->n_next = entry_node->n_next;
     }
-    else if( book->a_tail == entry_node )
+    else
     {
-        retval = book->a_tail->n_entry;
-        book->a_tail = book->a_tail->n_prev;
+        book->a_head = entry_node->n_next;
+    }
 
-        if( book->a_tail != NULL )
-        {
-            book->a_tail->n_next = NULL;
-        }
+    if( entry_node->n_next != NULL )
+    {
+        entry_node->n_next->n_prev = entry_node->n_prev;
     }
     else
     {
-        retval = entry_node->n_entry;
-        entry_node->n_prev->n_next = entry_node->n_next;
-        entry_node->n_next->n_prev = entry_node->n_prev;
+        book->a_tail = entry_node->n_prev;
+    }
+
+    book->a_count--;
+    book->a_version++;
+
+    if( book->a_index != NULL )
+    {
+        book_index_removed( book, retval );
+    }
+
+    if( book->a_unique != NULL
+            && book->a_unique->u_generation == unique_generation( book ) )
+    {
+        unique_erase( book->a_unique, entry_node );
     }
 
+    STATS_FREE( STATS_NODE, sizeof( entry_node_t ) );
     free( entry_node );
+    STATS_RECORD( STATS_BOOK_REMOVE, start, 0 );
 
     return retval;
 }
 
 book_t *book_remove_all( book_t *book, book_t *some_book )
 {
-    entry_node_t *it1, *it2;
+    entry_node_t *it1, *it2, *next;
 
     it1 = some_book->a_head;
 
@@ -402,12 +804,14 @@ book_t *book_remove_all( book_t *book, book_t *some_book )
 
         while( it2 != NULL )
         {
+            next = it2->n_next;
+
             if( it1->n_entry == it2->n_entry )
             {
                 book_remove( book, it2 );
             }
 
-            it2 = it2->n_next;
+            it2 = next;
         }
 
         it1 = it1->n_next;
@@ -431,9 +835,17 @@ void book_destroy( book_t *book, int all )
             entry_destroy( it->n_entry );
         }
 
+        STATS_FREE( STATS_NODE, sizeof( entry_node_t ) );
         free( it );
         it = next;
     }
 
+    if( book->a_index != NULL )
+    {
+        book_index_destroy( book->a_index );
+    }
+
+    book_set_unique( book, 0 );
+    STATS_FREE( STATS_BOOK, sizeof( book_t ) );
     free( book );
 }
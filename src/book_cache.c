@@ -0,0 +1,422 @@
+#include <book_cache.h>
+
+static unsigned long long cache_put( char *data, unsigned long long size,
+                                     const void *value, unsigned long long len )
+{
+    if( data != NULL && len > 0 )
+    {
+        memcpy( data + size, value, len );
+    }
+
+    return size + len;
+}
+
+static unsigned long long cache_key( char *data, const query_t *query, unsigned *fields )
+{
+    unsigned long long size;
+    int op, field;
+    unsigned i;
+
+    op = ( int )query->q_op;
+    field = ( int )query->q_field;
+
+    size = cache_put( data, 0, &op, sizeof( op ) );
+    size = cache_put( data, size, &field, sizeof( field ) );
+    size = cache_put( data, size, &query->q_len, sizeof( query->q_len ) );
+    size = cache_put( data, size, query->q_value, query->q_len );
+    size = cache_put( data, size, &query->q_min, sizeof( query->q_min ) );
+    size = cache_put( data, size, &query->q_max, sizeof( query->q_max ) );
+    size = cache_put( data, size, &query->q_count, sizeof( query->q_count ) );
+
+    if( query->q_op != QUERY_AND && query->q_op != QUERY_OR )
+    {
+        *fields |= 1U << query->q_field;
+    }
+
+    for( i = 0; i < query->q_count; i++ )
+    {
+        size += cache_key( data != NULL ? data + size : NULL, query->q_args[ i ], fields );
+    }
+
+    return size;
+}
+
+static int cache_match( const char *key, entry_t *entry, unsigned long long *used )
+{
+    query_t query;
+    unsigned long long size, length;
+    unsigned i;
+    int op, field, matched, match;
+
+    memset( &query, 0, sizeof( query_t ) );
+    memcpy( &op, key, sizeof( op ) );
+    size = sizeof( op );
+    memcpy( &field, key + size, sizeof( field ) );
+    size += sizeof( field );
+    memcpy( &query.q_len, key + size, sizeof( query.q_len ) );
+    size += sizeof( query.q_len );
+    query.q_value = ( char* )key + size;
+    size += query.q_len;
+    memcpy( &query.q_min, key + size, sizeof( query.q_min ) );
+    size += sizeof( query.q_min );
+    memcpy( &query.q_max, key + size, sizeof( query.q_max ) );
+    size += sizeof( query.q_max );
+    memcpy( &query.q_count, key + size, sizeof( query.q_count ) );
+    size += sizeof( query.q_count );
+
+    query.q_op = ( query_op_t )op;
+    query.q_field = ( entry_field_t )field;
+    matched = query.q_op == QUERY_AND;
+
+    for( i = 0; i < query.q_count; i++ )
+    {
+        match = cache_match( key + size, entry, &length );
+        matched = query.q_op == QUERY_AND ? matched && match : matched || match;
+        size += length;
+    }
+
+    if( query.q_op != QUERY_AND && query.q_op != QUERY_OR )
+    {
+        matched = query_match( &query, entry );
+    }
+
+    *used = size;
+
+    return matched;
+}
+
+static int cache_valid( const book_cached_t *cached, const book_t *book,
+                        unsigned long version, entry_field_t edited,
+                        unsigned long generation )
+{
+    int field;
+
+    if( cached->k_key == NULL || cached->k_version != version )
+    {
+        return 0;
+    }
+
+    for( field = 0; field < ENTRY_FIELDS; field++ )
+    {
+        if( ( cached->k_fields & ( 1U << field ) )
+                && cached->k_generations[ field ]
+                   != ( field == ( int )edited ? generation
+                                               : book_generation( book, ( entry_field_t )field ) ) )
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+static unsigned long cache_position( const book_cached_t *cached, const entry_t *entry )
+{
+    unsigned long i;
+
+    for( i = 0; i < cached->k_count && cached->k_entries[ i ] != entry; i++ );
+
+    return i;
+}
+
+static void cache_drop( book_cached_t *cached )
+{
+    free( cached->k_key );
+    free( cached->k_entries );
+    memset( cached, 0, sizeof( book_cached_t ) );
+}
+
+book_cache_t *book_cache_create( void )
+{
+    book_cache_t *cache;
+
+    if( ( cache = malloc( sizeof( book_cache_t ) ) ) == NULL )
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    memset( cache, 0, sizeof( book_cache_t ) );
+    pthread_mutex_init( &cache->c_lock, NULL );
+
+    return cache;
+}
+
+book_t *book_cache_find( book_cache_t *cache, const book_t *book,
+                         const query_t *query )
+{
+    book_cached_t *cached;
+    book_t *retval;
+    unsigned long long size;
+    unsigned long hash, i;
+    unsigned fields;
+    char *key;
+    int slot;
+
+    fields = 0;
+    size = cache_key( NULL, query, &fields );
+
+    if( ( key = malloc( size + 1 ) ) == NULL )
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    cache_key( key, query, &fields );
+    hash = string_hash( key, size );
+    retval = NULL;
+
+    pthread_mutex_lock( &cache->c_lock );
+
+    for( slot = 0; slot < BOOK_CACHE_ENTRIES; slot++ )
+    {
+        cached = &cache->c_slots[ slot ];
+
+        if( cached->k_key != NULL && cached->k_hash == hash && cached->k_size == size
+                && memcmp( cached->k_key, key, size ) == 0 )
+        {
+            break;
+        }
+    }
+
+    if( slot < BOOK_CACHE_ENTRIES
+            && !cache_valid( cached, book, book->a_version, ENTRY_FIELDS, 0 ) )
+    {
+        cache_drop( cached );
+        slot = BOOK_CACHE_ENTRIES;
+    }
+
+    if( slot < BOOK_CACHE_ENTRIES && ( retval = book_create( ) ) != NULL )
+    {
+        for( i = 0; i < cached->k_count; i++ )
+        {
+            if( book_append( retval, cached->k_entries[ i ] ) == -1 )
+            {
+                book_destroy( retval, 0 );
+                retval = NULL;
+
+                break;
+            }
+        }
+
+        cached->k_used = ++cache->c_tick;
+    }
+
+    if( slot < BOOK_CACHE_ENTRIES )
+    {
+        cache->c_hits++;
+    }
+    else
+    {
+        cache->c_misses++;
+    }
+
+    pthread_mutex_unlock( &cache->c_lock );
+    free( key );
+
+    if( retval == NULL )
+    {
+        errno = slot < BOOK_CACHE_ENTRIES ? ENOMEM : ENOENT;
+    }
+
+    return retval;
+}
+
+int book_cache_store( book_cache_t *cache, const book_t *book,
+                      const query_t *query, const book_t *result )
+{
+    book_cached_t fresh, *cached;
+    entry_node_t *it;
+    unsigned long i;
+    int slot, victim, field;
+
+    if( result->a_count > BOOK_CACHE_ROWS )
+    {
+        return 0;
+    }
+
+    memset( &fresh, 0, sizeof( book_cached_t ) );
+    fresh.k_size = cache_key( NULL, query, &fresh.k_fields );
+    fresh.k_key = malloc( fresh.k_size + 1 );
+    fresh.k_entries = malloc( ( result->a_count + 1 ) * sizeof( entry_t* ) );
+
+    if( fresh.k_key == NULL || fresh.k_entries == NULL )
+    {
+        cache_drop( &fresh );
+        errno = ENOMEM;
+
+        return -1;
+    }
+
+    cache_key( fresh.k_key, query, &fresh.k_fields );
+    fresh.k_hash = string_hash( fresh.k_key, fresh.k_size );
+    fresh.k_version = book->a_version;
+
+    for( field = 0; field < ENTRY_FIELDS; field++ )
+    {
+        if( fresh.k_fields & ( 1U << field ) )
+        {
+            fresh.k_generations[ field ] = book_generation( book, ( entry_field_t )field );
+        }
+    }
+
+    for( it = result->a_head, i = 0; it != NULL; it = it->n_next, i++ )
+    {
+        fresh.k_entries[ i ] = it->n_entry;
+    }
+
+    fresh.k_count = i;
+
+    pthread_mutex_lock( &cache->c_lock );
+
+    for( slot = 0, victim = 0; slot < BOOK_CACHE_ENTRIES; slot++ )
+    {
+        cached = &cache->c_slots[ slot ];
+
+        if( cached->k_key != NULL && cached->k_hash == fresh.k_hash
+                && cached->k_size == fresh.k_size
+                && memcmp( cached->k_key, fresh.k_key, fresh.k_size ) == 0 )
+        {
+            victim = slot;
+            break;
+        }
+
+        if( cached->k_used < cache->c_slots[ victim ].k_used )
+        {
+            victim = slot;
+        }
+    }
+
+    cached = &cache->c_slots[ victim ];
+    cache_drop( cached );
+    *cached = fresh;
+    cached->k_used = ++cache->c_tick;
+
+    pthread_mutex_unlock( &cache->c_lock );
+
+    return 0;
+}
+
+void book_cache_appended( book_cache_t *cache, const book_t *book, entry_t *entry )
+{
+    book_cached_t *cached;
+    entry_t **entries;
+    unsigned long long used;
+    int slot;
+
+    pthread_mutex_lock( &cache->c_lock );
+
+    for( slot = 0; slot < BOOK_CACHE_ENTRIES; slot++ )
+    {
+        cached = &cache->c_slots[ slot ];
+
+        if( !cache_valid( cached, book, book->a_version - 1, ENTRY_FIELDS, 0 ) )
+        {
+            continue;
+        }
+
+        if( cache_match( cached->k_key, entry, &used ) )
+        {
+            if( cached->k_count >= BOOK_CACHE_ROWS || ( entries = realloc( cached->k_entries,
+                        ( cached->k_count + 2 ) * sizeof( entry_t* ) ) ) == NULL )
+            {
+                cache_drop( cached );
+                continue;
+            }
+
+            cached->k_entries = entries;
+            cached->k_entries[ cached->k_count++ ] = entry;
+        }
+
+        cached->k_version = book->a_version;
+    }
+
+    pthread_mutex_unlock( &cache->c_lock );
+}
+
+void book_cache_removed( book_cache_t *cache, const book_t *book, entry_t *entry )
+{
+    book_cached_t *cached;
+    unsigned long i;
+    int slot;
+
+    pthread_mutex_lock( &cache->c_lock );
+
+    for( slot = 0; slot < BOOK_CACHE_ENTRIES; slot++ )
+    {
+        cached = &cache->c_slots[ slot ];
+
+        if( !cache_valid( cached, book, book->a_version - 1, ENTRY_FIELDS, 0 ) )
+        {
+            continue;
+        }
+
+        if( ( i = cache_position( cached, entry ) ) < cached->k_count )
+        {
+            memmove( cached->k_entries + i, cached->k_entries + i + 1,
+                     ( cached->k_count - i - 1 ) * sizeof( entry_t* ) );
+            cached->k_count--;
+        }
+
+        cached->k_version = book->a_version;
+    }
+
+    pthread_mutex_unlock( &cache->c_lock );
+}
+
+void book_cache_edited( book_cache_t *cache, const book_t *book, entry_t *entry,
+                        entry_field_t field, unsigned long generation )
+{
+    book_cached_t *cached;
+    unsigned long long used;
+    unsigned long current;
+    int slot, held;
+
+    current = book_generation( book, field );
+
+    pthread_mutex_lock( &cache->c_lock );
+
+    for( slot = 0; slot < BOOK_CACHE_ENTRIES; slot++ )
+    {
+        cached = &cache->c_slots[ slot ];
+
+        if( !( cached->k_fields & ( 1U << field ) )
+                || !cache_valid( cached, book, book->a_version, field, generation ) )
+        {
+            continue;
+        }
+
+        held = cache_position( cached, entry ) < cached->k_count;
+
+        if( current - generation > 1 || held != cache_match( cached->k_key, entry, &used ) )
+        {
+            cache_drop( cached );
+            continue;
+        }
+
+        cached->k_generations[ field ] = current;
+    }
+
+    pthread_mutex_unlock( &cache->c_lock );
+}
+
+void book_cache_clear( book_cache_t *cache )
+{
+    int slot;
+
+    pthread_mutex_lock( &cache->c_lock );
+
+    for( slot = 0; slot < BOOK_CACHE_ENTRIES; slot++ )
+    {
+        cache_drop( &cache->c_slots[ slot ] );
+    }
+
+    pthread_mutex_unlock( &cache->c_lock );
+}
+
+void book_cache_destroy( book_cache_t *cache )
+{
+    book_cache_clear( cache );
+    pthread_mutex_destroy( &cache->c_lock );
+    free( cache );
+}
@@ -0,0 +1,1432 @@
+#include <book_file.h>
+#include <book_index.h>
+#include <lz.h>
+#include <crc32c.h>
+#include <pool.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define BOOK_RECORD_MIN     ( ENTRY_FIELDS * sizeof( unsigned long long ) )
+#define BOOK_RATIO_MAX      255
+#define BOOK_BLOCK_V1       ( sizeof( unsigned long long ) + 4 * sizeof( unsigned ) )
+#define BOOK_VERSION_PLAIN  2
+#define BOOK_SECTIONS_MAX   ( 2 * ENTRY_FIELDS + 2 )
+#define BOOK_SECTION_PARTS  3
+#define BOOK_ALIGN          8
+
+typedef struct
+{
+    entry_t **w_entries;
+    book_block_t *w_blocks;
+    unsigned long *w_first;
+    char **w_data;
+    int *w_status;
+} book_pack_t;
+
+typedef struct
+{
+    entry_t **r_entries;
+    book_block_t *r_blocks;
+    unsigned long *r_first;
+    char **r_data;
+    int *r_status;
+    int r_verify;
+} book_unpack_t;
+
+typedef struct
+{
+    const char *d_data;
+    unsigned long long *d_offsets;
+    unsigned long *d_first;
+    entry_t **d_entries;
+    int *d_status;
+} book_decode_t;
+
+typedef struct
+{
+    const char *h_filename;
+    book_t **h_books;
+    int *h_status;
+    int h_packed;
+} book_shards_t;
+
+static int verify = 1;
+static int lazy = 0;
+static int indexes = 0;
+
+static void book_pack_block( void *arg, unsigned part )
+{
+    book_pack_t *pack = arg;
+    book_block_t *block;
+    unsigned long long size, packed;
+    unsigned long i;
+    char *raw, *data;
+
+    block = &pack->w_blocks[ part ];
+
+    if( ( raw = malloc( block->b_size + 1 ) ) == NULL )
+    {
+        pack->w_status[ part ] = ENOMEM;
+        return;
+    }
+
+    for( i = 0, size = 0; i < block->b_count; i++ )
+    {
+        if( ( packed = entry_encode( raw + size,
+                                     pack->w_entries[ pack->w_first[ part ] + i ] ) ) == 0 )
+        {
+            free( raw );
+            pack->w_status[ part ] = EIO;
+
+            return;
+        }
+
+        size += packed;
+    }
+
+    if( ( data = malloc( lz_bound( size ) ) ) == NULL )
+    {
+        free( raw );
+        pack->w_status[ part ] = ENOMEM;
+
+        return;
+    }
+
+    if( ( packed = lz_compress( raw, size, data, size ) ) != 0 )
+    {
+        free( raw );
+        block->b_packed = ( unsigned )packed;
+        block->b_codec = BOOK_CODEC_LZ;
+        pack->w_data[ part ] = data;
+    }
+    else
+    {
+        free( data );
+        block->b_packed = ( unsigned )size;
+        block->b_codec = BOOK_CODEC_NONE;
+        pack->w_data[ part ] = raw;
+    }
+
+    block->b_crc = crc32c( 0, pack->w_data[ part ], block->b_packed );
+}
+
+static void book_unpack_block( void *arg, unsigned part )
+{
+    book_unpack_t *unpack = arg;
+    book_block_t *block;
+    unsigned long long offset, used;
+    unsigned long i;
+    entry_t **entries;
+    char *raw;
+
+    block = &unpack->r_blocks[ part ];
+    entries = unpack->r_entries + unpack->r_first[ part ];
+
+    if( unpack->r_verify
+            && crc32c( 0, unpack->r_data[ part ], block->b_packed ) != block->b_crc )
+    {
+        unpack->r_status[ part ] = EIO;
+        return;
+    }
+
+    if( block->b_codec == BOOK_CODEC_LZ )
+    {
+        if( ( raw = malloc( block->b_size + 1 ) ) == NULL )
+        {
+            unpack->r_status[ part ] = ENOMEM;
+            return;
+        }
+
+        if( lz_decompress( unpack->r_data[ part ], block->b_packed,
+                           raw, block->b_size ) == -1 )
+        {
+            free( raw );
+            unpack->r_status[ part ] = EIO;
+
+            return;
+        }
+    }
+    else
+    {
+        raw = unpack->r_data[ part ];
+    }
+
+    for( i = 0, offset = 0; i < block->b_count; i++ )
+    {
+        if( ( entries[ i ] = entry_decode( raw + offset, block->b_size - offset,
+                                           &used ) ) == NULL )
+        {
+            unpack->r_status[ part ] = errno;
+            break;
+        }
+
+        offset += used;
+    }
+
+    if( unpack->r_status[ part ] == 0 && offset != block->b_size )
+    {
+        unpack->r_status[ part ] = EIO;
+    }
+
+    if( raw != unpack->r_data[ part ] )
+    {
+        free( raw );
+    }
+}
+
+book_format_t book_file_format( FILE *file )
+{
+    char magic[ 4 ];
+    long position;
+    size_t count;
+
+    if( ( position = ftell( file ) ) == -1 )
+    {
+        return BOOK_FORMAT_LEGACY;
+    }
+
+    count = fread( magic, sizeof( char ), sizeof( magic ), file );
+    fseek( file, position, SEEK_SET );
+
+    if( count == sizeof( magic ) && memcmp( magic, BOOK_MAGIC, sizeof( magic ) ) == 0 )
+    {
+        return BOOK_FORMAT_PACKED;
+    }
+
+    if( count == sizeof( magic ) && memcmp( magic, BOOK_SHARDS_MAGIC, sizeof( magic ) ) == 0 )
+    {
+        return BOOK_FORMAT_SHARDED;
+    }
+
+    return BOOK_FORMAT_LEGACY;
+}
+
+void book_set_verify( int value )
+{
+    verify = value;
+}
+
+void book_set_lazy( int value )
+{
+    lazy = value;
+}
+
+int book_get_lazy( void )
+{
+    return lazy;
+}
+
+void book_set_indexes( int value )
+{
+    indexes = value;
+}
+
+static unsigned book_index_sections( book_t *book, book_section_t *sections,
+                                     const void *parts[ ][ BOOK_SECTION_PARTS ],
+                                     unsigned long long lengths[ ][ BOOK_SECTION_PARTS ] )
+{
+    const hash_index_t *hash;
+    const order_index_t *order;
+    const range_index_t *range;
+    const bloom_filter_t *bloom;
+    unsigned count;
+    int field, kinds;
+
+    memset( sections, 0, BOOK_SECTIONS_MAX * sizeof( book_section_t ) );
+    memset( lengths, 0, BOOK_SECTIONS_MAX * sizeof( lengths[ 0 ] ) );
+
+    for( field = 0, count = 0; field < ENTRY_FIELDS; field++ )
+    {
+        kinds = book_index_kinds( ( entry_field_t )field );
+
+        if( ( kinds & INDEX_HASH )
+                && ( hash = book_index_hash( book, ( entry_field_t )field ) ) != NULL )
+        {
+            sections[ count ].s_kind = INDEX_HASH;
+            sections[ count ].s_field = field;
+            sections[ count ].s_count = hash->h_groups;
+            sections[ count ].s_mask = hash->h_mask;
+            parts[ count ][ 0 ] = hash->h_slots;
+            lengths[ count ][ 0 ] = ( hash->h_mask + 1ULL ) * sizeof( unsigned long );
+            parts[ count ][ 1 ] = hash->h_starts;
+            lengths[ count ][ 1 ] = ( hash->h_groups + 1ULL ) * sizeof( unsigned long );
+            parts[ count ][ 2 ] = hash->h_postings;
+            lengths[ count ][ 2 ] = book->a_count * sizeof( unsigned long );
+            count++;
+        }
+
+        if( ( kinds & INDEX_ORDER )
+                && ( order = book_index_order( book, ( entry_field_t )field ) ) != NULL )
+        {
+            sections[ count ].s_kind = INDEX_ORDER;
+            sections[ count ].s_field = field;
+            sections[ count ].s_count = order->o_count;
+            parts[ count ][ 0 ] = order->o_rows;
+            lengths[ count ][ 0 ] = order->o_count * sizeof( unsigned long );
+            count++;
+        }
+
+        if( ( kinds & INDEX_RANGE )
+                && ( range = book_index_range( book, ( entry_field_t )field ) ) != NULL )
+        {
+            sections[ count ].s_kind = INDEX_RANGE;
+            sections[ count ].s_field = field;
+            sections[ count ].s_count = range->r_count;
+            parts[ count ][ 0 ] = range->r_keys;
+            lengths[ count ][ 0 ] = range->r_count * sizeof( range_key_t );
+            count++;
+        }
+
+        if( ( kinds & INDEX_BLOOM )
+                && ( bloom = book_index_bloom( book, ( entry_field_t )field ) ) != NULL )
+        {
+            sections[ count ].s_kind = INDEX_BLOOM;
+            sections[ count ].s_field = field;
+            sections[ count ].s_count = bloom->b_values;
+            sections[ count ].s_mask = bloom->b_mask;
+            parts[ count ][ 0 ] = bloom->b_words;
+            lengths[ count ][ 0 ] = ( bloom->b_mask + 1ULL ) * BLOOM_WORDS
+                                  * sizeof( unsigned long long );
+            count++;
+        }
+    }
+
+    return count;
+}
+
+static int book_write_indexes( FILE *file, book_t *book, unsigned long long position,
+                               unsigned fingerprint )
+{
+    static const char zeros[ BOOK_ALIGN ];
+    book_indexes_t directory;
+    book_section_t sections[ BOOK_SECTIONS_MAX ];
+    const void *parts[ BOOK_SECTIONS_MAX ][ BOOK_SECTION_PARTS ];
+    unsigned long long lengths[ BOOK_SECTIONS_MAX ][ BOOK_SECTION_PARTS ], size, offset;
+    unsigned count, crc, i, j;
+
+    count = book_index_sections( book, sections, parts, lengths );
+
+    for( i = 0, offset = 0; i < count; i++ )
+    {
+        for( j = 0, size = 0, crc = 0; j < BOOK_SECTION_PARTS; j++ )
+        {
+            crc = crc32c( crc, parts[ i ][ j ], lengths[ i ][ j ] );
+            size += lengths[ i ][ j ];
+        }
+
+        sections[ i ].s_offset = offset;
+        sections[ i ].s_size = ( size + BOOK_ALIGN - 1 ) / BOOK_ALIGN * BOOK_ALIGN;
+        sections[ i ].s_crc = crc32c( crc, zeros, sections[ i ].s_size - size );
+        offset += sections[ i ].s_size;
+    }
+
+    position += sizeof( book_indexes_t ) + count * sizeof( book_section_t ) + sizeof( crc );
+
+    memset( &directory, 0, sizeof( book_indexes_t ) );
+    memcpy( directory.x_magic, BOOK_INDEXES_MAGIC, sizeof( directory.x_magic ) );
+    directory.x_sections = count;
+    directory.x_word = sizeof( unsigned long );
+    directory.x_blocks = fingerprint;
+    directory.x_padding = ( unsigned )( ( BOOK_ALIGN - position % BOOK_ALIGN ) % BOOK_ALIGN );
+    directory.x_rows = book->a_count;
+    directory.x_size = offset;
+
+    crc = crc32c( 0, &directory, sizeof( book_indexes_t ) );
+    crc = crc32c( crc, sections, count * sizeof( book_section_t ) );
+
+    if( fwrite( &directory, sizeof( book_indexes_t ), 1, file ) != 1
+            || fwrite( sections, sizeof( book_section_t ), count, file ) != count
+            || fwrite( &crc, sizeof( crc ), 1, file ) != 1
+            || fwrite( zeros, sizeof( char ), directory.x_padding, file ) != directory.x_padding )
+    {
+        errno = EIO;
+        return -1;
+    }
+
+    for( i = 0; i < count; i++ )
+    {
+        for( j = 0, size = 0; j < BOOK_SECTION_PARTS; j++ )
+        {
+            if( fwrite( parts[ i ][ j ], sizeof( char ), lengths[ i ][ j ], file )
+                    != lengths[ i ][ j ] )
+            {
+                errno = EIO;
+                return -1;
+            }
+
+            size += lengths[ i ][ j ];
+        }
+
+        if( fwrite( zeros, sizeof( char ), sections[ i ].s_size - size, file )
+                != sections[ i ].s_size - size )
+        {
+            errno = EIO;
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static void book_adopt_section( book_t *book, const book_section_t *section, char *data )
+{
+    unsigned long long words, mask, groups, rows;
+    unsigned long *array;
+
+    words = section->s_size / sizeof( unsigned long );
+    array = ( unsigned long* )( data + section->s_offset );
+    mask = section->s_mask;
+    groups = section->s_count;
+    rows = book->a_count;
+
+    if( ( verify && crc32c( 0, array, section->s_size ) != section->s_crc )
+            || section->s_field >= ENTRY_FIELDS )
+    {
+        return;
+    }
+
+    switch( section->s_kind )
+    {
+        case INDEX_HASH:
+            if( mask < words && groups < words - mask - 1
+                    && rows <= words - mask - 1 - groups - 1 )
+            {
+                book_index_adopt_hash( book, ( entry_field_t )section->s_field, array,
+                                       ( unsigned long )mask, array + mask + 1,
+                                       ( unsigned long )groups, array + mask + 1 + groups + 1 );
+            }
+            break;
+        case INDEX_ORDER:
+            if( groups <= words )
+            {
+                book_index_adopt_order( book, ( entry_field_t )section->s_field, array,
+                                        ( unsigned long )groups );
+            }
+            break;
+        case INDEX_RANGE:
+            if( groups <= section->s_size / sizeof( range_key_t ) )
+            {
+                book_index_adopt_range( book, ( entry_field_t )section->s_field,
+                                        ( range_key_t* )array, ( unsigned long )groups );
+            }
+            break;
+        case INDEX_BLOOM:
+            if( mask < section->s_size / ( BLOOM_WORDS * sizeof( unsigned long long ) ) )
+            {
+                book_index_adopt_bloom( book, ( entry_field_t )section->s_field,
+                                        ( unsigned long long* )array, ( unsigned long )mask,
+                                        ( unsigned long )groups );
+            }
+            break;
+    }
+}
+
+static void book_read_indexes( FILE *file, book_t *book, unsigned fingerprint )
+{
+    book_indexes_t directory;
+    book_section_t sections[ BOOK_SECTIONS_MAX ];
+    struct stat status;
+    unsigned long long start, offset, length;
+    unsigned crc, i;
+    char *region;
+    long position, page;
+    int mapped;
+
+    if( fread( &directory, sizeof( book_indexes_t ), 1, file ) != 1
+            || memcmp( directory.x_magic, BOOK_INDEXES_MAGIC, sizeof( directory.x_magic ) ) != 0
+            || directory.x_sections > BOOK_SECTIONS_MAX
+            || directory.x_word != sizeof( unsigned long )
+            || directory.x_blocks != fingerprint || directory.x_rows != book->a_count
+            || directory.x_padding >= BOOK_ALIGN
+            || fread( sections, sizeof( book_section_t ), directory.x_sections,
+                      file ) != directory.x_sections
+            || fread( &crc, sizeof( crc ), 1, file ) != 1
+            || ( verify && crc != crc32c( crc32c( 0, &directory, sizeof( book_indexes_t ) ),
+                                          sections,
+                                          directory.x_sections * sizeof( book_section_t ) ) )
+            || ( position = ftell( file ) ) == -1 || fstat( fileno( file ), &status ) == -1 )
+    {
+        return;
+    }
+
+    start = ( unsigned long long )position + directory.x_padding;
+
+    if( start > ( unsigned long long )status.st_size
+            || directory.x_size > ( unsigned long long )status.st_size - start )
+    {
+        return;
+    }
+
+    for( i = 0; i < directory.x_sections; i++ )
+    {
+        if( sections[ i ].s_offset > directory.x_size
+                || sections[ i ].s_size > directory.x_size - sections[ i ].s_offset
+                || sections[ i ].s_offset % BOOK_ALIGN != 0 )
+        {
+            return;
+        }
+    }
+
+    page = sysconf( _SC_PAGESIZE );
+    offset = page > 0 ? start - start % ( unsigned long long )page : start;
+    length = start - offset + directory.x_size;
+    region = MAP_FAILED;
+
+    if( start % BOOK_ALIGN == 0 && directory.x_size > 0 )
+    {
+        region = mmap( NULL, length, PROT_READ, MAP_PRIVATE, fileno( file ), ( off_t )offset );
+    }
+
+    if( ( mapped = region != MAP_FAILED ) == 0 )
+    {
+        offset = start;
+        length = directory.x_size;
+
+        if( ( region = malloc( length + 1 ) ) == NULL )
+        {
+            return;
+        }
+
+        if( fseek( file, ( long )start, SEEK_SET ) == -1
+                || fread( region, sizeof( char ), length, file ) != length )
+        {
+            free( region );
+            return;
+        }
+    }
+
+    if( book_index_attach( book, region, length, mapped ) == -1 )
+    {
+        if( mapped )
+        {
+            munmap( region, length );
+        }
+        else
+        {
+            free( region );
+        }
+
+        return;
+    }
+
+    for( i = 0; i < directory.x_sections; i++ )
+    {
+        book_adopt_section( book, &sections[ i ], region + ( start - offset ) );
+    }
+}
+
+int book_write_packed( FILE *file, book_t *book )
+{
+    book_header_t header;
+    book_pack_t pack;
+    entry_node_t *it;
+    unsigned long long size, offset;
+    unsigned long row;
+    unsigned blocks, crc, i;
+    long base;
+    int status, indexed;
+
+    base = ftell( file );
+    memset( &pack, 0, sizeof( book_pack_t ) );
+    pack.w_entries = malloc( ( book->a_count + 1 ) * sizeof( entry_t* ) );
+    pack.w_blocks = calloc( book->a_count + 1, sizeof( book_block_t ) );
+    pack.w_first = malloc( ( book->a_count + 1 ) * sizeof( unsigned long ) );
+
+    if( pack.w_entries == NULL || pack.w_blocks == NULL || pack.w_first == NULL )
+    {
+        free( pack.w_entries );
+        free( pack.w_blocks );
+        free( pack.w_first );
+        errno = ENOMEM;
+
+        return -1;
+    }
+
+    blocks = 0;
+
+    for( it = book->a_head, row = 0; it != NULL; it = it->n_next, row++ )
+    {
+        pack.w_entries[ row ] = it->n_entry;
+        size = entry_encode( NULL, it->n_entry );
+
+        if( blocks == 0 || pack.w_blocks[ blocks - 1 ].b_size >= BOOK_BLOCK_SIZE
+                || pack.w_blocks[ blocks - 1 ].b_size + size > 0xFFFFFFFFULL )
+        {
+            pack.w_first[ blocks ] = row;
+            blocks++;
+        }
+
+        pack.w_blocks[ blocks - 1 ].b_size += ( unsigned )size;
+        pack.w_blocks[ blocks - 1 ].b_count++;
+    }
+
+    pack.w_data = calloc( blocks + 1, sizeof( char* ) );
+    pack.w_status = calloc( blocks + 1, sizeof( int ) );
+
+    status = pack.w_data == NULL || pack.w_status == NULL ? ENOMEM : 0;
+
+    if( status == 0 )
+    {
+        pool_run( pool_shared( ), blocks, book_pack_block, &pack );
+
+        for( i = 0; i < blocks && status == 0; i++ )
+        {
+            status = pack.w_status[ i ];
+        }
+    }
+
+    if( status == 0 )
+    {
+        indexed = indexes && row > 0 && book_index_warm( book ) == 0;
+
+        memcpy( header.f_magic, BOOK_MAGIC, sizeof( header.f_magic ) );
+        header.f_version = indexed ? BOOK_FILE_VERSION : BOOK_VERSION_PLAIN;
+        header.f_blocks = blocks;
+        header.f_flags = indexed ? BOOK_FLAG_INDEXES : 0;
+        header.f_count = row;
+
+        for( i = 0, offset = 0; i < blocks; i++ )
+        {
+            pack.w_blocks[ i ].b_offset = offset;
+            offset += pack.w_blocks[ i ].b_packed;
+        }
+
+        crc = crc32c( 0, &header, sizeof( header ) );
+        crc = crc32c( crc, pack.w_blocks, blocks * sizeof( book_block_t ) );
+
+        if( fwrite( &header, sizeof( header ), 1, file ) != 1
+                || fwrite( pack.w_blocks, sizeof( book_block_t ), blocks, file ) != blocks
+                || fwrite( &crc, sizeof( crc ), 1, file ) != 1 )
+        {
+            status = EIO;
+        }
+
+        for( i = 0; i < blocks && status == 0; i++ )
+        {
+            if( fwrite( pack.w_data[ i ], sizeof( char ), pack.w_blocks[ i ].b_packed,
+                        file ) != pack.w_blocks[ i ].b_packed )
+            {
+                status = EIO;
+            }
+        }
+
+        if( status == 0 && indexed
+                && book_write_indexes( file, book, ( base > 0 ? base : 0 ) + sizeof( header )
+                                       + blocks * sizeof( book_block_t ) + sizeof( crc ) + offset,
+                                       crc32c( 0, pack.w_blocks,
+                                               blocks * sizeof( book_block_t ) ) ) == -1 )
+        {
+            status = EIO;
+        }
+
+        if( status == 0 && fflush( file ) == EOF )
+        {
+            status = EIO;
+        }
+    }
+
+    for( i = 0; pack.w_data != NULL && i < blocks; i++ )
+    {
+        free( pack.w_data[ i ] );
+    }
+
+    free( pack.w_entries );
+    free( pack.w_blocks );
+    free( pack.w_first );
+    free( pack.w_data );
+    free( pack.w_status );
+
+    if( status != 0 )
+    {
+        errno = status;
+        return -1;
+    }
+
+    return 0;
+}
+
+book_t *book_read_packed( FILE *file )
+{
+    book_header_t header;
+    book_unpack_t unpack;
+    book_block_t *block, *blocks;
+    book_t *book;
+    unsigned long long offset, count;
+    unsigned long row;
+    unsigned i, capacity, crc;
+    int status;
+
+    if( fread( &header, sizeof( header ), 1, file ) != 1
+            || memcmp( header.f_magic, BOOK_MAGIC, sizeof( header.f_magic ) ) != 0
+            || header.f_version < 1 || header.f_version > BOOK_FILE_VERSION )
+    {
+        errno = EIO;
+        return NULL;
+    }
+
+    memset( &unpack, 0, sizeof( book_unpack_t ) );
+    unpack.r_verify = verify && header.f_version >= 2;
+    status = 0;
+
+    for( i = 0, capacity = 0; i < header.f_blocks && status == 0; i++ )
+    {
+        if( i == capacity )
+        {
+            capacity = capacity == 0 ? 64 : 2 * capacity;
+
+            if( ( blocks = realloc( unpack.r_blocks,
+                                    capacity * sizeof( book_block_t ) ) ) == NULL )
+            {
+                status = ENOMEM;
+                break;
+            }
+
+            unpack.r_blocks = blocks;
+        }
+
+        memset( &unpack.r_blocks[ i ], 0, sizeof( book_block_t ) );
+
+        if( fread( &unpack.r_blocks[ i ], header.f_version >= 2 ? sizeof( book_block_t )
+                                                               : BOOK_BLOCK_V1,
+                   1, file ) != 1 )
+        {
+            status = EIO;
+        }
+    }
+
+    if( status == 0 && header.f_version >= 2 )
+    {
+        if( fread( &crc, sizeof( crc ), 1, file ) != 1 )
+        {
+            status = EIO;
+        }
+        else if( unpack.r_verify
+                && crc != crc32c( crc32c( 0, &header, sizeof( header ) ), unpack.r_blocks,
+                                  header.f_blocks * sizeof( book_block_t ) ) )
+        {
+            status = EIO;
+        }
+    }
+
+    for( i = 0, offset = 0, count = 0; i < header.f_blocks && status == 0; i++ )
+    {
+        block = &unpack.r_blocks[ i ];
+
+        if( block->b_offset != offset || block->b_count == 0
+                || block->b_count > block->b_size / BOOK_RECORD_MIN
+                || ( block->b_codec == BOOK_CODEC_NONE && block->b_packed != block->b_size )
+                || ( block->b_codec == BOOK_CODEC_LZ
+                     && block->b_size > ( unsigned long long )block->b_packed * BOOK_RATIO_MAX + 16 )
+                || block->b_codec > BOOK_CODEC_LZ )
+        {
+            status = EIO;
+        }
+
+        offset += block->b_packed;
+        count += block->b_count;
+    }
+
+    if( status == 0 && count != header.f_count )
+    {
+        status = EIO;
+    }
+
+    if( status == 0 )
+    {
+        unpack.r_first = malloc( ( header.f_blocks + 1ULL ) * sizeof( unsigned long ) );
+        unpack.r_data = calloc( header.f_blocks + 1ULL, sizeof( char* ) );
+        unpack.r_status = calloc( header.f_blocks + 1ULL, sizeof( int ) );
+
+        if( unpack.r_first == NULL || unpack.r_data == NULL || unpack.r_status == NULL )
+        {
+            status = ENOMEM;
+        }
+    }
+
+    for( i = 0, row = 0; i < header.f_blocks && status == 0; i++ )
+    {
+        block = &unpack.r_blocks[ i ];
+        unpack.r_first[ i ] = row;
+        row += block->b_count;
+
+        if( ( unpack.r_data[ i ] = malloc( block->b_packed + 1ULL ) ) == NULL )
+        {
+            status = ENOMEM;
+        }
+        else if( fread( unpack.r_data[ i ], sizeof( char ), block->b_packed,
+                        file ) != block->b_packed )
+        {
+            status = EIO;
+        }
+    }
+
+    if( status == 0 && ( unpack.r_entries = calloc( count + 1, sizeof( entry_t* ) ) ) == NULL )
+    {
+        status = ENOMEM;
+    }
+
+    if( status == 0 )
+    {
+        pool_run( pool_shared( ), header.f_blocks, book_unpack_block, &unpack );
+
+        for( i = 0; i < header.f_blocks && status == 0; i++ )
+        {
+            status = unpack.r_status[ i ];
+        }
+    }
+
+    book = NULL;
+
+    if( status == 0 && ( book = book_create( ) ) == NULL )
+    {
+        status = ENOMEM;
+    }
+
+    for( row = 0; status == 0 && row < count; row++ )
+    {
+        if( book_append( book, unpack.r_entries[ row ] ) == -1 )
+        {
+            status = ENOMEM;
+            break;
+        }
+
+        unpack.r_entries[ row ] = NULL;
+    }
+
+    if( status == 0 && header.f_version >= 3 && ( header.f_flags & BOOK_FLAG_INDEXES ) )
+    {
+        book_read_indexes( file, book, crc32c( 0, unpack.r_blocks,
+                                               header.f_blocks * sizeof( book_block_t ) ) );
+    }
+
+    if( status != 0 && book != NULL )
+    {
+        book_destroy( book, 1 );
+        book = NULL;
+    }
+
+    for( row = 0; unpack.r_entries != NULL && row < count; row++ )
+    {
+        if( unpack.r_entries[ row ] != NULL )
+        {
+            entry_destroy( unpack.r_entries[ row ] );
+        }
+    }
+
+    for( i = 0; unpack.r_data != NULL && i < header.f_blocks; i++ )
+    {
+        free( unpack.r_data[ i ] );
+    }
+
+    free( unpack.r_entries );
+    free( unpack.r_blocks );
+    free( unpack.r_first );
+    free( unpack.r_data );
+    free( unpack.r_status );
+
+    if( status != 0 )
+    {
+        errno = status;
+        return NULL;
+    }
+
+    return book;
+}
+
+static void book_decode_part( void *arg, unsigned part )
+{
+    book_decode_t *decode = arg;
+    unsigned long long offset, used;
+    unsigned long row;
+
+    offset = decode->d_offsets[ part ];
+
+    for( row = decode->d_first[ part ]; row < decode->d_first[ part + 1 ]; row++ )
+    {
+        if( ( decode->d_entries[ row ] = entry_decode( decode->d_data + offset,
+                                                       decode->d_offsets[ part + 1 ] - offset,
+                                                       &used ) ) == NULL )
+        {
+            decode->d_status[ part ] = errno;
+            return;
+        }
+
+        offset += used;
+    }
+}
+
+book_t *book_read_parallel( FILE *file, unsigned count )
+{
+    book_decode_t decode;
+    book_t *book;
+    char *data;
+    unsigned long long size, offset, length;
+    unsigned long row;
+    unsigned parts, i;
+    long start, end;
+    int field, status;
+
+    if( ( start = ftell( file ) ) == -1 || fseek( file, 0, SEEK_END ) == -1
+            || ( end = ftell( file ) ) == -1 || fseek( file, start, SEEK_SET ) == -1 )
+    {
+        errno = ESPIPE;
+        return NULL;
+    }
+
+    size = ( unsigned long long )( end - start );
+
+    if( size < ( unsigned long long )count * BOOK_RECORD_MIN )
+    {
+        errno = EIO;
+        return NULL;
+    }
+
+    if( ( data = malloc( size + 1 ) ) == NULL )
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    if( fread( data, sizeof( char ), size, file ) != size )
+    {
+        free( data );
+        errno = EIO;
+
+        return NULL;
+    }
+
+    memset( &decode, 0, sizeof( book_decode_t ) );
+    parts = ( count + BOOK_DECODE_ROWS - 1 ) / BOOK_DECODE_ROWS;
+    decode.d_data = data;
+    decode.d_offsets = malloc( ( parts + 1 ) * sizeof( unsigned long long ) );
+    decode.d_first = malloc( ( parts + 1 ) * sizeof( unsigned long ) );
+    decode.d_entries = calloc( count + 1, sizeof( entry_t* ) );
+    decode.d_status = calloc( parts + 1, sizeof( int ) );
+    status = 0;
+
+    if( decode.d_offsets == NULL || decode.d_first == NULL || decode.d_entries == NULL
+            || decode.d_status == NULL )
+    {
+        status = ENOMEM;
+    }
+
+    for( row = 0, offset = 0; row < count && status == 0; row++ )
+    {
+        if( row % BOOK_DECODE_ROWS == 0 )
+        {
+            decode.d_offsets[ row / BOOK_DECODE_ROWS ] = offset;
+            decode.d_first[ row / BOOK_DECODE_ROWS ] = row;
+        }
+
+        for( field = 0; field < ENTRY_FIELDS && status == 0; field++ )
+        {
+            if( size - offset < sizeof( length ) )
+            {
+                status = EIO;
+                break;
+            }
+
+            memcpy( &length, data + offset, sizeof( length ) );
+            offset += sizeof( length );
+
+            if( length > size - offset )
+            {
+                status = EIO;
+                break;
+            }
+
+            offset += length;
+        }
+    }
+
+    if( status == 0 )
+    {
+        decode.d_offsets[ parts ] = offset;
+        decode.d_first[ parts ] = count;
+
+        pool_run( pool_shared( ), parts, book_decode_part, &decode );
+
+        for( i = 0; i < parts && status == 0; i++ )
+        {
+            status = decode.d_status[ i ];
+        }
+    }
+
+    book = NULL;
+
+    if( status == 0 && ( book = book_create( ) ) == NULL )
+    {
+        status = ENOMEM;
+    }
+
+    for( row = 0; status == 0 && row < count; row++ )
+    {
+        if( book_append( book, decode.d_entries[ row ] ) == -1 )
+        {
+            status = ENOMEM;
+        }
+        else
+        {
+            decode.d_entries[ row ] = NULL;
+        }
+    }
+
+    if( status != 0 && book != NULL )
+    {
+        book_destroy( book, 1 );
+    }
+
+    for( row = 0; decode.d_entries != NULL && row < count; row++ )
+    {
+        if( decode.d_entries[ row ] != NULL )
+        {
+            entry_destroy( decode.d_entries[ row ] );
+        }
+    }
+
+    if( status == 0 )
+    {
+        fseek( file, start + ( long )offset, SEEK_SET );
+    }
+
+    free( data );
+    free( decode.d_offsets );
+    free( decode.d_first );
+    free( decode.d_entries );
+    free( decode.d_status );
+
+    if( status != 0 )
+    {
+        errno = status;
+        return NULL;
+    }
+
+    return book;
+}
+
+book_t *book_load( const char *filename, int *packed )
+{
+    book_t *book, **shards;
+    book_format_t format;
+    unsigned count, i;
+    entry_node_t *it;
+    FILE *file;
+
+    if( packed != NULL )
+    {
+        *packed = 0;
+    }
+
+    if( ( file = fopen( filename, "r" ) ) == NULL )
+    {
+        return errno == ENOENT ? book_create( ) : NULL;
+    }
+
+    if( ( format = book_file_format( file ) ) != BOOK_FORMAT_SHARDED )
+    {
+        if( packed != NULL )
+        {
+            *packed = format == BOOK_FORMAT_PACKED;
+        }
+
+        book = book_read( file );
+        fclose( file );
+
+        return book;
+    }
+
+    fclose( file );
+
+    if( ( shards = book_load_shards( filename, &count, packed ) ) == NULL )
+    {
+        return NULL;
+    }
+
+    book = book_create( );
+
+    for( i = 0; i < count && book != NULL; i++ )
+    {
+        for( it = shards[ i ]->a_head; it != NULL && book != NULL; it = it->n_next )
+        {
+            if( book_append( book, it->n_entry ) == -1 )
+            {
+                book_destroy( book, 0 );
+                book = NULL;
+            }
+        }
+    }
+
+    for( i = 0; i < count; i++ )
+    {
+        book_destroy( shards[ i ], book == NULL );
+    }
+
+    free( shards );
+
+    if( book == NULL )
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    return book;
+}
+
+static char *book_temp_name( const char *filename )
+{
+    char *name;
+
+    if( ( name = malloc( strlen( filename ) + 5 ) ) == NULL )
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    sprintf( name, "%s.tmp", filename );
+
+    return name;
+}
+
+static int book_replace( const char *filename, char *name, int status )
+{
+    if( status == 0 && rename( name, filename ) == -1 )
+    {
+        status = -1;
+    }
+
+    if( status == -1 )
+    {
+        status = errno;
+        remove( name );
+        errno = status;
+        status = -1;
+    }
+
+    free( name );
+
+    return status;
+}
+
+int book_save( const char *filename, book_t *book, int packed )
+{
+    FILE *file;
+    char *name;
+    int status;
+
+    if( ( name = book_temp_name( filename ) ) == NULL )
+    {
+        return -1;
+    }
+
+    if( ( file = fopen( name, "w+" ) ) == NULL )
+    {
+        free( name );
+        return -1;
+    }
+
+    if( packed )
+    {
+        status = book_write_packed( file, book );
+    }
+    else if( ( status = book_write( file, book ) ) == 0 && fflush( file ) == EOF )
+    {
+        errno = EIO;
+        status = -1;
+    }
+
+    if( fclose( file ) == EOF && status == 0 )
+    {
+        errno = EIO;
+        status = -1;
+    }
+
+    return book_replace( filename, name, status );
+}
+
+static char *book_shard_name( const char *filename, unsigned shard )
+{
+    char *name;
+
+    if( ( name = malloc( strlen( filename ) + 16 ) ) == NULL )
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    sprintf( name, "%s.%u", filename, shard );
+
+    return name;
+}
+
+static void book_load_shard( void *arg, unsigned part )
+{
+    book_shards_t *load = arg;
+    FILE *file;
+    char *name;
+
+    if( ( name = book_shard_name( load->h_filename, part ) ) == NULL )
+    {
+        load->h_status[ part ] = ENOMEM;
+        return;
+    }
+
+    if( ( file = fopen( name, "r" ) ) == NULL )
+    {
+        load->h_status[ part ] = errno == ENOENT ? EIO : errno;
+    }
+    else
+    {
+        if( book_file_format( file ) != ( load->h_packed ? BOOK_FORMAT_PACKED
+                                                         : BOOK_FORMAT_LEGACY ) )
+        {
+            load->h_status[ part ] = EIO;
+        }
+        else if( ( load->h_books[ part ] = book_read( file ) ) == NULL )
+        {
+            load->h_status[ part ] = errno;
+        }
+
+        fclose( file );
+    }
+
+    free( name );
+}
+
+static void book_save_shard( void *arg, unsigned part )
+{
+    book_shards_t *save = arg;
+    char *name;
+
+    if( ( name = book_shard_name( save->h_filename, part ) ) == NULL )
+    {
+        save->h_status[ part ] = ENOMEM;
+        return;
+    }
+
+    if( book_save( name, save->h_books[ part ], save->h_packed ) == -1 )
+    {
+        save->h_status[ part ] = errno;
+    }
+
+    free( name );
+}
+
+static int book_read_manifest( FILE *file, book_manifest_t *manifest )
+{
+    if( fread( manifest, sizeof( book_manifest_t ), 1, file ) != 1
+            || memcmp( manifest->m_magic, BOOK_SHARDS_MAGIC, sizeof( manifest->m_magic ) ) != 0
+            || manifest->m_version != BOOK_SHARDS_VERSION
+            || manifest->m_shards == 0 || manifest->m_shards > BOOK_SHARDS_MAX
+            || ( verify && crc32c( 0, manifest, sizeof( book_manifest_t ) - sizeof( unsigned ) )
+                           != manifest->m_crc ) )
+    {
+        errno = EIO;
+        return -1;
+    }
+
+    return 0;
+}
+
+book_t **book_load_shards( const char *filename, unsigned *count, int *packed )
+{
+    book_manifest_t manifest;
+    book_shards_t load;
+    book_format_t format;
+    FILE *file;
+    unsigned i;
+    int status;
+
+    if( packed != NULL )
+    {
+        *packed = 0;
+    }
+
+    if( ( load.h_books = calloc( 1, sizeof( book_t* ) ) ) == NULL )
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    if( ( file = fopen( filename, "r" ) ) == NULL )
+    {
+        if( errno != ENOENT || ( load.h_books[ 0 ] = book_create( ) ) == NULL )
+        {
+            free( load.h_books );
+            return NULL;
+        }
+
+        *count = 1;
+
+        return load.h_books;
+    }
+
+    if( ( format = book_file_format( file ) ) != BOOK_FORMAT_SHARDED )
+    {
+        if( packed != NULL )
+        {
+            *packed = format == BOOK_FORMAT_PACKED;
+        }
+
+        load.h_books[ 0 ] = book_read( file );
+        fclose( file );
+
+        if( load.h_books[ 0 ] == NULL )
+        {
+            free( load.h_books );
+            return NULL;
+        }
+
+        *count = 1;
+
+        return load.h_books;
+    }
+
+    free( load.h_books );
+    status = book_read_manifest( file, &manifest );
+    fclose( file );
+
+    if( status == -1 )
+    {
+        return NULL;
+    }
+
+    load.h_filename = filename;
+    load.h_packed = manifest.m_packed != 0;
+    load.h_books = calloc( manifest.m_shards, sizeof( book_t* ) );
+    load.h_status = calloc( manifest.m_shards, sizeof( int ) );
+
+    if( load.h_books == NULL || load.h_status == NULL )
+    {
+        free( load.h_books );
+        free( load.h_status );
+        errno = ENOMEM;
+
+        return NULL;
+    }
+
+    pool_run( pool_shared( ), manifest.m_shards, book_load_shard, &load );
+
+    for( i = 0, status = 0; i < manifest.m_shards; i++ )
+    {
+        if( load.h_status[ i ] != 0 && status == 0 )
+        {
+            status = load.h_status[ i ];
+        }
+    }
+
+    free( load.h_status );
+
+    if( status != 0 )
+    {
+        for( i = 0; i < manifest.m_shards; i++ )
+        {
+            if( load.h_books[ i ] != NULL )
+            {
+                book_destroy( load.h_books[ i ], 1 );
+            }
+        }
+
+        free( load.h_books );
+        errno = status;
+
+        return NULL;
+    }
+
+    if( packed != NULL )
+    {
+        *packed = load.h_packed;
+    }
+
+    *count = manifest.m_shards;
+
+    return load.h_books;
+}
+
+int book_save_shards( const char *filename, book_t **shards, unsigned count, int packed )
+{
+    book_manifest_t manifest;
+    book_shards_t save;
+    FILE *file;
+    char *name;
+    unsigned i;
+    int status;
+
+    if( count == 0 || count > BOOK_SHARDS_MAX )
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if( ( save.h_status = calloc( count, sizeof( int ) ) ) == NULL )
+    {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    save.h_filename = filename;
+    save.h_books = shards;
+    save.h_packed = packed;
+
+    pool_run( pool_shared( ), count, book_save_shard, &save );
+
+    for( i = 0, status = 0; i < count; i++ )
+    {
+        if( save.h_status[ i ] != 0 && status == 0 )
+        {
+            status = save.h_status[ i ];
+        }
+    }
+
+    free( save.h_status );
+
+    if( status != 0 )
+    {
+        errno = status;
+        return -1;
+    }
+
+    memset( &manifest, 0, sizeof( book_manifest_t ) );
+    memcpy( manifest.m_magic, BOOK_SHARDS_MAGIC, sizeof( manifest.m_magic ) );
+    manifest.m_version = BOOK_SHARDS_VERSION;
+    manifest.m_shards = count;
+    manifest.m_packed = packed != 0;
+    manifest.m_crc = crc32c( 0, &manifest, sizeof( book_manifest_t ) - sizeof( unsigned ) );
+
+    if( ( name = book_temp_name( filename ) ) == NULL )
+    {
+        return -1;
+    }
+
+    if( ( file = fopen( name, "w" ) ) == NULL )
+    {
+        free( name );
+        return -1;
+    }
+
+    status = fwrite( &manifest, sizeof( book_manifest_t ), 1, file ) == 1 ? 0 : -1;
+
+    if( fclose( file ) == EOF || status == -1 )
+    {
+        errno = EIO;
+        status = -1;
+    }
+
+    if( book_replace( filename, name, status ) == -1 )
+    {
+        return -1;
+    }
+
+    for( i = count; ( name = book_shard_name( filename, i ) ) != NULL; i++ )
+    {
+        status = unlink( name );
+        free( name );
+
+        if( status == -1 )
+        {
+            break;
+        }
+    }
+
+    return 0;
+}
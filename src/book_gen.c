@@ -0,0 +1,488 @@
+#include <math.h>
+#include <book_gen.h>
+#include <pool.h>
+
+#define GEN_SCRATCH     ( 2 * BOOK_GEN_LENGTH )
+
+typedef struct
+{
+    const book_gen_t *w_gen;
+    unsigned long long w_base;
+    unsigned long long w_count;
+    char **w_data;
+    unsigned long long *w_size;
+    unsigned long long *w_capacity;
+    int *w_status;
+} gen_write_t;
+
+static const char *first_names[ ] =
+{
+    "Maria", "John", "Ana", "James", "Lucia", "Robert", "Elena", "Michael",
+    "Sofia", "David", "Laura", "William", "Carmen", "Richard", "Julia", "Thomas",
+    "Isabel", "Charles", "Marta", "Daniel", "Paula", "Joseph", "Clara", "Paul",
+    "Alice", "Peter", "Emma", "George", "Irene", "Henry", "Nora", "Victor"
+};
+
+static const char *last_names[ ] =
+{
+    "Garcia", "Smith", "Martinez", "Johnson", "Lopez", "Brown", "Gonzalez", "Jones",
+    "Rodriguez", "Miller", "Fernandez", "Davis", "Perez", "Wilson", "Sanchez", "Moore",
+    "Romero", "Taylor", "Torres", "Anderson", "Ramirez", "Thomas", "Flores", "Jackson",
+    "Diaz", "White", "Morales", "Harris", "Ortiz", "Martin", "Castro", "Clark"
+};
+
+static const char *publisher_names[ ] =
+{
+    "Penguin", "Harbor", "Northwind", "Atlas", "Beacon", "Cedar", "Summit", "Orchard",
+    "Lantern", "Meridian", "Riverside", "Granite", "Aurora", "Compass", "Willow", "Falcon"
+};
+
+static const char *publisher_kinds[ ] =
+{
+    "Press", "Books", "Publishing", "House", "Editions", "Media", "Library", "Classics"
+};
+
+static const char *words[ ] =
+{
+    "the", "of", "and", "a", "in", "to", "is", "was", "for", "on", "with", "as",
+    "his", "her", "by", "at", "from", "story", "world", "life", "time", "history",
+    "love", "war", "night", "city", "house", "river", "secret", "garden", "journey",
+    "light", "shadow", "king", "queen", "empire", "science", "guide", "art", "mind",
+    "country", "sea", "mountain", "family", "friend", "letters", "voices", "island",
+    "winter", "summer", "memory", "future", "silent", "lost", "golden", "dark",
+    "new", "old", "last", "first", "great", "little", "hidden", "broken"
+};
+
+static const char *languages[ ] =
+{
+    "English", "Spanish", "French", "German", "Italian", "Portuguese", "Japanese", "Chinese"
+};
+
+static const unsigned language_weights[ ] = { 60, 12, 8, 7, 5, 4, 2, 2 };
+
+static unsigned long long gen_next( unsigned long long *state )
+{
+    unsigned long long z;
+
+    z = ( *state += 0x9E3779B97F4A7C15ULL );
+    z = ( z ^ ( z >> 30 ) ) * 0xBF58476D1CE4E5B9ULL;
+    z = ( z ^ ( z >> 27 ) ) * 0x94D049BB133111EBULL;
+
+    return z ^ ( z >> 31 );
+}
+
+static double gen_uniform( unsigned long long *state )
+{
+    return ( double )( gen_next( state ) >> 11 ) / 9007199254740992.0;
+}
+
+static unsigned long gen_below( unsigned long long *state, unsigned long range )
+{
+    return ( unsigned long )( gen_next( state ) % range );
+}
+
+static double gen_lognormal( unsigned long long *state, double median, double sigma )
+{
+    double u, v;
+
+    u = 1.0 - gen_uniform( state );
+    v = gen_uniform( state );
+
+    return median * exp( sigma * sqrt( -2.0 * log( u ) ) * cos( 6.283185307179586 * v ) );
+}
+
+static unsigned long gen_zipf( unsigned long long *state, const double *cdf,
+                               unsigned long count )
+{
+    unsigned long low, high, middle;
+    double u;
+
+    u = gen_uniform( state );
+    low = 0;
+    high = count - 1;
+
+    while( low < high )
+    {
+        middle = low + ( high - low ) / 2;
+
+        if( cdf[ middle ] < u )
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+
+    return low;
+}
+
+static double *gen_cdf( unsigned long count, double skew )
+{
+    double *cdf, total;
+    unsigned long i;
+
+    if( ( cdf = malloc( count * sizeof( double ) ) ) == NULL )
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    for( i = 0, total = 0; i < count; i++ )
+    {
+        total += 1.0 / pow( ( double )( i + 1 ), skew );
+        cdf[ i ] = total;
+    }
+
+    for( i = 0; i < count; i++ )
+    {
+        cdf[ i ] /= total;
+    }
+
+    return cdf;
+}
+
+static unsigned long gen_words( unsigned long long *state, char *s,
+                                unsigned long len, int capitalize )
+{
+    unsigned long used, n;
+    const char *word;
+
+    for( used = 0; ; used += n )
+    {
+        word = words[ gen_below( state, sizeof( words ) / sizeof( words[ 0 ] ) ) ];
+        n = strlen( word );
+
+        if( used + ( used > 0 ) + n > len )
+        {
+            break;
+        }
+
+        if( used > 0 )
+        {
+            s[ used++ ] = ' ';
+        }
+
+        memcpy( s + used, word, n );
+
+        if( capitalize || used == 0 )
+        {
+            s[ used ] = ( char )( s[ used ] - 'a' + 'A' );
+        }
+    }
+
+    return used;
+}
+
+static void gen_fields( const book_gen_t *gen, unsigned long long row,
+                        char *scratch, string_t *values )
+{
+    unsigned long long state, body;
+    unsigned long rank, len, i, weight;
+    char *s;
+    int n, check;
+
+    state = gen->g_config.g_seed ^ ( row * 0xD1B54A32D192ED03ULL );
+    s = scratch;
+
+    values[ ENTRY_TITLE ].s_len = gen_words( &state, s, 8 + gen_below( &state, 40 ), 1 );
+    s += values[ ENTRY_TITLE ].s_len;
+
+    rank = gen_zipf( &state, gen->g_authors, gen->g_config.g_authors );
+    n = sprintf( s, "%s %s", first_names[ rank % 32 ], last_names[ rank / 32 % 32 ] );
+
+    if( rank >= 32 * 32 )
+    {
+        n += sprintf( s + n, " %lu", rank / ( 32 * 32 ) );
+    }
+
+    values[ ENTRY_AUTHOR ].s_len = ( unsigned long long )n;
+    s += n;
+
+    len = ( unsigned long )gen_lognormal( &state, 280, 0.45 );
+    n = sprintf( s, "%lu", len < 16 ? 16 : len > 3000 ? 3000 : len );
+    values[ ENTRY_PAGES ].s_len = ( unsigned long long )n;
+    s += n;
+
+    n = sprintf( s, "%lu", gen_below( &state, 5 ) < 4 ? 1 : 2 + gen_below( &state, 7 ) );
+    values[ ENTRY_EDITION ].s_len = ( unsigned long long )n;
+    s += n;
+
+    for( i = 0, weight = gen_below( &state, 100 ); weight >= language_weights[ i ]; i++ )
+    {
+        weight -= language_weights[ i ];
+    }
+
+    n = sprintf( s, "%s", languages[ i ] );
+    values[ ENTRY_LANGUAGE ].s_len = ( unsigned long long )n;
+    s += n;
+
+    rank = gen_zipf( &state, gen->g_publishers, gen->g_config.g_publishers );
+    n = sprintf( s, "%s %s", publisher_names[ rank % 16 ], publisher_kinds[ rank / 16 % 8 ] );
+
+    if( rank >= 16 * 8 )
+    {
+        n += sprintf( s + n, " %lu", rank / ( 16 * 8 ) );
+    }
+
+    values[ ENTRY_PUBLISHER ].s_len = ( unsigned long long )n;
+    s += n;
+
+    len = ( unsigned long )gen_lognormal( &state, 12, 0.9 );
+    n = sprintf( s, "%04lu-%02lu-%02lu", len > 225 ? 1800 : 2025 - len,
+                 1 + gen_below( &state, 12 ), 1 + gen_below( &state, 28 ) );
+    values[ ENTRY_PUBDATE ].s_len = ( unsigned long long )n;
+    s += n;
+
+    body = ( row % 1000000000ULL * 999999937ULL + gen->g_config.g_seed ) % 1000000000ULL;
+    sprintf( s, "%s%09llu", row < 1000000000ULL ? "978" : "979", body );
+
+    for( i = 0, check = 0; i < 12; i++ )
+    {
+        check += ( s[ i ] - '0' ) * ( i % 2 == 0 ? 1 : 3 );
+    }
+
+    s[ 12 ] = ( char )( '0' + ( 10 - check % 10 ) % 10 );
+    values[ ENTRY_ISBN ].s_len = 13;
+    s += 13;
+
+    len = ( unsigned long )gen_lognormal( &state, ( double )gen->g_config.g_description, 0.6 );
+    len = gen_words( &state, s, len < 16 ? 15 : len > BOOK_GEN_LENGTH - 1 ? BOOK_GEN_LENGTH - 2
+                                                                          : len - 1, 0 );
+    s[ len ] = '.';
+    values[ ENTRY_DESCRIPTION ].s_len = len + 1;
+
+    for( i = 0, s = scratch; i < ENTRY_FIELDS; i++ )
+    {
+        values[ i ].s_ptr = s;
+        s += values[ i ].s_len;
+    }
+}
+
+static void gen_encode_part( void *arg, unsigned part )
+{
+    gen_write_t *write = arg;
+    string_t values[ ENTRY_FIELDS ];
+    unsigned long long row, last, size, need;
+    char *scratch, *data;
+    int field;
+
+    row = ( write->w_base + part ) * BOOK_GEN_ROWS;
+    last = row + BOOK_GEN_ROWS < write->w_count ? row + BOOK_GEN_ROWS : write->w_count;
+
+    if( ( scratch = malloc( GEN_SCRATCH ) ) == NULL )
+    {
+        write->w_status[ part ] = ENOMEM;
+        return;
+    }
+
+    for( size = 0; row < last; row++ )
+    {
+        gen_fields( write->w_gen, row, scratch, values );
+
+        for( field = 0, need = size; field < ENTRY_FIELDS; field++ )
+        {
+            need += sizeof( values[ field ].s_len ) + values[ field ].s_len;
+        }
+
+        if( need > write->w_capacity[ part ] )
+        {
+            if( ( data = realloc( write->w_data[ part ], 2 * need ) ) == NULL )
+            {
+                write->w_status[ part ] = ENOMEM;
+                break;
+            }
+
+            write->w_data[ part ] = data;
+            write->w_capacity[ part ] = 2 * need;
+        }
+
+        for( field = 0; field < ENTRY_FIELDS; field++ )
+        {
+            size += string_encode( write->w_data[ part ] + size, &values[ field ] );
+        }
+    }
+
+    write->w_size[ part ] = size;
+    free( scratch );
+}
+
+void book_gen_defaults( book_gen_config_t *config )
+{
+    config->g_seed = 1;
+    config->g_authors = 100000;
+    config->g_publishers = 2000;
+    config->g_skew = 1.0;
+    config->g_description = 600;
+}
+
+book_gen_t *book_gen_create( const book_gen_config_t *config )
+{
+    book_gen_t *gen;
+
+    if( config->g_authors == 0 || config->g_publishers == 0 || config->g_skew < 0
+            || config->g_description == 0 )
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    if( ( gen = malloc( sizeof( book_gen_t ) ) ) == NULL )
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    gen->g_config = *config;
+    gen->g_authors = gen_cdf( config->g_authors, config->g_skew );
+    gen->g_publishers = gen_cdf( config->g_publishers, config->g_skew );
+
+    if( gen->g_authors == NULL || gen->g_publishers == NULL )
+    {
+        book_gen_destroy( gen );
+        errno = ENOMEM;
+
+        return NULL;
+    }
+
+    return gen;
+}
+
+entry_t *book_gen_entry( const book_gen_t *gen, unsigned long long row )
+{
+    string_t values[ ENTRY_FIELDS ];
+    string_t *value;
+    entry_t *entry;
+    char *scratch;
+    int field;
+
+    if( ( scratch = malloc( GEN_SCRATCH ) ) == NULL || ( entry = entry_create( ) ) == NULL )
+    {
+        free( scratch );
+        errno = ENOMEM;
+
+        return NULL;
+    }
+
+    gen_fields( gen, row, scratch, values );
+
+    for( field = 0; field < ENTRY_FIELDS; field++ )
+    {
+        if( ( value = string_create_n( values[ field ].s_ptr, values[ field ].s_len ) ) == NULL )
+        {
+            free( scratch );
+            entry_destroy( entry );
+            errno = ENOMEM;
+
+            return NULL;
+        }
+
+        entry_set_field( entry, ( entry_field_t )field, value );
+    }
+
+    free( scratch );
+
+    return entry;
+}
+
+book_t *book_gen_book( const book_gen_t *gen, unsigned long count )
+{
+    book_t *book;
+    entry_t *entry;
+    unsigned long row;
+
+    if( ( book = book_create( ) ) == NULL )
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    for( row = 0; row < count; row++ )
+    {
+        if( ( entry = book_gen_entry( gen, row ) ) == NULL )
+        {
+            book_destroy( book, 1 );
+            return NULL;
+        }
+
+        if( book_append( book, entry ) == -1 )
+        {
+            entry_destroy( entry );
+            book_destroy( book, 1 );
+            errno = ENOMEM;
+
+            return NULL;
+        }
+    }
+
+    return book;
+}
+
+int book_gen_write( FILE *file, const book_gen_t *gen, unsigned count )
+{
+    gen_write_t write;
+    unsigned long long parts;
+    unsigned batch, run, i;
+    int status;
+
+    if( fwrite( &count, sizeof( count ), 1, file ) != 1 )
+    {
+        errno = EIO;
+        return -1;
+    }
+
+    parts = ( ( unsigned long long )count + BOOK_GEN_ROWS - 1 ) / BOOK_GEN_ROWS;
+    batch = 2 * pool_cpus( );
+
+    memset( &write, 0, sizeof( gen_write_t ) );
+    write.w_gen = gen;
+    write.w_count = count;
+    write.w_data = calloc( batch, sizeof( char* ) );
+    write.w_size = calloc( batch, sizeof( unsigned long long ) );
+    write.w_capacity = calloc( batch, sizeof( unsigned long long ) );
+    write.w_status = calloc( batch, sizeof( int ) );
+
+    status = write.w_data == NULL || write.w_size == NULL || write.w_capacity == NULL
+             || write.w_status == NULL ? ENOMEM : 0;
+
+    for( write.w_base = 0; status == 0 && write.w_base < parts; write.w_base += batch )
+    {
+        run = write.w_base + batch > parts ? ( unsigned )( parts - write.w_base ) : batch;
+        pool_run( pool_shared( ), run, gen_encode_part, &write );
+
+        for( i = 0; i < run && status == 0; i++ )
+        {
+            if( ( status = write.w_status[ i ] ) == 0
+                    && fwrite( write.w_data[ i ], 1, write.w_size[ i ], file ) != write.w_size[ i ] )
+            {
+                status = EIO;
+            }
+        }
+    }
+
+    for( i = 0; write.w_data != NULL && i < batch; i++ )
+    {
+        free( write.w_data[ i ] );
+    }
+
+    free( write.w_data );
+    free( write.w_size );
+    free( write.w_capacity );
+    free( write.w_status );
+
+    if( status != 0 )
+    {
+        errno = status;
+        return -1;
+    }
+
+    return 0;
+}
+
+void book_gen_destroy( book_gen_t *gen )
+{
+    free( gen->g_authors );
+    free( gen->g_publishers );
+    free( gen );
+}
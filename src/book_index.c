@@ -0,0 +1,1114 @@
+#include <sys/mman.h>
+#include <book_index.h>
+#include <match.h>
+
+typedef struct
+{
+    const char *o_value;
+    unsigned long o_row;
+} order_key_t;
+
+static const int index_kinds[ ENTRY_FIELDS ] =
+{
+    INDEX_HASH | INDEX_ORDER | INDEX_BLOOM, /* ENTRY_TITLE */
+    INDEX_HASH | INDEX_ORDER | INDEX_BLOOM, /* ENTRY_AUTHOR */
+    INDEX_RANGE,                            /* ENTRY_PAGES */
+    INDEX_HASH,                             /* ENTRY_EDITION */
+    INDEX_HASH,                             /* ENTRY_LANGUAGE */
+    INDEX_HASH | INDEX_ORDER,               /* ENTRY_PUBLISHER */
+    INDEX_RANGE,                            /* ENTRY_PUBDATE */
+    INDEX_HASH | INDEX_ORDER | INDEX_BLOOM, /* ENTRY_ISBN */
+    0                                       /* ENTRY_DESCRIPTION */
+};
+
+static const string_t empty_value = { "", 0 };
+
+static const string_t *index_value( const book_index_t *index,
+                                    unsigned long row, entry_field_t field )
+{
+    const string_t *value;
+
+    value = entry_get_field( index->i_rows[ row ], field );
+
+    return value != NULL ? value : &empty_value;
+}
+
+static int index_shared( const book_index_t *index, const void *data )
+{
+    return index->i_region != NULL && ( const char* )data >= ( const char* )index->i_region
+        && ( const char* )data < ( const char* )index->i_region + index->i_region_size;
+}
+
+static void index_free( const book_index_t *index, void *data )
+{
+    if( !index_shared( index, data ) )
+    {
+        free( data );
+    }
+}
+
+static unsigned long long bloom_mix( unsigned long long x )
+{
+    x ^= x >> 30;
+    x *= 0xBF58476D1CE4E5B9ULL;
+    x ^= x >> 27;
+    x *= 0x94D049BB133111EBULL;
+
+    return x ^ ( x >> 31 );
+}
+
+static unsigned long bloom_capacity( const bloom_filter_t *bloom )
+{
+    return ( bloom->b_mask + 1 ) * BLOOM_WORDS * 64 / BLOOM_BITS;
+}
+
+static int bloom_current( const book_t *book, const bloom_filter_t *bloom,
+                          entry_field_t field, unsigned long version )
+{
+    return bloom->b_words != NULL && bloom->b_version == version
+        && bloom->b_generation == book_generation( book, field );
+}
+
+static unsigned long long *bloom_block( const bloom_filter_t *bloom, const char *s,
+                                        unsigned long long len, unsigned long long *bits )
+{
+    unsigned long long hash;
+
+    hash = bloom_mix( string_hash( s, len ) );
+    *bits = bloom_mix( hash );
+
+    return bloom->b_words + ( ( unsigned long )( hash >> 32 ) & bloom->b_mask ) * BLOOM_WORDS;
+}
+
+static void bloom_add( bloom_filter_t *bloom, entry_t *entry, entry_field_t field )
+{
+    const string_t *value;
+    unsigned long long *block, bits;
+    int i;
+
+    if( ( value = entry_get_field( entry, field ) ) == NULL )
+    {
+        value = &empty_value;
+    }
+
+    block = bloom_block( bloom, value->s_ptr, value->s_len, &bits );
+
+    for( i = 0; i < BLOOM_PROBES; i++, bits >>= 9 )
+    {
+        block[ ( bits >> 6 ) & ( BLOOM_WORDS - 1 ) ] |= 1ULL << ( bits & 63 );
+    }
+}
+
+static int bloom_private( const book_index_t *index, bloom_filter_t *bloom )
+{
+    unsigned long long size;
+    void *words;
+
+    if( !index_shared( index, bloom->b_words ) )
+    {
+        return 0;
+    }
+
+    size = ( bloom->b_mask + 1 ) * BLOOM_WORDS * sizeof( unsigned long long );
+
+    if( posix_memalign( &words, BLOOM_WORDS * sizeof( unsigned long long ), size ) != 0 )
+    {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    memcpy( words, bloom->b_words, size );
+    bloom->b_words = words;
+
+    return 0;
+}
+
+static int range_key_compare( const void *a, const void *b )
+{
+    const range_key_t *x = a, *y = b;
+
+    if( x->r_key != y->r_key )
+    {
+        return x->r_key < y->r_key ? -1 : 1;
+    }
+
+    return x->r_row < y->r_row ? -1 : x->r_row > y->r_row;
+}
+
+static int order_key_compare( const void *a, const void *b )
+{
+    const order_key_t *x = a, *y = b;
+    int cmp;
+
+    if( ( cmp = strcmp( x->o_value, y->o_value ) ) != 0 )
+    {
+        return cmp;
+    }
+
+    return x->o_row < y->o_row ? -1 : x->o_row > y->o_row;
+}
+
+static int book_index_rows( book_index_t *index, const book_t *book )
+{
+    entry_node_t *it;
+    entry_t **rows;
+    unsigned long i;
+
+    if( index->i_valid && index->i_version == book->a_version )
+    {
+        return 0;
+    }
+
+    rows = realloc( index->i_rows, ( book->a_count + 1 ) * sizeof( entry_t* ) );
+
+    if( rows == NULL )
+    {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    index->i_rows = rows;
+
+    for( it = book->a_head, i = 0; it != NULL; it = it->n_next, i++ )
+    {
+        rows[ i ] = it->n_entry;
+    }
+
+    index->i_count = i;
+    index->i_version = book->a_version;
+    index->i_valid = 1;
+
+    return 0;
+}
+
+book_index_t *book_index_get( const book_t *book )
+{
+    if( book->a_index == NULL
+            && ( ( ( book_t* )book )->a_index = book_index_create( ) ) == NULL )
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    if( book_index_rows( book->a_index, book ) == -1 )
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    return book->a_index;
+}
+
+static int hash_index_build( const book_t *book, book_index_t *index,
+                             hash_index_t *hash, entry_field_t field )
+{
+    unsigned long *slots, *starts, *postings, *groups, *cursor;
+    unsigned long size, row, slot, group, count;
+    const string_t *value, *other;
+
+    for( size = 16; size < 2 * index->i_count; size *= 2 );
+
+    slots = calloc( size, sizeof( unsigned long ) );
+    starts = calloc( index->i_count + 2, sizeof( unsigned long ) );
+    postings = malloc( ( index->i_count + 1 ) * sizeof( unsigned long ) );
+    groups = malloc( ( index->i_count + 1 ) * sizeof( unsigned long ) );
+    cursor = malloc( ( index->i_count + 1 ) * sizeof( unsigned long ) );
+
+    if( slots == NULL || starts == NULL || postings == NULL
+            || groups == NULL || cursor == NULL )
+    {
+        free( slots );
+        free( starts );
+        free( postings );
+        free( groups );
+        free( cursor );
+        errno = ENOMEM;
+
+        return -1;
+    }
+
+    count = 0;
+
+    for( row = 0; row < index->i_count; row++ )
+    {
+        value = index_value( index, row, field );
+        slot = string_hash( value->s_ptr, value->s_len ) & ( size - 1 );
+
+        while( slots[ slot ] != 0 )
+        {
+            other = index_value( index, cursor[ slots[ slot ] - 1 ], field );
+
+            if( match_equal( other->s_ptr, other->s_len,
+                             value->s_ptr, value->s_len ) )
+            {
+                break;
+            }
+
+            slot = ( slot + 1 ) & ( size - 1 );
+        }
+
+        if( slots[ slot ] == 0 )
+        {
+            slots[ slot ] = count + 1;
+            cursor[ count ] = row;
+            count++;
+        }
+
+        group = slots[ slot ] - 1;
+        groups[ row ] = group;
+        starts[ group + 1 ]++;
+    }
+
+    for( group = 0; group < count; group++ )
+    {
+        starts[ group + 1 ] += starts[ group ];
+        cursor[ group ] = starts[ group ];
+    }
+
+    for( row = 0; row < index->i_count; row++ )
+    {
+        postings[ cursor[ groups[ row ] ]++ ] = row;
+    }
+
+    free( groups );
+    free( cursor );
+    index_free( index, hash->h_slots );
+    index_free( index, hash->h_starts );
+    index_free( index, hash->h_postings );
+
+    hash->h_slots = slots;
+    hash->h_mask = size - 1;
+    hash->h_starts = starts;
+    hash->h_postings = postings;
+    hash->h_groups = count;
+    hash->h_version = index->i_version;
+    hash->h_generation = book_generation( book, field );
+
+    return 0;
+}
+
+static int bloom_filter_build( book_index_t *index, const book_t *book,
+                               bloom_filter_t *bloom, entry_field_t field )
+{
+    entry_node_t *it;
+    unsigned long blocks;
+    void *words;
+
+    for( blocks = 1; blocks * BLOOM_WORDS * 64 < ( unsigned long long )book->a_count * BLOOM_BITS;
+            blocks *= 2 );
+
+    if( posix_memalign( &words, BLOOM_WORDS * sizeof( unsigned long long ),
+                        blocks * BLOOM_WORDS * sizeof( unsigned long long ) ) != 0 )
+    {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    memset( words, 0, blocks * BLOOM_WORDS * sizeof( unsigned long long ) );
+    index_free( index, bloom->b_words );
+
+    bloom->b_words = words;
+    bloom->b_mask = blocks - 1;
+    bloom->b_values = book->a_count;
+    bloom->b_removed = 0;
+    bloom->b_version = book->a_version;
+    bloom->b_generation = book_generation( book, field );
+
+    for( it = book->a_head; it != NULL; it = it->n_next )
+    {
+        bloom_add( bloom, it->n_entry, field );
+    }
+
+    return 0;
+}
+
+book_index_t *book_index_create( void )
+{
+    book_index_t *index;
+
+    if( ( index = malloc( sizeof( book_index_t ) ) ) == NULL )
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    memset( index, 0, sizeof( book_index_t ) );
+
+    if( ( index->i_cache = book_cache_create( ) ) == NULL )
+    {
+        free( index );
+        errno = ENOMEM;
+
+        return NULL;
+    }
+
+    return index;
+}
+
+int book_index_kinds( entry_field_t field )
+{
+    return field < ENTRY_FIELDS ? index_kinds[ field ] : 0;
+}
+
+const range_index_t *book_index_range( const book_t *book, entry_field_t field )
+{
+    book_index_t *index;
+    range_index_t *range;
+    range_key_t *keys;
+    unsigned long i, count;
+    long key;
+
+    if( !( book_index_kinds( field ) & INDEX_RANGE ) )
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    if( ( index = book_index_get( book ) ) == NULL )
+    {
+        return NULL;
+    }
+
+    range = field == ENTRY_PAGES ? &index->i_pages : &index->i_pubdate;
+
+    if( range->r_keys != NULL
+            && range->r_version == index->i_version
+            && range->r_generation == book_generation( book, field ) )
+    {
+        return range;
+    }
+
+    if( ( keys = malloc( ( index->i_count + 1 ) * sizeof( range_key_t ) ) ) == NULL )
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    for( i = 0, count = 0; i < index->i_count; i++ )
+    {
+        key = field == ENTRY_PAGES ? entry_get_pages_num( index->i_rows[ i ] )
+                                   : entry_get_pubdate_num( index->i_rows[ i ] );
+
+        if( key != ENTRY_NONE )
+        {
+            keys[ count ].r_key = key;
+            keys[ count ].r_row = i;
+            count++;
+        }
+    }
+
+    qsort( keys, count, sizeof( range_key_t ), range_key_compare );
+
+    index_free( index, range->r_keys );
+    range->r_keys = keys;
+    range->r_count = count;
+    range->r_version = index->i_version;
+    range->r_generation = book_generation( book, field );
+
+    return range;
+}
+
+const hash_index_t *book_index_hash( const book_t *book, entry_field_t field )
+{
+    book_index_t *index;
+    hash_index_t *hash;
+
+    if( !( book_index_kinds( field ) & INDEX_HASH ) )
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    if( ( index = book_index_get( book ) ) == NULL )
+    {
+        return NULL;
+    }
+
+    hash = &index->i_hash[ field ];
+
+    if( hash->h_slots != NULL
+            && hash->h_version == index->i_version
+            && hash->h_generation == book_generation( book, field ) )
+    {
+        return hash;
+    }
+
+    if( hash_index_build( book, index, hash, field ) == -1 )
+    {
+        return NULL;
+    }
+
+    return hash;
+}
+
+const order_index_t *book_index_order( const book_t *book, entry_field_t field )
+{
+    book_index_t *index;
+    order_index_t *order;
+    order_key_t *keys;
+    unsigned long *rows, i;
+
+    if( !( book_index_kinds( field ) & INDEX_ORDER ) )
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    if( ( index = book_index_get( book ) ) == NULL )
+    {
+        return NULL;
+    }
+
+    order = &index->i_order[ field ];
+
+    if( order->o_rows != NULL
+            && order->o_version == index->i_version
+            && order->o_generation == book_generation( book, field ) )
+    {
+        return order;
+    }
+
+    keys = malloc( ( index->i_count + 1 ) * sizeof( order_key_t ) );
+    rows = malloc( ( index->i_count + 1 ) * sizeof( unsigned long ) );
+
+    if( keys == NULL || rows == NULL )
+    {
+        free( keys );
+        free( rows );
+        errno = ENOMEM;
+
+        return NULL;
+    }
+
+    for( i = 0; i < index->i_count; i++ )
+    {
+        keys[ i ].o_value = index_value( index, i, field )->s_ptr;
+        keys[ i ].o_row = i;
+    }
+
+    qsort( keys, index->i_count, sizeof( order_key_t ), order_key_compare );
+
+    for( i = 0; i < index->i_count; i++ )
+    {
+        rows[ i ] = keys[ i ].o_row;
+    }
+
+    free( keys );
+    index_free( index, order->o_rows );
+    order->o_rows = rows;
+    order->o_count = index->i_count;
+    order->o_version = index->i_version;
+    order->o_generation = book_generation( book, field );
+
+    return order;
+}
+
+const bloom_filter_t *book_index_bloom( const book_t *book, entry_field_t field )
+{
+    bloom_filter_t *bloom;
+
+    if( !( book_index_kinds( field ) & INDEX_BLOOM ) )
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    if( book->a_index == NULL
+            && ( ( ( book_t* )book )->a_index = book_index_create( ) ) == NULL )
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    bloom = &book->a_index->i_bloom[ field ];
+
+    if( !bloom_current( book, bloom, field, book->a_version )
+            && bloom_filter_build( book->a_index, book, bloom, field ) == -1 )
+    {
+        return NULL;
+    }
+
+    return bloom;
+}
+
+static unsigned long column_stamp( const book_t *book, entry_field_t field )
+{
+    return book->a_version + book_generation( book, field ) + 1;
+}
+
+static unsigned long column_wanted( const column_t *column )
+{
+#ifdef __GNUC__
+    return __atomic_load_n( &column->c_wanted, __ATOMIC_RELAXED );
+#else
+    return column->c_wanted;
+#endif
+}
+
+static void column_want( column_t *column, unsigned long stamp )
+{
+#ifdef __GNUC__
+    __atomic_store_n( &column->c_wanted, stamp, __ATOMIC_RELAXED );
+#else
+    column->c_wanted = stamp;
+#endif
+}
+
+static int column_current( const book_t *book, const column_t *column,
+                           entry_field_t field )
+{
+    return column->c_data != NULL && column->c_version == book->a_version
+        && column->c_generation == book_generation( book, field );
+}
+
+static int column_pending( const book_t *book, const column_t *column,
+                           entry_field_t field )
+{
+    return column_wanted( column ) == column_stamp( book, field )
+        && column->c_failed != column_stamp( book, field )
+        && !column_current( book, column, field );
+}
+
+static column_t *column_refresh( const book_t *book, book_index_t *index,
+                                 entry_field_t field )
+{
+    column_t *column;
+
+    column = &index->i_columns[ field ];
+
+    if( column_build( column, index->i_rows, index->i_count, field ) == -1 )
+    {
+        column->c_failed = column_stamp( book, field );
+        return NULL;
+    }
+
+    column->c_version = index->i_version;
+    column->c_generation = book_generation( book, field );
+
+    return column;
+}
+
+const column_t *book_index_column( const book_t *book, entry_field_t field )
+{
+    book_index_t *index;
+    column_t *column;
+    unsigned long stamp;
+
+    if( ( unsigned )field >= ENTRY_FIELDS || ( index = book_index_get( book ) ) == NULL )
+    {
+        return NULL;
+    }
+
+    column = &index->i_columns[ field ];
+    stamp = column_stamp( book, field );
+
+    if( column_current( book, column, field ) )
+    {
+        return column;
+    }
+
+    if( column->c_failed == stamp )
+    {
+        return NULL;
+    }
+
+    if( book->a_sealed || column_wanted( column ) != stamp )
+    {
+        column_want( column, stamp );
+        return NULL;
+    }
+
+    return column_refresh( book, index, field );
+}
+
+int book_index_pending( const book_t *book )
+{
+    int field;
+
+    for( field = 0; book->a_index != NULL && field < ENTRY_FIELDS; field++ )
+    {
+        if( column_pending( book, &book->a_index->i_columns[ field ], ( entry_field_t )field ) )
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+int book_index_absent( const book_t *book, entry_field_t field, const char *value )
+{
+    const bloom_filter_t *bloom;
+    unsigned long long *block, bits;
+    int i;
+
+    if( !( book_index_kinds( field ) & INDEX_BLOOM )
+            || ( bloom = book_index_bloom( book, field ) ) == NULL )
+    {
+        return 0;
+    }
+
+    block = bloom_block( bloom, value, strlen( value ), &bits );
+
+    for( i = 0; i < BLOOM_PROBES; i++, bits >>= 9 )
+    {
+        if( !( block[ ( bits >> 6 ) & ( BLOOM_WORDS - 1 ) ] & ( 1ULL << ( bits & 63 ) ) ) )
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+void book_index_appended( book_t *book, entry_t *entry )
+{
+    bloom_filter_t *bloom;
+    int field;
+
+    for( field = 0; book->a_index != NULL && field < ENTRY_FIELDS; field++ )
+    {
+        bloom = &book->a_index->i_bloom[ field ];
+
+        if( ( index_kinds[ field ] & INDEX_BLOOM )
+                && bloom_current( book, bloom, ( entry_field_t )field, book->a_version - 1 )
+                && bloom->b_values < bloom_capacity( bloom )
+                && bloom_private( book->a_index, bloom ) == 0 )
+        {
+            bloom_add( bloom, entry, ( entry_field_t )field );
+            bloom->b_values++;
+            bloom->b_version = book->a_version;
+        }
+    }
+
+    if( book->a_index != NULL )
+    {
+        book_cache_appended( book->a_index->i_cache, book, entry );
+    }
+}
+
+void book_index_removed( book_t *book, entry_t *entry )
+{
+    bloom_filter_t *bloom;
+    int field;
+
+    for( field = 0; book->a_index != NULL && field < ENTRY_FIELDS; field++ )
+    {
+        bloom = &book->a_index->i_bloom[ field ];
+
+        if( ( index_kinds[ field ] & INDEX_BLOOM )
+                && bloom_current( book, bloom, ( entry_field_t )field, book->a_version - 1 )
+                && ++bloom->b_removed <= bloom->b_values / 2 )
+        {
+            bloom->b_version = book->a_version;
+        }
+    }
+
+    if( book->a_index != NULL )
+    {
+        book_cache_removed( book->a_index->i_cache, book, entry );
+    }
+}
+
+void book_index_edited( book_t *book, entry_t *entry, entry_field_t field,
+                        unsigned long generation )
+{
+    if( book->a_index != NULL )
+    {
+        book_cache_edited( book->a_index->i_cache, book, entry, field, generation );
+    }
+}
+
+int book_index_warm( const book_t *book )
+{
+    book_index_t *index;
+    int field, kinds;
+
+    if( ( index = book_index_get( book ) ) == NULL )
+    {
+        return -1;
+    }
+
+    for( field = 0; field < ENTRY_FIELDS; field++ )
+    {
+        kinds = book_index_kinds( ( entry_field_t )field );
+
+        if( ( ( kinds & INDEX_HASH ) && book_index_hash( book, ( entry_field_t )field ) == NULL )
+                || ( ( kinds & INDEX_ORDER ) && book_index_order( book, ( entry_field_t )field ) == NULL )
+                || ( ( kinds & INDEX_RANGE ) && book_index_range( book, ( entry_field_t )field ) == NULL )
+                || ( ( kinds & INDEX_BLOOM ) && book_index_bloom( book, ( entry_field_t )field ) == NULL ) )
+        {
+            return -1;
+        }
+
+        if( column_pending( book, &index->i_columns[ field ], ( entry_field_t )field ) )
+        {
+            column_refresh( book, index, ( entry_field_t )field );
+        }
+    }
+
+    return 0;
+}
+
+int book_index_attach( const book_t *book, void *region, unsigned long long size,
+                       int mapped )
+{
+    book_index_t *index;
+
+    if( ( index = book_index_get( book ) ) == NULL )
+    {
+        return -1;
+    }
+
+    if( index->i_region != NULL )
+    {
+        errno = EBUSY;
+        return -1;
+    }
+
+    index->i_region = region;
+    index->i_region_size = size;
+    index->i_mapped = mapped;
+
+    return 0;
+}
+
+int book_index_adopt_hash( const book_t *book, entry_field_t field,
+                           unsigned long *slots, unsigned long mask,
+                           unsigned long *starts, unsigned long groups,
+                           unsigned long *postings )
+{
+    book_index_t *index;
+    hash_index_t *hash;
+    unsigned long i, used;
+
+    if( !( book_index_kinds( field ) & INDEX_HASH ) )
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if( ( index = book_index_get( book ) ) == NULL )
+    {
+        return -1;
+    }
+
+    if( ( mask & ( mask + 1 ) ) != 0 || groups > mask || groups > index->i_count
+            || starts[ 0 ] != 0 || starts[ groups ] != index->i_count )
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    for( i = 0, used = 0; i <= mask; i++ )
+    {
+        if( slots[ i ] > groups )
+        {
+            errno = EINVAL;
+            return -1;
+        }
+
+        used += slots[ i ] != 0;
+    }
+
+    if( used != groups )
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    for( i = 0; i < groups; i++ )
+    {
+        if( starts[ i ] >= starts[ i + 1 ] )
+        {
+            errno = EINVAL;
+            return -1;
+        }
+    }
+
+    for( i = 0; i < index->i_count; i++ )
+    {
+        if( postings[ i ] >= index->i_count )
+        {
+            errno = EINVAL;
+            return -1;
+        }
+    }
+
+    hash = &index->i_hash[ field ];
+    index_free( index, hash->h_slots );
+    index_free( index, hash->h_starts );
+    index_free( index, hash->h_postings );
+
+    hash->h_slots = slots;
+    hash->h_mask = mask;
+    hash->h_starts = starts;
+    hash->h_postings = postings;
+    hash->h_groups = groups;
+    hash->h_version = index->i_version;
+    hash->h_generation = book_generation( book, field );
+
+    return 0;
+}
+
+int book_index_adopt_order( const book_t *book, entry_field_t field,
+                            unsigned long *rows, unsigned long count )
+{
+    book_index_t *index;
+    order_index_t *order;
+    unsigned long i;
+
+    if( !( book_index_kinds( field ) & INDEX_ORDER ) )
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if( ( index = book_index_get( book ) ) == NULL )
+    {
+        return -1;
+    }
+
+    if( count != index->i_count )
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    for( i = 0; i < count; i++ )
+    {
+        if( rows[ i ] >= count )
+        {
+            errno = EINVAL;
+            return -1;
+        }
+    }
+
+    order = &index->i_order[ field ];
+    index_free( index, order->o_rows );
+    order->o_rows = rows;
+    order->o_count = count;
+    order->o_version = index->i_version;
+    order->o_generation = book_generation( book, field );
+
+    return 0;
+}
+
+int book_index_adopt_range( const book_t *book, entry_field_t field,
+                            range_key_t *keys, unsigned long count )
+{
+    book_index_t *index;
+    range_index_t *range;
+    unsigned long i;
+
+    if( !( book_index_kinds( field ) & INDEX_RANGE ) )
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if( ( index = book_index_get( book ) ) == NULL )
+    {
+        return -1;
+    }
+
+    if( count > index->i_count )
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    for( i = 0; i < count; i++ )
+    {
+        if( keys[ i ].r_row >= index->i_count
+                || ( i > 0 && range_key_compare( &keys[ i - 1 ], &keys[ i ] ) >= 0 ) )
+        {
+            errno = EINVAL;
+            return -1;
+        }
+    }
+
+    range = field == ENTRY_PAGES ? &index->i_pages : &index->i_pubdate;
+    index_free( index, range->r_keys );
+    range->r_keys = keys;
+    range->r_count = count;
+    range->r_version = index->i_version;
+    range->r_generation = book_generation( book, field );
+
+    return 0;
+}
+
+int book_index_adopt_bloom( const book_t *book, entry_field_t field,
+                            unsigned long long *words, unsigned long mask,
+                            unsigned long values )
+{
+    book_index_t *index;
+    bloom_filter_t *bloom;
+
+    if( !( book_index_kinds( field ) & INDEX_BLOOM ) )
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if( ( index = book_index_get( book ) ) == NULL )
+    {
+        return -1;
+    }
+
+    bloom = &index->i_bloom[ field ];
+
+    if( ( mask & ( mask + 1 ) ) != 0 || values < book->a_count
+            || values > ( mask + 1 ) * BLOOM_WORDS * 64 / BLOOM_BITS )
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    index_free( index, bloom->b_words );
+    bloom->b_words = words;
+    bloom->b_mask = mask;
+    bloom->b_values = values;
+    bloom->b_removed = values - book->a_count;
+    bloom->b_version = book->a_version;
+    bloom->b_generation = book_generation( book, field );
+
+    return 0;
+}
+
+unsigned long range_index_lower( const range_index_t *range, long key )
+{
+    unsigned long low, high, middle;
+
+    low = 0;
+    high = range->r_count;
+
+    while( low < high )
+    {
+        middle = low + ( high - low ) / 2;
+
+        if( range->r_keys[ middle ].r_key < key )
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+
+    return low;
+}
+
+unsigned long hash_index_find( const book_index_t *index,
+                               const hash_index_t *hash,
+                               entry_field_t field, const char *value,
+                               const unsigned long **rows )
+{
+    const string_t *other;
+    unsigned long slot, group, len;
+
+    len = strlen( value );
+    slot = string_hash( value, len ) & hash->h_mask;
+
+    while( hash->h_slots[ slot ] != 0 )
+    {
+        group = hash->h_slots[ slot ] - 1;
+        other = index_value( index, hash->h_postings[ hash->h_starts[ group ] ],
+                             field );
+
+        if( match_equal( other->s_ptr, other->s_len, value, len ) )
+        {
+            *rows = hash->h_postings + hash->h_starts[ group ];
+            return hash->h_starts[ group + 1 ] - hash->h_starts[ group ];
+        }
+
+        slot = ( slot + 1 ) & hash->h_mask;
+    }
+
+    *rows = NULL;
+
+    return 0;
+}
+
+unsigned long order_index_prefix( const book_index_t *index,
+                                  const order_index_t *order,
+                                  entry_field_t field, const char *prefix,
+                                  unsigned long *first )
+{
+    unsigned long low, high, middle, lower;
+    size_t len;
+
+    len = strlen( prefix );
+    low = 0;
+    high = order->o_count;
+
+    while( low < high )
+    {
+        middle = low + ( high - low ) / 2;
+
+        if( strncmp( index_value( index, order->o_rows[ middle ], field )->s_ptr,
+                     prefix, len ) < 0 )
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+
+    lower = low;
+    high = order->o_count;
+
+    while( low < high )
+    {
+        middle = low + ( high - low ) / 2;
+
+        if( strncmp( index_value( index, order->o_rows[ middle ], field )->s_ptr,
+                     prefix, len ) <= 0 )
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+
+    *first = lower;
+
+    return low - lower;
+}
+
+void book_index_destroy( book_index_t *index )
+{
+    int i;
+
+    for( i = 0; i < ENTRY_FIELDS; i++ )
+    {
+        index_free( index, index->i_hash[ i ].h_slots );
+        index_free( index, index->i_hash[ i ].h_starts );
+        index_free( index, index->i_hash[ i ].h_postings );
+        index_free( index, index->i_order[ i ].o_rows );
+        index_free( index, index->i_bloom[ i ].b_words );
+        column_destroy( &index->i_columns[ i ] );
+    }
+
+    index_free( index, index->i_pages.r_keys );
+    index_free( index, index->i_pubdate.r_keys );
+
+    if( index->i_mapped )
+    {
+        munmap( index->i_region, index->i_region_size );
+    }
+    else
+    {
+        free( index->i_region );
+    }
+
+    book_cache_destroy( index->i_cache );
+
+    free( index->i_rows );
+    free( index );
+}
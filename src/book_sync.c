@@ -0,0 +1,1021 @@
+#include <book_sync.h>
+#include <book_index.h>
+#include <book_file.h>
+#include <pool.h>
+
+typedef struct
+{
+    book_sync_t *l_sync;
+    book_t **l_books;
+    const query_t *l_query;
+    book_view_t *l_view;
+} sync_part_t;
+
+static unsigned sync_index( const book_sync_t *sync, const char *isbn )
+{
+    const unsigned char *p;
+    unsigned long hash;
+
+    for( hash = 2166136261UL, p = ( const unsigned char* )isbn; *p != '\0'; p++ )
+    {
+        hash = ( ( hash ^ *p ) * 16777619UL ) & 0xFFFFFFFFUL;
+    }
+
+    return ( unsigned )( hash % sync->y_count );
+}
+
+static unsigned long long sync_bytes( entry_t *entry )
+{
+    return sizeof( entry_node_t ) + entry_bytes( entry );
+}
+
+static int sync_route( const book_sync_t *sync, const query_t *query )
+{
+    unsigned i;
+
+    if( query->q_op == QUERY_EQUAL && query->q_field == ENTRY_ISBN )
+    {
+        return ( int )sync_index( sync, query->q_value );
+    }
+
+    if( query->q_op == QUERY_AND )
+    {
+        for( i = 0; i < query->q_count; i++ )
+        {
+            if( query->q_args[ i ]->q_op == QUERY_EQUAL
+                    && query->q_args[ i ]->q_field == ENTRY_ISBN )
+            {
+                return ( int )sync_index( sync, query->q_args[ i ]->q_value );
+            }
+        }
+    }
+
+    return -1;
+}
+
+static void shard_read_lock( book_shard_t *shard )
+{
+    pthread_rwlock_rdlock( &shard->d_lock );
+
+    if( !shard->d_dirty && !book_index_pending( shard->d_book ) )
+    {
+        return;
+    }
+
+    pthread_rwlock_unlock( &shard->d_lock );
+    pthread_rwlock_wrlock( &shard->d_lock );
+
+    if( ( shard->d_dirty || book_index_pending( shard->d_book ) )
+            && book_index_warm( shard->d_book ) == 0 )
+    {
+        shard->d_dirty = 0;
+    }
+}
+
+static book_t *shard_find( book_shard_t *shard, const char *isbn )
+{
+    query_t *query;
+    book_t *found;
+
+    if( ( query = query_equal( ENTRY_ISBN, isbn ) ) == NULL )
+    {
+        return NULL;
+    }
+
+    found = book_query( shard->d_book, query, NULL );
+    query_destroy( query );
+
+    return found;
+}
+
+static void sync_lock_all( book_sync_t *sync )
+{
+    unsigned i;
+
+    for( i = 0; i < sync->y_count; i++ )
+    {
+        pthread_rwlock_rdlock( &sync->y_shards[ i ].d_lock );
+    }
+}
+
+static void sync_unlock_all( book_sync_t *sync )
+{
+    unsigned i;
+
+    for( i = sync->y_count; i-- > 0; )
+    {
+        pthread_rwlock_unlock( &sync->y_shards[ i ].d_lock );
+    }
+}
+
+static void version_destroy( book_version_t *version )
+{
+    unsigned long i;
+
+    for( i = 0; i < version->v_retired_count; i++ )
+    {
+        entry_destroy( version->v_retired[ i ] );
+    }
+
+    free( version->v_retired );
+    free( version->v_rows );
+    free( version );
+}
+
+static void shard_reclaim( book_shard_t *shard )
+{
+    book_version_t *oldest;
+
+    while( ( oldest = shard->d_oldest ) != NULL && oldest->v_refs == 0 )
+    {
+        shard->d_oldest = oldest->v_next;
+
+        if( shard->d_latest == oldest )
+        {
+            shard->d_latest = NULL;
+        }
+
+        version_destroy( oldest );
+    }
+}
+
+static book_version_t *shard_publish( book_shard_t *shard )
+{
+    book_version_t *version;
+    entry_node_t *it;
+
+    pthread_mutex_lock( &shard->d_mutex );
+
+    if( shard->d_latest == NULL || shard->d_stale )
+    {
+        if( ( version = malloc( sizeof( book_version_t ) ) ) == NULL )
+        {
+            pthread_mutex_unlock( &shard->d_mutex );
+            errno = ENOMEM;
+
+            return NULL;
+        }
+
+        memset( version, 0, sizeof( book_version_t ) );
+
+        if( ( version->v_rows = malloc( ( shard->d_book->a_count + 1 )
+                                        * sizeof( entry_t* ) ) ) == NULL )
+        {
+            free( version );
+            pthread_mutex_unlock( &shard->d_mutex );
+            errno = ENOMEM;
+
+            return NULL;
+        }
+
+        for( it = shard->d_book->a_head; it != NULL; it = it->n_next )
+        {
+            version->v_rows[ version->v_count++ ] = it->n_entry;
+        }
+
+        version->v_refs = 1;
+
+        if( shard->d_latest != NULL )
+        {
+            shard->d_latest->v_next = version;
+            shard->d_latest->v_refs--;
+        }
+        else
+        {
+            shard->d_oldest = version;
+        }
+
+        shard->d_latest = version;
+        shard->d_stale = 0;
+        shard_reclaim( shard );
+    }
+
+    version = shard->d_latest;
+    version->v_refs++;
+
+    pthread_mutex_unlock( &shard->d_mutex );
+
+    return version;
+}
+
+static int shard_reserve( book_shard_t *shard, unsigned long count )
+{
+    book_version_t *latest;
+    entry_t **retired;
+    unsigned long capacity;
+
+    latest = shard->d_latest;
+
+    if( latest == NULL || latest->v_retired_count + count <= latest->v_retired_cap )
+    {
+        return 0;
+    }
+
+    for( capacity = latest->v_retired_cap > 0 ? latest->v_retired_cap : 16;
+            capacity < latest->v_retired_count + count; capacity *= 2 );
+
+    if( ( retired = realloc( latest->v_retired, capacity * sizeof( entry_t* ) ) ) == NULL )
+    {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    latest->v_retired = retired;
+    latest->v_retired_cap = capacity;
+
+    return 0;
+}
+
+static void shard_retire( book_shard_t *shard, entry_t *entry )
+{
+    if( shard->d_latest == NULL )
+    {
+        entry_destroy( entry );
+    }
+    else
+    {
+        shard->d_latest->v_retired[ shard->d_latest->v_retired_count++ ] = entry;
+    }
+}
+
+static void shard_changed( book_shard_t *shard )
+{
+    shard->d_dirty = 1;
+    shard->d_stale = 1;
+}
+
+book_sync_t *book_sync_create( unsigned shards )
+{
+    book_sync_t *sync;
+
+    if( shards == 0 )
+    {
+        shards = BOOK_SYNC_SHARDS;
+    }
+
+    if( ( sync = malloc( sizeof( book_sync_t ) ) ) == NULL )
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    if( ( sync->y_shards = calloc( shards, sizeof( book_shard_t ) ) ) == NULL )
+    {
+        free( sync );
+        errno = ENOMEM;
+
+        return NULL;
+    }
+
+    for( sync->y_count = 0; sync->y_count < shards; sync->y_count++ )
+    {
+        if( ( sync->y_shards[ sync->y_count ].d_book = book_create( ) ) == NULL )
+        {
+            book_sync_destroy( sync );
+            errno = ENOMEM;
+
+            return NULL;
+        }
+
+        sync->y_shards[ sync->y_count ].d_book->a_sealed = 1;
+        sync->y_shards[ sync->y_count ].d_dirty = 1;
+        pthread_rwlock_init( &sync->y_shards[ sync->y_count ].d_lock, NULL );
+        pthread_mutex_init( &sync->y_shards[ sync->y_count ].d_mutex, NULL );
+    }
+
+    return sync;
+}
+
+int book_sync_adopt( book_sync_t *sync, book_t *book )
+{
+    book_shard_t *shard;
+    entry_t *entry;
+    int status;
+
+    while( book->a_head != NULL )
+    {
+        entry = book->a_head->n_entry;
+        shard = &sync->y_shards[ sync_index( sync, entry_get_isbn( entry )->s_ptr ) ];
+
+        pthread_rwlock_wrlock( &shard->d_lock );
+
+        if( ( status = book_append( shard->d_book, entry ) ) == 0 )
+        {
+            shard->d_bytes += sync_bytes( entry );
+            shard_changed( shard );
+        }
+
+        pthread_rwlock_unlock( &shard->d_lock );
+
+        if( status == -1 )
+        {
+            errno = ENOMEM;
+            return -1;
+        }
+
+        book_remove( book, book->a_head );
+    }
+
+    return 0;
+}
+
+int book_sync_add( book_sync_t *sync, entry_t *entry )
+{
+    entry_t *duplicate;
+
+    if( ( duplicate = entry_duplicate( entry ) ) == NULL )
+    {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    if( book_sync_add_take( sync, duplicate ) == -1 )
+    {
+        entry_destroy( duplicate );
+        return -1;
+    }
+
+    return 0;
+}
+
+int book_sync_add_take( book_sync_t *sync, entry_t *entry )
+{
+    book_shard_t *shard;
+    int status;
+
+    shard = &sync->y_shards[ sync_index( sync, entry_get_isbn( entry )->s_ptr ) ];
+
+    pthread_rwlock_wrlock( &shard->d_lock );
+
+    if( ( status = book_add_take( shard->d_book, entry ) ) == 0 )
+    {
+        shard->d_bytes += sync_bytes( entry );
+        shard_changed( shard );
+    }
+
+    pthread_rwlock_unlock( &shard->d_lock );
+
+    if( status == -1 )
+    {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    return 0;
+}
+
+static void sync_query_shard( void *arg, unsigned part )
+{
+    sync_part_t *scan = arg;
+    book_shard_t *shard;
+    book_t *found, *copies;
+
+    shard = &scan->l_sync->y_shards[ part ];
+
+    if( ( copies = book_create( ) ) == NULL )
+    {
+        return;
+    }
+
+    shard_read_lock( shard );
+
+    if( ( found = book_query( shard->d_book, scan->l_query, NULL ) ) == NULL
+            || book_add_all( copies, found ) == -1 )
+    {
+        book_destroy( copies, 1 );
+        copies = NULL;
+    }
+
+    pthread_rwlock_unlock( &shard->d_lock );
+
+    if( found != NULL )
+    {
+        book_destroy( found, 0 );
+    }
+
+    scan->l_books[ part ] = copies;
+}
+
+book_t *book_sync_query( book_sync_t *sync, const query_t *query )
+{
+    book_t *result;
+    sync_part_t scan;
+    entry_node_t *it;
+    unsigned i;
+    int route, status;
+
+    if( ( result = book_create( ) ) == NULL )
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    if( ( scan.l_books = calloc( sync->y_count, sizeof( book_t* ) ) ) == NULL )
+    {
+        book_destroy( result, 0 );
+        errno = ENOMEM;
+
+        return NULL;
+    }
+
+    scan.l_sync = sync;
+    scan.l_query = query;
+
+    if( ( route = sync_route( sync, query ) ) != -1 )
+    {
+        sync_query_shard( &scan, ( unsigned )route );
+        status = scan.l_books[ route ] == NULL ? -1 : 0;
+    }
+    else
+    {
+        pool_run( pool_shared( ), sync->y_count, sync_query_shard, &scan );
+
+        for( i = 0, status = 0; i < sync->y_count; i++ )
+        {
+            status = scan.l_books[ i ] == NULL ? -1 : status;
+        }
+    }
+
+    for( i = 0; i < sync->y_count && status == 0; i++ )
+    {
+        for( it = scan.l_books[ i ] != NULL ? scan.l_books[ i ]->a_head : NULL;
+                it != NULL && status == 0; it = it->n_next )
+        {
+            status = book_append( result, it->n_entry );
+        }
+    }
+
+    for( i = 0; i < sync->y_count; i++ )
+    {
+        if( scan.l_books[ i ] != NULL )
+        {
+            book_destroy( scan.l_books[ i ], status == -1 );
+        }
+    }
+
+    free( scan.l_books );
+
+    if( status == -1 )
+    {
+        book_destroy( result, 0 );
+        errno = ENOMEM;
+
+        return NULL;
+    }
+
+    return result;
+}
+
+book_view_t *book_sync_pin( book_sync_t *sync )
+{
+    book_view_t *view;
+    unsigned i;
+
+    if( ( view = malloc( sizeof( book_view_t ) ) ) == NULL )
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    if( ( view->w_versions = calloc( sync->y_count, sizeof( book_version_t* ) ) ) == NULL )
+    {
+        free( view );
+        errno = ENOMEM;
+
+        return NULL;
+    }
+
+    view->w_sync = sync;
+    view->w_count = 0;
+
+    sync_lock_all( sync );
+
+    for( i = 0; i < sync->y_count; i++ )
+    {
+        if( ( view->w_versions[ i ] = shard_publish( &sync->y_shards[ i ] ) ) == NULL )
+        {
+            break;
+        }
+
+        view->w_count += view->w_versions[ i ]->v_count;
+    }
+
+    sync_unlock_all( sync );
+
+    if( i < sync->y_count )
+    {
+        book_view_release( view );
+        errno = ENOMEM;
+
+        return NULL;
+    }
+
+    return view;
+}
+
+entry_t *book_view_get( const book_view_t *view, unsigned long row )
+{
+    unsigned i;
+
+    for( i = 0; row >= view->w_versions[ i ]->v_count; i++ )
+    {
+        row -= view->w_versions[ i ]->v_count;
+    }
+
+    return view->w_versions[ i ]->v_rows[ row ];
+}
+
+book_t *book_view_book( const book_view_t *view )
+{
+    book_version_t *version;
+    book_t *book;
+    unsigned long row;
+    unsigned i;
+
+    if( ( book = book_create( ) ) == NULL )
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    for( i = 0; i < view->w_sync->y_count; i++ )
+    {
+        version = view->w_versions[ i ];
+
+        for( row = 0; row < version->v_count; row++ )
+        {
+            if( book_append( book, version->v_rows[ row ] ) == -1 )
+            {
+                book_destroy( book, 0 );
+                errno = ENOMEM;
+
+                return NULL;
+            }
+        }
+    }
+
+    return book;
+}
+
+void book_view_release( book_view_t *view )
+{
+    book_shard_t *shard;
+    unsigned i;
+
+    for( i = 0; i < view->w_sync->y_count; i++ )
+    {
+        if( view->w_versions[ i ] != NULL )
+        {
+            shard = &view->w_sync->y_shards[ i ];
+
+            pthread_mutex_lock( &shard->d_mutex );
+            view->w_versions[ i ]->v_refs--;
+            shard_reclaim( shard );
+            pthread_mutex_unlock( &shard->d_mutex );
+        }
+    }
+
+    free( view->w_versions );
+    free( view );
+}
+
+long book_sync_update( book_sync_t *sync, const char *isbn,
+                       entry_field_t field, const char *value )
+{
+    book_shard_t *from, *to;
+    entry_node_t *it;
+    entry_t *edited;
+    string_t *copy;
+    book_t *found;
+    unsigned first, second;
+    long count;
+    int status;
+
+    first = sync_index( sync, isbn );
+    second = field == ENTRY_ISBN ? sync_index( sync, value ) : first;
+    from = &sync->y_shards[ first ];
+    to = &sync->y_shards[ second ];
+
+    pthread_rwlock_wrlock( &sync->y_shards[ first < second ? first : second ].d_lock );
+
+    if( first != second )
+    {
+        pthread_rwlock_wrlock( &sync->y_shards[ first < second ? second : first ].d_lock );
+    }
+
+    if( ( found = shard_find( from, isbn ) ) == NULL )
+    {
+        status = -1;
+        count = 0;
+    }
+    else
+    {
+        pthread_mutex_lock( &from->d_mutex );
+        status = shard_reserve( from, found->a_count );
+
+        for( it = found->a_head, count = 0; it != NULL && status == 0;
+                it = it->n_next, count++ )
+        {
+            if( ( copy = string_create( value ) ) == NULL
+                    || ( edited = entry_duplicate( it->n_entry ) ) == NULL )
+            {
+                string_destroy( copy );
+                status = -1;
+                break;
+            }
+
+            entry_set_field( edited, field, copy );
+
+            if( book_append( to->d_book, edited ) == -1 )
+            {
+                entry_destroy( edited );
+                status = -1;
+                break;
+            }
+
+            to->d_bytes += sync_bytes( edited );
+        }
+
+        while( found->a_count > ( unsigned long )count )
+        {
+            book_remove( found, found->a_tail );
+        }
+
+        book_remove_all( from->d_book, found );
+
+        for( it = found->a_head; it != NULL; it = it->n_next )
+        {
+            from->d_bytes -= sync_bytes( it->n_entry );
+            shard_retire( from, it->n_entry );
+        }
+
+        pthread_mutex_unlock( &from->d_mutex );
+
+        if( count > 0 )
+        {
+            shard_changed( from );
+            shard_changed( to );
+        }
+
+        book_destroy( found, 0 );
+    }
+
+    pthread_rwlock_unlock( &from->d_lock );
+
+    if( first != second )
+    {
+        pthread_rwlock_unlock( &to->d_lock );
+    }
+
+    if( status == -1 )
+    {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    return count;
+}
+
+long book_sync_remove( book_sync_t *sync, const char *isbn )
+{
+    book_shard_t *shard;
+    entry_node_t *it;
+    book_t *found;
+    long count;
+
+    shard = &sync->y_shards[ sync_index( sync, isbn ) ];
+
+    pthread_rwlock_wrlock( &shard->d_lock );
+
+    if( ( found = shard_find( shard, isbn ) ) != NULL )
+    {
+        pthread_mutex_lock( &shard->d_mutex );
+
+        if( shard_reserve( shard, found->a_count ) == -1 )
+        {
+            book_destroy( found, 0 );
+            found = NULL;
+        }
+        else if( found->a_count > 0 )
+        {
+            book_remove_all( shard->d_book, found );
+
+            for( it = found->a_head; it != NULL; it = it->n_next )
+            {
+                shard->d_bytes -= sync_bytes( it->n_entry );
+                shard_retire( shard, it->n_entry );
+            }
+
+            shard_changed( shard );
+        }
+
+        pthread_mutex_unlock( &shard->d_mutex );
+    }
+
+    pthread_rwlock_unlock( &shard->d_lock );
+
+    if( found == NULL )
+    {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    count = ( long )found->a_count;
+    book_destroy( found, 0 );
+
+    return count;
+}
+
+unsigned long book_sync_count( book_sync_t *sync )
+{
+    unsigned long count;
+    unsigned i;
+
+    for( i = 0, count = 0; i < sync->y_count; i++ )
+    {
+        pthread_rwlock_rdlock( &sync->y_shards[ i ].d_lock );
+        count += sync->y_shards[ i ].d_book->a_count;
+        pthread_rwlock_unlock( &sync->y_shards[ i ].d_lock );
+    }
+
+    return count;
+}
+
+unsigned long long book_sync_bytes( book_sync_t *sync )
+{
+    unsigned long long bytes;
+    unsigned i;
+
+    for( i = 0, bytes = 0; i < sync->y_count; i++ )
+    {
+        pthread_rwlock_rdlock( &sync->y_shards[ i ].d_lock );
+        bytes += sync->y_shards[ i ].d_bytes;
+        pthread_rwlock_unlock( &sync->y_shards[ i ].d_lock );
+    }
+
+    return bytes;
+}
+
+book_t *book_sync_snapshot( book_sync_t *sync )
+{
+    book_view_t *view;
+    book_t *shared, *snapshot;
+
+    if( ( view = book_sync_pin( sync ) ) == NULL )
+    {
+        return NULL;
+    }
+
+    snapshot = NULL;
+
+    if( ( shared = book_view_book( view ) ) != NULL )
+    {
+        snapshot = book_duplicate( shared );
+        book_destroy( shared, 0 );
+    }
+
+    book_view_release( view );
+
+    if( snapshot == NULL )
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    return snapshot;
+}
+
+int book_sync_save( book_sync_t *sync, const char *filename, int packed )
+{
+    book_view_t *view;
+    book_t *shared;
+    int status, saved;
+
+    if( ( view = book_sync_pin( sync ) ) == NULL )
+    {
+        return -1;
+    }
+
+    if( ( shared = book_view_book( view ) ) == NULL )
+    {
+        book_view_release( view );
+        return -1;
+    }
+
+    status = book_save( filename, shared, packed );
+    saved = errno;
+    book_destroy( shared, 0 );
+    book_view_release( view );
+    errno = saved;
+
+    return status;
+}
+
+static void sync_place_shard( void *arg, unsigned part )
+{
+    sync_part_t *load = arg;
+    book_shard_t *shard;
+    entry_node_t *it;
+    book_t *book;
+
+    book = load->l_books[ part ];
+
+    for( it = book->a_head; it != NULL; it = it->n_next )
+    {
+        if( sync_index( load->l_sync, entry_get_isbn( it->n_entry )->s_ptr ) != part )
+        {
+            return;
+        }
+    }
+
+    shard = &load->l_sync->y_shards[ part ];
+    book_destroy( shard->d_book, 0 );
+    shard->d_book = book;
+    shard->d_book->a_sealed = 1;
+
+    for( it = book->a_head; it != NULL; it = it->n_next )
+    {
+        shard->d_bytes += sync_bytes( it->n_entry );
+    }
+
+    shard->d_dirty = book_index_warm( book ) == -1;
+    load->l_books[ part ] = NULL;
+}
+
+book_sync_t *book_sync_load( const char *filename, int *packed, int *sharded )
+{
+    book_sync_t *sync;
+    sync_part_t load;
+    unsigned count, i;
+    FILE *file;
+    int status;
+
+    *sharded = 0;
+
+    if( ( file = fopen( filename, "r" ) ) != NULL )
+    {
+        *sharded = book_file_format( file ) == BOOK_FORMAT_SHARDED;
+        fclose( file );
+    }
+
+    if( ( load.l_books = *sharded ? book_load_shards( filename, &count, packed )
+                                  : calloc( 1, sizeof( book_t* ) ) ) == NULL )
+    {
+        return NULL;
+    }
+
+    if( !*sharded )
+    {
+        count = 1;
+
+        if( ( load.l_books[ 0 ] = book_load( filename, packed ) ) == NULL )
+        {
+            free( load.l_books );
+            return NULL;
+        }
+    }
+
+    if( ( sync = book_sync_create( *sharded ? count : 0 ) ) == NULL )
+    {
+        for( i = 0; i < count; i++ )
+        {
+            book_destroy( load.l_books[ i ], 1 );
+        }
+
+        free( load.l_books );
+        errno = ENOMEM;
+
+        return NULL;
+    }
+
+    load.l_sync = sync;
+
+    if( *sharded )
+    {
+        pool_run( pool_shared( ), count, sync_place_shard, &load );
+    }
+
+    for( i = 0, status = 0; i < count; i++ )
+    {
+        if( load.l_books[ i ] == NULL )
+        {
+            continue;
+        }
+
+        if( status == 0 )
+        {
+            status = book_sync_adopt( sync, load.l_books[ i ] );
+        }
+
+        book_destroy( load.l_books[ i ], 1 );
+    }
+
+    free( load.l_books );
+
+    if( status == -1 )
+    {
+        book_sync_destroy( sync );
+        errno = ENOMEM;
+
+        return NULL;
+    }
+
+    return sync;
+}
+
+static void sync_shard_book( void *arg, unsigned part )
+{
+    sync_part_t *save = arg;
+    book_version_t *version;
+    unsigned long row;
+
+    version = save->l_view->w_versions[ part ];
+
+    if( ( save->l_books[ part ] = book_create( ) ) == NULL )
+    {
+        return;
+    }
+
+    for( row = 0; row < version->v_count; row++ )
+    {
+        if( book_append( save->l_books[ part ], version->v_rows[ row ] ) == -1 )
+        {
+            book_destroy( save->l_books[ part ], 0 );
+            save->l_books[ part ] = NULL;
+
+            return;
+        }
+    }
+}
+
+int book_sync_save_shards( book_sync_t *sync, const char *filename, int packed )
+{
+    sync_part_t save;
+    unsigned i;
+    int status, saved;
+
+    if( ( save.l_books = calloc( sync->y_count, sizeof( book_t* ) ) ) == NULL )
+    {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    if( ( save.l_view = book_sync_pin( sync ) ) == NULL )
+    {
+        free( save.l_books );
+        return -1;
+    }
+
+    pool_run( pool_shared( ), sync->y_count, sync_shard_book, &save );
+
+    for( i = 0, status = 0; i < sync->y_count; i++ )
+    {
+        status = save.l_books[ i ] == NULL ? -1 : status;
+    }
+
+    if( status == -1 )
+    {
+        saved = ENOMEM;
+    }
+    else
+    {
+        status = book_save_shards( filename, save.l_books, sync->y_count, packed );
+        saved = errno;
+    }
+
+    for( i = 0; i < sync->y_count; i++ )
+    {
+        if( save.l_books[ i ] != NULL )
+        {
+            book_destroy( save.l_books[ i ], 0 );
+        }
+    }
+
+    free( save.l_books );
+    book_view_release( save.l_view );
+    errno = saved;
+
+    return status;
+}
+
+void book_sync_destroy( book_sync_t *sync )
+{
+    book_version_t *version;
+    unsigned i;
+
+    for( i = 0; i < sync->y_count; i++ )
+    {
+        while( ( version = sync->y_shards[ i ].d_oldest ) != NULL )
+        {
+            sync->y_shards[ i ].d_oldest = version->v_next;
+            version_destroy( version );
+        }
+
+        book_destroy( sync->y_shards[ i ].d_book, 1 );
+        pthread_rwlock_destroy( &sync->y_shards[ i ].d_lock );
+        pthread_mutex_destroy( &sync->y_shards[ i ].d_mutex );
+    }
+
+    free( sync->y_shards );
+    free( sync );
+}
@@ -0,0 +1,403 @@
+#include <catalog.h>
+
+static unsigned long catalog_slot( const char *filename, unsigned long mask )
+{
+    const unsigned char *p;
+    unsigned long hash;
+
+    for( hash = 2166136261UL, p = ( const unsigned char* )filename; *p != '\0'; p++ )
+    {
+        hash = ( ( hash ^ *p ) * 16777619UL ) & 0xFFFFFFFFUL;
+    }
+
+    return hash & mask;
+}
+
+static catalog_entry_t *catalog_find( catalog_t *catalog, const char *filename )
+{
+    catalog_entry_t *it;
+
+    for( it = catalog->a_slots[ catalog_slot( filename, catalog->a_mask ) ];
+            it != NULL; it = it->e_chain )
+    {
+        if( strcmp( it->e_filename, filename ) == 0 )
+        {
+            return it;
+        }
+    }
+
+    return NULL;
+}
+
+static int catalog_insert( catalog_t *catalog, catalog_entry_t *entry )
+{
+    catalog_entry_t **slots, *it, *next;
+    unsigned long size, slot;
+
+    if( catalog->a_count > catalog->a_mask )
+    {
+        size = 2 * ( catalog->a_mask + 1 );
+
+        if( ( slots = calloc( size, sizeof( catalog_entry_t* ) ) ) == NULL )
+        {
+            errno = ENOMEM;
+            return -1;
+        }
+
+        for( slot = 0; slot <= catalog->a_mask; slot++ )
+        {
+            for( it = catalog->a_slots[ slot ]; it != NULL; it = next )
+            {
+                next = it->e_chain;
+                it->e_chain = slots[ catalog_slot( it->e_filename, size - 1 ) ];
+                slots[ catalog_slot( it->e_filename, size - 1 ) ] = it;
+            }
+        }
+
+        free( catalog->a_slots );
+        catalog->a_slots = slots;
+        catalog->a_mask = size - 1;
+    }
+
+    slot = catalog_slot( entry->e_filename, catalog->a_mask );
+    entry->e_chain = catalog->a_slots[ slot ];
+    catalog->a_slots[ slot ] = entry;
+    catalog->a_count++;
+
+    entry->e_prev = NULL;
+    entry->e_next = catalog->a_head;
+
+    if( catalog->a_head != NULL )
+    {
+        catalog->a_head->e_prev = entry;
+    }
+    else
+    {
+        catalog->a_tail = entry;
+    }
+
+    catalog->a_head = entry;
+
+    return 0;
+}
+
+static void catalog_unlink( catalog_t *catalog, catalog_entry_t *entry )
+{
+    catalog_entry_t **it;
+
+    for( it = &catalog->a_slots[ catalog_slot( entry->e_filename, catalog->a_mask ) ];
+            *it != entry; it = &( *it )->e_chain );
+
+    *it = entry->e_chain;
+    catalog->a_count--;
+
+    if( entry->e_prev != NULL )
+    {
+        entry->e_prev->e_next = entry->e_next;
+    }
+    else
+    {
+        catalog->a_head = entry->e_next;
+    }
+
+    if( entry->e_next != NULL )
+    {
+        entry->e_next->e_prev = entry->e_prev;
+    }
+    else
+    {
+        catalog->a_tail = entry->e_prev;
+    }
+}
+
+static void catalog_touch( catalog_t *catalog, catalog_entry_t *entry )
+{
+    if( catalog->a_head == entry )
+    {
+        return;
+    }
+
+    entry->e_prev->e_next = entry->e_next;
+
+    if( entry->e_next != NULL )
+    {
+        entry->e_next->e_prev = entry->e_prev;
+    }
+    else
+    {
+        catalog->a_tail = entry->e_prev;
+    }
+
+    entry->e_prev = NULL;
+    entry->e_next = catalog->a_head;
+    catalog->a_head->e_prev = entry;
+    catalog->a_head = entry;
+}
+
+static void catalog_entry_destroy( catalog_entry_t *entry )
+{
+    if( entry->e_store != NULL )
+    {
+        book_sync_destroy( entry->e_store );
+    }
+
+    free( entry->e_filename );
+    free( entry );
+}
+
+static int catalog_write( catalog_t *catalog, catalog_entry_t *entry )
+{
+    if( catalog->a_sharded || entry->e_sharded )
+    {
+        return book_sync_save_shards( entry->e_store, entry->e_filename,
+                                      catalog->a_compress || entry->e_packed );
+    }
+
+    return book_sync_save( entry->e_store, entry->e_filename,
+                           catalog->a_compress || entry->e_packed );
+}
+
+catalog_t *catalog_create( unsigned long long budget, int compress, int sharded )
+{
+    catalog_t *catalog;
+
+    if( ( catalog = malloc( sizeof( catalog_t ) ) ) == NULL )
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    memset( catalog, 0, sizeof( catalog_t ) );
+
+    if( ( catalog->a_slots = calloc( 16, sizeof( catalog_entry_t* ) ) ) == NULL )
+    {
+        free( catalog );
+        errno = ENOMEM;
+
+        return NULL;
+    }
+
+    catalog->a_mask = 15;
+    catalog->a_budget = budget > 0 ? budget : CATALOG_BUDGET;
+    catalog->a_compress = compress;
+    catalog->a_sharded = sharded;
+    pthread_mutex_init( &catalog->a_lock, NULL );
+    pthread_cond_init( &catalog->a_ready, NULL );
+
+    return catalog;
+}
+
+catalog_entry_t *catalog_acquire( catalog_t *catalog, const char *filename )
+{
+    catalog_entry_t *entry;
+    book_sync_t *store;
+    int packed, sharded, saved;
+
+    pthread_mutex_lock( &catalog->a_lock );
+
+    while( ( entry = catalog_find( catalog, filename ) ) != NULL && entry->e_busy )
+    {
+        pthread_cond_wait( &catalog->a_ready, &catalog->a_lock );
+    }
+
+    if( entry != NULL )
+    {
+        entry->e_refs++;
+        catalog_touch( catalog, entry );
+        pthread_mutex_unlock( &catalog->a_lock );
+
+        return entry;
+    }
+
+    if( ( entry = calloc( 1, sizeof( catalog_entry_t ) ) ) == NULL
+            || ( entry->e_filename = malloc( strlen( filename ) + 1 ) ) == NULL )
+    {
+        pthread_mutex_unlock( &catalog->a_lock );
+        free( entry );
+        errno = ENOMEM;
+
+        return NULL;
+    }
+
+    strcpy( entry->e_filename, filename );
+
+    if( catalog_insert( catalog, entry ) == -1 )
+    {
+        pthread_mutex_unlock( &catalog->a_lock );
+        catalog_entry_destroy( entry );
+
+        return NULL;
+    }
+
+    entry->e_busy = 1;
+    entry->e_refs = 1;
+
+    pthread_mutex_unlock( &catalog->a_lock );
+
+    store = book_sync_load( filename, &packed, &sharded );
+    saved = errno;
+
+    pthread_mutex_lock( &catalog->a_lock );
+
+    if( store == NULL )
+    {
+        catalog_unlink( catalog, entry );
+        pthread_cond_broadcast( &catalog->a_ready );
+        pthread_mutex_unlock( &catalog->a_lock );
+        catalog_entry_destroy( entry );
+        errno = saved;
+
+        return NULL;
+    }
+
+    entry->e_store = store;
+    entry->e_packed = packed;
+    entry->e_sharded = sharded;
+    entry->e_bytes = book_sync_bytes( store );
+    entry->e_busy = 0;
+    catalog->a_bytes += entry->e_bytes;
+    pthread_cond_broadcast( &catalog->a_ready );
+    pthread_mutex_unlock( &catalog->a_lock );
+
+    catalog_trim( catalog );
+
+    return entry;
+}
+
+void catalog_release( catalog_t *catalog, catalog_entry_t *entry, int modified )
+{
+    unsigned long long bytes;
+
+    bytes = book_sync_bytes( entry->e_store );
+
+    pthread_mutex_lock( &catalog->a_lock );
+
+    catalog->a_bytes = catalog->a_bytes - entry->e_bytes + bytes;
+    entry->e_bytes = bytes;
+    entry->e_refs--;
+
+    if( modified )
+    {
+        entry->e_dirty = 1;
+    }
+
+    catalog_touch( catalog, entry );
+    pthread_mutex_unlock( &catalog->a_lock );
+}
+
+int catalog_trim( catalog_t *catalog )
+{
+    catalog_entry_t *victim;
+    int status, saved;
+
+    pthread_mutex_lock( &catalog->a_lock );
+
+    for( status = 0; catalog->a_bytes > catalog->a_budget; )
+    {
+        for( victim = catalog->a_tail; victim != NULL; victim = victim->e_prev )
+        {
+            if( victim->e_refs == 0 && !victim->e_busy )
+            {
+                break;
+            }
+        }
+
+        if( victim == NULL )
+        {
+            break;
+        }
+
+        victim->e_busy = 1;
+        pthread_mutex_unlock( &catalog->a_lock );
+
+        if( victim->e_dirty && catalog_write( catalog, victim ) == -1 )
+        {
+            saved = errno;
+            pthread_mutex_lock( &catalog->a_lock );
+            victim->e_busy = 0;
+            pthread_cond_broadcast( &catalog->a_ready );
+            status = -1;
+
+            break;
+        }
+
+        pthread_mutex_lock( &catalog->a_lock );
+        catalog_unlink( catalog, victim );
+        catalog->a_bytes -= victim->e_bytes;
+        pthread_cond_broadcast( &catalog->a_ready );
+        pthread_mutex_unlock( &catalog->a_lock );
+
+        catalog_entry_destroy( victim );
+
+        pthread_mutex_lock( &catalog->a_lock );
+    }
+
+    pthread_mutex_unlock( &catalog->a_lock );
+
+    if( status == -1 )
+    {
+        errno = saved;
+    }
+
+    return status;
+}
+
+int catalog_save( catalog_t *catalog, catalog_entry_t *entry )
+{
+    int saved;
+
+    pthread_mutex_lock( &catalog->a_lock );
+    entry->e_dirty = 0;
+    pthread_mutex_unlock( &catalog->a_lock );
+
+    if( catalog_write( catalog, entry ) == -1 )
+    {
+        saved = errno;
+        pthread_mutex_lock( &catalog->a_lock );
+        entry->e_dirty = 1;
+        pthread_mutex_unlock( &catalog->a_lock );
+        errno = saved;
+
+        return -1;
+    }
+
+    return 0;
+}
+
+int catalog_flush( catalog_t *catalog )
+{
+    catalog_entry_t *it;
+    int status, saved;
+
+    for( it = catalog->a_head, status = 0, saved = 0; it != NULL; it = it->e_next )
+    {
+        if( it->e_dirty && catalog_save( catalog, it ) == -1 )
+        {
+            status = -1;
+            saved = errno;
+        }
+    }
+
+    if( status == -1 )
+    {
+        errno = saved;
+    }
+
+    return status;
+}
+
+void catalog_destroy( catalog_t *catalog )
+{
+    catalog_entry_t *it, *next;
+
+    for( it = catalog->a_head; it != NULL; it = next )
+    {
+        next = it->e_next;
+        catalog_entry_destroy( it );
+    }
+
+    pthread_mutex_destroy( &catalog->a_lock );
+    pthread_cond_destroy( &catalog->a_ready );
+    free( catalog->a_slots );
+    free( catalog );
+}
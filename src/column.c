@@ -0,0 +1,223 @@
+#include <column.h>
+#include <match.h>
+
+static unsigned long column_row( const column_t *column, unsigned long first,
+                                 unsigned long last, unsigned long long offset )
+{
+    unsigned long low, high, middle;
+
+    low = first;
+    high = last;
+
+    while( high - low > 1 )
+    {
+        middle = low + ( high - low ) / 2;
+
+        if( column->c_offsets[ middle ] <= offset )
+        {
+            low = middle;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+
+    return low;
+}
+
+int column_build( column_t *column, entry_t **rows, unsigned long count,
+                  entry_field_t field )
+{
+    const string_t *value;
+    unsigned long long *offsets, size;
+    unsigned long row;
+    long *numbers;
+    char *data;
+
+    for( row = 0; field == ENTRY_DESCRIPTION && row < count; row++ )
+    {
+        if( entry_lazy( rows[ row ] ) )
+        {
+            errno = EAGAIN;
+            return -1;
+        }
+    }
+
+    if( ( offsets = malloc( ( count + 1 ) * sizeof( unsigned long long ) ) ) == NULL )
+    {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    for( row = 0, size = 0; row < count; row++ )
+    {
+        value = entry_get_field( rows[ row ], field );
+        offsets[ row ] = size;
+        size += ( value != NULL ? value->s_len : 0 ) + 1;
+    }
+
+    offsets[ count ] = size;
+    numbers = NULL;
+
+    if( ( data = malloc( size + 1 ) ) == NULL
+            || ( ( field == ENTRY_PAGES || field == ENTRY_PUBDATE )
+                 && ( numbers = malloc( ( count + 1 ) * sizeof( long ) ) ) == NULL ) )
+    {
+        free( offsets );
+        free( data );
+        errno = ENOMEM;
+
+        return -1;
+    }
+
+    for( row = 0; row < count; row++ )
+    {
+        value = entry_get_field( rows[ row ], field );
+
+        if( value != NULL )
+        {
+            memcpy( data + offsets[ row ], value->s_ptr, value->s_len );
+        }
+
+        data[ offsets[ row + 1 ] - 1 ] = '\0';
+
+        if( numbers != NULL )
+        {
+            numbers[ row ] = field == ENTRY_PAGES ? entry_get_pages_num( rows[ row ] )
+                                                  : entry_get_pubdate_num( rows[ row ] );
+        }
+    }
+
+    column_destroy( column );
+    column->c_data = data;
+    column->c_offsets = offsets;
+    column->c_size = size;
+    column->c_numbers = numbers;
+    column->c_rows = count;
+
+    return 0;
+}
+
+const char *column_value( const column_t *column, unsigned long row,
+                          unsigned long long *len )
+{
+    if( len != NULL )
+    {
+        *len = column->c_offsets[ row + 1 ] - column->c_offsets[ row ] - 1;
+    }
+
+    return column->c_data + column->c_offsets[ row ];
+}
+
+unsigned long column_match( const column_t *column, const query_t *query,
+                            unsigned long first, unsigned long last,
+                            unsigned long *rows )
+{
+    const char *hit;
+    unsigned long long offset, end, len;
+    unsigned long row, count;
+
+    count = 0;
+
+    switch( query->q_op )
+    {
+        case QUERY_EQUAL:
+        case QUERY_PREFIX:
+            for( row = first; row < last; row++ )
+            {
+                offset = column->c_offsets[ row ];
+                len = column->c_offsets[ row + 1 ] - offset - 1;
+
+                if( query->q_op == QUERY_EQUAL
+                        ? match_equal( column->c_data + offset, len,
+                                       query->q_value, query->q_len )
+                        : match_prefix( column->c_data + offset, len,
+                                        query->q_value, query->q_len ) )
+                {
+                    rows[ count++ ] = row;
+                }
+            }
+            break;
+
+        case QUERY_CONTAINS:
+            offset = column->c_offsets[ first ];
+            end = column->c_offsets[ last ];
+
+            while( offset < end )
+            {
+                if( query->q_len == 0 )
+                {
+                    row = column_row( column, first, last, offset );
+                }
+                else if( ( hit = match_find( column->c_data + offset, end - offset,
+                                             query->q_value, query->q_len ) ) != NULL )
+                {
+                    row = column_row( column, first, last,
+                                      ( unsigned long long )( hit - column->c_data ) );
+                }
+                else
+                {
+                    break;
+                }
+
+                rows[ count++ ] = row;
+                offset = column->c_offsets[ row + 1 ];
+            }
+            break;
+
+        case QUERY_RANGE:
+            for( row = first; column->c_numbers != NULL && row < last; row++ )
+            {
+                if( column->c_numbers[ row ] != ENTRY_NONE
+                        && column->c_numbers[ row ] >= query->q_min
+                        && column->c_numbers[ row ] <= query->q_max )
+                {
+                    rows[ count++ ] = row;
+                }
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    return count;
+}
+
+int column_sum( const column_t *column, long long *sum, unsigned long *count )
+{
+    unsigned long row;
+
+    if( column->c_numbers == NULL )
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    *sum = 0;
+    *count = 0;
+
+    for( row = 0; row < column->c_rows; row++ )
+    {
+        if( column->c_numbers[ row ] != ENTRY_NONE )
+        {
+            *sum += column->c_numbers[ row ];
+            ( *count )++;
+        }
+    }
+
+    return 0;
+}
+
+void column_destroy( column_t *column )
+{
+    free( column->c_data );
+    free( column->c_offsets );
+    free( column->c_numbers );
+    column->c_data = NULL;
+    column->c_offsets = NULL;
+    column->c_numbers = NULL;
+    column->c_size = 0;
+    column->c_rows = 0;
+}
@@ -0,0 +1,124 @@
+#include <pthread.h>
+#include <crc32c.h>
+
+#if defined( __GNUC__ ) && defined( __x86_64__ )
+#define CRC32C_X86
+#include <immintrin.h>
+#endif
+
+#define CRC32C_POLY 0x82F63B78U
+
+static pthread_once_t kernel_once = PTHREAD_ONCE_INIT;
+static unsigned ( *kernel )( unsigned crc, const unsigned char *p,
+                             unsigned long long len );
+static const char *kernel_name;
+static unsigned table[ 8 ][ 256 ];
+
+static unsigned table_crc( unsigned crc, const unsigned char *p,
+                           unsigned long long len )
+{
+    unsigned lo, hi;
+
+    for( ; len > 0 && ( ( unsigned long )p & 7 ) != 0; len-- )
+    {
+        crc = table[ 0 ][ ( crc ^ *p++ ) & 0xFF ] ^ ( crc >> 8 );
+    }
+
+    for( ; len >= 8; len -= 8, p += 8 )
+    {
+        memcpy( &lo, p, sizeof( lo ) );
+        memcpy( &hi, p + 4, sizeof( hi ) );
+        lo ^= crc;
+        crc = table[ 7 ][ lo & 0xFF ] ^ table[ 6 ][ ( lo >> 8 ) & 0xFF ]
+            ^ table[ 5 ][ ( lo >> 16 ) & 0xFF ] ^ table[ 4 ][ lo >> 24 ]
+            ^ table[ 3 ][ hi & 0xFF ] ^ table[ 2 ][ ( hi >> 8 ) & 0xFF ]
+            ^ table[ 1 ][ ( hi >> 16 ) & 0xFF ] ^ table[ 0 ][ hi >> 24 ];
+    }
+
+    for( ; len > 0; len-- )
+    {
+        crc = table[ 0 ][ ( crc ^ *p++ ) & 0xFF ] ^ ( crc >> 8 );
+    }
+
+    return crc;
+}
+
+#ifdef CRC32C_X86
+
+__attribute__(( target( "sse4.2" ) ))
+static unsigned sse42_crc( unsigned crc, const unsigned char *p,
+                           unsigned long long len )
+{
+    unsigned long long crc64, word;
+
+    for( ; len > 0 && ( ( unsigned long )p & 7 ) != 0; len-- )
+    {
+        crc = _mm_crc32_u8( crc, *p++ );
+    }
+
+    for( crc64 = crc; len >= 8; len -= 8, p += 8 )
+    {
+        memcpy( &word, p, sizeof( word ) );
+        crc64 = _mm_crc32_u64( crc64, word );
+    }
+
+    for( crc = ( unsigned )crc64; len > 0; len-- )
+    {
+        crc = _mm_crc32_u8( crc, *p++ );
+    }
+
+    return crc;
+}
+
+#endif /* CRC32C_X86 */
+
+static void crc32c_select( void )
+{
+    unsigned i, j, crc;
+
+    for( i = 0; i < 256; i++ )
+    {
+        for( crc = i, j = 0; j < 8; j++ )
+        {
+            crc = crc & 1 ? ( crc >> 1 ) ^ CRC32C_POLY : crc >> 1;
+        }
+
+        table[ 0 ][ i ] = crc;
+    }
+
+    for( i = 0; i < 256; i++ )
+    {
+        for( j = 1; j < 8; j++ )
+        {
+            table[ j ][ i ] = table[ 0 ][ table[ j - 1 ][ i ] & 0xFF ]
+                            ^ ( table[ j - 1 ][ i ] >> 8 );
+        }
+    }
+
+    kernel = table_crc;
+    kernel_name = "table";
+
+#ifdef CRC32C_X86
+    __builtin_cpu_init( );
+
+    if( __builtin_cpu_supports( "sse4.2" ) )
+    {
+        kernel = sse42_crc;
+        kernel_name = "sse4.2";
+    }
+#endif
+}
+
+unsigned crc32c( unsigned crc, const void *data, unsigned long long len )
+{
+    pthread_once( &kernel_once, crc32c_select );
+
+    return ~kernel( ~crc, data, len );
+}
+
+const char *crc32c_kernel( void )
+{
+    pthread_once( &kernel_once, crc32c_select );
+
+    return kernel_name;
+}
@@ -0,0 +1,443 @@
+#include <stdio.h>
+#include <sys/stat.h>
+#include <credentials.h>
+#include <sha256.h>
+
+static unsigned long credentials_slot( const char *username, unsigned long mask )
+{
+    const unsigned char *p;
+    unsigned long hash;
+
+    for( hash = 2166136261UL, p = ( const unsigned char* )username; *p != '\0'; p++ )
+    {
+        hash = ( ( hash ^ *p ) * 16777619UL ) & 0xFFFFFFFFUL;
+    }
+
+    return hash & mask;
+}
+
+static void credential_destroy( credential_t *credential )
+{
+    free( credential->c_username );
+    free( credential );
+}
+
+static credential_t *credential_parse( char *line )
+{
+    credential_t *credential;
+    char *secret, *filename;
+    size_t len;
+
+    len = strlen( line );
+
+    while( len > 0 && ( line[ len - 1 ] == '\n' || line[ len - 1 ] == '\r' ) )
+    {
+        line[ --len ] = '\0';
+    }
+
+    if( line[ 0 ] == '#' || line[ 0 ] == ':'
+            || ( secret = strchr( line, ':' ) ) == NULL
+            || ( filename = strchr( secret + 1, ':' ) ) == NULL )
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    if( ( credential = malloc( sizeof( credential_t ) ) ) == NULL )
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    if( ( credential->c_username = malloc( len + 1 ) ) == NULL )
+    {
+        free( credential );
+        errno = ENOMEM;
+
+        return NULL;
+    }
+
+    memcpy( credential->c_username, line, len + 1 );
+    credential->c_username[ secret - line ] = '\0';
+    credential->c_username[ filename - line ] = '\0';
+    credential->c_secret = credential->c_username + ( secret - line ) + 1;
+    credential->c_filename = credential->c_username + ( filename - line ) + 1;
+    credential->c_next = NULL;
+
+    return credential;
+}
+
+static credential_t **credentials_table( credential_t *list, unsigned long count,
+                                         unsigned long *mask )
+{
+    credential_t **slots, *credential, *it;
+    unsigned long size, slot;
+
+    for( size = 16; size < 2 * count; size *= 2 );
+
+    if( ( slots = calloc( size, sizeof( credential_t* ) ) ) == NULL )
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    while( ( credential = list ) != NULL )
+    {
+        list = credential->c_next;
+        credential->c_next = NULL;
+        slot = credentials_slot( credential->c_username, size - 1 );
+
+        for( it = slots[ slot ]; it != NULL; it = it->c_next )
+        {
+            if( strcmp( it->c_username, credential->c_username ) == 0 )
+            {
+                break;
+            }
+        }
+
+        if( it != NULL )
+        {
+            credential_destroy( credential );
+            continue;
+        }
+
+        credential->c_next = slots[ slot ];
+        slots[ slot ] = credential;
+    }
+
+    *mask = size - 1;
+
+    return slots;
+}
+
+static void credentials_clear( credential_t **slots, unsigned long mask )
+{
+    credential_t *it, *next;
+    unsigned long slot;
+
+    for( slot = 0; slot <= mask; slot++ )
+    {
+        for( it = slots[ slot ]; it != NULL; it = next )
+        {
+            next = it->c_next;
+            credential_destroy( it );
+        }
+    }
+
+    free( slots );
+}
+
+static int credentials_load( credentials_t *credentials )
+{
+    credential_t *head, *tail, *credential, **slots;
+    unsigned long count, mask;
+    struct stat status;
+    char *line;
+    size_t capacity;
+    FILE *file;
+    int failed;
+
+    if( ( file = fopen( credentials->r_path, "r" ) ) == NULL )
+    {
+        return -1;
+    }
+
+    if( fstat( fileno( file ), &status ) == -1 )
+    {
+        fclose( file );
+        return -1;
+    }
+
+    head = tail = NULL;
+    line = NULL;
+    capacity = 0;
+    count = 0;
+    failed = 0;
+
+    while( getline( &line, &capacity, file ) != -1 )
+    {
+        if( ( credential = credential_parse( line ) ) == NULL )
+        {
+            if( errno == ENOMEM )
+            {
+                failed = 1;
+                break;
+            }
+
+            continue;
+        }
+
+        if( tail == NULL )
+        {
+            head = credential;
+        }
+        else
+        {
+            tail->c_next = credential;
+        }
+
+        tail = credential;
+        count++;
+    }
+
+    free( line );
+    fclose( file );
+
+    if( failed || ( slots = credentials_table( head, count, &mask ) ) == NULL )
+    {
+        while( ( credential = head ) != NULL )
+        {
+            head = credential->c_next;
+            credential_destroy( credential );
+        }
+
+        errno = ENOMEM;
+
+        return -1;
+    }
+
+    if( credentials->r_slots != NULL )
+    {
+        credentials_clear( credentials->r_slots, credentials->r_mask );
+    }
+
+    credentials->r_slots = slots;
+    credentials->r_mask = mask;
+    credentials->r_count = count;
+    credentials->r_mtime = status.st_mtime;
+    credentials->r_ctime = status.st_ctime;
+    credentials->r_size = status.st_size;
+    credentials->r_inode = status.st_ino;
+
+    return 0;
+}
+
+static int credentials_hex( const char *s, unsigned char *bytes, size_t size )
+{
+    size_t i;
+    int j, digit;
+
+    for( i = 0; i < size; i++ )
+    {
+        bytes[ i ] = 0;
+
+        for( j = 0; j < 2; j++ )
+        {
+            if( *s >= '0' && *s <= '9' )
+            {
+                digit = *s - '0';
+            }
+            else if( *s >= 'a' && *s <= 'f' )
+            {
+                digit = *s - 'a' + 10;
+            }
+            else if( *s >= 'A' && *s <= 'F' )
+            {
+                digit = *s - 'A' + 10;
+            }
+            else
+            {
+                return -1;
+            }
+
+            bytes[ i ] = ( unsigned char )( bytes[ i ] << 4 | digit );
+            s++;
+        }
+    }
+
+    return 0;
+}
+
+static int credentials_equal( const unsigned char *a, const unsigned char *b, size_t len )
+{
+    unsigned char difference;
+    size_t i;
+
+    for( i = 0, difference = 0; i < len; i++ )
+    {
+        difference |= a[ i ] ^ b[ i ];
+    }
+
+    return difference == 0;
+}
+
+static int credentials_verify( const char *secret, const char *password )
+{
+    unsigned char salt[ SHA256_BLOCK ], hash[ SHA256_SIZE ],
+                  expected[ SHA256_SIZE ];
+    unsigned long iterations;
+    const char *salt_hex, *hash_hex;
+    char *end;
+    sha256_t sha;
+    size_t salt_len;
+
+    if( strncmp( secret, CREDENTIALS_SCHEME, strlen( CREDENTIALS_SCHEME ) ) != 0 )
+    {
+        sha256_init( &sha );
+        sha256_update( &sha, secret, strlen( secret ) );
+        sha256_final( &sha, expected );
+        sha256_init( &sha );
+        sha256_update( &sha, password, strlen( password ) );
+        sha256_final( &sha, hash );
+
+        return credentials_equal( expected, hash, SHA256_SIZE );
+    }
+
+    iterations = strtoul( secret + strlen( CREDENTIALS_SCHEME ), &end, 10 );
+
+    if( iterations == 0 || *end != '$' )
+    {
+        return 0;
+    }
+
+    salt_hex = end + 1;
+
+    if( ( hash_hex = strchr( salt_hex, '$' ) ) == NULL )
+    {
+        return 0;
+    }
+
+    salt_len = ( size_t )( hash_hex - salt_hex ) / 2;
+    hash_hex++;
+
+    if( ( size_t )( hash_hex - 1 - salt_hex ) % 2 != 0 || salt_len > sizeof( salt )
+            || strlen( hash_hex ) != 2 * SHA256_SIZE
+            || credentials_hex( salt_hex, salt, salt_len ) == -1
+            || credentials_hex( hash_hex, expected, SHA256_SIZE ) == -1 )
+    {
+        return 0;
+    }
+
+    pbkdf2_sha256( password, strlen( password ), salt, salt_len, iterations,
+                   hash, SHA256_SIZE );
+
+    return credentials_equal( expected, hash, SHA256_SIZE );
+}
+
+credentials_t *credentials_open( const char *path )
+{
+    credentials_t *credentials;
+
+    if( ( credentials = malloc( sizeof( credentials_t ) ) ) == NULL )
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    memset( credentials, 0, sizeof( credentials_t ) );
+
+    if( ( credentials->r_path = malloc( strlen( path ) + 1 ) ) == NULL )
+    {
+        free( credentials );
+        errno = ENOMEM;
+
+        return NULL;
+    }
+
+    strcpy( credentials->r_path, path );
+
+    if( credentials_load( credentials ) == -1 )
+    {
+        credentials_destroy( credentials );
+        return NULL;
+    }
+
+    return credentials;
+}
+
+int credentials_refresh( credentials_t *credentials )
+{
+    struct stat status;
+
+    if( stat( credentials->r_path, &status ) == -1 )
+    {
+        return -1;
+    }
+
+    if( status.st_mtime == credentials->r_mtime && status.st_ctime == credentials->r_ctime
+            && status.st_size == credentials->r_size && status.st_ino == credentials->r_inode )
+    {
+        return 0;
+    }
+
+    return credentials_load( credentials );
+}
+
+const char *credentials_check( credentials_t *credentials,
+                               const char *username,
+                               const char *password )
+{
+    credential_t *it;
+
+    credentials_refresh( credentials );
+
+    for( it = credentials->r_slots[ credentials_slot( username, credentials->r_mask ) ];
+            it != NULL; it = it->c_next )
+    {
+        if( strcmp( it->c_username, username ) == 0 )
+        {
+            return credentials_verify( it->c_secret, password ) ? it->c_filename : NULL;
+        }
+    }
+
+    return NULL;
+}
+
+int credentials_hash( const char *password, char *secret, size_t size )
+{
+    unsigned char salt[ CREDENTIALS_SALT ], hash[ SHA256_SIZE ];
+    size_t len, i;
+    FILE *random;
+
+    if( size < CREDENTIALS_SECRET_MAX )
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if( ( random = fopen( "/dev/urandom", "rb" ) ) == NULL )
+    {
+        errno = EIO;
+        return -1;
+    }
+
+    len = fread( salt, 1, sizeof( salt ), random );
+    fclose( random );
+
+    if( len != sizeof( salt ) )
+    {
+        errno = EIO;
+        return -1;
+    }
+
+    pbkdf2_sha256( password, strlen( password ), salt, sizeof( salt ),
+                   CREDENTIALS_ITERATIONS, hash, SHA256_SIZE );
+
+    len = ( size_t )sprintf( secret, "%s%lu$", CREDENTIALS_SCHEME,
+                             ( unsigned long )CREDENTIALS_ITERATIONS );
+
+    for( i = 0; i < sizeof( salt ); i++ )
+    {
+        len += ( size_t )sprintf( secret + len, "%02x", salt[ i ] );
+    }
+
+    secret[ len++ ] = '$';
+
+    for( i = 0; i < sizeof( hash ); i++ )
+    {
+        len += ( size_t )sprintf( secret + len, "%02x", hash[ i ] );
+    }
+
+    return 0;
+}
+
+void credentials_destroy( credentials_t *credentials )
+{
+    if( credentials->r_slots != NULL )
+    {
+        credentials_clear( credentials->r_slots, credentials->r_mask );
+    }
+
+    free( credentials->r_path );
+    free( credentials );
+}
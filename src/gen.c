@@ -0,0 +1,136 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <book.h>
+#include <book_file.h>
+#include <book_gen.h>
+
+int main( int argc, char *argv[ ] )
+{
+    book_gen_config_t config;
+    struct timespec start, end;
+    const char *filename;
+    book_gen_t *gen;
+    book_t *book;
+    unsigned long count;
+    FILE *file;
+    int compress, status, i;
+    char *end_ptr;
+
+    book_gen_defaults( &config );
+    filename = NULL;
+    count = 1000000;
+    compress = 0;
+    end_ptr = NULL;
+
+    for( i = 1; i < argc; i++ )
+    {
+        if( strcmp( argv[ i ], "--count" ) == 0 && i + 1 < argc
+                && ( count = strtoul( argv[ i + 1 ], &end_ptr, 10 ) ) > 0 && *end_ptr == '\0'
+                && count <= 0xFFFFFFFFUL )
+        {
+            i++;
+        }
+        else if( strcmp( argv[ i ], "--seed" ) == 0 && i + 1 < argc
+                && ( config.g_seed = strtoull( argv[ i + 1 ], &end_ptr, 10 ), *end_ptr == '\0' ) )
+        {
+            i++;
+        }
+        else if( strcmp( argv[ i ], "--authors" ) == 0 && i + 1 < argc
+                && ( config.g_authors = strtoul( argv[ i + 1 ], &end_ptr, 10 ) ) > 0
+                && *end_ptr == '\0' )
+        {
+            i++;
+        }
+        else if( strcmp( argv[ i ], "--publishers" ) == 0 && i + 1 < argc
+                && ( config.g_publishers = strtoul( argv[ i + 1 ], &end_ptr, 10 ) ) > 0
+                && *end_ptr == '\0' )
+        {
+            i++;
+        }
+        else if( strcmp( argv[ i ], "--skew" ) == 0 && i + 1 < argc
+                && ( config.g_skew = strtod( argv[ i + 1 ], &end_ptr ) ) >= 0
+                && *end_ptr == '\0' )
+        {
+            i++;
+        }
+        else if( strcmp( argv[ i ], "--description" ) == 0 && i + 1 < argc
+                && ( config.g_description = strtoul( argv[ i + 1 ], &end_ptr, 10 ) ) > 0
+                && *end_ptr == '\0' )
+        {
+            i++;
+        }
+        else if( strcmp( argv[ i ], "--compress" ) == 0 )
+        {
+            compress = 1;
+        }
+        else if( strcmp( argv[ i ], "--indexes" ) == 0 )
+        {
+            compress = 1;
+            book_set_indexes( 1 );
+        }
+        else if( argv[ i ][ 0 ] != '-' && filename == NULL )
+        {
+            filename = argv[ i ];
+        }
+        else
+        {
+            filename = NULL;
+            break;
+        }
+    }
+
+    if( filename == NULL )
+    {
+        fprintf( stderr, "Usage: %s [--count N] [--seed N] [--authors N] [--publishers N] "
+                         "[--skew S] [--description LENGTH] [--compress] [--indexes] FILE\n", argv[ 0 ] );
+        return EXIT_FAILURE;
+    }
+
+    if( ( gen = book_gen_create( &config ) ) == NULL )
+    {
+        perror( "book_gen_create" );
+        return EXIT_FAILURE;
+    }
+
+    clock_gettime( CLOCK_MONOTONIC, &start );
+
+    if( compress )
+    {
+        status = -1;
+
+        if( ( book = book_gen_book( gen, count ) ) != NULL )
+        {
+            status = book_save( filename, book, 1 );
+            book_destroy( book, 1 );
+        }
+    }
+    else if( ( file = fopen( filename, "w" ) ) == NULL )
+    {
+        status = -1;
+    }
+    else
+    {
+        status = book_gen_write( file, gen, ( unsigned )count );
+
+        if( fclose( file ) == EOF && status == 0 )
+        {
+            errno = EIO;
+            status = -1;
+        }
+    }
+
+    book_gen_destroy( gen );
+
+    if( status == -1 )
+    {
+        perror( filename );
+        return EXIT_FAILURE;
+    }
+
+    clock_gettime( CLOCK_MONOTONIC, &end );
+    fprintf( stderr, "%lu entries written to %s in %.2f s\n", count, filename,
+             ( double )( end.tv_sec - start.tv_sec ) + ( double )( end.tv_nsec - start.tv_nsec ) / 1e9 );
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,258 @@
+#include <lz.h>
+
+#define LZ_MIN_MATCH    4
+#define LZ_HASH_BITS    14
+#define LZ_TAIL         8
+
+static unsigned lz_load( const unsigned char *p )
+{
+    unsigned value;
+
+    memcpy( &value, p, sizeof( value ) );
+
+    return value;
+}
+
+static unsigned lz_hash( unsigned value )
+{
+    return ( value * 2654435761U ) >> ( 32 - LZ_HASH_BITS );
+}
+
+static unsigned char *lz_length( unsigned char *op, unsigned char *oend,
+                                 unsigned long long len )
+{
+    for( ; len >= 255; len -= 255 )
+    {
+        if( op >= oend )
+        {
+            return NULL;
+        }
+
+        *op++ = 255;
+    }
+
+    if( op >= oend )
+    {
+        return NULL;
+    }
+
+    *op++ = ( unsigned char )len;
+
+    return op;
+}
+
+static unsigned char *lz_sequence( unsigned char *op, unsigned char *oend,
+                                   const unsigned char *literals,
+                                   unsigned long long count,
+                                   unsigned offset, unsigned long long match )
+{
+    unsigned char *token;
+
+    if( op >= oend )
+    {
+        return NULL;
+    }
+
+    token = op++;
+    *token = ( unsigned char )( ( count < 15 ? count : 15 ) << 4 );
+
+    if( count >= 15 && ( op = lz_length( op, oend, count - 15 ) ) == NULL )
+    {
+        return NULL;
+    }
+
+    if( count > ( unsigned long long )( oend - op ) )
+    {
+        return NULL;
+    }
+
+    memcpy( op, literals, count );
+    op += count;
+
+    if( match == 0 )
+    {
+        return op;
+    }
+
+    if( oend - op < 2 )
+    {
+        return NULL;
+    }
+
+    *op++ = ( unsigned char )( offset & 0xFF );
+    *op++ = ( unsigned char )( offset >> 8 );
+    match -= LZ_MIN_MATCH;
+    *token |= ( unsigned char )( match < 15 ? match : 15 );
+
+    if( match >= 15 && ( op = lz_length( op, oend, match - 15 ) ) == NULL )
+    {
+        return NULL;
+    }
+
+    return op;
+}
+
+unsigned long long lz_bound( unsigned long long len )
+{
+    return len + len / 255 + 16;
+}
+
+unsigned long long lz_compress( const char *src, unsigned long long len,
+                                char *dst, unsigned long long cap )
+{
+    const unsigned char *base, *anchor, *ip, *ref, *limit, *end;
+    unsigned char *op, *oend;
+    unsigned long long *table, match, step;
+    unsigned value, slot;
+
+    if( ( table = calloc( 1U << LZ_HASH_BITS, sizeof( unsigned long long ) ) ) == NULL )
+    {
+        return 0;
+    }
+
+    base = ( const unsigned char* )src;
+    anchor = ip = base;
+    end = base + len;
+    limit = len > LZ_TAIL ? end - LZ_TAIL : base;
+    op = ( unsigned char* )dst;
+    oend = op + cap;
+    step = 0;
+
+    while( ip < limit )
+    {
+        value = lz_load( ip );
+        slot = lz_hash( value );
+        ref = table[ slot ] != 0 ? base + table[ slot ] - 1 : NULL;
+        table[ slot ] = ( unsigned long long )( ip - base ) + 1;
+
+        if( ref == NULL || ip - ref > LZ_WINDOW || lz_load( ref ) != value )
+        {
+            ip += 1 + ( step++ >> 6 );
+            continue;
+        }
+
+        for( match = LZ_MIN_MATCH;
+                ip + match < limit && ref[ match ] == ip[ match ]; match++ );
+
+        if( ( op = lz_sequence( op, oend, anchor, ( unsigned long long )( ip - anchor ),
+                                ( unsigned )( ip - ref ), match ) ) == NULL )
+        {
+            free( table );
+            return 0;
+        }
+
+        ip += match;
+        anchor = ip;
+        step = 0;
+    }
+
+    free( table );
+
+    if( ( op = lz_sequence( op, oend, anchor, ( unsigned long long )( end - anchor ),
+                            0, 0 ) ) == NULL )
+    {
+        return 0;
+    }
+
+    return ( unsigned long long )( op - ( unsigned char* )dst );
+}
+
+int lz_decompress( const char *src, unsigned long long len,
+                   char *dst, unsigned long long size )
+{
+    const unsigned char *ip, *iend, *ref;
+    unsigned char *op, *oend;
+    unsigned long long count;
+    unsigned token, offset, byte;
+
+    ip = ( const unsigned char* )src;
+    iend = ip + len;
+    op = ( unsigned char* )dst;
+    oend = op + size;
+
+    while( ip < iend )
+    {
+        token = *ip++;
+        count = token >> 4;
+
+        if( count == 15 )
+        {
+            do
+            {
+                if( ip >= iend )
+                {
+                    return -1;
+                }
+
+                byte = *ip++;
+                count += byte;
+            } while( byte == 255 );
+        }
+
+        if( count > ( unsigned long long )( iend - ip )
+                || count > ( unsigned long long )( oend - op ) )
+        {
+            return -1;
+        }
+
+        memcpy( op, ip, count );
+        ip += count;
+        op += count;
+
+        if( ip == iend )
+        {
+            break;
+        }
+
+        if( iend - ip < 2 )
+        {
+            return -1;
+        }
+
+        offset = ip[ 0 ] | ( unsigned )ip[ 1 ] << 8;
+        ip += 2;
+
+        if( offset == 0 || offset > ( unsigned long long )( op - ( unsigned char* )dst ) )
+        {
+            return -1;
+        }
+
+        count = ( token & 15 ) + LZ_MIN_MATCH;
+
+        if( ( token & 15 ) == 15 )
+        {
+            do
+            {
+                if( ip >= iend )
+                {
+                    return -1;
+                }
+
+                byte = *ip++;
+                count += byte;
+            } while( byte == 255 );
+        }
+
+        if( count > ( unsigned long long )( oend - op ) )
+        {
+            return -1;
+        }
+
+        ref = op - offset;
+
+        if( offset >= count )
+        {
+            memcpy( op, ref, count );
+            op += count;
+        }
+        else
+        {
+            while( count-- > 0 )
+            {
+                *op++ = *ref++;
+            }
+        }
+    }
+
+    return op == oend ? 0 : -1;
+}
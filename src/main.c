@@ -1,10 +1,17 @@
 #include <stdio.h>
 #include <string.h>
 #include <assert.h>
+#include <limits.h>
 #include <termios.h>
 #include <signal.h>
 #include <errno.h>
 #include <book.h>
+#include <book_file.h>
+#include <server.h>
+#include <credentials.h>
+#include <query.h>
+#include <aggregate.h>
+#include <stats.h>
 
 #define MAXLENGTH   512
 
@@ -17,48 +24,160 @@ typedef enum
     FIND_BY_AUTHOR,
     FIND_BY_PUBLISHER,
     EDIT,
-    DELETE
+    DELETE,
+    SEARCH,
+    GROUP
 } option_t;
 
+static const char *field_prompts[ ENTRY_FIELDS ] =
+{
+    "Book title",
+    "Author",
+    "Pages",
+    "Edition",
+    "Language",
+    "Publisher",
+    "Publication date",
+    "ISBN",
+    "Description"
+};
+
 struct termios saved_term;
 static int login( void );
 static entry_t *entry_prompt( void );
+static unsigned entry_list( book_t *book );
+static entry_t *entry_choose( book_t *book );
+static void entry_edit( book_t *book, entry_t *entry );
+static void entry_set( book_t *book, entry_t *entry, entry_field_t field, string_t *value );
+static void entry_delete( book_t *book, book_t *result, entry_t *entry );
+static void result_menu( book_t *book, book_t *result );
+static query_t *query_prompt( int *explain );
+static void group_report( book_t *book );
+static int serve( const char *path, int compress, int sharded, unsigned long long budget );
+static int hash_password( void );
 static void restore_terminal( void );
 static void sigint_handler( int sig );
+static void print_stats( void );
 
 int main( int argc, char *argv[ ] )
 {
-    int logged;
+    const char *path, *filename;
+    unsigned long long budget;
+    int logged, compress, sharded, unique, i;
+    char *end;
+
+    compress = 0;
+    sharded = 0;
+    unique = 0;
+    budget = 0;
+    path = NULL;
+    filename = NULL;
+
+    for( i = 1; i < argc; i++ )
+    {
+        if( strcmp( argv[ i ], "--compress" ) == 0 )
+        {
+            compress = 1;
+        }
+        else if( strcmp( argv[ i ], "--shards" ) == 0 )
+        {
+            sharded = 1;
+        }
+        else if( strcmp( argv[ i ], "--no-verify" ) == 0 )
+        {
+            book_set_verify( 0 );
+        }
+        else if( strcmp( argv[ i ], "--lazy" ) == 0 )
+        {
+            book_set_lazy( 1 );
+        }
+        else if( strcmp( argv[ i ], "--indexes" ) == 0 )
+        {
+            book_set_indexes( 1 );
+        }
+        else if( strcmp( argv[ i ], "--unique" ) == 0 )
+        {
+            unique = 1;
+        }
+        else if( strcmp( argv[ i ], "--stats" ) == 0 )
+        {
+            stats_set_enabled( 1 );
+            atexit( print_stats );
+        }
+        else if( strcmp( argv[ i ], "--serve" ) == 0 && i + 1 < argc )
+        {
+            path = argv[ ++i ];
+        }
+        else if( strcmp( argv[ i ], "--file" ) == 0 && i + 1 < argc )
+        {
+            filename = argv[ ++i ];
+        }
+        else if( strcmp( argv[ i ], "--budget" ) == 0 && i + 1 < argc
+                && ( budget = strtoull( argv[ i + 1 ], &end, 10 ) ) > 0 && *end == '\0'
+                && budget <= ULLONG_MAX / ( 1024 * 1024 ) )
+        {
+            budget *= 1024 * 1024;
+            i++;
+        }
+        else if( strcmp( argv[ i ], "--hash-password" ) == 0 )
+        {
+            return hash_password( );
+        }
+        else
+        {
+            fprintf( stderr, "Usage: %s [--compress] [--indexes] [--no-verify] [--lazy] [--unique] [--stats] "
+                             "[--serve SOCKET [--file FILE] [--budget MIB] [--shards]] "
+                             "[--hash-password]\n", argv[ 0 ] );
+            return EXIT_FAILURE;
+        }
+    }
+
+    if( ( filename != NULL || budget > 0 || sharded ) && path == NULL )
+    {
+        fprintf( stderr, "%s: --file, --budget and --shards require --serve\n", argv[ 0 ] );
+        return EXIT_FAILURE;
+    }
+
+    if( path != NULL )
+    {
+        if( filename != NULL )
+        {
+            strncpy( FILENAME, filename, MAXLENGTH - 1 );
+        }
+        else if( ( logged = login( ) ) != 1 )
+        {
+            printf( "Fail to login\n" );
+            return EXIT_FAILURE;
+        }
+
+        return serve( path, compress, sharded, budget );
+    }
 
     logged = login( );
 
     if( logged == 1 )
     {
         book_t *book;
-        FILE *file;
-        int option;
-
+        int option, packed;
 
         printf( "User logged in successful\n" );
 
-        if( ( file = fopen( FILENAME, "r" ) ) == NULL )
+        if( ( book = book_load( FILENAME, &packed ) ) == NULL )
         {
-            if( errno == ENOENT )
-            {
-                book = book_create( );
-            }
-            else
-            {
-                perror( "fopen" );
-                return EXIT_FAILURE;
-            }
+            perror( "book_load" );
+            return EXIT_FAILURE;
         }
-        else
+
+        if( unique && book_set_unique( book, 1 ) == -1 )
         {
-            book = book_read( file );
-            fclose( file );
+            perror( "book_set_unique" );
+            book_destroy( book, 1 );
+
+            return EXIT_FAILURE;
         }
 
+        compress = compress || packed;
+
         do {
             printf( "\
 [1] Add new entry\n\
@@ -68,6 +187,8 @@ int main( int argc, char *argv[ ] )
 [5] Find entries by publisher\n\
 [6] Edit an entry\n\
 [7] Delete an entry\n\
+[8] Search entries\n\
+[9] Group entries\n\
 [0] Exit\n\
 --> " );
             scanf( "%d", &option );
@@ -79,17 +200,29 @@ int main( int argc, char *argv[ ] )
                     {
                         entry_t *entry;
 
-                        entry = entry_prompt( );
+                        if( ( entry = entry_prompt( ) ) == NULL )
+                        {
+                            errno = ENOMEM;
+                            perror( "entry_prompt" );
+                            break;
+                        }
+
+                        if( book_add_take( book, entry ) == 0 )
+                        {
+                            printf( "Book added to book store!\n" );
+                            break;
+                        }
 
-                        if( book_add( book, entry ) == -1 )
+                        if( errno == EEXIST )
                         {
-                            perror( "book_add" );
+                            printf( "An entry with this ISBN is already in the book store\n" );
                         }
                         else
                         {
-                            printf( "Book added to book store!\n" );
-                            entry_destroy( entry );
+                            perror( "book_add_take" );
                         }
+
+                        entry_destroy( entry );
                     } break;
                 case DISPLAY:
                     {
@@ -108,491 +241,179 @@ int main( int argc, char *argv[ ] )
                         }
                     } break;
                 case FIND_BY_TITLE:
+                case FIND_BY_AUTHOR:
+                case FIND_BY_PUBLISHER:
                     {
-                        char title[ MAXLENGTH ];
+                        char value[ MAXLENGTH ];
                         book_t *result;
-                        entry_node_t *it;
-                        int next_option;
-                        unsigned count;
 
-                        printf( "Enter Book title: " );
-                        scanf( "%[^\n]", title );
+                        value[ 0 ] = '\0';
+                        printf( "Enter %s: ", field_prompts[ option == FIND_BY_TITLE ? ENTRY_TITLE
+                                              : option == FIND_BY_AUTHOR ? ENTRY_AUTHOR
+                                              : ENTRY_PUBLISHER ] );
+                        scanf( "%[^\n]", value );
                         while( getchar( ) != '\n' );
 
-                        result = book_find_by_title( book, title );
-                        it = result->a_head;
-                        count = 0;
-
-                        printf( "List of entries found\n" );
-
-                        while( it != NULL )
+                        if( option == FIND_BY_TITLE )
                         {
-                            printf( "%d. %s, %s (%s)\n", count + 1,
-                                    it->n_entry->e_author->s_ptr,
-                                    it->n_entry->e_title->s_ptr,
-                                    it->n_entry->e_publisher->s_ptr );
-                            it = it->n_next;
-                            count++;
+                            result = book_find_by_title( book, value );
+                        }
+                        else if( option == FIND_BY_AUTHOR )
+                        {
+                            result = book_find_by_author( book, value );
+                        }
+                        else
+                        {
+                            result = book_find_by_publisher( book, value );
                         }
 
-                        if( count == 0 )
+                        if( result == NULL )
                         {
-                            printf( "No results found for \"%s\"", title );
+                            perror( "book_find" );
                             break;
                         }
 
-                        do {
-                            printf( "\
-[1] Edit found entry\n\
-[2] Delete found entry\n\
-[3] Display entry information\n\
-[0] Exit\n\
---> " );
-                            scanf( "%d", &next_option );
-                            while( getchar( ) != '\n' );
-
-                            switch( next_option )
-                            {
-                                case 1:
-                                    {
-                                        entry_t *entry;
-                                        int field_option;
-                                        unsigned index;
-
-                                        do {
-                                            printf( "Enter index from list: " );
-                                            scanf( "%d", &index );
-                                            while( getchar( ) != '\n' );
-                                        } while( index-1 > count );
-
-                                        entry = book_get( book, index-1 )->n_entry;
-
-                                        do {
-                                            printf( "\
-What field to wish to edit?\n\
-[ 1] Book title\n\
-[ 2] Author\n\
-[ 3] Pages\n\
-[ 4] Edition\n\
-[ 5] Language\n\
-[ 6] Publisher\n\
-[ 7] Publication date\n\
-[ 8] ISBN\n\
-[ 9] Description\n\
-[10] All fields\n\
-[ 0] Exit\n\
---> " );
-                                            scanf( "%d", &field_option );
-                                            while( getchar( ) != '\n' );
-
-                                            switch( field_option )
-                                            {
-                                                case 1:
-                                                    {
-                                                        string_t *title;
-
-                                                        printf( "Enter Book title: " );
-                                                        title = string_scan( stdin );
-
-                                                        entry_set_title( entry, title );
-                                                    } break;
-                                                case 2:
-                                                    {
-                                                        string_t *author;
-
-                                                        printf( "Enter Author: " );
-                                                        author = string_scan( stdin );
-
-                                                        entry_set_author( entry, author );
-                                                    } break;
-                                                case 3:
-                                                    {
-                                                        string_t *pages;
-
-                                                        printf( "Enter Pages: " );
-                                                        pages = string_scan( stdin );
-
-                                                        entry_set_pages( entry, pages );
-                                                    } break;
-                                                case 4:
-                                                    {
-                                                        string_t *edition;
-
-                                                        printf( "Enter Edition: " );
-                                                        edition = string_scan( stdin );
-
-                                                        entry_set_edition( entry, edition );
-                                                    } break;
-                                                case 5:
-                                                    {
-                                                        string_t *language;
-
-                                                        printf( "Enter Language: " );
-                                                        language = string_scan( stdin );
-
-                                                        entry_set_language( entry, language );
-                                                    } break;
-                                                case 6:
-                                                    {
-                                                        string_t *publisher;
-
-                                                        printf( "Enter Publisher: " );
-                                                        publisher = string_scan( stdin );
-                                                        
-                                                        entry_set_publisher( entry, publisher );
-                                                    } break;
-                                                case 7:
-                                                    {
-                                                        string_t *pubdate;
-
-                                                        printf( "Enter Publication date: " );
-                                                        pubdate = string_scan( stdin );
-
-                                                        entry_set_pubdate( entry, pubdate );
-                                                    } break;
-                                                case 8:
-                                                    {
-                                                        string_t *isbn;
-
-                                                        printf( "Enter ISBN: " );
-                                                        isbn = string_scan( stdin );
-
-                                                        entry_set_isbn( entry, isbn );
-                                                    } break;
-                                                case 9:
-                                                    {
-                                                        string_t *description;
-
-                                                        printf( "Description: " );
-                                                        description = string_scan( stdin );
-
-                                                        entry_set_description( entry, description );
-                                                    } break;
-                                                case 10:
-                                                    {
-                                                        entry_destroy( entry );
-                                                        entry = entry_prompt( );
-                                                    } break;
-                                            }
-                                        } while( field_option != 0 );
-
-                                    } break;
-                                case 2:
-                                    {
-                                        entry_node_t *it;
-                                        entry_t *entry;
-                                        unsigned index;
-
-                                        do {
-                                            printf( "Enter index from list: " );
-                                            scanf( "%d", &index );
-                                            while( getchar( ) != '\n' );
-                                        } while( index-1 > count );
-
-                                        entry = book_get( book, index-1 )->n_entry;
-                                        it = book->a_head;
-
-                                        while( it != NULL && it->n_entry != entry )
-                                        {
-                                            it = it->n_next;
-                                        }
-
-                                        book_remove( book, it );
-                                        printf( "Book removed successfully\n" );
-                                    } break;
-                                case 3:
-                                    {
-                                        entry_t *entry;
-                                        unsigned index;
-
-                                        do {
-                                            printf( "Enter index from list: " );
-                                            scanf( "%d", &index );
-                                            while( getchar( ) != '\n' );
-                                        } while( index-1 > count );
-
-                                        entry = book_get( book, index-1 )->n_entry;
-                                        entry_print( stdout, entry );
-                                    } break;
-                            }
-                        } while( next_option != 0 );
+                        printf( "List of entries found\n" );
+
+                        if( entry_list( result ) == 0 )
+                        {
+                            printf( "No results found for \"%s\"\n", value );
+                        }
+                        else
+                        {
+                            result_menu( book, result );
+                        }
 
                         book_destroy( result, 0 );
                     } break;
-                case FIND_BY_AUTHOR:
+                case EDIT:
                     {
-                        char author[ MAXLENGTH ];
-                        book_t *result;
-                        entry_node_t *it;
-                        int next_option;
-                        unsigned count;
-
-                        printf( "Enter Author: " );
-                        scanf( "%[^\n]", author );
-                        while( getchar( ) != '\n' );
-
-                        result = book_find_by_author( book, author );
-                        it = result->a_head;
-                        count = 0;
-
-                        printf( "List of entry found\n" );
+                        printf( "List of entries found\n" );
 
-                        while( it != NULL )
+                        if( entry_list( book ) == 0 )
                         {
-                            printf( "%d. %s, %s (%s)\n", count + 1,
-                                    it->n_entry->e_author->s_ptr,
-                                    it->n_entry->e_title->s_ptr,
-                                    it->n_entry->e_publisher->s_ptr );
-                            it = it->n_next;
-                            count++;
+                            printf( "There are no entries in your book store\n" );
+                            break;
                         }
 
-                        if( count == 0 )
+                        result_menu( book, book );
+                    } break;
+                case DELETE:
+                    {
+                        if( entry_list( book ) == 0 )
                         {
-                            printf( "No results found for \"%s\"", author );
+                            printf( "There are not entries in the book store.. EXITING\n" );
                             break;
                         }
 
-                        do {
-                            printf( "\
-[1] Edit found entry\n\
-[2] Delete found entry\n\
-[3] Display entry information\n\
-[0] Exit\n\
---> " );
-                            scanf( "%d", &next_option );
-                            while( getchar( ) != '\n' );
-
-                            switch( next_option )
-                            {
-                                case 1:
-                                    {
-                                        entry_t *entry;
-                                        int field_option;
-                                        unsigned index;
-
-                                        do {
-                                            printf( "Enter index from list: " );
-                                            scanf( "%d", &index );
-                                            while( getchar( ) != '\n' );
-                                        } while( index-1 > count );
-
-                                        entry = book_get( book, index-1 )->n_entry;
-
-                                        do {
-                                            printf( "\
-What field to wish to edit?\n\
-[ 1] Book title\n\
-[ 2] Author\n\
-[ 3] Pages\n\
-[ 4] Edition\n\
-[ 5] Language\n\
-[ 6] Publisher\n\
-[ 7] Publication date\n\
-[ 8] ISBN\n\
-[ 9] Description\n\
-[10] All fields\n\
-[ 0] Exit\n\
---> " );
-                                            scanf( "%d", &field_option );
-                                            while( getchar( ) != '\n' );
-
-                                            switch( field_option )
-                                            {
-                                                case 1:
-                                                    {
-                                                        string_t *title;
-
-                                                        printf( "Enter Book title: " );
-                                                        title = string_scan( stdin );
-
-                                                        entry_set_title( entry, title );
-                                                    } break;
-                                                case 2:
-                                                    {
-                                                        string_t *author;
-
-                                                        printf( "Enter Author: " );
-                                                        author = string_scan( stdin );
-
-                                                        entry_set_author( entry, author );
-                                                    } break;
-                                                case 3:
-                                                    {
-                                                        string_t *pages;
-
-                                                        printf( "Enter Pages: " );
-                                                        pages = string_scan( stdin );
-
-                                                        entry_set_pages( entry, pages );
-                                                    } break;
-                                                case 4:
-                                                    {
-                                                        string_t *edition;
-
-                                                        printf( "Enter Edition: " );
-                                                        edition = string_scan( stdin );
-
-                                                        entry_set_edition( entry, edition );
-                                                    } break;
-                                                case 5:
-                                                    {
-                                                        string_t *language;
-
-                                                        printf( "Enter Language: " );
-                                                        language = string_scan( stdin );
-
-                                                        entry_set_language( entry, language );
-                                                    } break;
-                                                case 6:
-                                                    {
-                                                        string_t *publisher;
-                                                        
-                                                        printf( "Enter Publisher: " );
-                                                        publisher = string_scan( stdin );
-                                                        
-                                                        entry_set_publisher( entry, publisher );
-                                                    } break;
-                                                case 7:
-                                                    {
-                                                        string_t *pubdate;
-
-                                                        printf( "Enter Publication date: " );
-                                                        pubdate = string_scan( stdin );
-
-                                                        entry_set_pubdate( entry, pubdate );
-                                                    } break;
-                                                case 8:
-                                                    {
-                                                        string_t *isbn;
-
-                                                        printf( "Enter ISBN: " );
-                                                        isbn = string_scan( stdin );
-
-                                                        entry_set_isbn( entry, isbn );
-                                                    } break;
-                                                case 9:
-                                                    {
-                                                        string_t *description;
-
-                                                        printf( "Description: " );
-                                                        description = string_scan( stdin );
-
-                                                        entry_set_description( entry, description );
-                                                    } break;
-                                                case 10:
-                                                    {
-                                                        entry_destroy( entry );
-                                                        entry = entry_prompt( );
-                                                    } break;
-                                            }
-                                        } while( field_option != 0 );
-
-                                    } break;
-                                case 2:
-                                    {
-                                        entry_node_t *it;
-                                        entry_t *entry;
-                                        unsigned index;
-
-                                        do {
-                                            printf( "Enter index from list: " );
-                                            scanf( "%d", &index );
-                                            while( getchar( ) != '\n' );
-                                        } while( index-1 > count );
-
-                                        entry = book_get( book, index-1 )->n_entry;
-                                        it = book->a_head;
-
-                                        while( it != NULL && it->n_entry != entry )
-                                        {
-                                            it = it->n_next;
-                                        }
-
-                                        book_remove( book, it );
-                                        printf( "Book removed successfully\n" );
-                                    } break;
-                                case 3:
-                                    {
-                                        entry_t *entry;
-                                        unsigned index;
-
-                                        do {
-                                            printf( "Enter index from list: " );
-                                            scanf( "%d", &index );
-                                            while( getchar( ) != '\n' );
-                                        } while( index-1 > count );
-
-                                        entry = book_get( book, index-1 )->n_entry;
-                                        entry_print( stdout, entry );
-                                    } break;
-                            }
-                        } while( next_option != 0 );
-
-                        book_destroy( result, 0 );
+                        entry_delete( book, book, entry_choose( book ) );
+                        printf( "Entry successfully removed\n" );
                     } break;
-                case FIND_BY_PUBLISHER:
+                case SEARCH:
                     {
-                        char publisher[ MAXLENGTH ];
+                        query_plan_t plan;
+                        query_t *query;
                         book_t *result;
-                        entry_node_t *it;
-                        int next_option;
-                        unsigned count;
+                        int explain;
 
-                        printf( "Enter Publisher: " );
-                        scanf( "%[^\n]", publisher );
-                        while( getchar( ) != '\n' );
+                        if( ( query = query_prompt( &explain ) ) == NULL )
+                        {
+                            printf( "No search criteria given\n" );
+                            break;
+                        }
 
-                        result = book_find_by_publisher( book, publisher );
-                        it = result->a_head;
-                        count = 0;
+                        result = book_query( book, query, &plan );
+                        query_destroy( query );
 
-                        printf( "List of entries found\n" );
+                        if( result == NULL )
+                        {
+                            perror( "book_query" );
+                            break;
+                        }
 
-                        while( it != NULL )
+                        if( explain )
                         {
-                            printf( "%d. %s, %s (%s)\n", count + 1,
-                                    it->n_entry->e_author->s_ptr,
-                                    it->n_entry->e_title->s_ptr,
-                                    it->n_entry->e_publisher->s_ptr );
-                            it = it->n_next;
-                            count++;
+                            query_plan_print( stdout, &plan );
                         }
 
-                        if( count == 0 )
+                        printf( "List of entries found\n" );
+
+                        if( entry_list( result ) == 0 )
                         {
-                            printf( "No results found for \"%s\"", publisher );
-                            break;
+                            printf( "No results found\n" );
+                        }
+                        else
+                        {
+                            result_menu( book, result );
                         }
 
-                        do {
-                            printf( "\
-[1] Edit found entry\n\
-[2] Delete found entry\n\
-[3] Display entry information\n\
-[0] Exit\n\
---> " );
-                            scanf( "%d", &next_option );
-                            while( getchar( ) != '\n' );
-
-                            switch( next_option )
-                            {
-                                case 1:
-                                    {
-                                        entry_t *entry;
-                                        int field_option;
-                                        unsigned index;
-
-                                        do {
-                                            printf( "Enter index from list: " );
-                                            scanf( "%d", &index );
-                                            while( getchar( ) != '\n' );
-                                        } while( index-1 > count );
-
-                                        entry = book_get( book, index-1 )->n_entry;
-
-                                        do {
-                                            printf( "\
+                        book_destroy( result, 0 );
+                    } break;
+                case GROUP:
+                    group_report( book );
+                    break;
+            }
+        } while( option != 0 );
+
+        if( book_save( FILENAME, book, compress ) == -1 )
+        {
+            perror( "book_save" );
+            book_destroy( book, 1 );
+
+            return EXIT_FAILURE;
+        }
+
+        book_destroy( book, 1 );
+    }
+    else if( logged == 0 )
+    {
+        printf( "Fail to login\n" );
+    }
+
+    return 0;
+}
+
+unsigned entry_list( book_t *book )
+{
+    entry_node_t *it;
+    unsigned count;
+
+    it = book->a_head;
+    count = 0;
+
+    while( it != NULL )
+    {
+        printf( "%d. %s, %s (%s)\n", count + 1,
+                it->n_entry->e_author->s_ptr,
+                it->n_entry->e_title->s_ptr,
+                it->n_entry->e_publisher->s_ptr );
+        it = it->n_next;
+        count++;
+    }
+
+    return count;
+}
+
+entry_t *entry_choose( book_t *book )
+{
+    unsigned index;
+
+    do {
+        index = 0;
+        printf( "Enter index from list: " );
+        scanf( "%u", &index );
+        while( getchar( ) != '\n' );
+    } while( index < 1 || index > book->a_count );
+
+    return book_get( book, index-1 )->n_entry;
+}
+
+void entry_edit( book_t *book, entry_t *entry )
+{
+    int field_option;
+
+    do {
+        printf( "\
 What field to wish to edit?\n\
 [ 1] Book title\n\
 [ 2] Author\n\
@@ -606,422 +427,322 @@ What field to wish to edit?\n\
 [10] All fields\n\
 [ 0] Exit\n\
 --> " );
-                                            scanf( "%d", &field_option );
-                                            while( getchar( ) != '\n' );
-
-                                            switch( field_option )
-                                            {
-                                                case 1:
-                                                    {
-                                                        string_t *title;
-
-                                                        printf( "Enter Book title: " );
-                                                        title = string_scan( stdin );
-
-                                                        entry_set_title( entry, title );
-                                                    } break;
-                                                case 2:
-                                                    {
-                                                        string_t *author;
-
-                                                        printf( "Enter Author: " );
-                                                        author = string_scan( stdin );
-
-                                                        entry_set_author( entry, author );
-                                                    } break;
-                                                case 3:
-                                                    {
-                                                        string_t *pages;
-
-                                                        printf( "Enter Pages: " );
-                                                        pages = string_scan( stdin );
-
-                                                        entry_set_pages( entry, pages );
-                                                    } break;
-                                                case 4:
-                                                    {
-                                                        string_t *edition;
-
-                                                        printf( "Enter Edition: " );
-                                                        edition = string_scan( stdin );
-
-                                                        entry_set_edition( entry, edition );
-                                                    } break;
-                                                case 5:
-                                                    {
-                                                        string_t *language;
-
-                                                        printf( "Enter Language: " );
-                                                        language = string_scan( stdin );
-
-                                                        entry_set_language( entry, language );
-                                                    } break;
-                                                case 6:
-                                                    {
-                                                        string_t *publisher;
-                                                           
-                                                        printf( "Enter Publisher: " );
-                                                        publisher = string_scan( stdin );
-                                                        
-                                                        entry_set_publisher( entry, publisher );
-                                                    } break;
-                                                case 7:
-                                                    {
-                                                        string_t *pubdate;
-
-                                                        printf( "Enter Publication date: " );
-                                                        pubdate = string_scan( stdin );
-
-                                                        entry_set_pubdate( entry, pubdate );
-                                                    } break;
-                                                case 8:
-                                                    {
-                                                        string_t *isbn;
-
-                                                        printf( "Enter ISBN: " );
-                                                        isbn = string_scan( stdin );
-
-                                                        entry_set_isbn( entry, isbn );
-                                                    } break;
-                                                case 9:
-                                                    {
-                                                        string_t *description;
-
-                                                        printf( "Description: " );
-                                                        description = string_scan( stdin );
-
-                                                        entry_set_description( entry, description );
-                                                    } break;
-                                                case 10:
-                                                    {
-                                                        entry_destroy( entry );
-                                                        entry = entry_prompt( );
-                                                    } break;
-                                            }
-                                        } while( field_option != 0 );
-
-                                    } break;
-                                case 2:
-                                    {
-                                        entry_node_t *it;
-                                        entry_t *entry;
-                                        unsigned index;
-
-                                        do {
-                                            printf( "Enter index from list: " );
-                                            scanf( "%d", &index );
-                                            while( getchar( ) != '\n' );
-                                        } while( index-1 > count );
-
-                                        entry = book_get( book, index-1 )->n_entry;
-                                        it = book->a_head;
-
-                                        while( it != NULL && it->n_entry != entry )
-                                        {
-                                            it = it->n_next;
-                                        }
-
-                                        book_remove( book, it );
-                                        printf( "Book removed successfully\n" );
-                                    } break;
-                                case 3:
-                                    {
-                                        entry_t *entry;
-                                        unsigned index;
-
-                                        do {
-                                            printf( "Enter index from list: " );
-                                            scanf( "%d", &index );
-                                            while( getchar( ) != '\n' );
-                                        } while( index-1 > count );
-
-                                        entry = book_get( book, index-1 )->n_entry;
-                                        entry_print( stdout, entry );
-                                    } break;
-                            }
-                        } while( next_option != 0 );
+        scanf( "%d", &field_option );
+        while( getchar( ) != '\n' );
 
-                        book_destroy( result, 0 );
-                    } break;
-                case EDIT:
-                    {
-                        entry_node_t *it;
-                        int next_option;
-                        unsigned count;
+        if( field_option >= 1 && field_option <= ENTRY_FIELDS )
+        {
+            printf( "Enter %s: ", field_prompts[ field_option - 1 ] );
+            entry_set( book, entry, field_option - 1, string_scan( stdin ) );
+        }
+        else if( field_option == 10 )
+        {
+            entry_t *fields;
+            int field;
 
-                        it = book->a_head;
-                        count = 0;
+            if( ( fields = entry_prompt( ) ) == NULL )
+            {
+                perror( "entry_prompt" );
+                continue;
+            }
 
-                        printf( "List of entries found\n" );
+            for( field = 0; field < ENTRY_FIELDS; field++ )
+            {
+                entry_set( book, entry, field,
+                        string_duplicate( entry_get_field( fields, field ) ) );
+            }
 
-                        while( it != NULL )
-                        {
-                            printf( "%d. %s, %s (%s)\n", count + 1,
-                                    it->n_entry->e_author->s_ptr,
-                                    it->n_entry->e_title->s_ptr,
-                                    it->n_entry->e_publisher->s_ptr );
-                            it = it->n_next;
-                            count++;
-                        }
+            entry_destroy( fields );
+        }
+    } while( field_option != 0 );
+}
 
-                        if( count == 0 )
-                        {
-                            printf( "There are no entries in your book store\n" );
-                            break;
-                        }
+void entry_set( book_t *book, entry_t *entry, entry_field_t field, string_t *value )
+{
+    if( book_set_field( book, entry, field, value ) == -1 )
+    {
+        if( errno == EEXIST )
+        {
+            printf( "An entry with this ISBN is already in the book store\n" );
+        }
+        else
+        {
+            perror( "book_set_field" );
+        }
+
+        string_destroy( value );
+    }
+}
+
+void entry_delete( book_t *book, book_t *result, entry_t *entry )
+{
+    entry_node_t *it;
+
+    for( it = book->a_head; it != NULL && it->n_entry != entry; it = it->n_next );
+
+    if( it != NULL )
+    {
+        book_remove( book, it );
+    }
+
+    if( result != book )
+    {
+        for( it = result->a_head; it != NULL && it->n_entry != entry; it = it->n_next );
+
+        if( it != NULL )
+        {
+            book_remove( result, it );
+        }
+    }
 
-                        do {
-                            printf( "\
-[1] Edit entry\n\
-[2] Delete entry\n\
+    entry_destroy( entry );
+}
+
+void result_menu( book_t *book, book_t *result )
+{
+    int next_option;
+
+    do {
+        if( result->a_count == 0 )
+        {
+            printf( "There are no entries left in the list\n" );
+            break;
+        }
+
+        printf( "\
+[1] Edit found entry\n\
+[2] Delete found entry\n\
 [3] Display entry information\n\
 [0] Exit\n\
 --> " );
-                            scanf( "%d", &next_option );
-                            while( getchar( ) != '\n' );
-
-                            switch( next_option )
-                            {
-                                case 1:
-                                    {
-                                        entry_t *entry;
-                                        int field_option;
-                                        unsigned index;
-
-                                        do {
-                                            printf( "Enter index from list: " );
-                                            scanf( "%d", &index );
-                                            while( getchar( ) != '\n' );
-                                        } while( index-1 > count );
-
-                                        entry = book_get( book, index-1 )->n_entry;
-
-                                        do {
-                                            printf( "\
-What field to wish to edit?\n\
-[ 1] Book title\n\
-[ 2] Author\n\
-[ 3] Pages\n\
-[ 4] Edition\n\
-[ 5] Language\n\
-[ 6] Publisher\n\
-[ 7] Publication date\n\
-[ 8] ISBN\n\
-[ 9] Description\n\
-[10] All fields\n\
-[ 0] Exit\n\
---> " );
-                                            scanf( "%d", &field_option );
-                                            while( getchar( ) != '\n' );
-
-                                            switch( field_option )
-                                            {
-                                                case 1:
-                                                    {
-                                                        string_t *title;
-
-                                                        printf( "Enter Book title: " );
-                                                        title = string_scan( stdin );
-
-                                                        entry_set_title( entry, title );
-                                                    } break;
-                                                case 2:
-                                                    {
-                                                        string_t *author;
-
-                                                        printf( "Enter Author: " );
-                                                        author = string_scan( stdin );
-
-                                                        entry_set_author( entry, author );
-                                                    } break;
-                                                case 3:
-                                                    {
-                                                        string_t *pages;
-
-                                                        printf( "Enter Pages: " );
-                                                        pages = string_scan( stdin );
-
-                                                        entry_set_pages( entry, pages );
-                                                    } break;
-                                                case 4:
-                                                    {
-                                                        string_t *edition;
-
-                                                        printf( "Enter Edition: " );
-                                                        edition = string_scan( stdin );
-
-                                                        entry_set_edition( entry, edition );
-                                                    } break;
-                                                case 5:
-                                                    {
-                                                        string_t *language;
-
-                                                        printf( "Enter Language: " );
-                                                        language = string_scan( stdin );
-
-                                                        entry_set_language( entry, language );
-                                                    } break;
-                                                case 6:
-                                                    {
-                                                        string_t *publisher;
-                                                        
-                                                        printf( "Enter Publisher: " );
-                                                        publisher = string_scan( stdin );
-                                                        
-                                                        entry_set_publisher( entry, publisher );
-                                                    } break;
-                                                case 7:
-                                                    {
-                                                        string_t *pubdate;
-
-                                                        printf( "Enter Publication date: " );
-                                                        pubdate = string_scan( stdin );
-
-                                                        entry_set_pubdate( entry, pubdate );
-                                                    } break;
-                                                case 8:
-                                                    {
-                                                        string_t *isbn;
-
-                                                        printf( "Enter ISBN: " );
-                                                        isbn = string_scan( stdin );
-
-                                                        entry_set_isbn( entry, isbn );
-                                                    } break;
-                                                case 9:
-                                                    {
-                                                        string_t *description;
-
-                                                        printf( "Description: " );
-                                                        description = string_scan( stdin );
-
-                                                        entry_set_description( entry, description );
-                                                    } break;
-                                                case 10:
-                                                    {
-                                                        entry_destroy( entry );
-                                                        entry = entry_prompt( );
-                                                    } break;
-                                            }
-                                        } while( field_option != 0 );
-
-                                    } break;
-                                case 2:
-                                    {
-                                        entry_node_t *it;
-                                        entry_t *entry;
-                                        unsigned index;
-
-                                        do {
-                                            printf( "Enter index from list: " );
-                                            scanf( "%d", &index );
-                                            while( getchar( ) != '\n' );
-                                        } while( index-1 > count );
-
-                                        entry = book_get( book, index-1 )->n_entry;
-                                        it = book->a_head;
-
-                                        while( it != NULL && it->n_entry != entry )
-                                        {
-                                            it = it->n_next;
-                                        }
-
-                                        book_remove( book, it );
-                                        printf( "Book removed successfully\n" );
-                                    } break;
-                                case 3:
-                                    {
-                                        entry_t *entry;
-                                        unsigned index;
-
-                                        do {
-                                            printf( "Enter index from list: " );
-                                            scanf( "%d", &index );
-                                            while( getchar( ) != '\n' );
-                                        } while( index-1 > count );
-
-                                        entry = book_get( book, index-1 )->n_entry;
-                                        entry_print( stdout, entry );
-                                    } break;
-                            }
-                        } while( next_option != 0 );
-                    } break;
-                case DELETE:
-                    {
-                        unsigned count, index;
-                        entry_node_t *it;
+        scanf( "%d", &next_option );
+        while( getchar( ) != '\n' );
 
-                        it = book->a_head;
-                        count = 0;
+        switch( next_option )
+        {
+            case 1:
+                entry_edit( book, entry_choose( result ) );
+                break;
+            case 2:
+                entry_delete( book, result, entry_choose( result ) );
+                printf( "Book removed successfully\n" );
+                break;
+            case 3:
+                entry_print( stdout, entry_choose( result ) );
+                break;
+        }
+    } while( next_option != 0 );
+}
 
-                        while( it != NULL )
-                        {
-                            printf( "%d. %s, %s (%s)\n", count + 1,
-                                    it->n_entry->e_author->s_ptr,
-                                    it->n_entry->e_title->s_ptr,
-                                    it->n_entry->e_publisher->s_ptr );
-                            it = it->n_next;
-                            count++;
-                        }
+query_t *query_prompt( int *explain )
+{
+    static const entry_field_t fields[ ] =
+    {
+        ENTRY_TITLE, ENTRY_AUTHOR, ENTRY_PUBLISHER, ENTRY_LANGUAGE, ENTRY_ISBN,
+        ENTRY_DESCRIPTION
+    };
+    query_t *args[ 9 ], **combined;
+    string_t *from, *to;
+    unsigned count, i;
+    int option, answer;
+
+    count = 0;
+    printf( "\
+Leave a criterion blank to skip it, end a value with '*' to match a prefix\n\
+or enclose it in '*' to match a substring.\n" );
+
+    for( i = 0; i < sizeof( fields ) / sizeof( fields[ 0 ] ); i++ )
+    {
+        string_t *value;
 
-                        if( count == 0 )
-                        {
-                            printf( "There are not entries in the book store.. EXITING\n" );
-                            break;
-                        }
+        printf( "%s: ", field_prompts[ fields[ i ] ] );
 
-                        printf( "Enter index from list: " );
-                        scanf( "%d", &index );
-                        while( getchar( ) != '\n' );
+        if( ( value = string_scan( stdin ) ) == NULL )
+        {
+            continue;
+        }
 
-                        it = book->a_head;
+        if( value->s_len > 2 && value->s_ptr[ 0 ] == '*'
+                && value->s_ptr[ value->s_len - 1 ] == '*' )
+        {
+            value->s_ptr[ value->s_len - 1 ] = '\0';
+            args[ count++ ] = query_contains( fields[ i ], value->s_ptr + 1 );
+        }
+        else if( value->s_len > 0 && value->s_ptr[ value->s_len - 1 ] == '*' )
+        {
+            value->s_ptr[ value->s_len - 1 ] = '\0';
+            args[ count++ ] = query_prefix( fields[ i ], value->s_ptr );
+        }
+        else if( value->s_len > 0 )
+        {
+            args[ count++ ] = query_equal( fields[ i ], value->s_ptr );
+        }
 
-                        while( index > 1 )
-                        {
-                            it = it->n_next;
-                            index--;
-                        }
+        string_destroy( value );
+    }
 
-                        book_remove( book, it );
-                        printf( "Entry successfully removed\n" );
-                    } break;
-            }
-        } while( option != 0 );
+    printf( "Pages from: " );
+    from = string_scan( stdin );
+    printf( "Pages to: " );
+    to = string_scan( stdin );
+
+    if( from != NULL && to != NULL && ( from->s_len > 0 || to->s_len > 0 ) )
+    {
+        args[ count++ ] = query_range( ENTRY_PAGES,
+                from->s_len > 0 ? entry_parse_pages( from->s_ptr ) : 0,
+                to->s_len > 0 ? entry_parse_pages( to->s_ptr ) : LONG_MAX );
+    }
 
-        if( ( file = fopen( FILENAME, "w+" ) ) == NULL )
+    if( from != NULL ) string_destroy( from );
+    if( to != NULL ) string_destroy( to );
+
+    printf( "Publication date from (YYYY[-MM[-DD]]): " );
+    from = string_scan( stdin );
+    printf( "Publication date to (YYYY[-MM[-DD]]): " );
+    to = string_scan( stdin );
+
+    if( from != NULL && to != NULL && ( from->s_len > 0 || to->s_len > 0 ) )
+    {
+        long min, max;
+
+        min = from->s_len > 0 ? entry_parse_pubdate( from->s_ptr ) : 0;
+        max = to->s_len > 0 ? entry_parse_pubdate( to->s_ptr ) : LONG_MAX;
+
+        if( max != LONG_MAX && max % 10000 == 0 )
         {
-            perror( "fopen" );
-            return EXIT_FAILURE;
+            max += 1231;
         }
-        else
+        else if( max != LONG_MAX && max % 100 == 0 )
         {
-            book_write( file, book );
-            fclose( file );
+            max += 31;
         }
 
-        book_destroy( book, 1 );
+        args[ count++ ] = query_range( ENTRY_PUBDATE, min, max );
     }
-    else if( logged == 0 )
+
+    if( from != NULL ) string_destroy( from );
+    if( to != NULL ) string_destroy( to );
+
+    option = 1;
+
+    if( count > 1 )
     {
-        printf( "Fail to login\n" );
+        printf( "[1] Match all criteria\n[2] Match any criterion\n--> " );
+        scanf( "%d", &option );
+        while( getchar( ) != '\n' );
     }
 
-    return 0;
+    printf( "Explain the query plan? [y/n] " );
+    answer = getchar( );
+    *explain = answer == 'y' || answer == 'Y';
+
+    while( answer != '\n' && answer != EOF )
+    {
+        answer = getchar( );
+    }
+
+    if( count == 0 )
+    {
+        return NULL;
+    }
+
+    if( count == 1 )
+    {
+        return args[ 0 ];
+    }
+
+    if( ( combined = malloc( count * sizeof( query_t* ) ) ) == NULL )
+    {
+        for( i = 0; i < count; i++ )
+        {
+            if( args[ i ] != NULL )
+            {
+                query_destroy( args[ i ] );
+            }
+        }
+
+        return NULL;
+    }
+
+    memcpy( combined, args, count * sizeof( query_t* ) );
+
+    return query_combine( option == 2 ? QUERY_OR : QUERY_AND, combined, count );
+}
+
+void group_report( book_t *book )
+{
+    book_aggregate_t *aggregate;
+    int field, measure, order;
+    unsigned long limit;
+
+    printf( "\
+Group entries by\n\
+[1] Book title\n\
+[2] Author\n\
+[3] Pages\n\
+[4] Edition\n\
+[5] Language\n\
+[6] Publisher\n\
+[7] Publication date\n\
+[8] ISBN\n\
+--> " );
+    field = 0;
+    scanf( "%d", &field );
+    while( getchar( ) != '\n' );
+
+    printf( "Summarize\n[1] Pages\n[2] Publication date\n--> " );
+    measure = 0;
+    scanf( "%d", &measure );
+    while( getchar( ) != '\n' );
+
+    printf( "\
+Order groups by\n\
+[1] Number of entries\n\
+[2] Sum\n\
+[3] Mean\n\
+[4] Minimum\n\
+[5] Maximum\n\
+[6] Value\n\
+--> " );
+    order = 0;
+    scanf( "%d", &order );
+    while( getchar( ) != '\n' );
+
+    printf( "Number of groups to show (0 for all): " );
+    limit = 0;
+    scanf( "%lu", &limit );
+    while( getchar( ) != '\n' );
+
+    if( field < 1 || field > ENTRY_FIELDS - 1 || measure < 1 || measure > 2
+            || order < 1 || order > AGGREGATE_ORDERS )
+    {
+        printf( "Invalid option\n" );
+        return;
+    }
+
+    if( ( aggregate = book_aggregate( book, ( entry_field_t )( field - 1 ),
+                                      measure == 1 ? ENTRY_PAGES : ENTRY_PUBDATE ) ) == NULL )
+    {
+        perror( "book_aggregate" );
+        return;
+    }
+
+    book_aggregate_sort( aggregate, ( aggregate_order_t )( order - 1 ), limit );
+    book_aggregate_print( stdout, aggregate );
+    book_aggregate_destroy( aggregate );
 }
 
 int login( void )
 {
     struct termios tmp_term;
     struct sigaction sa_sigint;
+    static credentials_t *credentials;
     char username[ MAXLENGTH ],
-         password[ MAXLENGTH ],
-         scanned_line[ MAXLENGTH ],
-         scanned_username[ MAXLENGTH ],
-         scanned_password[ MAXLENGTH ];
-    FILE *file;
+         password[ MAXLENGTH ];
+    const char *filename;
 
     printf( "Enter your username: " );
-    scanf( "%s", username );
+    scanf( "%511s", username );
 
     if( tcgetattr( fileno( stdin ), &saved_term ) == -1 ) 
     {
@@ -1049,49 +770,29 @@ int login( void )
     }
 
     printf( "Enter password: " );
-    scanf( "%s", password );
+    scanf( "%511s", password );
 
     restore_terminal( );
 
-    if( ( file = fopen( "credentials.txt", "r" ) ) == NULL )
+    if( credentials == NULL
+            && ( credentials = credentials_open( "credentials.txt" ) ) == NULL )
     {
-        perror( "fopen" );
+        perror( "credentials_open" );
         return -1;
     }
 
-    while( !feof( file ) )
-    {
-        int items_scanned;
-        char *ptr1, *ptr2;
-
-        items_scanned = fscanf( file, "%[^\n]\n", scanned_line );
-
-        if( scanned_line[ 0 ] == '#' )
-        {
-            continue;
-        }
-
-        /* parse and copy scanned line from credentials file */
-        ptr1 = strchr( scanned_line, ':' );
-        strncpy( scanned_username, scanned_line, ptr1-scanned_line );
-        scanned_username[ ptr1-scanned_line ] = '\0';
+    filename = credentials_check( credentials, username, password );
+    memset( password, 0, sizeof( password ) );
 
-        ptr2 = strchr( ptr1 + 1, ':' );
-        strncpy( scanned_password, ptr1 + 1, ptr2-ptr1-1 );
-        scanned_password[ ptr2-ptr1-1 ] = '\0';
-        strcpy( FILENAME, ptr2 + 1 );
-
-        if( items_scanned == 1
-                && strcmp( username, scanned_username ) == 0
-                && strcmp( password, scanned_password ) == 0 )
-        {
-            fclose( file );
-            return 1;
-        }
+    if( filename == NULL )
+    {
+        return 0;
     }
 
-    fclose( file );
-    return 0;
+    strncpy( FILENAME, filename, MAXLENGTH - 1 );
+    FILENAME[ MAXLENGTH - 1 ] = '\0';
+
+    return 1;
 }
 
 entry_t *entry_prompt( void )
@@ -1100,7 +801,7 @@ entry_t *entry_prompt( void )
 
     if( ( entry = entry_create( ) ) == NULL )
     {
-        perror( "entry_create" );
+        errno = ENOMEM;
         return NULL;
     }
 
@@ -1126,6 +827,90 @@ entry_t *entry_prompt( void )
     return entry;
 }
 
+int serve( const char *path, int compress, int sharded, unsigned long long budget )
+{
+    credentials_t *credentials;
+    catalog_entry_t *tenant;
+    catalog_t *catalog;
+    int status;
+
+    if( ( catalog = catalog_create( budget, compress, sharded ) ) == NULL )
+    {
+        perror( "catalog_create" );
+        return EXIT_FAILURE;
+    }
+
+    if( ( tenant = catalog_acquire( catalog, FILENAME ) ) == NULL )
+    {
+        perror( "book_load" );
+        catalog_destroy( catalog );
+
+        return EXIT_FAILURE;
+    }
+
+    if( ( credentials = credentials_open( "credentials.txt" ) ) == NULL )
+    {
+        perror( "credentials_open" );
+    }
+
+    printf( "Serving %s on %s\n", FILENAME, path );
+    fflush( stdout );
+
+    status = server_run( path, catalog, tenant, credentials, 0 );
+
+    if( status == -1 )
+    {
+        perror( "server_run" );
+    }
+
+    catalog_release( catalog, tenant, 1 );
+
+    if( catalog_flush( catalog ) == -1 )
+    {
+        perror( "catalog_flush" );
+        status = -1;
+    }
+
+    if( credentials != NULL )
+    {
+        credentials_destroy( credentials );
+    }
+
+    catalog_destroy( catalog );
+
+    return status == -1 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+int hash_password( void )
+{
+    char password[ MAXLENGTH ], secret[ CREDENTIALS_SECRET_MAX ];
+    size_t len;
+
+    if( fgets( password, sizeof( password ), stdin ) == NULL )
+    {
+        fprintf( stderr, "No password given\n" );
+        return EXIT_FAILURE;
+    }
+
+    len = strlen( password );
+
+    while( len > 0 && ( password[ len - 1 ] == '\n' || password[ len - 1 ] == '\r' ) )
+    {
+        password[ --len ] = '\0';
+    }
+
+    if( credentials_hash( password, secret, sizeof( secret ) ) == -1 )
+    {
+        perror( "credentials_hash" );
+        return EXIT_FAILURE;
+    }
+
+    memset( password, 0, sizeof( password ) );
+    printf( "%s\n", secret );
+
+    return EXIT_SUCCESS;
+}
+
 void restore_terminal( void )
 {
     if( tcsetattr( fileno( stdin ), TCSANOW, &saved_term ) == -1 )
@@ -1144,3 +929,8 @@ void sigint_handler( int sig )
 
     exit( EXIT_SUCCESS );
 }
+
+void print_stats( void )
+{
+    stats_print( stderr );
+}
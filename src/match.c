@@ -0,0 +1,244 @@
+#include <pthread.h>
+#include <match.h>
+
+#if defined( __GNUC__ ) && ( defined( __x86_64__ ) || defined( __i386__ ) )
+#define MATCH_X86
+#include <immintrin.h>
+#endif
+
+typedef struct
+{
+    const char *k_name;
+    int ( *k_equal )( const char *a, const char *b, unsigned long long len );
+    const char *( *k_find )( const char *haystack, unsigned long long hlen,
+                             const char *needle, unsigned long long nlen );
+} match_kernel_t;
+
+static pthread_once_t kernel_once = PTHREAD_ONCE_INIT;
+static const match_kernel_t *kernel;
+
+static int scalar_equal( const char *a, const char *b, unsigned long long len )
+{
+    return memcmp( a, b, len ) == 0;
+}
+
+static const char *scalar_find( const char *haystack, unsigned long long hlen,
+                                const char *needle, unsigned long long nlen )
+{
+    const char *it, *end;
+
+    end = haystack + hlen - nlen + 1;
+
+    for( it = haystack; it < end; it++ )
+    {
+        if( ( it = memchr( it, needle[ 0 ], end - it ) ) == NULL )
+        {
+            return NULL;
+        }
+
+        if( memcmp( it + 1, needle + 1, nlen - 1 ) == 0 )
+        {
+            return it;
+        }
+    }
+
+    return NULL;
+}
+
+static const match_kernel_t scalar_kernel =
+{
+    "scalar", scalar_equal, scalar_find
+};
+
+#ifdef MATCH_X86
+
+__attribute__(( target( "sse2" ) ))
+static int sse2_equal( const char *a, const char *b, unsigned long long len )
+{
+    unsigned long long i;
+    __m128i x, y;
+
+    for( i = 0; i + 16 <= len; i += 16 )
+    {
+        x = _mm_loadu_si128( ( const __m128i* )( a + i ) );
+        y = _mm_loadu_si128( ( const __m128i* )( b + i ) );
+
+        if( _mm_movemask_epi8( _mm_cmpeq_epi8( x, y ) ) != 0xFFFF )
+        {
+            return 0;
+        }
+    }
+
+    return memcmp( a + i, b + i, len - i ) == 0;
+}
+
+__attribute__(( target( "sse2" ) ))
+static const char *sse2_find( const char *haystack, unsigned long long hlen,
+                              const char *needle, unsigned long long nlen )
+{
+    __m128i first, last, eq;
+    unsigned long long i;
+    unsigned mask, bit;
+
+    first = _mm_set1_epi8( needle[ 0 ] );
+    last = _mm_set1_epi8( needle[ nlen - 1 ] );
+
+    for( i = 0; i + nlen - 1 + 16 <= hlen; i += 16 )
+    {
+        eq = _mm_and_si128(
+                _mm_cmpeq_epi8( first, _mm_loadu_si128( ( const __m128i* )( haystack + i ) ) ),
+                _mm_cmpeq_epi8( last, _mm_loadu_si128( ( const __m128i* )( haystack + i + nlen - 1 ) ) ) );
+        mask = ( unsigned )_mm_movemask_epi8( eq );
+
+        while( mask != 0 )
+        {
+            bit = __builtin_ctz( mask );
+
+            if( nlen <= 2 || memcmp( haystack + i + bit + 1, needle + 1, nlen - 2 ) == 0 )
+            {
+                return haystack + i + bit;
+            }
+
+            mask &= mask - 1;
+        }
+    }
+
+    return hlen - i >= nlen ? scalar_find( haystack + i, hlen - i, needle, nlen )
+                            : NULL;
+}
+
+__attribute__(( target( "avx2" ) ))
+static int avx2_equal( const char *a, const char *b, unsigned long long len )
+{
+    unsigned long long i;
+    __m256i x, y;
+
+    for( i = 0; i + 32 <= len; i += 32 )
+    {
+        x = _mm256_loadu_si256( ( const __m256i* )( a + i ) );
+        y = _mm256_loadu_si256( ( const __m256i* )( b + i ) );
+
+        if( ( unsigned )_mm256_movemask_epi8( _mm256_cmpeq_epi8( x, y ) ) != 0xFFFFFFFFU )
+        {
+            return 0;
+        }
+    }
+
+    return sse2_equal( a + i, b + i, len - i );
+}
+
+__attribute__(( target( "avx2" ) ))
+static const char *avx2_find( const char *haystack, unsigned long long hlen,
+                              const char *needle, unsigned long long nlen )
+{
+    __m256i first, last, eq;
+    unsigned long long i;
+    unsigned mask, bit;
+
+    first = _mm256_set1_epi8( needle[ 0 ] );
+    last = _mm256_set1_epi8( needle[ nlen - 1 ] );
+
+    for( i = 0; i + nlen - 1 + 32 <= hlen; i += 32 )
+    {
+        eq = _mm256_and_si256(
+                _mm256_cmpeq_epi8( first, _mm256_loadu_si256( ( const __m256i* )( haystack + i ) ) ),
+                _mm256_cmpeq_epi8( last, _mm256_loadu_si256( ( const __m256i* )( haystack + i + nlen - 1 ) ) ) );
+        mask = ( unsigned )_mm256_movemask_epi8( eq );
+
+        while( mask != 0 )
+        {
+            bit = __builtin_ctz( mask );
+
+            if( nlen <= 2 || memcmp( haystack + i + bit + 1, needle + 1, nlen - 2 ) == 0 )
+            {
+                return haystack + i + bit;
+            }
+
+            mask &= mask - 1;
+        }
+    }
+
+    return hlen - i >= nlen ? sse2_find( haystack + i, hlen - i, needle, nlen )
+                            : NULL;
+}
+
+static const match_kernel_t sse2_kernel =
+{
+    "sse2", sse2_equal, sse2_find
+};
+
+static const match_kernel_t avx2_kernel =
+{
+    "avx2", avx2_equal, avx2_find
+};
+
+#endif /* MATCH_X86 */
+
+static void match_select( void )
+{
+    kernel = &scalar_kernel;
+
+#ifdef MATCH_X86
+    __builtin_cpu_init( );
+
+    if( __builtin_cpu_supports( "avx2" ) )
+    {
+        kernel = &avx2_kernel;
+    }
+    else if( __builtin_cpu_supports( "sse2" ) )
+    {
+        kernel = &sse2_kernel;
+    }
+#endif
+}
+
+int match_equal( const char *a, unsigned long long alen,
+                 const char *b, unsigned long long blen )
+{
+    if( alen != blen )
+    {
+        return 0;
+    }
+
+    pthread_once( &kernel_once, match_select );
+
+    return kernel->k_equal( a, b, alen );
+}
+
+int match_prefix( const char *s, unsigned long long slen,
+                  const char *prefix, unsigned long long plen )
+{
+    if( plen > slen )
+    {
+        return 0;
+    }
+
+    pthread_once( &kernel_once, match_select );
+
+    return kernel->k_equal( s, prefix, plen );
+}
+
+const char *match_find( const char *haystack, unsigned long long hlen,
+                        const char *needle, unsigned long long nlen )
+{
+    if( nlen == 0 )
+    {
+        return haystack;
+    }
+
+    if( nlen > hlen )
+    {
+        return NULL;
+    }
+
+    pthread_once( &kernel_once, match_select );
+
+    return kernel->k_find( haystack, hlen, needle, nlen );
+}
+
+const char *match_kernel( void )
+{
+    pthread_once( &kernel_once, match_select );
+
+    return kernel->k_name;
+}
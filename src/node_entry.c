@@ -1,5 +1,67 @@
+#include <ctype.h>
 #include <node_entry.h>
+#include <stats.h>
 
+static unsigned long generation[ ENTRY_FIELDS ];
+static string_t missing = { "", 0 };
+static const char *field_names[ ENTRY_FIELDS ] =
+{
+    "title", "author", "pages", "edition", "language",
+    "publisher", "pubdate", "isbn", "description"
+};
+
+static void entry_touch( entry_field_t field )
+{
+#ifdef __GNUC__
+    __atomic_fetch_add( &generation[ field ], 1, __ATOMIC_RELAXED );
+#else
+    generation[ field ]++;
+#endif
+}
+
+static char *entry_resident( const entry_t *entry )
+{
+#ifdef __GNUC__
+    return __atomic_load_n( &entry->e_description->s_ptr, __ATOMIC_ACQUIRE );
+#else
+    return entry->e_description->s_ptr;
+#endif
+}
+
+int entry_lazy( const entry_t *entry )
+{
+    return entry->e_source != NULL && entry_resident( entry ) == NULL;
+}
+
+static string_t *entry_fetch( entry_t *entry )
+{
+    char *text, *expected;
+
+    if( ( text = string_source_read( entry->e_source, entry->e_offset,
+                                     entry->e_description->s_len ) ) == NULL )
+    {
+        return &missing;
+    }
+
+    expected = NULL;
+
+#ifdef __GNUC__
+    if( !__atomic_compare_exchange_n( &entry->e_description->s_ptr, &expected, text, 0,
+                                      __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE ) )
+    {
+        free( text );
+    }
+    else
+    {
+        STATS_GROW( STATS_STRING, entry->e_description->s_len + 1 );
+    }
+#else
+    entry->e_description->s_ptr = text;
+    STATS_GROW( STATS_STRING, entry->e_description->s_len + 1 );
+#endif
+
+    return entry->e_description;
+}
 
 entry_t *entry_create( void )
 {
@@ -12,6 +74,9 @@ entry_t *entry_create( void )
     }
 
     memset( entry, 0, sizeof( entry_t ) );
+    entry->e_pages_num = ENTRY_NONE;
+    entry->e_pubdate_num = ENTRY_NONE;
+    STATS_ALLOC( STATS_ENTRY, sizeof( entry_t ) );
 
     return entry;
 }
@@ -34,7 +99,20 @@ entry_t *entry_duplicate( const entry_t *entry )
     duplicate->e_publisher = string_duplicate ( entry->e_publisher );
     duplicate->e_pubdate = string_duplicate ( entry->e_pubdate );
     duplicate->e_isbn = string_duplicate ( entry->e_isbn );
-    duplicate->e_description    = string_duplicate  ( entry->e_description );
+    duplicate->e_description    = entry_lazy( entry ) ? malloc( sizeof( string_t ) )
+                                                      : string_duplicate( entry->e_description );
+    duplicate->e_pages_num = entry->e_pages_num;
+    duplicate->e_pubdate_num = entry->e_pubdate_num;
+
+    if( entry_lazy( entry ) && duplicate->e_description != NULL )
+    {
+        STATS_ALLOC( STATS_STRING, sizeof( string_t ) );
+        duplicate->e_description->s_ptr = NULL;
+        duplicate->e_description->s_len = entry->e_description->s_len;
+        duplicate->e_source = entry->e_source;
+        duplicate->e_offset = entry->e_offset;
+        string_source_retain( duplicate->e_source );
+    }
 
     return duplicate;
 }
@@ -82,8 +160,10 @@ entry_t *entry_scan( FILE *file )
     return entry;
 }
 
-void entry_write( FILE *file, entry_t *entry )
+int entry_write( FILE *file, entry_t *entry )
 {
+    string_t description;
+
     string_write( file, entry->e_title );
     string_write( file, entry->e_author );
     string_write( file, entry->e_pages );
@@ -92,23 +172,218 @@ void entry_write( FILE *file, entry_t *entry )
     string_write( file, entry->e_publisher );
     string_write( file, entry->e_pubdate );
     string_write( file, entry->e_isbn );
-    string_write( file, entry->e_description );
+
+    if( !entry_lazy( entry ) )
+    {
+        string_write( file, entry->e_description );
+        return 0;
+    }
+
+    description.s_len = entry->e_description->s_len;
+
+    if( ( description.s_ptr = string_source_read( entry->e_source, entry->e_offset,
+                                                  description.s_len ) ) == NULL )
+    {
+        errno = EIO;
+        return -1;
+    }
+
+    string_write( file, &description );
+    free( description.s_ptr );
+
+    return 0;
 }
 
 entry_t *entry_read( FILE *file )
+{
+    return entry_read_lazy( file, NULL );
+}
+
+entry_t *entry_read_lazy( FILE *file, string_source_t *source )
 {
     entry_t *entry;
+    string_t *value;
+    unsigned long long length;
+    long offset;
+    int field;
 
-    entry = entry_create( );
-    entry_set_title( entry, string_read( file ) );
-    entry_set_author( entry, string_read( file ) );
-    entry_set_pages( entry, string_read( file ) );
-    entry_set_edition( entry, string_read( file ) );
-    entry_set_language( entry, string_read( file ) );
-    entry_set_publisher( entry, string_read( file ) );
-    entry_set_pubdate( entry, string_read( file ) );
-    entry_set_isbn( entry, string_read( file ) );
-    entry_set_description( entry, string_read( file ) );
+    if( ( entry = entry_create( ) ) == NULL )
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    for( field = 0; field < ENTRY_DESCRIPTION; field++ )
+    {
+        if( ( value = string_read( file ) ) == NULL )
+        {
+            entry_destroy( entry );
+            return NULL;
+        }
+
+        entry_set_field( entry, ( entry_field_t )field, value );
+    }
+
+    if( source != NULL )
+    {
+        if( fread( &length, sizeof( length ), 1, file ) != 1
+                || ( offset = ftell( file ) ) == -1 )
+        {
+            entry_destroy( entry );
+            errno = EIO;
+
+            return NULL;
+        }
+
+        if( length >= ENTRY_LAZY_MIN )
+        {
+            if( fseek( file, ( long )( length - 1 ), SEEK_CUR ) == -1 || getc( file ) == EOF )
+            {
+                entry_destroy( entry );
+                errno = EIO;
+
+                return NULL;
+            }
+
+            if( ( value = malloc( sizeof( string_t ) ) ) == NULL )
+            {
+                entry_destroy( entry );
+                errno = ENOMEM;
+
+                return NULL;
+            }
+
+            STATS_ALLOC( STATS_STRING, sizeof( string_t ) );
+            value->s_ptr = NULL;
+            value->s_len = length;
+            entry->e_description = value;
+            entry->e_source = source;
+            entry->e_offset = ( unsigned long long )offset;
+            string_source_retain( source );
+
+            return entry;
+        }
+
+        if( fseek( file, offset - ( long )sizeof( length ), SEEK_SET ) == -1 )
+        {
+            entry_destroy( entry );
+            errno = EIO;
+
+            return NULL;
+        }
+    }
+
+    if( ( value = string_read( file ) ) == NULL )
+    {
+        entry_destroy( entry );
+        return NULL;
+    }
+
+    entry->e_description = value;
+
+    return entry;
+}
+
+unsigned long long entry_encode( char *data, entry_t *entry )
+{
+    unsigned long long size, len;
+    int field;
+
+    for( field = 0, size = 0; field < ENTRY_DESCRIPTION; field++ )
+    {
+        size += string_encode( data != NULL ? data + size : NULL,
+                               entry_get_field( entry, ( entry_field_t )field ) );
+    }
+
+    if( !entry_lazy( entry ) )
+    {
+        return size + string_encode( data != NULL ? data + size : NULL, entry->e_description );
+    }
+
+    len = entry->e_description->s_len;
+
+    if( data != NULL )
+    {
+        memcpy( data + size, &len, sizeof( len ) );
+
+        if( string_source_fill( entry->e_source, entry->e_offset, len,
+                                data + size + sizeof( len ) ) == -1 )
+        {
+            return 0;
+        }
+    }
+
+    return size + sizeof( len ) + len;
+}
+
+entry_t *entry_decode( const char *data, unsigned long long size,
+                       unsigned long long *used )
+{
+    return entry_decode_lazy( data, size, used, NULL, 0 );
+}
+
+entry_t *entry_decode_lazy( const char *data, unsigned long long size,
+                            unsigned long long *used, string_source_t *source,
+                            unsigned long long offset )
+{
+    entry_t *entry;
+    string_t *value;
+    unsigned long long position, length;
+    int field;
+
+    if( ( entry = entry_create( ) ) == NULL )
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    for( field = 0, position = 0; field < ENTRY_DESCRIPTION; field++ )
+    {
+        if( ( value = string_decode( data + position, size - position, &length ) ) == NULL )
+        {
+            entry_destroy( entry );
+            return NULL;
+        }
+
+        entry_set_field( entry, ( entry_field_t )field, value );
+        position += length;
+    }
+
+    if( source != NULL && size - position >= sizeof( length ) )
+    {
+        memcpy( &length, data + position, sizeof( length ) );
+
+        if( length >= ENTRY_LAZY_MIN && length <= size - position - sizeof( length ) )
+        {
+            if( ( value = malloc( sizeof( string_t ) ) ) == NULL )
+            {
+                entry_destroy( entry );
+                errno = ENOMEM;
+
+                return NULL;
+            }
+
+            STATS_ALLOC( STATS_STRING, sizeof( string_t ) );
+            value->s_ptr = NULL;
+            value->s_len = length;
+            entry->e_description = value;
+            entry->e_source = source;
+            entry->e_offset = offset + position + sizeof( length );
+            string_source_retain( source );
+            *used = position + sizeof( length ) + length;
+
+            return entry;
+        }
+    }
+
+    if( ( value = string_decode( data + position, size - position, &length ) ) == NULL )
+    {
+        entry_destroy( entry );
+        return NULL;
+    }
+
+    entry->e_description = value;
+    *used = position + length;
 
     return entry;
 }
@@ -116,7 +391,10 @@ entry_t *entry_read( FILE *file )
 void entry_set_title( entry_t *entry, string_t *title )
 {
     if( entry->e_title != NULL )
+    {
         string_destroy( entry->e_title );
+        entry_touch( ENTRY_TITLE );
+    }
 
     entry->e_title = title;
 }
@@ -124,7 +402,10 @@ void entry_set_title( entry_t *entry, string_t *title )
 void entry_set_author( entry_t *entry, string_t *author )
 {
     if( entry->e_author != NULL )
+    {
         string_destroy( entry->e_author );
+        entry_touch( ENTRY_AUTHOR );
+    }
 
     entry->e_author = author;
 }
@@ -132,15 +413,23 @@ void entry_set_author( entry_t *entry, string_t *author )
 void entry_set_pages( entry_t *entry, string_t *pages )
 {
     if( entry->e_pages != NULL )
+    {
         string_destroy( entry->e_pages );
+        entry_touch( ENTRY_PAGES );
+    }
 
     entry->e_pages = pages;
+    entry->e_pages_num = pages != NULL ? entry_parse_pages( pages->s_ptr )
+                                       : ENTRY_NONE;
 }
 
 void entry_set_edition( entry_t *entry, string_t *edition )
 {
     if( entry->e_edition != NULL )
+    {
         string_destroy( entry->e_edition );
+        entry_touch( ENTRY_EDITION );
+    }
 
     entry->e_edition = edition;
 }
@@ -148,7 +437,10 @@ void entry_set_edition( entry_t *entry, string_t *edition )
 void entry_set_language( entry_t *entry, string_t *language )
 {
     if( entry->e_language != NULL )
+    {
         string_destroy( entry->e_language );
+        entry_touch( ENTRY_LANGUAGE );
+    }
 
     entry->e_language = language;
 }
@@ -156,7 +448,10 @@ void entry_set_language( entry_t *entry, string_t *language )
 void entry_set_publisher( entry_t *entry, string_t *publisher )
 {
     if( entry->e_publisher != NULL )
+    {
         string_destroy( entry->e_publisher );
+        entry_touch( ENTRY_PUBLISHER );
+    }
 
     entry->e_publisher = publisher;
 }
@@ -164,15 +459,24 @@ void entry_set_publisher( entry_t *entry, string_t *publisher )
 void entry_set_pubdate( entry_t *entry, string_t *pubdate )
 {
     if( entry->e_pubdate != NULL )
+    {
         string_destroy( entry->e_pubdate );
+        entry_touch( ENTRY_PUBDATE );
+    }
 
     entry->e_pubdate = pubdate;
+    entry->e_pubdate_num = pubdate != NULL
+                           ? entry_parse_pubdate( pubdate->s_ptr )
+                           : ENTRY_NONE;
 }
 
 void entry_set_isbn( entry_t *entry, string_t *isbn )
 {
     if( entry->e_isbn != NULL )
+    {
         string_destroy( entry->e_isbn );
+        entry_touch( ENTRY_ISBN );
+    }
 
     entry->e_isbn = isbn;
 }
@@ -180,11 +484,33 @@ void entry_set_isbn( entry_t *entry, string_t *isbn )
 void entry_set_description( entry_t *entry, string_t *description )
 {
     if( entry->e_description != NULL )
+    {
         string_destroy( entry->e_description );
+        entry_touch( ENTRY_DESCRIPTION );
+    }
 
+    string_source_release( entry->e_source );
+    entry->e_source = NULL;
     entry->e_description = description;
 }
 
+void entry_set_field( entry_t *entry, entry_field_t field, string_t *value )
+{
+    switch( field )
+    {
+        case ENTRY_TITLE:       entry_set_title( entry, value );       break;
+        case ENTRY_AUTHOR:      entry_set_author( entry, value );      break;
+        case ENTRY_PAGES:       entry_set_pages( entry, value );       break;
+        case ENTRY_EDITION:     entry_set_edition( entry, value );     break;
+        case ENTRY_LANGUAGE:    entry_set_language( entry, value );    break;
+        case ENTRY_PUBLISHER:   entry_set_publisher( entry, value );   break;
+        case ENTRY_PUBDATE:     entry_set_pubdate( entry, value );     break;
+        case ENTRY_ISBN:        entry_set_isbn( entry, value );        break;
+        case ENTRY_DESCRIPTION: entry_set_description( entry, value ); break;
+        default:                                                       break;
+    }
+}
+
 string_t *entry_get_title( entry_t *entry )
 {
     return entry->e_title;
@@ -227,9 +553,224 @@ string_t *entry_get_isbn( entry_t *entry )
 
 string_t *entry_get_description( entry_t *entry )
 {
+    if( entry_lazy( entry ) )
+    {
+        return entry_fetch( entry );
+    }
+
     return entry->e_description;
 }
 
+string_t *entry_get_field( entry_t *entry, entry_field_t field )
+{
+    switch( field )
+    {
+        case ENTRY_TITLE:       return entry_get_title( entry );
+        case ENTRY_AUTHOR:      return entry_get_author( entry );
+        case ENTRY_PAGES:       return entry_get_pages( entry );
+        case ENTRY_EDITION:     return entry_get_edition( entry );
+        case ENTRY_LANGUAGE:    return entry_get_language( entry );
+        case ENTRY_PUBLISHER:   return entry_get_publisher( entry );
+        case ENTRY_PUBDATE:     return entry_get_pubdate( entry );
+        case ENTRY_ISBN:        return entry_get_isbn( entry );
+        case ENTRY_DESCRIPTION: return entry_get_description( entry );
+        default:                return NULL;
+    }
+}
+
+const char *entry_field_name( entry_field_t field )
+{
+    return field < ENTRY_FIELDS ? field_names[ field ] : "";
+}
+
+long entry_get_pages_num( entry_t *entry )
+{
+    return entry->e_pages_num;
+}
+
+long entry_get_pubdate_num( entry_t *entry )
+{
+    return entry->e_pubdate_num;
+}
+
+long entry_parse_pages( const char *s )
+{
+    long value;
+
+    while( *s != '\0' && !isdigit( ( unsigned char )*s ) )
+    {
+        s++;
+    }
+
+    if( *s == '\0' )
+    {
+        return ENTRY_NONE;
+    }
+
+    value = 0;
+
+    while( isdigit( ( unsigned char )*s ) && value < 100000000L )
+    {
+        value = value * 10 + ( *s - '0' );
+        s++;
+    }
+
+    return value;
+}
+
+long entry_parse_pubdate( const char *s )
+{
+    static const char *months[ ] =
+    {
+        "jan", "feb", "mar", "apr", "may", "jun",
+        "jul", "aug", "sep", "oct", "nov", "dec"
+    };
+    long nums[ 3 ], year, month, day;
+    int lens[ 3 ], count, named, first, i;
+
+    count = 0;
+    named = 0;
+    first = -1;
+
+    while( *s != '\0' )
+    {
+        if( isdigit( ( unsigned char )*s ) )
+        {
+            long value;
+            int len;
+
+            value = 0;
+            len = 0;
+
+            while( isdigit( ( unsigned char )*s ) )
+            {
+                if( len < 8 )
+                {
+                    value = value * 10 + ( *s - '0' );
+                }
+
+                len++;
+                s++;
+            }
+
+            if( count < 3 )
+            {
+                if( len == 4 && first == -1 )
+                {
+                    first = count;
+                }
+
+                nums[ count ] = value;
+                lens[ count ] = len;
+                count++;
+            }
+        }
+        else if( isalpha( ( unsigned char )*s ) )
+        {
+            const char *word;
+
+            word = s;
+
+            while( isalpha( ( unsigned char )*s ) )
+            {
+                s++;
+            }
+
+            for( i = 0; named == 0 && s - word >= 3 && i < 12; i++ )
+            {
+                if( tolower( ( unsigned char )word[ 0 ] ) == months[ i ][ 0 ]
+                        && tolower( ( unsigned char )word[ 1 ] ) == months[ i ][ 1 ]
+                        && tolower( ( unsigned char )word[ 2 ] ) == months[ i ][ 2 ] )
+                {
+                    named = i + 1;
+                }
+            }
+        }
+        else
+        {
+            s++;
+        }
+    }
+
+    if( first == -1 )
+    {
+        return ENTRY_NONE;
+    }
+
+    year = nums[ first ];
+    month = day = 0;
+
+    if( named != 0 )
+    {
+        month = named;
+
+        for( i = 0; i < count; i++ )
+        {
+            if( i != first && lens[ i ] <= 2 )
+            {
+                day = nums[ i ];
+                break;
+            }
+        }
+    }
+    else if( first == 0 )
+    {
+        month = count > 1 ? nums[ 1 ] : 0;
+        day = count > 2 ? nums[ 2 ] : 0;
+    }
+    else
+    {
+        month = nums[ 0 ];
+        day = first == 2 ? nums[ 1 ] : 0;
+    }
+
+    if( month < 1 || month > 12 )
+    {
+        month = day = 0;
+    }
+
+    if( day < 1 || day > 31 )
+    {
+        day = 0;
+    }
+
+    return year * 10000 + month * 100 + day;
+}
+
+unsigned long long entry_bytes( entry_t *entry )
+{
+    unsigned long long bytes;
+    string_t *value;
+    int field;
+
+    for( field = 0, bytes = sizeof( entry_t ); field < ENTRY_FIELDS; field++ )
+    {
+        value = field == ENTRY_DESCRIPTION ? entry->e_description
+                                           : entry_get_field( entry, ( entry_field_t )field );
+
+        if( value != NULL )
+        {
+            bytes += sizeof( string_t );
+
+            if( field != ENTRY_DESCRIPTION || entry->e_source == NULL )
+            {
+                bytes += value->s_len + 1;
+            }
+        }
+    }
+
+    return bytes;
+}
+
+unsigned long entry_generation( entry_field_t field )
+{
+#ifdef __GNUC__
+    return __atomic_load_n( &generation[ field ], __ATOMIC_RELAXED );
+#else
+    return generation[ field ];
+#endif
+}
+
 void entry_destroy( entry_t *entry )
 {
     string_destroy  ( entry->e_title );
@@ -241,5 +782,7 @@ void entry_destroy( entry_t *entry )
     string_destroy  ( entry->e_pubdate );
     string_destroy  ( entry->e_isbn );
     string_destroy  ( entry->e_description );
+    string_source_release( entry->e_source );
+    STATS_FREE( STATS_ENTRY, sizeof( entry_t ) );
     free            ( entry );
 }
@@ -1,6 +1,13 @@
+#include <unistd.h>
 #include <node_string.h>
+#include <stats.h>
 
 string_t *string_create( const char *s )
+{
+    return string_create_n( s, strlen( s ) );
+}
+
+string_t *string_create_n( const char *s, unsigned long long len )
 {
     string_t *str;
 
@@ -10,21 +17,25 @@ string_t *string_create( const char *s )
         return NULL;
     }
 
-    if( ( str->s_ptr = malloc( strlen( s ) + 1 ) ) == NULL )
+    if( len == ( unsigned long long )-1 || ( str->s_ptr = malloc( len + 1 ) ) == NULL )
     {
+        free( str );
         errno = ENOMEM;
+
         return NULL;
     }
 
-    strcpy( str->s_ptr, s );
-    str->s_len = strlen( s );
+    memcpy( str->s_ptr, s, len );
+    str->s_ptr[ len ] = '\0';
+    str->s_len = len;
+    STATS_ALLOC( STATS_STRING, sizeof( string_t ) + len + 1 );
 
     return str;
 }
 
 string_t *string_duplicate( const string_t *str )
 {
-    return string_create( str->s_ptr );
+    return string_create_n( str->s_ptr, str->s_len );
 }
 
 void string_print( FILE *file, string_t *str )
@@ -65,7 +76,8 @@ string_t *string_scan( FILE *file )
 
             if( tmp == NULL )
             {
-                string_destroy( str );
+                free( str->s_ptr );
+                free( str );
 
                 errno = ENOMEM;
                 return NULL;
@@ -92,6 +104,7 @@ string_t *string_scan( FILE *file )
     }
 
     str->s_ptr = tmp;
+    STATS_ALLOC( STATS_STRING, sizeof( string_t ) + str->s_len + 1 );
 
     return str;
 }
@@ -103,30 +116,224 @@ void string_write( FILE *file, string_t *str )
 }
 
 string_t *string_read( FILE *file )
+{
+    string_t *str;
+    unsigned long long length, start;
+
+    STATS_START( start );
+
+    if( fread( &length, sizeof( length ), 1, file ) != 1 )
+    {
+        errno = EIO;
+        return NULL;
+    }
+
+    if( ( str = malloc( sizeof( string_t ) ) ) == NULL )
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    if( length == ( unsigned long long )-1 || ( str->s_ptr = malloc( length + 1 ) ) == NULL )
+    {
+        free( str );
+        errno = ENOMEM;
+
+        return NULL;
+    }
+
+    if( fread( str->s_ptr, sizeof( char ), length, file ) != length )
+    {
+        free( str->s_ptr );
+        free( str );
+        errno = EIO;
+
+        return NULL;
+    }
+
+    str->s_ptr[ length ] = '\0';
+    str->s_len = length;
+    STATS_ALLOC( STATS_STRING, sizeof( string_t ) + length + 1 );
+    STATS_RECORD( STATS_STRING_READ, start, sizeof( length ) + length );
+
+    return str;
+}
+
+unsigned long long string_encode( char *data, const string_t *str )
+{
+    if( data != NULL )
+    {
+        memcpy( data, &str->s_len, sizeof( str->s_len ) );
+        memcpy( data + sizeof( str->s_len ), str->s_ptr, str->s_len );
+    }
+
+    return sizeof( str->s_len ) + str->s_len;
+}
+
+string_t *string_decode( const char *data, unsigned long long size,
+                         unsigned long long *used )
 {
     string_t *str;
     unsigned long long length;
-    char *ptr;
 
-    fread( &length, sizeof( length ), 1, file );
+    if( size < sizeof( length ) )
+    {
+        errno = EIO;
+        return NULL;
+    }
+
+    memcpy( &length, data, sizeof( length ) );
+
+    if( length > size - sizeof( length ) )
+    {
+        errno = EIO;
+        return NULL;
+    }
 
-    if( ( ptr = malloc( length + 1 ) ) == NULL )
+    if( ( str = malloc( sizeof( string_t ) ) ) == NULL )
     {
         errno = ENOMEM;
         return NULL;
     }
 
-    fread( ptr, sizeof( char ), length, file );
-    ptr[ length ] = '\0';
-    str = string_create( ptr );
+    if( ( str->s_ptr = malloc( length + 1 ) ) == NULL )
+    {
+        free( str );
+        errno = ENOMEM;
+
+        return NULL;
+    }
 
-    free( ptr );
+    memcpy( str->s_ptr, data + sizeof( length ), length );
+    str->s_ptr[ length ] = '\0';
+    str->s_len = length;
+    STATS_ALLOC( STATS_STRING, sizeof( string_t ) + length + 1 );
+    *used = sizeof( length ) + length;
 
     return str;
 }
 
+unsigned long string_hash( const char *s, unsigned long long len )
+{
+    unsigned long long hash;
+
+    hash = 14695981039346656037ULL;
+
+    while( len > 0 )
+    {
+        hash ^= ( unsigned char )*s++;
+        hash *= 1099511628211ULL;
+        len--;
+    }
+
+    return ( unsigned long )( hash ^ ( hash >> 32 ) );
+}
+
 void string_destroy( string_t *str )
 {
+    if( str == NULL )
+    {
+        return;
+    }
+
+    STATS_FREE( STATS_STRING, sizeof( string_t ) + ( str->s_ptr != NULL ? str->s_len + 1 : 0 ) );
     free( str->s_ptr );
     free( str        );
 }
+
+string_source_t *string_source_open( int fd )
+{
+    string_source_t *source;
+
+    if( ( source = malloc( sizeof( string_source_t ) ) ) == NULL )
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    if( ( source->u_fd = dup( fd ) ) == -1 )
+    {
+        free( source );
+        return NULL;
+    }
+
+    source->u_refs = 1;
+
+    return source;
+}
+
+void string_source_retain( string_source_t *source )
+{
+#ifdef __GNUC__
+    __atomic_fetch_add( &source->u_refs, 1, __ATOMIC_RELAXED );
+#else
+    source->u_refs++;
+#endif
+}
+
+int string_source_fill( string_source_t *source, unsigned long long offset,
+                        unsigned long long len, char *s )
+{
+    unsigned long long done;
+    ssize_t n;
+
+    for( done = 0; done < len; done += ( unsigned long long )n )
+    {
+        if( ( n = pread( source->u_fd, s + done, len - done,
+                         ( off_t )( offset + done ) ) ) == -1 && errno == EINTR )
+        {
+            n = 0;
+        }
+        else if( n <= 0 )
+        {
+            errno = EIO;
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+char *string_source_read( string_source_t *source, unsigned long long offset,
+                          unsigned long long len )
+{
+    char *s;
+
+    if( len == ( unsigned long long )-1 || ( s = malloc( len + 1 ) ) == NULL )
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    if( string_source_fill( source, offset, len, s ) == -1 )
+    {
+        free( s );
+        return NULL;
+    }
+
+    s[ len ] = '\0';
+
+    return s;
+}
+
+void string_source_release( string_source_t *source )
+{
+    unsigned long refs;
+
+    if( source == NULL )
+    {
+        return;
+    }
+
+#ifdef __GNUC__
+    refs = __atomic_sub_fetch( &source->u_refs, 1, __ATOMIC_ACQ_REL );
+#else
+    refs = --source->u_refs;
+#endif
+
+    if( refs == 0 )
+    {
+        close( source->u_fd );
+        free( source );
+    }
+}
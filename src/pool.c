@@ -0,0 +1,297 @@
+#include <unistd.h>
+#include <pool.h>
+
+typedef struct
+{
+    pool_t *b_pool;
+    void ( *b_task )( void *arg, unsigned part );
+    void *b_arg;
+    unsigned b_count;
+    unsigned b_next;
+    unsigned b_done;
+    unsigned b_helpers;
+} pool_batch_t;
+
+static pthread_once_t shared_once = PTHREAD_ONCE_INIT;
+static pool_t *shared_pool;
+
+static void *pool_worker( void *arg )
+{
+    pool_t *pool = arg;
+    pool_job_t *job;
+
+    pthread_mutex_lock( &pool->p_lock );
+
+    for( ;; )
+    {
+        while( pool->p_head == NULL && !pool->p_stop )
+        {
+            pthread_cond_wait( &pool->p_work, &pool->p_lock );
+        }
+
+        if( pool->p_head == NULL )
+        {
+            break;
+        }
+
+        job = pool->p_head;
+        pool->p_head = job->j_next;
+
+        if( pool->p_head == NULL )
+        {
+            pool->p_tail = NULL;
+        }
+
+        pthread_mutex_unlock( &pool->p_lock );
+        job->j_task( job->j_arg );
+        free( job );
+        pthread_mutex_lock( &pool->p_lock );
+    }
+
+    pthread_mutex_unlock( &pool->p_lock );
+
+    return NULL;
+}
+
+static void pool_batch_parts( pool_batch_t *batch )
+{
+    pool_t *pool = batch->b_pool;
+    unsigned part;
+
+    pthread_mutex_lock( &pool->p_lock );
+
+    while( batch->b_next < batch->b_count )
+    {
+        part = batch->b_next++;
+        pthread_mutex_unlock( &pool->p_lock );
+        batch->b_task( batch->b_arg, part );
+        pthread_mutex_lock( &pool->p_lock );
+        batch->b_done++;
+    }
+
+    if( batch->b_done == batch->b_count )
+    {
+        pthread_cond_broadcast( &pool->p_done );
+    }
+
+    pthread_mutex_unlock( &pool->p_lock );
+}
+
+static void pool_batch_help( void *arg )
+{
+    pool_batch_t *batch = arg;
+    pool_t *pool = batch->b_pool;
+
+    pool_batch_parts( batch );
+
+    pthread_mutex_lock( &pool->p_lock );
+    batch->b_helpers--;
+    pthread_cond_broadcast( &pool->p_done );
+    pthread_mutex_unlock( &pool->p_lock );
+}
+
+static void pool_shared_create( void )
+{
+    shared_pool = pool_create( 0 );
+}
+
+pool_t *pool_create( unsigned threads )
+{
+    pool_t *pool;
+    unsigned i;
+
+    if( threads == 0 )
+    {
+        threads = pool_cpus( );
+    }
+
+    if( ( pool = malloc( sizeof( pool_t ) ) ) == NULL )
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    memset( pool, 0, sizeof( pool_t ) );
+
+    if( ( pool->p_threads = malloc( threads * sizeof( pthread_t ) ) ) == NULL )
+    {
+        free( pool );
+        errno = ENOMEM;
+
+        return NULL;
+    }
+
+    pthread_mutex_init( &pool->p_lock, NULL );
+    pthread_cond_init( &pool->p_work, NULL );
+    pthread_cond_init( &pool->p_done, NULL );
+
+    for( i = 0; i < threads; i++ )
+    {
+        if( pthread_create( &pool->p_threads[ i ], NULL, pool_worker, pool ) != 0 )
+        {
+            break;
+        }
+
+        pool->p_count++;
+    }
+
+    if( pool->p_count < threads )
+    {
+        pool_destroy( pool );
+        errno = EAGAIN;
+
+        return NULL;
+    }
+
+    return pool;
+}
+
+pool_t *pool_shared( void )
+{
+    pthread_once( &shared_once, pool_shared_create );
+
+    return shared_pool;
+}
+
+unsigned pool_cpus( void )
+{
+    long cpus;
+
+    cpus = sysconf( _SC_NPROCESSORS_ONLN );
+
+    return cpus > 0 ? ( unsigned )cpus : 1;
+}
+
+int pool_submit( pool_t *pool, void ( *task )( void *arg ), void *arg )
+{
+    pool_job_t *job;
+
+    if( ( job = malloc( sizeof( pool_job_t ) ) ) == NULL )
+    {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    job->j_task = task;
+    job->j_arg = arg;
+    job->j_next = NULL;
+
+    pthread_mutex_lock( &pool->p_lock );
+
+    if( pool->p_tail == NULL )
+    {
+        pool->p_head = job;
+    }
+    else
+    {
+        pool->p_tail->j_next = job;
+    }
+
+    pool->p_tail = job;
+    pthread_cond_signal( &pool->p_work );
+    pthread_mutex_unlock( &pool->p_lock );
+
+    return 0;
+}
+
+void pool_run( pool_t *pool, unsigned count,
+               void ( *task )( void *arg, unsigned part ), void *arg )
+{
+    pool_batch_t batch;
+    pool_job_t *it, *prev, *next;
+    unsigned i, helpers;
+
+    if( pool == NULL || count <= 1 )
+    {
+        for( i = 0; i < count; i++ )
+        {
+            task( arg, i );
+        }
+
+        return;
+    }
+
+    memset( &batch, 0, sizeof( pool_batch_t ) );
+    batch.b_pool = pool;
+    batch.b_task = task;
+    batch.b_arg = arg;
+    batch.b_count = count;
+
+    helpers = count - 1 < pool->p_count ? count - 1 : pool->p_count;
+
+    for( i = 0; i < helpers; i++ )
+    {
+        pthread_mutex_lock( &pool->p_lock );
+        batch.b_helpers++;
+        pthread_mutex_unlock( &pool->p_lock );
+
+        if( pool_submit( pool, pool_batch_help, &batch ) == -1 )
+        {
+            pthread_mutex_lock( &pool->p_lock );
+            batch.b_helpers--;
+            pthread_mutex_unlock( &pool->p_lock );
+            break;
+        }
+    }
+
+    pool_batch_parts( &batch );
+
+    pthread_mutex_lock( &pool->p_lock );
+
+    for( it = pool->p_head, prev = NULL; it != NULL; it = next )
+    {
+        next = it->j_next;
+
+        if( it->j_task == pool_batch_help && it->j_arg == &batch )
+        {
+            if( prev == NULL )
+            {
+                pool->p_head = next;
+            }
+            else
+            {
+                prev->j_next = next;
+            }
+
+            if( pool->p_tail == it )
+            {
+                pool->p_tail = prev;
+            }
+
+            free( it );
+            batch.b_helpers--;
+        }
+        else
+        {
+            prev = it;
+        }
+    }
+
+    while( batch.b_done < batch.b_count || batch.b_helpers > 0 )
+    {
+        pthread_cond_wait( &pool->p_done, &pool->p_lock );
+    }
+
+    pthread_mutex_unlock( &pool->p_lock );
+}
+
+void pool_destroy( pool_t *pool )
+{
+    unsigned i;
+
+    pthread_mutex_lock( &pool->p_lock );
+    pool->p_stop = 1;
+    pthread_cond_broadcast( &pool->p_work );
+    pthread_mutex_unlock( &pool->p_lock );
+
+    for( i = 0; i < pool->p_count; i++ )
+    {
+        pthread_join( pool->p_threads[ i ], NULL );
+    }
+
+    pthread_mutex_destroy( &pool->p_lock );
+    pthread_cond_destroy( &pool->p_work );
+    pthread_cond_destroy( &pool->p_done );
+    free( pool->p_threads );
+    free( pool );
+}
@@ -0,0 +1,938 @@
+#include <stdarg.h>
+#include <limits.h>
+#include <query.h>
+#include <book_index.h>
+#include <pool.h>
+#include <match.h>
+#include <stats.h>
+
+typedef enum
+{
+    ACCESS_HASH,
+    ACCESS_ORDER,
+    ACCESS_RANGE
+} access_kind_t;
+
+typedef struct
+{
+    access_kind_t a_kind;
+    entry_field_t a_field;
+    const unsigned long *a_rows;
+    const range_key_t *a_keys;
+    unsigned long a_count;
+} query_access_t;
+
+typedef struct
+{
+    query_access_t *p_access;
+    unsigned p_count;
+    int p_scan;
+    unsigned long p_cost;
+} query_path_t;
+
+typedef struct
+{
+    const query_t *s_query;
+    const column_t *s_column;
+    entry_t **s_rows;
+    unsigned long s_count;
+    unsigned s_parts;
+    unsigned long **s_matches;
+    unsigned long *s_matched;
+    int *s_failed;
+} query_scan_t;
+
+static const char *access_names[ ] = { "hash", "prefix", "range" };
+static unsigned long parallel_rows = QUERY_PARALLEL_ROWS;
+static int cache = 1;
+
+static query_t *query_create( query_op_t op, entry_field_t field )
+{
+    query_t *query;
+
+    if( ( query = malloc( sizeof( query_t ) ) ) == NULL )
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    memset( query, 0, sizeof( query_t ) );
+    query->q_op = op;
+    query->q_field = field;
+
+    return query;
+}
+
+static query_t *query_create_value( query_op_t op, entry_field_t field,
+                                    const char *value )
+{
+    query_t *query;
+
+    if( ( query = query_create( op, field ) ) == NULL )
+    {
+        return NULL;
+    }
+
+    if( ( query->q_value = malloc( strlen( value ) + 1 ) ) == NULL )
+    {
+        free( query );
+        errno = ENOMEM;
+
+        return NULL;
+    }
+
+    strcpy( query->q_value, value );
+    query->q_len = strlen( value );
+
+    return query;
+}
+
+static query_t *query_vcombine( query_op_t op, int count, va_list ap )
+{
+    query_t **args;
+    int i;
+
+    if( ( args = malloc( ( count + 1 ) * sizeof( query_t* ) ) ) == NULL )
+    {
+        query_t *arg;
+
+        for( i = 0; i < count; i++ )
+        {
+            if( ( arg = va_arg( ap, query_t* ) ) != NULL )
+            {
+                query_destroy( arg );
+            }
+        }
+
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    for( i = 0; i < count; i++ )
+    {
+        args[ i ] = va_arg( ap, query_t* );
+    }
+
+    return query_combine( op, args, count );
+}
+
+static void query_path_scan( const book_t *book, query_path_t *path )
+{
+    free( path->p_access );
+    path->p_access = NULL;
+    path->p_count = 0;
+    path->p_scan = 1;
+    path->p_cost = book->a_count;
+}
+
+static int query_path_access( query_path_t *path, query_access_t *access )
+{
+    if( ( path->p_access = malloc( sizeof( query_access_t ) ) ) == NULL )
+    {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    path->p_access[ 0 ] = *access;
+    path->p_count = 1;
+    path->p_scan = 0;
+    path->p_cost = access->a_count;
+
+    return 0;
+}
+
+static int query_path_leaf( const book_t *book, const query_t *query,
+                            query_path_t *path )
+{
+    query_access_t access;
+    int kinds;
+
+    kinds = book_index_kinds( query->q_field );
+    access.a_field = query->q_field;
+    access.a_rows = NULL;
+    access.a_keys = NULL;
+
+    if( query->q_op == QUERY_EQUAL && ( kinds & INDEX_HASH ) )
+    {
+        const hash_index_t *hash;
+
+        if( ( hash = book_index_hash( book, query->q_field ) ) == NULL )
+        {
+            return -1;
+        }
+
+        access.a_kind = ACCESS_HASH;
+        access.a_count = hash_index_find( book->a_index, hash, query->q_field,
+                                          query->q_value, &access.a_rows );
+
+        return query_path_access( path, &access );
+    }
+
+    if( ( query->q_op == QUERY_EQUAL || query->q_op == QUERY_PREFIX )
+            && ( kinds & INDEX_ORDER ) )
+    {
+        const order_index_t *order;
+        unsigned long first;
+
+        if( ( order = book_index_order( book, query->q_field ) ) == NULL )
+        {
+            return -1;
+        }
+
+        access.a_kind = ACCESS_ORDER;
+        access.a_count = order_index_prefix( book->a_index, order,
+                                             query->q_field, query->q_value,
+                                             &first );
+        access.a_rows = order->o_rows + first;
+
+        return query_path_access( path, &access );
+    }
+
+    if( query->q_op == QUERY_RANGE && ( kinds & INDEX_RANGE ) )
+    {
+        const range_index_t *range;
+        unsigned long first, last;
+
+        if( ( range = book_index_range( book, query->q_field ) ) == NULL )
+        {
+            return -1;
+        }
+
+        first = range_index_lower( range, query->q_min );
+        last = query->q_max == LONG_MAX ? range->r_count
+                                        : range_index_lower( range, query->q_max + 1 );
+
+        access.a_kind = ACCESS_RANGE;
+        access.a_keys = range->r_keys + first;
+        access.a_count = last > first ? last - first : 0;
+
+        return query_path_access( path, &access );
+    }
+
+    query_path_scan( book, path );
+
+    return 0;
+}
+
+static int query_path( const book_t *book, const query_t *query,
+                       query_path_t *path )
+{
+    query_path_t child;
+    query_access_t *access;
+    unsigned i;
+
+    memset( path, 0, sizeof( query_path_t ) );
+
+    if( query->q_op != QUERY_AND && query->q_op != QUERY_OR )
+    {
+        return query_path_leaf( book, query, path );
+    }
+
+    if( query->q_op == QUERY_AND )
+    {
+        query_path_scan( book, path );
+
+        for( i = 0; i < query->q_count; i++ )
+        {
+            if( query_path( book, query->q_args[ i ], &child ) == -1 )
+            {
+                free( path->p_access );
+                return -1;
+            }
+
+            if( !child.p_scan && ( path->p_scan || child.p_cost < path->p_cost ) )
+            {
+                free( path->p_access );
+                *path = child;
+            }
+            else
+            {
+                free( child.p_access );
+            }
+        }
+
+        return 0;
+    }
+
+    path->p_scan = 0;
+
+    for( i = 0; i < query->q_count; i++ )
+    {
+        if( query_path( book, query->q_args[ i ], &child ) == -1 )
+        {
+            free( path->p_access );
+            return -1;
+        }
+
+        if( child.p_scan )
+        {
+            query_path_scan( book, path );
+            return 0;
+        }
+
+        access = realloc( path->p_access,
+                          ( path->p_count + child.p_count + 1 ) * sizeof( query_access_t ) );
+
+        if( access == NULL )
+        {
+            free( child.p_access );
+            free( path->p_access );
+            errno = ENOMEM;
+
+            return -1;
+        }
+
+        memcpy( access + path->p_count, child.p_access,
+                child.p_count * sizeof( query_access_t ) );
+        free( child.p_access );
+        path->p_access = access;
+        path->p_count += child.p_count;
+        path->p_cost += child.p_cost;
+    }
+
+    return 0;
+}
+
+static void query_path_describe( const query_path_t *path, char *buffer )
+{
+    size_t len;
+    unsigned i;
+
+    if( path->p_scan )
+    {
+        strcpy( buffer, "full scan" );
+        return;
+    }
+
+    len = 0;
+
+    if( path->p_count > 1 )
+    {
+        len += sprintf( buffer, "union(" );
+    }
+
+    for( i = 0; i < path->p_count && len + 40 < QUERY_PLAN_LENGTH; i++ )
+    {
+        len += sprintf( buffer + len, "%s%s(%s)", i > 0 ? ", " : "",
+                        access_names[ path->p_access[ i ].a_kind ],
+                        entry_field_name( path->p_access[ i ].a_field ) );
+    }
+
+    if( i < path->p_count )
+    {
+        len += sprintf( buffer + len, ", ..." );
+    }
+
+    sprintf( buffer + len, "%s -> filter", path->p_count > 1 ? ")" : "" );
+}
+
+static int row_compare( const void *a, const void *b )
+{
+    unsigned long x = *( const unsigned long* )a, y = *( const unsigned long* )b;
+
+    return x < y ? -1 : x > y;
+}
+
+static unsigned long *query_path_rows( const query_path_t *path,
+                                       unsigned long *count )
+{
+    const query_access_t *access;
+    unsigned long *rows, i, j, n;
+    unsigned k;
+
+    if( ( rows = malloc( ( path->p_cost + 1 ) * sizeof( unsigned long ) ) ) == NULL )
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    for( k = 0, n = 0; k < path->p_count; k++ )
+    {
+        access = &path->p_access[ k ];
+
+        for( i = 0; i < access->a_count; i++ )
+        {
+            rows[ n++ ] = access->a_keys != NULL ? access->a_keys[ i ].r_row
+                                                 : access->a_rows[ i ];
+        }
+    }
+
+    if( path->p_count > 1
+            || ( path->p_count == 1 && path->p_access[ 0 ].a_kind != ACCESS_HASH ) )
+    {
+        qsort( rows, n, sizeof( unsigned long ), row_compare );
+
+        for( i = 0, j = 0; i < n; i++ )
+        {
+            if( j == 0 || rows[ j - 1 ] != rows[ i ] )
+            {
+                rows[ j++ ] = rows[ i ];
+            }
+        }
+
+        n = j;
+    }
+
+    *count = n;
+
+    return rows;
+}
+
+static void query_scan_part( void *arg, unsigned part )
+{
+    query_scan_t *scan = arg;
+    unsigned long *matches, *tmp, first, last, row, count, capacity;
+
+    first = scan->s_count * part / scan->s_parts;
+    last = scan->s_count * ( part + 1 ) / scan->s_parts;
+    matches = NULL;
+    count = capacity = 0;
+
+    if( scan->s_column != NULL )
+    {
+        if( ( matches = malloc( ( last - first + 1 ) * sizeof( unsigned long ) ) ) == NULL )
+        {
+            scan->s_failed[ part ] = 1;
+        }
+        else
+        {
+            count = column_match( scan->s_column, scan->s_query, first, last, matches );
+        }
+    }
+
+    for( row = first; scan->s_column == NULL && row < last; row++ )
+    {
+        if( !query_match( scan->s_query, scan->s_rows[ row ] ) )
+        {
+            continue;
+        }
+
+        if( count == capacity )
+        {
+            capacity = capacity == 0 ? 64 : 2 * capacity;
+
+            if( ( tmp = realloc( matches, capacity * sizeof( unsigned long ) ) ) == NULL )
+            {
+                scan->s_failed[ part ] = 1;
+                break;
+            }
+
+            matches = tmp;
+        }
+
+        matches[ count++ ] = row;
+    }
+
+    scan->s_matches[ part ] = matches;
+    scan->s_matched[ part ] = count;
+}
+
+static int query_scan_parallel( const book_t *book, const query_t *query,
+                                const column_t *column, pool_t *pool,
+                                book_t *retval, query_plan_t *report )
+{
+    book_index_t *index;
+    query_scan_t scan;
+    unsigned long i;
+    unsigned part;
+    int error;
+
+    if( ( index = book_index_get( book ) ) == NULL )
+    {
+        return -1;
+    }
+
+    memset( &scan, 0, sizeof( query_scan_t ) );
+    scan.s_query = query;
+    scan.s_column = column;
+    scan.s_rows = index->i_rows;
+    scan.s_count = index->i_count;
+    scan.s_parts = 4 * ( pool->p_count + 1 );
+    scan.s_matches = calloc( scan.s_parts, sizeof( unsigned long* ) );
+    scan.s_matched = calloc( scan.s_parts, sizeof( unsigned long ) );
+    scan.s_failed = calloc( scan.s_parts, sizeof( int ) );
+
+    if( scan.s_matches == NULL || scan.s_matched == NULL || scan.s_failed == NULL )
+    {
+        free( scan.s_matches );
+        free( scan.s_matched );
+        free( scan.s_failed );
+        errno = ENOMEM;
+
+        return -1;
+    }
+
+    pool_run( pool, scan.s_parts, query_scan_part, &scan );
+
+    for( part = 0, error = 0; part < scan.s_parts; part++ )
+    {
+        error = error || scan.s_failed[ part ];
+    }
+
+    for( part = 0; part < scan.s_parts; part++ )
+    {
+        for( i = 0; !error && i < scan.s_matched[ part ]; i++ )
+        {
+            error = book_append( retval,
+                    scan.s_rows[ scan.s_matches[ part ][ i ] ] ) == -1;
+        }
+
+        free( scan.s_matches[ part ] );
+    }
+
+    free( scan.s_matches );
+    free( scan.s_matched );
+    free( scan.s_failed );
+
+    if( error )
+    {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    if( column != NULL )
+    {
+        sprintf( report->p_access, "parallel column scan(%s) (%u partitions)",
+                 entry_field_name( query->q_field ), scan.s_parts );
+    }
+    else
+    {
+        sprintf( report->p_access, "parallel scan (%u partitions)", scan.s_parts );
+    }
+
+    report->p_examined = scan.s_count;
+    report->p_matched = retval->a_count;
+
+    return 0;
+}
+
+static int query_scan_column( const book_t *book, const column_t *column,
+                              const query_t *query, book_t *retval,
+                              query_plan_t *report )
+{
+    unsigned long *rows, count, i;
+
+    if( ( rows = malloc( ( column->c_rows + 1 ) * sizeof( unsigned long ) ) ) == NULL )
+    {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    count = column_match( column, query, 0, column->c_rows, rows );
+
+    for( i = 0; i < count; i++ )
+    {
+        if( book_append( retval, book->a_index->i_rows[ rows[ i ] ] ) == -1 )
+        {
+            free( rows );
+            errno = ENOMEM;
+
+            return -1;
+        }
+    }
+
+    free( rows );
+
+    sprintf( report->p_access, "column scan(%s)", entry_field_name( query->q_field ) );
+    report->p_examined = column->c_rows;
+    report->p_matched = retval->a_count;
+
+    return 0;
+}
+
+query_t *query_equal( entry_field_t field, const char *value )
+{
+    return query_create_value( QUERY_EQUAL, field, value );
+}
+
+query_t *query_prefix( entry_field_t field, const char *prefix )
+{
+    return query_create_value( QUERY_PREFIX, field, prefix );
+}
+
+query_t *query_contains( entry_field_t field, const char *needle )
+{
+    return query_create_value( QUERY_CONTAINS, field, needle );
+}
+
+query_t *query_range( entry_field_t field, long min, long max )
+{
+    query_t *query;
+
+    if( field != ENTRY_PAGES && field != ENTRY_PUBDATE )
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    if( ( query = query_create( QUERY_RANGE, field ) ) == NULL )
+    {
+        return NULL;
+    }
+
+    query->q_min = min;
+    query->q_max = max;
+
+    return query;
+}
+
+query_t *query_combine( query_op_t op, query_t **args, unsigned count )
+{
+    query_t *query;
+    unsigned i;
+    int error;
+
+    for( i = 0; i < count && args[ i ] != NULL; i++ );
+
+    query = NULL;
+    error = EINVAL;
+
+    if( ( op == QUERY_AND || op == QUERY_OR ) && i == count )
+    {
+        query = query_create( op, ENTRY_FIELDS );
+        error = ENOMEM;
+    }
+
+    if( query == NULL )
+    {
+        for( i = 0; i < count; i++ )
+        {
+            if( args[ i ] != NULL )
+            {
+                query_destroy( args[ i ] );
+            }
+        }
+
+        free( args );
+        errno = error;
+
+        return NULL;
+    }
+
+    query->q_args = args;
+    query->q_count = count;
+
+    return query;
+}
+
+query_t *query_and( int count, ... )
+{
+    query_t *query;
+    va_list ap;
+
+    va_start( ap, count );
+    query = query_vcombine( QUERY_AND, count, ap );
+    va_end( ap );
+
+    return query;
+}
+
+query_t *query_or( int count, ... )
+{
+    query_t *query;
+    va_list ap;
+
+    va_start( ap, count );
+    query = query_vcombine( QUERY_OR, count, ap );
+    va_end( ap );
+
+    return query;
+}
+
+int query_match( const query_t *query, entry_t *entry )
+{
+    string_t *value;
+    long number;
+    unsigned i;
+
+    switch( query->q_op )
+    {
+        case QUERY_EQUAL:
+            value = entry_get_field( entry, query->q_field );
+            return value != NULL && match_equal( value->s_ptr, value->s_len,
+                                                 query->q_value, query->q_len );
+        case QUERY_PREFIX:
+            value = entry_get_field( entry, query->q_field );
+            return value != NULL && match_prefix( value->s_ptr, value->s_len,
+                                                  query->q_value, query->q_len );
+        case QUERY_CONTAINS:
+            value = entry_get_field( entry, query->q_field );
+            return value != NULL && match_find( value->s_ptr, value->s_len,
+                                                query->q_value, query->q_len ) != NULL;
+        case QUERY_RANGE:
+            number = query->q_field == ENTRY_PAGES ? entry_get_pages_num( entry )
+                                                   : entry_get_pubdate_num( entry );
+            return number != ENTRY_NONE
+                && number >= query->q_min && number <= query->q_max;
+        case QUERY_AND:
+            for( i = 0; i < query->q_count; i++ )
+            {
+                if( !query_match( query->q_args[ i ], entry ) )
+                {
+                    return 0;
+                }
+            }
+
+            return 1;
+        case QUERY_OR:
+            for( i = 0; i < query->q_count; i++ )
+            {
+                if( query_match( query->q_args[ i ], entry ) )
+                {
+                    return 1;
+                }
+            }
+
+            return 0;
+    }
+
+    return 0;
+}
+
+static int query_absent( const book_t *book, const query_t *query )
+{
+    unsigned i;
+
+    switch( query->q_op )
+    {
+        case QUERY_EQUAL:
+            return book_index_absent( book, query->q_field, query->q_value );
+        case QUERY_AND:
+            for( i = 0; i < query->q_count; i++ )
+            {
+                if( query_absent( book, query->q_args[ i ] ) )
+                {
+                    return 1;
+                }
+            }
+
+            return 0;
+        case QUERY_OR:
+            for( i = 0; i < query->q_count; i++ )
+            {
+                if( !query_absent( book, query->q_args[ i ] ) )
+                {
+                    return 0;
+                }
+            }
+
+            return query->q_count > 0;
+        default:
+            return 0;
+    }
+}
+
+static book_t *query_run( const book_t *book, const query_t *query,
+                          query_plan_t *plan )
+{
+    const column_t *column;
+    query_plan_t report;
+    query_path_t path;
+    book_t *retval;
+    unsigned long *rows, count, i;
+    entry_node_t *it;
+    entry_t *entry;
+    pool_t *pool;
+
+    if( query_absent( book, query ) )
+    {
+        if( ( retval = book_create( ) ) == NULL )
+        {
+            errno = ENOMEM;
+            return NULL;
+        }
+
+        if( plan != NULL )
+        {
+            memset( plan, 0, sizeof( query_plan_t ) );
+            strcpy( plan->p_access, "bloom" );
+        }
+
+        return retval;
+    }
+
+    if( cache && book_index_get( book ) != NULL
+            && ( ( retval = book_cache_find( book->a_index->i_cache, book, query ) ) != NULL
+                 || errno != ENOENT ) )
+    {
+        if( retval != NULL && plan != NULL )
+        {
+            memset( plan, 0, sizeof( query_plan_t ) );
+            strcpy( plan->p_access, "cache" );
+            plan->p_matched = retval->a_count;
+        }
+
+        return retval;
+    }
+
+    if( query_path( book, query, &path ) == -1 )
+    {
+        return NULL;
+    }
+
+    if( ( retval = book_create( ) ) == NULL )
+    {
+        free( path.p_access );
+        errno = ENOMEM;
+
+        return NULL;
+    }
+
+    memset( &report, 0, sizeof( query_plan_t ) );
+
+    if( !path.p_scan && path.p_cost >= book->a_count )
+    {
+        query_path_scan( book, &path );
+    }
+
+    query_path_describe( &path, report.p_access );
+    report.p_estimated = path.p_cost;
+
+    column = NULL;
+
+    if( path.p_scan && query->q_op != QUERY_AND && query->q_op != QUERY_OR
+            && ( query->q_op == QUERY_RANGE || query->q_len > 0 ) )
+    {
+        column = book_index_column( book, query->q_field );
+    }
+
+    if( path.p_scan && parallel_rows > 0 && book->a_count >= parallel_rows
+            && ( pool = pool_shared( ) ) != NULL )
+    {
+        if( query_scan_parallel( book, query, column, pool, retval, &report ) == -1 )
+        {
+            book_destroy( retval, 0 );
+            errno = ENOMEM;
+
+            return NULL;
+        }
+    }
+    else if( column != NULL )
+    {
+        if( query_scan_column( book, column, query, retval, &report ) == -1 )
+        {
+            book_destroy( retval, 0 );
+            errno = ENOMEM;
+
+            return NULL;
+        }
+    }
+    else if( path.p_scan )
+    {
+        for( it = book->a_head; it != NULL; it = it->n_next )
+        {
+            report.p_examined++;
+
+            if( query_match( query, it->n_entry ) )
+            {
+                if( book_append( retval, it->n_entry ) == -1 )
+                {
+                    book_destroy( retval, 0 );
+                    errno = ENOMEM;
+
+                    return NULL;
+                }
+
+                report.p_matched++;
+            }
+        }
+    }
+    else
+    {
+        if( ( rows = query_path_rows( &path, &count ) ) == NULL )
+        {
+            free( path.p_access );
+            book_destroy( retval, 0 );
+            errno = ENOMEM;
+
+            return NULL;
+        }
+
+        for( i = 0; i < count; i++ )
+        {
+            entry = book->a_index->i_rows[ rows[ i ] ];
+            report.p_examined++;
+
+            if( query_match( query, entry ) )
+            {
+                if( book_append( retval, entry ) == -1 )
+                {
+                    free( rows );
+                    free( path.p_access );
+                    book_destroy( retval, 0 );
+                    errno = ENOMEM;
+
+                    return NULL;
+                }
+
+                report.p_matched++;
+            }
+        }
+
+        free( rows );
+    }
+
+    free( path.p_access );
+
+    if( cache && book->a_index != NULL )
+    {
+        book_cache_store( book->a_index->i_cache, book, query, retval );
+    }
+
+    if( plan != NULL )
+    {
+        *plan = report;
+    }
+
+    return retval;
+}
+
+book_t *book_query( const book_t *book, const query_t *query,
+                    query_plan_t *plan )
+{
+    unsigned long long start;
+    book_t *retval;
+
+    STATS_START( start );
+
+    if( ( retval = query_run( book, query, plan ) ) != NULL )
+    {
+        STATS_RECORD( STATS_BOOK_QUERY, start, 0 );
+    }
+
+    return retval;
+}
+
+void query_set_parallel( unsigned long rows )
+{
+    parallel_rows = rows;
+}
+
+void query_set_cache( int enabled )
+{
+    cache = enabled;
+}
+
+void query_plan_print( FILE *file, const query_plan_t *plan )
+{
+    fprintf( file, "\
+Plan:             %s\n\
+Estimated rows:   %lu\n\
+Rows examined:    %lu\n\
+Rows matched:     %lu\n",
+        plan->p_access, plan->p_estimated, plan->p_examined, plan->p_matched );
+}
+
+void query_destroy( query_t *query )
+{
+    unsigned i;
+
+    for( i = 0; i < query->q_count; i++ )
+    {
+        query_destroy( query->q_args[ i ] );
+    }
+
+    free( query->q_args );
+    free( query->q_value );
+    free( query );
+}
@@ -0,0 +1,938 @@
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+#include <server.h>
+#include <query.h>
+#include <stats.h>
+
+#define SERVER_EVENTS   64
+#define SERVER_ARGS     ( 2 * ENTRY_FIELDS + 2 )
+
+static volatile sig_atomic_t stopping;
+static int stop_fd = -1;
+
+static void server_signal( int sig )
+{
+    int saved;
+    ssize_t n;
+
+    saved = errno;
+    stopping = 1;
+
+    if( stop_fd != -1 )
+    {
+        n = write( stop_fd, &sig, 1 );
+        ( void )n;
+    }
+
+    errno = saved;
+}
+
+static int buffer_append( server_buffer_t *buffer, const char *s, size_t len )
+{
+    size_t capacity;
+    char *data;
+
+    if( buffer->b_len + len + 1 > buffer->b_cap )
+    {
+        for( capacity = buffer->b_cap > 0 ? buffer->b_cap : 256;
+                capacity < buffer->b_len + len + 1; capacity *= 2 );
+
+        if( ( data = realloc( buffer->b_data, capacity ) ) == NULL )
+        {
+            errno = ENOMEM;
+            return -1;
+        }
+
+        buffer->b_data = data;
+        buffer->b_cap = capacity;
+    }
+
+    memcpy( buffer->b_data + buffer->b_len, s, len );
+    buffer->b_len += len;
+    buffer->b_data[ buffer->b_len ] = '\0';
+
+    return 0;
+}
+
+static int buffer_printf( server_buffer_t *buffer, const char *format, ... )
+{
+    char line[ 256 ];
+    va_list args;
+    int len;
+
+    va_start( args, format );
+    len = vsnprintf( line, sizeof( line ), format, args );
+    va_end( args );
+
+    if( len < 0 )
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    return buffer_append( buffer, line, ( size_t )len < sizeof( line ) ? ( size_t )len
+                                                                      : sizeof( line ) - 1 );
+}
+
+static int buffer_entry( server_buffer_t *buffer, entry_t *entry )
+{
+    const string_t *value;
+    size_t start, i;
+    int field;
+
+    for( field = 0; field < ENTRY_FIELDS; field++ )
+    {
+        value = entry_get_field( entry, ( entry_field_t )field );
+        start = buffer->b_len;
+
+        if( buffer_append( buffer, field > 0 ? "\t" : "", field > 0 ) == -1
+                || buffer_append( buffer, value->s_ptr, value->s_len ) == -1 )
+        {
+            return -1;
+        }
+
+        for( i = start + ( field > 0 ); i < buffer->b_len; i++ )
+        {
+            if( buffer->b_data[ i ] == '\t' || buffer->b_data[ i ] == '\n'
+                    || buffer->b_data[ i ] == '\r' )
+            {
+                buffer->b_data[ i ] = ' ';
+            }
+        }
+    }
+
+    return buffer_append( buffer, "\n", 1 );
+}
+
+static int server_field( const char *name )
+{
+    int field;
+
+    for( field = 0; field < ENTRY_FIELDS; field++ )
+    {
+        if( strcmp( name, entry_field_name( ( entry_field_t )field ) ) == 0 )
+        {
+            return field;
+        }
+    }
+
+    return -1;
+}
+
+static query_t *server_predicate( entry_field_t field, char *value )
+{
+    size_t len;
+
+    len = strlen( value );
+
+    if( len >= 2 && value[ 0 ] == '*' && value[ len - 1 ] == '*' )
+    {
+        value[ len - 1 ] = '\0';
+        return query_contains( field, value + 1 );
+    }
+
+    if( len >= 1 && value[ len - 1 ] == '*' )
+    {
+        value[ len - 1 ] = '\0';
+        return query_prefix( field, value );
+    }
+
+    return query_equal( field, value );
+}
+
+static catalog_entry_t *server_tenant( server_t *server, server_conn_t *conn )
+{
+    return conn->c_tenant != NULL ? conn->c_tenant : server->s_default;
+}
+
+static int server_find( server_t *server, server_conn_t *conn, char **args, int count,
+                        server_buffer_t *reply )
+{
+    query_t **predicates, *query;
+    book_t *result;
+    entry_node_t *it;
+    int i, field, status;
+
+    if( count < 2 || count % 2 != 0 || count / 2 > ENTRY_FIELDS )
+    {
+        return buffer_printf( reply, "ERR usage: find FIELD VALUE [FIELD VALUE ...]\n" );
+    }
+
+    if( ( predicates = malloc( ( count / 2 ) * sizeof( query_t* ) ) ) == NULL )
+    {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    for( i = 0; i < count / 2; i++ )
+    {
+        if( ( field = server_field( args[ 2 * i ] ) ) == -1 )
+        {
+            status = buffer_printf( reply, "ERR unknown field %s\n", args[ 2 * i ] );
+
+            while( i-- > 0 )
+            {
+                query_destroy( predicates[ i ] );
+            }
+
+            free( predicates );
+
+            return status;
+        }
+
+        predicates[ i ] = server_predicate( ( entry_field_t )field, args[ 2 * i + 1 ] );
+    }
+
+    if( ( query = query_combine( QUERY_AND, predicates, count / 2 ) ) == NULL )
+    {
+        return -1;
+    }
+
+    result = book_sync_query( server_tenant( server, conn )->e_store, query );
+    status = result == NULL ? -1 : buffer_printf( reply, "OK %lu\n", result->a_count );
+
+    for( it = result != NULL ? result->a_head : NULL; it != NULL && status == 0;
+            it = it->n_next )
+    {
+        status = buffer_entry( reply, it->n_entry );
+    }
+
+    if( result != NULL )
+    {
+        book_destroy( result, 1 );
+    }
+
+    query_destroy( query );
+
+    return status;
+}
+
+static int server_add( server_t *server, server_conn_t *conn, char **args, int count,
+                       server_buffer_t *reply )
+{
+    entry_t *entry;
+    string_t *value;
+    int field;
+
+    if( count != ENTRY_FIELDS )
+    {
+        return buffer_printf( reply, "ERR usage: add %s\n",
+                              "TITLE AUTHOR PAGES EDITION LANGUAGE PUBLISHER PUBDATE ISBN DESCRIPTION" );
+    }
+
+    if( ( entry = entry_create( ) ) == NULL )
+    {
+        return -1;
+    }
+
+    for( field = 0; field < ENTRY_FIELDS; field++ )
+    {
+        if( ( value = string_create( args[ field ] ) ) == NULL )
+        {
+            entry_destroy( entry );
+            return -1;
+        }
+
+        entry_set_field( entry, ( entry_field_t )field, value );
+    }
+
+    if( book_sync_add_take( server_tenant( server, conn )->e_store, entry ) == -1 )
+    {
+        entry_destroy( entry );
+        return -1;
+    }
+
+    conn->c_modified = 1;
+
+    return buffer_printf( reply, "OK 1\n" );
+}
+
+static int server_edit( server_t *server, server_conn_t *conn, char **args, int count,
+                        server_buffer_t *reply )
+{
+    long edited;
+    int field;
+
+    if( count != 3 )
+    {
+        return buffer_printf( reply, "ERR usage: edit ISBN FIELD VALUE\n" );
+    }
+
+    if( ( field = server_field( args[ 1 ] ) ) == -1 )
+    {
+        return buffer_printf( reply, "ERR unknown field %s\n", args[ 1 ] );
+    }
+
+    if( ( edited = book_sync_update( server_tenant( server, conn )->e_store, args[ 0 ],
+                                     ( entry_field_t )field, args[ 2 ] ) ) == -1 )
+    {
+        return -1;
+    }
+
+    conn->c_modified |= edited > 0;
+
+    return buffer_printf( reply, "OK %ld\n", edited );
+}
+
+static int server_delete( server_t *server, server_conn_t *conn, char **args, int count,
+                          server_buffer_t *reply )
+{
+    long removed;
+
+    if( count != 1 )
+    {
+        return buffer_printf( reply, "ERR usage: delete ISBN\n" );
+    }
+
+    if( ( removed = book_sync_remove( server_tenant( server, conn )->e_store,
+                                      args[ 0 ] ) ) == -1 )
+    {
+        return -1;
+    }
+
+    conn->c_modified |= removed > 0;
+
+    return buffer_printf( reply, "OK %ld\n", removed );
+}
+
+static int server_save( server_t *server, server_conn_t *conn, server_buffer_t *reply )
+{
+    int status;
+
+    pthread_mutex_lock( &server->s_save );
+    status = catalog_save( server->s_catalog, server_tenant( server, conn ) );
+    pthread_mutex_unlock( &server->s_save );
+
+    if( status == -1 )
+    {
+        return buffer_printf( reply, "ERR %s\n", strerror( errno ) );
+    }
+
+    return buffer_printf( reply, "OK 0\n" );
+}
+
+static int server_memory( server_buffer_t *reply )
+{
+    stats_memory_t memory;
+    int type, status;
+
+    status = buffer_printf( reply, "OK %d\n", STATS_TYPES );
+
+    for( type = 0; type < STATS_TYPES && status == 0; type++ )
+    {
+        stats_memory( ( stats_type_t )type, &memory );
+        status = buffer_printf( reply, "%s\t%llu\t%llu\t%llu\t%llu\n",
+                                stats_type_name( ( stats_type_t )type ), memory.m_objects,
+                                memory.m_bytes, memory.m_peak, memory.m_allocs );
+    }
+
+    return status;
+}
+
+static int server_login( server_t *server, server_conn_t *conn, char **args, int count,
+                         server_buffer_t *reply )
+{
+    catalog_entry_t *tenant;
+    const char *checked;
+    char *filename;
+
+    if( count != 2 )
+    {
+        return buffer_printf( reply, "ERR usage: login USERNAME PASSWORD\n" );
+    }
+
+    if( server->s_credentials == NULL )
+    {
+        return buffer_printf( reply, "ERR logins disabled\n" );
+    }
+
+    pthread_mutex_lock( &server->s_auth );
+    filename = NULL;
+
+    if( ( checked = credentials_check( server->s_credentials, args[ 0 ], args[ 1 ] ) ) != NULL
+            && ( filename = malloc( strlen( checked ) + 1 ) ) != NULL )
+    {
+        strcpy( filename, checked );
+    }
+
+    pthread_mutex_unlock( &server->s_auth );
+    memset( args[ 1 ], 0, strlen( args[ 1 ] ) );
+
+    if( checked == NULL )
+    {
+        return buffer_printf( reply, "ERR invalid credentials\n" );
+    }
+
+    if( filename == NULL )
+    {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    tenant = catalog_acquire( server->s_catalog, filename );
+    free( filename );
+
+    if( tenant == NULL )
+    {
+        return buffer_printf( reply, "ERR %s\n", strerror( errno ) );
+    }
+
+    if( conn->c_tenant != NULL )
+    {
+        catalog_release( server->s_catalog, conn->c_tenant, conn->c_modified );
+    }
+
+    conn->c_tenant = tenant;
+    conn->c_modified = 0;
+
+    return buffer_printf( reply, "OK 0\n" );
+}
+
+static void server_handle( server_request_t *request )
+{
+    char *args[ SERVER_ARGS ], *it;
+    server_t *server;
+    int count, status;
+
+    server = request->r_server;
+
+    for( count = 0, it = request->r_line; count < SERVER_ARGS; count++ )
+    {
+        args[ count ] = it;
+
+        if( ( it = strchr( it, '\t' ) ) == NULL )
+        {
+            count++;
+            break;
+        }
+
+        *it++ = '\0';
+    }
+
+    if( it != NULL )
+    {
+        status = buffer_printf( &request->r_reply, "ERR too many arguments\n" );
+    }
+    else if( strcmp( args[ 0 ], "find" ) == 0 )
+    {
+        status = server_find( server, request->r_conn, args + 1, count - 1,
+                              &request->r_reply );
+    }
+    else if( strcmp( args[ 0 ], "add" ) == 0 )
+    {
+        status = server_add( server, request->r_conn, args + 1, count - 1,
+                             &request->r_reply );
+    }
+    else if( strcmp( args[ 0 ], "edit" ) == 0 )
+    {
+        status = server_edit( server, request->r_conn, args + 1, count - 1,
+                              &request->r_reply );
+    }
+    else if( strcmp( args[ 0 ], "delete" ) == 0 )
+    {
+        status = server_delete( server, request->r_conn, args + 1, count - 1,
+                                &request->r_reply );
+    }
+    else if( strcmp( args[ 0 ], "save" ) == 0 && count == 1 )
+    {
+        status = server_save( server, request->r_conn, &request->r_reply );
+    }
+    else if( strcmp( args[ 0 ], "memory" ) == 0 && count == 1 )
+    {
+        status = server_memory( &request->r_reply );
+    }
+    else if( strcmp( args[ 0 ], "login" ) == 0 )
+    {
+        status = server_login( server, request->r_conn, args + 1, count - 1,
+                               &request->r_reply );
+    }
+    else if( strcmp( args[ 0 ], "quit" ) == 0 && count == 1 )
+    {
+        request->r_quit = 1;
+        status = buffer_printf( &request->r_reply, "OK 0\n" );
+    }
+    else
+    {
+        status = buffer_printf( &request->r_reply, "ERR unknown request\n" );
+    }
+
+    request->r_failed = status == -1;
+}
+
+static void server_work( void *arg )
+{
+    server_request_t *request = arg;
+    server_t *server;
+    ssize_t n;
+
+    server = request->r_server;
+    server_handle( request );
+
+    pthread_mutex_lock( &server->s_mutex );
+    request->r_next = server->s_done;
+    server->s_done = request;
+    pthread_mutex_unlock( &server->s_mutex );
+
+    n = write( server->s_wake[ 1 ], "", 1 );
+    ( void )n;
+}
+
+static void server_close( server_t *server, server_conn_t *conn )
+{
+    if( !conn->c_closed )
+    {
+        epoll_ctl( server->s_epoll, EPOLL_CTL_DEL, conn->c_fd, NULL );
+        close( conn->c_fd );
+        conn->c_closed = 1;
+    }
+
+    if( conn->c_busy )
+    {
+        return;
+    }
+
+    if( conn->c_prev != NULL )
+    {
+        conn->c_prev->c_next = conn->c_next;
+    }
+    else
+    {
+        server->s_conns = conn->c_next;
+    }
+
+    if( conn->c_next != NULL )
+    {
+        conn->c_next->c_prev = conn->c_prev;
+    }
+
+    if( conn->c_tenant != NULL )
+    {
+        catalog_release( server->s_catalog, conn->c_tenant, conn->c_modified );
+    }
+
+    free( conn->c_in );
+    free( conn->c_out.b_data );
+    free( conn );
+}
+
+static void server_dispatch( server_t *server, server_conn_t *conn )
+{
+    server_request_t *request;
+    char *newline;
+    size_t len;
+
+    if( ( newline = memchr( conn->c_in, '\n', conn->c_in_len ) ) == NULL )
+    {
+        if( conn->c_in_len == SERVER_LINE_MAX )
+        {
+            buffer_printf( &conn->c_out, "ERR request too long\n" );
+            conn->c_quit = 1;
+        }
+
+        return;
+    }
+
+    len = ( size_t )( newline - conn->c_in );
+
+    if( ( request = calloc( 1, sizeof( server_request_t ) ) ) == NULL
+            || ( request->r_line = malloc( len + 1 ) ) == NULL )
+    {
+        free( request );
+        buffer_printf( &conn->c_out, "ERR %s\n", strerror( ENOMEM ) );
+        conn->c_quit = 1;
+
+        return;
+    }
+
+    memcpy( request->r_line, conn->c_in, len );
+    request->r_line[ len > 0 && conn->c_in[ len - 1 ] == '\r' ? len - 1 : len ] = '\0';
+    memmove( conn->c_in, newline + 1, conn->c_in_len - len - 1 );
+    conn->c_in_len -= len + 1;
+
+    request->r_server = server;
+    request->r_conn = conn;
+    conn->c_busy = 1;
+
+    if( pool_submit( server->s_pool, server_work, request ) == -1 )
+    {
+        server_work( request );
+    }
+}
+
+static void server_progress( server_t *server, server_conn_t *conn )
+{
+    struct epoll_event event;
+    unsigned events;
+    ssize_t n;
+
+    if( conn->c_closed )
+    {
+        server_close( server, conn );
+        return;
+    }
+
+    if( !conn->c_busy && !conn->c_quit )
+    {
+        server_dispatch( server, conn );
+    }
+
+    while( conn->c_sent < conn->c_out.b_len )
+    {
+        n = send( conn->c_fd, conn->c_out.b_data + conn->c_sent,
+                  conn->c_out.b_len - conn->c_sent, MSG_NOSIGNAL );
+
+        if( n == -1 )
+        {
+            if( errno == EAGAIN || errno == EWOULDBLOCK )
+            {
+                break;
+            }
+
+            server_close( server, conn );
+            return;
+        }
+
+        conn->c_sent += ( size_t )n;
+    }
+
+    if( conn->c_sent == conn->c_out.b_len )
+    {
+        conn->c_sent = conn->c_out.b_len = 0;
+
+        if( !conn->c_busy && ( conn->c_quit
+                    || ( conn->c_eof && memchr( conn->c_in, '\n', conn->c_in_len ) == NULL ) ) )
+        {
+            server_close( server, conn );
+            return;
+        }
+    }
+
+    events = 0;
+
+    if( !conn->c_eof && !conn->c_quit && conn->c_in_len < SERVER_LINE_MAX )
+    {
+        events |= EPOLLIN;
+    }
+
+    if( conn->c_sent < conn->c_out.b_len )
+    {
+        events |= EPOLLOUT;
+    }
+
+    if( events != conn->c_events )
+    {
+        memset( &event, 0, sizeof( event ) );
+        event.events = events;
+        event.data.ptr = conn;
+        epoll_ctl( server->s_epoll, EPOLL_CTL_MOD, conn->c_fd, &event );
+        conn->c_events = events;
+    }
+}
+
+static void server_receive( server_t *server, server_conn_t *conn )
+{
+    ssize_t n;
+
+    while( conn->c_in_len < SERVER_LINE_MAX )
+    {
+        n = recv( conn->c_fd, conn->c_in + conn->c_in_len,
+                  SERVER_LINE_MAX - conn->c_in_len, 0 );
+
+        if( n > 0 )
+        {
+            conn->c_in_len += ( size_t )n;
+        }
+        else if( n == 0 )
+        {
+            conn->c_eof = 1;
+            break;
+        }
+        else if( errno == EAGAIN || errno == EWOULDBLOCK )
+        {
+            break;
+        }
+        else if( errno != EINTR )
+        {
+            server_close( server, conn );
+            return;
+        }
+    }
+
+    server_progress( server, conn );
+}
+
+static void server_accept( server_t *server )
+{
+    struct epoll_event event;
+    server_conn_t *conn;
+    int fd;
+
+    while( ( fd = accept4( server->s_listen, NULL, NULL,
+                           SOCK_NONBLOCK | SOCK_CLOEXEC ) ) != -1 )
+    {
+        if( ( conn = calloc( 1, sizeof( server_conn_t ) ) ) == NULL
+                || ( conn->c_in = malloc( SERVER_LINE_MAX ) ) == NULL )
+        {
+            free( conn );
+            close( fd );
+            continue;
+        }
+
+        conn->c_fd = fd;
+        conn->c_events = EPOLLIN;
+
+        memset( &event, 0, sizeof( event ) );
+        event.events = EPOLLIN;
+        event.data.ptr = conn;
+
+        if( epoll_ctl( server->s_epoll, EPOLL_CTL_ADD, fd, &event ) == -1 )
+        {
+            free( conn->c_in );
+            free( conn );
+            close( fd );
+            continue;
+        }
+
+        conn->c_next = server->s_conns;
+
+        if( server->s_conns != NULL )
+        {
+            server->s_conns->c_prev = conn;
+        }
+
+        server->s_conns = conn;
+    }
+}
+
+static void server_collect( server_t *server )
+{
+    server_request_t *done, *next;
+    server_conn_t *conn;
+    char drain[ 64 ];
+
+    while( read( server->s_wake[ 0 ], drain, sizeof( drain ) ) > 0 );
+
+    pthread_mutex_lock( &server->s_mutex );
+    done = server->s_done;
+    server->s_done = NULL;
+    pthread_mutex_unlock( &server->s_mutex );
+
+    for( ; done != NULL; done = next )
+    {
+        next = done->r_next;
+        conn = done->r_conn;
+        conn->c_busy = 0;
+
+        if( done->r_failed )
+        {
+            buffer_printf( &conn->c_out, "ERR %s\n", strerror( ENOMEM ) );
+        }
+        else if( buffer_append( &conn->c_out, done->r_reply.b_data,
+                                done->r_reply.b_len ) == -1 )
+        {
+            conn->c_quit = 1;
+        }
+
+        conn->c_quit |= done->r_quit;
+
+        free( done->r_line );
+        free( done->r_reply.b_data );
+        free( done );
+
+        server_progress( server, conn );
+    }
+}
+
+static int server_open( server_t *server, const char *path )
+{
+    struct sockaddr_un address;
+    struct epoll_event event;
+
+    if( strlen( path ) >= sizeof( address.sun_path ) )
+    {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+
+    memset( &address, 0, sizeof( address ) );
+    address.sun_family = AF_UNIX;
+    strcpy( address.sun_path, path );
+
+    if( ( server->s_listen = socket( AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0 ) ) == -1
+            || bind( server->s_listen, ( struct sockaddr* )&address, sizeof( address ) ) == -1 )
+    {
+        return -1;
+    }
+
+    if( chmod( path, S_IRUSR | S_IWUSR ) == -1
+            || listen( server->s_listen, SERVER_BACKLOG ) == -1
+            || pipe2( server->s_wake, O_NONBLOCK | O_CLOEXEC ) == -1
+            || ( server->s_epoll = epoll_create1( EPOLL_CLOEXEC ) ) == -1 )
+    {
+        unlink( path );
+        return -1;
+    }
+
+    memset( &event, 0, sizeof( event ) );
+    event.events = EPOLLIN;
+    event.data.ptr = &server->s_listen;
+
+    if( epoll_ctl( server->s_epoll, EPOLL_CTL_ADD, server->s_listen, &event ) == -1 )
+    {
+        unlink( path );
+        return -1;
+    }
+
+    event.data.ptr = &server->s_wake;
+
+    if( epoll_ctl( server->s_epoll, EPOLL_CTL_ADD, server->s_wake[ 0 ], &event ) == -1 )
+    {
+        unlink( path );
+        return -1;
+    }
+
+    return 0;
+}
+
+static int server_loop( server_t *server )
+{
+    struct epoll_event events[ SERVER_EVENTS ];
+    struct sigaction action, old_int, old_term, old_pipe;
+    server_request_t *done;
+    int count, i, saved;
+
+    memset( &action, 0, sizeof( action ) );
+    action.sa_handler = server_signal;
+    sigemptyset( &action.sa_mask );
+    stopping = 0;
+    stop_fd = server->s_wake[ 1 ];
+    sigaction( SIGINT, &action, &old_int );
+    sigaction( SIGTERM, &action, &old_term );
+    action.sa_handler = SIG_IGN;
+    sigaction( SIGPIPE, &action, &old_pipe );
+
+    while( !stopping )
+    {
+        if( ( count = epoll_wait( server->s_epoll, events, SERVER_EVENTS, -1 ) ) == -1 )
+        {
+            if( errno == EINTR )
+            {
+                continue;
+            }
+
+            break;
+        }
+
+        for( i = 0; i < count; i++ )
+        {
+            if( events[ i ].data.ptr == &server->s_listen )
+            {
+                server_accept( server );
+            }
+            else if( events[ i ].data.ptr == &server->s_wake )
+            {
+                server_collect( server );
+            }
+            else if( events[ i ].events & ( EPOLLERR | EPOLLHUP ) )
+            {
+                server_close( server, events[ i ].data.ptr );
+            }
+            else if( events[ i ].events & EPOLLIN )
+            {
+                server_receive( server, events[ i ].data.ptr );
+            }
+            else
+            {
+                server_progress( server, events[ i ].data.ptr );
+            }
+        }
+    }
+
+    saved = errno;
+
+    sigaction( SIGINT, &old_int, NULL );
+    sigaction( SIGTERM, &old_term, NULL );
+    sigaction( SIGPIPE, &old_pipe, NULL );
+    stop_fd = -1;
+
+    pool_destroy( server->s_pool );
+
+    for( done = server->s_done; done != NULL; done = server->s_done )
+    {
+        server->s_done = done->r_next;
+        done->r_conn->c_busy = 0;
+        free( done->r_line );
+        free( done->r_reply.b_data );
+        free( done );
+    }
+
+    while( server->s_conns != NULL )
+    {
+        server_close( server, server->s_conns );
+    }
+
+    if( !stopping )
+    {
+        errno = saved;
+        return -1;
+    }
+
+    return 0;
+}
+
+int server_run( const char *path, catalog_t *catalog, catalog_entry_t *tenant,
+                credentials_t *credentials, unsigned threads )
+{
+    server_t server;
+    int status, saved;
+
+    memset( &server, 0, sizeof( server_t ) );
+    server.s_listen = server.s_epoll = server.s_wake[ 0 ] = server.s_wake[ 1 ] = -1;
+    server.s_catalog = catalog;
+    server.s_default = tenant;
+    server.s_credentials = credentials;
+
+    pthread_mutex_init( &server.s_mutex, NULL );
+    pthread_mutex_init( &server.s_save, NULL );
+    pthread_mutex_init( &server.s_auth, NULL );
+
+    if( server_open( &server, path ) == -1
+            || ( server.s_pool = pool_create( threads ) ) == NULL )
+    {
+        status = -1;
+    }
+    else
+    {
+        status = server_loop( &server );
+    }
+
+    saved = errno;
+
+    if( server.s_listen != -1 )
+    {
+        close( server.s_listen );
+        unlink( path );
+    }
+
+    if( server.s_epoll != -1 )
+    {
+        close( server.s_epoll );
+    }
+
+    if( server.s_wake[ 0 ] != -1 )
+    {
+        close( server.s_wake[ 0 ] );
+        close( server.s_wake[ 1 ] );
+    }
+
+    pthread_mutex_destroy( &server.s_mutex );
+    pthread_mutex_destroy( &server.s_save );
+    pthread_mutex_destroy( &server.s_auth );
+    errno = saved;
+
+    return status;
+}
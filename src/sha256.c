@@ -0,0 +1,231 @@
+#include <sha256.h>
+
+#define ROTR( x, n )    ( ( ( x ) >> ( n ) ) | ( ( x ) << ( 32 - ( n ) ) ) )
+
+static const unsigned round_keys[ 64 ] =
+{
+    0x428A2F98U, 0x71374491U, 0xB5C0FBCFU, 0xE9B5DBA5U, 0x3956C25BU, 0x59F111F1U,
+    0x923F82A4U, 0xAB1C5ED5U, 0xD807AA98U, 0x12835B01U, 0x243185BEU, 0x550C7DC3U,
+    0x72BE5D74U, 0x80DEB1FEU, 0x9BDC06A7U, 0xC19BF174U, 0xE49B69C1U, 0xEFBE4786U,
+    0x0FC19DC6U, 0x240CA1CCU, 0x2DE92C6FU, 0x4A7484AAU, 0x5CB0A9DCU, 0x76F988DAU,
+    0x983E5152U, 0xA831C66DU, 0xB00327C8U, 0xBF597FC7U, 0xC6E00BF3U, 0xD5A79147U,
+    0x06CA6351U, 0x14292967U, 0x27B70A85U, 0x2E1B2138U, 0x4D2C6DFCU, 0x53380D13U,
+    0x650A7354U, 0x766A0ABBU, 0x81C2C92EU, 0x92722C85U, 0xA2BFE8A1U, 0xA81A664BU,
+    0xC24B8B70U, 0xC76C51A3U, 0xD192E819U, 0xD6990624U, 0xF40E3585U, 0x106AA070U,
+    0x19A4C116U, 0x1E376C08U, 0x2748774CU, 0x34B0BCB5U, 0x391C0CB3U, 0x4ED8AA4AU,
+    0x5B9CCA4FU, 0x682E6FF3U, 0x748F82EEU, 0x78A5636FU, 0x84C87814U, 0x8CC70208U,
+    0x90BEFFFAU, 0xA4506CEBU, 0xBEF9A3F7U, 0xC67178F2U
+};
+
+static void sha256_block( unsigned *state, const unsigned char *block )
+{
+    unsigned w[ 64 ], a, b, c, d, e, f, g, h, t1, t2;
+    int i;
+
+    for( i = 0; i < 16; i++ )
+    {
+        w[ i ] = ( unsigned )block[ 4 * i ] << 24 | ( unsigned )block[ 4 * i + 1 ] << 16
+               | ( unsigned )block[ 4 * i + 2 ] << 8 | block[ 4 * i + 3 ];
+    }
+
+    for( i = 16; i < 64; i++ )
+    {
+        w[ i ] = ( ROTR( w[ i - 2 ], 17 ) ^ ROTR( w[ i - 2 ], 19 ) ^ ( w[ i - 2 ] >> 10 ) )
+               + w[ i - 7 ]
+               + ( ROTR( w[ i - 15 ], 7 ) ^ ROTR( w[ i - 15 ], 18 ) ^ ( w[ i - 15 ] >> 3 ) )
+               + w[ i - 16 ];
+    }
+
+    a = state[ 0 ];
+    b = state[ 1 ];
+    c = state[ 2 ];
+    d = state[ 3 ];
+    e = state[ 4 ];
+    f = state[ 5 ];
+    g = state[ 6 ];
+    h = state[ 7 ];
+
+    for( i = 0; i < 64; i++ )
+    {
+        t1 = h + ( ROTR( e, 6 ) ^ ROTR( e, 11 ) ^ ROTR( e, 25 ) ) + ( ( e & f ) ^ ( ~e & g ) )
+           + round_keys[ i ] + w[ i ];
+        t2 = ( ROTR( a, 2 ) ^ ROTR( a, 13 ) ^ ROTR( a, 22 ) ) + ( ( a & b ) ^ ( a & c ) ^ ( b & c ) );
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+
+    state[ 0 ] += a;
+    state[ 1 ] += b;
+    state[ 2 ] += c;
+    state[ 3 ] += d;
+    state[ 4 ] += e;
+    state[ 5 ] += f;
+    state[ 6 ] += g;
+    state[ 7 ] += h;
+}
+
+void sha256_init( sha256_t *sha )
+{
+    static const unsigned initial[ 8 ] =
+    {
+        0x6A09E667U, 0xBB67AE85U, 0x3C6EF372U, 0xA54FF53AU,
+        0x510E527FU, 0x9B05688CU, 0x1F83D9ABU, 0x5BE0CD19U
+    };
+
+    memcpy( sha->s_state, initial, sizeof( initial ) );
+    sha->s_length = 0;
+    sha->s_used = 0;
+}
+
+void sha256_update( sha256_t *sha, const void *data, unsigned long long len )
+{
+    const unsigned char *p = data;
+    unsigned long long n;
+
+    sha->s_length += len;
+
+    if( sha->s_used > 0 )
+    {
+        n = SHA256_BLOCK - sha->s_used < len ? SHA256_BLOCK - sha->s_used : len;
+        memcpy( sha->s_block + sha->s_used, p, n );
+        sha->s_used += ( unsigned )n;
+        p += n;
+        len -= n;
+
+        if( sha->s_used < SHA256_BLOCK )
+        {
+            return;
+        }
+
+        sha256_block( sha->s_state, sha->s_block );
+        sha->s_used = 0;
+    }
+
+    for( ; len >= SHA256_BLOCK; len -= SHA256_BLOCK, p += SHA256_BLOCK )
+    {
+        sha256_block( sha->s_state, p );
+    }
+
+    memcpy( sha->s_block, p, len );
+    sha->s_used = ( unsigned )len;
+}
+
+void sha256_final( sha256_t *sha, unsigned char *digest )
+{
+    unsigned long long bits;
+    int i;
+
+    bits = sha->s_length * 8;
+    sha->s_block[ sha->s_used++ ] = 0x80;
+
+    if( sha->s_used > SHA256_BLOCK - 8 )
+    {
+        memset( sha->s_block + sha->s_used, 0, SHA256_BLOCK - sha->s_used );
+        sha256_block( sha->s_state, sha->s_block );
+        sha->s_used = 0;
+    }
+
+    memset( sha->s_block + sha->s_used, 0, SHA256_BLOCK - 8 - sha->s_used );
+
+    for( i = 0; i < 8; i++ )
+    {
+        sha->s_block[ SHA256_BLOCK - 1 - i ] = ( unsigned char )( bits >> ( 8 * i ) );
+    }
+
+    sha256_block( sha->s_state, sha->s_block );
+
+    for( i = 0; i < 8; i++ )
+    {
+        digest[ 4 * i ] = ( unsigned char )( sha->s_state[ i ] >> 24 );
+        digest[ 4 * i + 1 ] = ( unsigned char )( sha->s_state[ i ] >> 16 );
+        digest[ 4 * i + 2 ] = ( unsigned char )( sha->s_state[ i ] >> 8 );
+        digest[ 4 * i + 3 ] = ( unsigned char )sha->s_state[ i ];
+    }
+}
+
+void pbkdf2_sha256( const void *password, size_t password_len,
+                    const void *salt, size_t salt_len,
+                    unsigned long iterations,
+                    unsigned char *key, size_t key_len )
+{
+    unsigned char pad[ SHA256_BLOCK ], digest[ SHA256_SIZE ],
+                  block[ SHA256_SIZE ], counter[ 4 ];
+    sha256_t inner, outer, sha;
+    unsigned long i, index;
+    size_t n;
+    int j;
+
+    memset( pad, 0, sizeof( pad ) );
+
+    if( password_len > SHA256_BLOCK )
+    {
+        sha256_init( &sha );
+        sha256_update( &sha, password, password_len );
+        sha256_final( &sha, pad );
+    }
+    else
+    {
+        memcpy( pad, password, password_len );
+    }
+
+    for( j = 0; j < SHA256_BLOCK; j++ )
+    {
+        pad[ j ] ^= 0x36;
+    }
+
+    sha256_init( &inner );
+    sha256_update( &inner, pad, SHA256_BLOCK );
+
+    for( j = 0; j < SHA256_BLOCK; j++ )
+    {
+        pad[ j ] ^= 0x36 ^ 0x5C;
+    }
+
+    sha256_init( &outer );
+    sha256_update( &outer, pad, SHA256_BLOCK );
+
+    for( index = 1; key_len > 0; index++ )
+    {
+        counter[ 0 ] = ( unsigned char )( index >> 24 );
+        counter[ 1 ] = ( unsigned char )( index >> 16 );
+        counter[ 2 ] = ( unsigned char )( index >> 8 );
+        counter[ 3 ] = ( unsigned char )index;
+
+        sha = inner;
+        sha256_update( &sha, salt, salt_len );
+        sha256_update( &sha, counter, sizeof( counter ) );
+        sha256_final( &sha, digest );
+        sha = outer;
+        sha256_update( &sha, digest, SHA256_SIZE );
+        sha256_final( &sha, digest );
+        memcpy( block, digest, SHA256_SIZE );
+
+        for( i = 1; i < iterations; i++ )
+        {
+            sha = inner;
+            sha256_update( &sha, digest, SHA256_SIZE );
+            sha256_final( &sha, digest );
+            sha = outer;
+            sha256_update( &sha, digest, SHA256_SIZE );
+            sha256_final( &sha, digest );
+
+            for( j = 0; j < SHA256_SIZE; j++ )
+            {
+                block[ j ] ^= digest[ j ];
+            }
+        }
+
+        n = key_len < SHA256_SIZE ? key_len : SHA256_SIZE;
+        memcpy( key, block, n );
+        key += n;
+        key_len -= n;
+    }
+
+    memset( pad, 0, sizeof( pad ) );
+}
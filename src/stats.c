@@ -0,0 +1,268 @@
+#include <string.h>
+#include <time.h>
+#include <stats.h>
+
+static const char *op_names[ STATS_OPS ] =
+{
+    "book_read", "book_write", "book_find_by_title", "book_find_by_author",
+    "book_find_by_publisher", "book_find_by_pages", "book_find_by_pubdate",
+    "book_query", "book_aggregate", "book_add", "book_remove", "string_read"
+};
+
+static const char *type_names[ STATS_TYPES ] = { "string", "entry", "node", "book" };
+
+static stats_counter_t counters[ STATS_OPS ];
+static stats_memory_t memory[ STATS_TYPES ];
+static int enabled = 0;
+
+static unsigned long long stats_load( const unsigned long long *value )
+{
+#ifdef __GNUC__
+    return __atomic_load_n( value, __ATOMIC_RELAXED );
+#else
+    return *value;
+#endif
+}
+
+static void stats_add( unsigned long long *value, unsigned long long amount )
+{
+#ifdef __GNUC__
+    __atomic_fetch_add( value, amount, __ATOMIC_RELAXED );
+#else
+    *value += amount;
+#endif
+}
+
+static unsigned long long stats_add_fetch( unsigned long long *value,
+                                           unsigned long long amount )
+{
+#ifdef __GNUC__
+    return __atomic_add_fetch( value, amount, __ATOMIC_RELAXED );
+#else
+    return *value += amount;
+#endif
+}
+
+static void stats_sub( unsigned long long *value, unsigned long long amount )
+{
+#ifdef __GNUC__
+    __atomic_fetch_sub( value, amount, __ATOMIC_RELAXED );
+#else
+    *value -= amount;
+#endif
+}
+
+static void stats_peak( unsigned long long *peak, unsigned long long bytes )
+{
+#ifdef __GNUC__
+    unsigned long long seen;
+
+    seen = __atomic_load_n( peak, __ATOMIC_RELAXED );
+
+    while( bytes > seen && !__atomic_compare_exchange_n( peak, &seen, bytes, 1,
+                                                         __ATOMIC_RELAXED,
+                                                         __ATOMIC_RELAXED ) )
+    {
+    }
+#else
+    if( bytes > *peak )
+    {
+        *peak = bytes;
+    }
+#endif
+}
+
+static int stats_bucket( unsigned long long nanos )
+{
+    int bucket;
+
+    for( bucket = 0; nanos > 1 && bucket < STATS_BUCKETS - 1; bucket++ )
+    {
+        nanos >>= 1;
+    }
+
+    return bucket;
+}
+
+static void stats_label( char *buffer, unsigned long long nanos )
+{
+    if( nanos < 1000ULL )
+    {
+        sprintf( buffer, "%lluns", nanos );
+    }
+    else if( nanos < 1000000ULL )
+    {
+        sprintf( buffer, "%lluus", nanos / 1000ULL );
+    }
+    else if( nanos < 1000000000ULL )
+    {
+        sprintf( buffer, "%llums", nanos / 1000000ULL );
+    }
+    else
+    {
+        sprintf( buffer, "%llus", nanos / 1000000000ULL );
+    }
+}
+
+void stats_set_enabled( int value )
+{
+    enabled = value;
+}
+
+unsigned long long stats_start( void )
+{
+    struct timespec now;
+
+    if( !enabled )
+    {
+        return 0;
+    }
+
+    clock_gettime( CLOCK_MONOTONIC, &now );
+
+    return ( unsigned long long )now.tv_sec * 1000000000ULL
+         + ( unsigned long long )now.tv_nsec + 1;
+}
+
+void stats_record( stats_op_t op, unsigned long long start, unsigned long long bytes )
+{
+    unsigned long long end, nanos;
+
+    if( ( end = stats_start( ) ) == 0 )
+    {
+        return;
+    }
+
+    nanos = end > start ? end - start : 0;
+
+    stats_add( &counters[ op ].t_calls, 1 );
+    stats_add( &counters[ op ].t_bytes, bytes );
+    stats_add( &counters[ op ].t_nanos, nanos );
+    stats_add( &counters[ op ].t_buckets[ stats_bucket( nanos ) ], 1 );
+}
+
+void stats_alloc( stats_type_t type, unsigned long long bytes )
+{
+    stats_add( &memory[ type ].m_objects, 1 );
+    stats_add( &memory[ type ].m_allocs, 1 );
+    stats_peak( &memory[ type ].m_peak, stats_add_fetch( &memory[ type ].m_bytes, bytes ) );
+}
+
+void stats_grow( stats_type_t type, unsigned long long bytes )
+{
+    stats_peak( &memory[ type ].m_peak, stats_add_fetch( &memory[ type ].m_bytes, bytes ) );
+}
+
+void stats_free( stats_type_t type, unsigned long long bytes )
+{
+    stats_sub( &memory[ type ].m_objects, 1 );
+    stats_sub( &memory[ type ].m_bytes, bytes );
+}
+
+void stats_get( stats_op_t op, stats_counter_t *counter )
+{
+    int i;
+
+    counter->t_calls = stats_load( &counters[ op ].t_calls );
+    counter->t_bytes = stats_load( &counters[ op ].t_bytes );
+    counter->t_nanos = stats_load( &counters[ op ].t_nanos );
+
+    for( i = 0; i < STATS_BUCKETS; i++ )
+    {
+        counter->t_buckets[ i ] = stats_load( &counters[ op ].t_buckets[ i ] );
+    }
+}
+
+const char *stats_name( stats_op_t op )
+{
+    return op < STATS_OPS ? op_names[ op ] : "";
+}
+
+void stats_memory( stats_type_t type, stats_memory_t *copy )
+{
+    copy->m_objects = stats_load( &memory[ type ].m_objects );
+    copy->m_bytes = stats_load( &memory[ type ].m_bytes );
+    copy->m_peak = stats_load( &memory[ type ].m_peak );
+    copy->m_allocs = stats_load( &memory[ type ].m_allocs );
+}
+
+const char *stats_type_name( stats_type_t type )
+{
+    return type < STATS_TYPES ? type_names[ type ] : "";
+}
+
+void stats_print( FILE *file )
+{
+    stats_memory_t usage;
+    stats_counter_t counter;
+    char low[ 32 ], high[ 32 ];
+    int op, i;
+
+#ifdef BOOK_NO_STATS
+    fprintf( file, "Statistics were disabled at build time.\n" );
+    return;
+#endif
+
+    fprintf( file, "%-24s %12s %16s %14s %12s\n",
+             "Operation", "Calls", "Bytes", "Total ms", "Mean us" );
+
+    for( op = 0; op < STATS_OPS; op++ )
+    {
+        stats_get( ( stats_op_t )op, &counter );
+
+        if( counter.t_calls == 0 )
+        {
+            continue;
+        }
+
+        fprintf( file, "%-24s %12llu %16llu %14.3f %12.3f\n", op_names[ op ],
+                 counter.t_calls, counter.t_bytes, counter.t_nanos / 1e6,
+                 counter.t_nanos / 1e3 / counter.t_calls );
+
+        for( i = 0; i < STATS_BUCKETS; i++ )
+        {
+            if( counter.t_buckets[ i ] == 0 )
+            {
+                continue;
+            }
+
+            stats_label( low, i == 0 ? 0 : 1ULL << i );
+            stats_label( high, 1ULL << ( i + 1 ) );
+            fprintf( file, "    %6s - %-6s %12llu\n", low,
+                     i == STATS_BUCKETS - 1 ? "" : high, counter.t_buckets[ i ] );
+        }
+    }
+
+    fprintf( file, "\n%-24s %12s %16s %16s %12s\n",
+             "Type", "Live", "Live bytes", "Peak bytes", "Allocations" );
+
+    for( op = 0; op < STATS_TYPES; op++ )
+    {
+        stats_memory( ( stats_type_t )op, &usage );
+        fprintf( file, "%-24s %12llu %16llu %16llu %12llu\n", type_names[ op ],
+                 usage.m_objects, usage.m_bytes, usage.m_peak, usage.m_allocs );
+    }
+}
+
+void stats_reset( void )
+{
+    int op, i;
+
+    for( op = 0; op < STATS_OPS; op++ )
+    {
+        counters[ op ].t_calls = 0;
+        counters[ op ].t_bytes = 0;
+        counters[ op ].t_nanos = 0;
+
+        for( i = 0; i < STATS_BUCKETS; i++ )
+        {
+            counters[ op ].t_buckets[ i ] = 0;
+        }
+    }
+
+    for( op = 0; op < STATS_TYPES; op++ )
+    {
+        memory[ op ].m_allocs = 0;
+        memory[ op ].m_peak = stats_load( &memory[ op ].m_bytes );
+    }
+}